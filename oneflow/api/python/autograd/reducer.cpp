@@ -0,0 +1,46 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <memory>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/autograd/reducer.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+
+namespace py = pybind11;
+
+namespace oneflow {
+
+namespace autograd {
+
+ONEFLOW_API_PYBIND11_MODULE("autograd", m) {
+  py::class_<one::Reducer, std::shared_ptr<one::Reducer>>(m, "Reducer")
+      .def(py::init([](const one::TensorTuple& params, int64_t bucket_cap_bytes,
+                       double grad_scale) {
+             return one::Reducer::New(params, bucket_cap_bytes, grad_scale).GetPtrOrThrow();
+           }),
+           py::arg("params"), py::arg("bucket_cap_bytes"), py::arg("grad_scale") = 1.0)
+      .def("prepare_for_backward", &one::Reducer::PrepareForBackward)
+      .def("finalize_backward", &one::Reducer::FinalizeBackward)
+      .def_property_readonly("bucket_num", &one::Reducer::bucket_num)
+      .def("bucket", &one::Reducer::bucket)
+      .def("bucket_param_indices", &one::Reducer::bucket_param_indices);
+}
+
+}  // namespace autograd
+
+}  // namespace oneflow
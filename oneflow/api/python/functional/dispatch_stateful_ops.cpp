@@ -52,6 +52,7 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       [](const std::shared_ptr<OpExpr>& op, const std::string& data_dir, int32_t data_part_num,
          const std::string& part_name_prefix, int32_t part_name_suffix_length, int32_t batch_size,
          int32_t shuffle_buffer_size, bool random_shuffle, bool shuffle_after_epoch, int64_t seed,
+         bool use_record_index, int64_t start_cursor,
          const Optional<Symbol<Device>>& device) -> Maybe<Tensor> {
         MutableAttrMap attrs;
         JUST(attrs.SetAttr("data_dir", data_dir));
@@ -63,6 +64,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
         JUST(attrs.SetAttr("random_shuffle", random_shuffle));
         JUST(attrs.SetAttr("shuffle_after_epoch", shuffle_after_epoch));
         JUST(attrs.SetAttr("seed", seed));
+        JUST(attrs.SetAttr("use_record_index", use_record_index));
+        JUST(attrs.SetAttr("start_cursor", start_cursor));
         return OpInterpUtil::Dispatch<Tensor>(*op, {}, OpExprInterpContext(attrs, JUST(device)));
       });
   m.add_functor(
@@ -70,7 +73,7 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       [](const std::shared_ptr<OpExpr>& op, const std::string& data_dir, int32_t data_part_num,
          const std::string& part_name_prefix, int32_t part_name_suffix_length, int32_t batch_size,
          int32_t shuffle_buffer_size, bool random_shuffle, bool shuffle_after_epoch, int64_t seed,
-         const Symbol<ParallelDesc>& placement,
+         bool use_record_index, int64_t start_cursor, const Symbol<ParallelDesc>& placement,
          const std::vector<Symbol<SbpParallel>>& sbp_tuple) -> Maybe<Tensor> {
         MutableAttrMap attrs;
         JUST(attrs.SetAttr("data_dir", data_dir));
@@ -82,6 +85,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
         JUST(attrs.SetAttr("random_shuffle", random_shuffle));
         JUST(attrs.SetAttr("shuffle_after_epoch", shuffle_after_epoch));
         JUST(attrs.SetAttr("seed", seed));
+        JUST(attrs.SetAttr("use_record_index", use_record_index));
+        JUST(attrs.SetAttr("start_cursor", start_cursor));
         JUST(attrs.SetAttr("nd_sbp", *JUST(GetNdSbpStrList(sbp_tuple))));
         auto nd_sbp = JUST(GetNdSbp(sbp_tuple));
         return OpInterpUtil::Dispatch<Tensor>(*op, {},
@@ -334,7 +339,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       [](const std::shared_ptr<OpExpr>& op, const std::vector<std::string>& files,
          const int64_t batch_size, const bool random_shuffle, const std::string& shuffle_mode,
          const int32_t shuffle_buffer_size, const bool shuffle_after_epoch, int64_t random_seed,
-         const bool verify_example, const Optional<Symbol<Device>>& device) -> Maybe<Tensor> {
+         const bool verify_example, const bool use_record_index, const int64_t start_cursor,
+         const Optional<Symbol<Device>>& device) -> Maybe<Tensor> {
         MutableAttrMap attrs;
         JUST(attrs.SetAttr<std::vector<std::string>>("files", files));
         JUST(attrs.SetAttr<int64_t>("batch_size", batch_size));
@@ -344,6 +350,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
         JUST(attrs.SetAttr<bool>("shuffle_after_epoch", shuffle_after_epoch));
         JUST(attrs.SetAttr<int64_t>("seed", random_seed));
         JUST(attrs.SetAttr<bool>("verify_example", verify_example));
+        JUST(attrs.SetAttr<bool>("use_record_index", use_record_index));
+        JUST(attrs.SetAttr<int64_t>("start_cursor", start_cursor));
         return OpInterpUtil::Dispatch<Tensor>(*op, {}, OpExprInterpContext(attrs, JUST(device)));
       });
   m.add_functor(
@@ -351,7 +359,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
       [](const std::shared_ptr<OpExpr>& op, const std::vector<std::string>& files,
          const int64_t batch_size, const bool random_shuffle, const std::string& shuffle_mode,
          const int32_t shuffle_buffer_size, const bool shuffle_after_epoch, int64_t random_seed,
-         const bool verify_example, const Symbol<ParallelDesc>& placement,
+         const bool verify_example, const bool use_record_index, const int64_t start_cursor,
+         const Symbol<ParallelDesc>& placement,
          const std::vector<Symbol<SbpParallel>>& sbp_tuple) -> Maybe<Tensor> {
         MutableAttrMap attrs;
         JUST(attrs.SetAttr<std::vector<std::string>>("files", files));
@@ -362,6 +371,8 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
         JUST(attrs.SetAttr<bool>("shuffle_after_epoch", shuffle_after_epoch));
         JUST(attrs.SetAttr<int64_t>("seed", random_seed));
         JUST(attrs.SetAttr<bool>("verify_example", verify_example));
+        JUST(attrs.SetAttr<bool>("use_record_index", use_record_index));
+        JUST(attrs.SetAttr<int64_t>("start_cursor", start_cursor));
         JUST(attrs.SetAttr("nd_sbp", *JUST(GetNdSbpStrList(sbp_tuple))));
         auto nd_sbp = JUST(GetNdSbp(sbp_tuple));
         return OpInterpUtil::Dispatch<Tensor>(*op, {},
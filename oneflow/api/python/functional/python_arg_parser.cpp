@@ -21,11 +21,72 @@ namespace oneflow {
 namespace one {
 namespace functional {
 
-void FunctionSchema::ReportKwargsError(PyObject* kwargs, size_t nargs) const {
-  PyObject *key = nullptr, *value = nullptr;
-  Py_ssize_t pos = 0;
+PythonArguments::PythonArguments(PyObject* args, PyObject* kwargs)
+    : args_(args ? PySequence_Fast_ITEMS(args) : nullptr),
+      nargs_(args ? PyTuple_Size(args) : 0),
+      kwargs_(kwargs),
+      kwnames_(nullptr),
+      args_tuple_(py::reinterpret_borrow<py::object>(args)) {}
 
-  while (PyDict_Next(kwargs, &pos, &key, &value)) {
+PythonArguments::PythonArguments(PyObject* const* args, size_t nargs, PyObject* kwnames)
+    : args_(args), nargs_(nargs), kwargs_(nullptr), kwnames_(kwnames) {}
+
+size_t PythonArguments::nkwargs() const {
+  if (kwargs_) { return PyDict_Size(kwargs_); }
+  return kwnames_ ? PyTuple_GET_SIZE(kwnames_) : 0;
+}
+
+PyObject* PythonArguments::kwarg(PyObject* name) const {
+  // the hash of an interned name is cached, and a dict compares the keys by identity first
+  if (kwargs_) { return PyDict_GetItem(kwargs_, name); }
+  if (!kwnames_) { return NULL; }
+  // the keyword names of a call site are interned by the compiler as well
+  const Py_ssize_t size = PyTuple_GET_SIZE(kwnames_);
+  for (Py_ssize_t i = 0; i < size; ++i) {
+    if (PyTuple_GET_ITEM(kwnames_, i) == name) { return args_[nargs_ + i]; }
+  }
+  for (Py_ssize_t i = 0; i < size; ++i) {
+    if (PyUnicode_Compare(PyTuple_GET_ITEM(kwnames_, i), name) == 0) { return args_[nargs_ + i]; }
+  }
+  return NULL;
+}
+
+std::vector<PyObject*> PythonArguments::kwarg_names() const {
+  std::vector<PyObject*> names;
+  if (kwargs_) {
+    PyObject *key = nullptr, *value = nullptr;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(kwargs_, &pos, &key, &value)) { names.emplace_back(key); }
+  } else if (kwnames_) {
+    for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(kwnames_); ++i) {
+      names.emplace_back(PyTuple_GET_ITEM(kwnames_, i));
+    }
+  }
+  return names;
+}
+
+PyObject* PythonArguments::args_tuple() const {
+  if (!args_tuple_) {
+    args_tuple_ = py::reinterpret_steal<py::object>(PyTuple_New(nargs_));
+    for (size_t i = 0; i < nargs_; ++i) {
+      Py_INCREF(args_[i]);
+      PyTuple_SET_ITEM(args_tuple_.ptr(), i, args_[i]);
+    }
+  }
+  return args_tuple_.ptr();
+}
+
+FunctionSchema::FunctionSchema(const std::string& signature, const FunctionDef* def,
+                               size_t max_pos_nargs)
+    : signature_(signature), def_(def), max_pos_nargs_(max_pos_nargs) {
+  // the names live as long as the schemas, which are static
+  for (const auto& arg : def_->argument_def) {
+    arg_names_.emplace_back(PyUnicode_InternFromString(arg.name.c_str()));
+  }
+}
+
+void FunctionSchema::ReportKwargsError(const PythonArguments& args) const {
+  for (PyObject* key : args.kwarg_names()) {
     if (!PyStringCheck(key)) { THROW(TypeError) << def_->name << "(): keywords must be strings"; }
     int64_t index = -1;
     const std::string string_key = PyStringAsString(key);
@@ -40,7 +101,7 @@ void FunctionSchema::ReportKwargsError(PyObject* kwargs, size_t nargs) const {
       THROW(TypeError) << def_->name << "(): got an unexpected keyword argument '" << string_key
                        << "'";
     }
-    if (index < nargs) {
+    if (index < args.nargs()) {
       THROW(TypeError) << def_->name << "(): got multiple values for argument '" << string_key
                        << "'";
     }
@@ -49,11 +110,11 @@ void FunctionSchema::ReportKwargsError(PyObject* kwargs, size_t nargs) const {
 }
 
 // The argument parsing refers to the implementation of Pytorch.
-bool FunctionSchema::Parse(PyObject* args, PyObject* kwargs, PythonArg* parsed_args,
+bool FunctionSchema::Parse(const PythonArguments& args, PythonArg* parsed_args,
                            bool raise_exception) const {
   bool treat_args_as_list = false;
-  size_t nargs = args ? PyTuple_Size(args) : 0;
-  size_t remaining_kwargs = kwargs ? PyDict_Size(kwargs) : 0;
+  size_t nargs = args.nargs();
+  size_t remaining_kwargs = args.nkwargs();
 
   if (max_pos_nargs_ == 1) {
     const auto& type = def_->argument_def.at(0).type;
@@ -70,23 +131,23 @@ bool FunctionSchema::Parse(PyObject* args, PyObject* kwargs, PythonArg* parsed_a
   for (int i = 0; i < def_->argument_def.size(); ++i) {
     const auto& param = def_->argument_def.at(i);
     PyObject* obj = NULL;
-    if (args && arg_pos < nargs) {
+    if (arg_pos < nargs) {
       if (param.keyword_only) {
         if (raise_exception) {
           THROW(TypeError) << def_->name << "(): argument '" << param.name << "' is keyword only";
         }
         return false;
       }
-      obj = PyTuple_GetItem(args, arg_pos);
-    } else if (kwargs) {
-      obj = PyDict_GetItemString(kwargs, param.name.c_str());
+      obj = args.arg(arg_pos);
+    } else if (remaining_kwargs > 0) {
+      obj = args.kwarg(arg_names_.at(i));
       if (obj) { remaining_kwargs--; }
     }
 
     if (obj) {
       if (arg_pos == 0 && treat_args_as_list && !param.keyword_only
           && (PyLong_Check(obj) || PyTensor_Check(obj))) {
-        obj = args;
+        obj = args.args_tuple();
         arg_pos = nargs;
       } else {
         arg_pos++;
@@ -113,7 +174,7 @@ bool FunctionSchema::Parse(PyObject* args, PyObject* kwargs, PythonArg* parsed_a
     }
   }
   if (remaining_kwargs > 0) {
-    if (raise_exception) { ReportKwargsError(kwargs, nargs); }
+    if (raise_exception) { ReportKwargsError(args); }
     return false;
   }
   return true;
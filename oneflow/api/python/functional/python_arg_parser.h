@@ -39,22 +39,50 @@ class ParsedArgs {
   PythonArg data[N];
 };
 
+// The arguments of a call, either a tuple of the positional arguments and a dict of the keyword
+// arguments, or in the vectorcall layout an array of the positional arguments followed by the
+// values of the keyword arguments, whose names are in a tuple.
+class PythonArguments {
+ public:
+  PythonArguments(PyObject* args, PyObject* kwargs);
+  PythonArguments(PyObject* const* args, size_t nargs, PyObject* kwnames);
+
+  size_t nargs() const { return nargs_; }
+  size_t nkwargs() const;
+  PyObject* arg(size_t i) const { return args_[i]; }
+
+  // The value of the keyword argument `name`, an interned string, or NULL if it is not given.
+  PyObject* kwarg(PyObject* name) const;
+  std::vector<PyObject*> kwarg_names() const;
+
+  // The positional arguments as a tuple, which is only created for the vectorcall layout.
+  PyObject* args_tuple() const;
+
+ private:
+  PyObject* const* args_;
+  size_t nargs_;
+  PyObject* kwargs_;
+  PyObject* kwnames_;
+  mutable py::object args_tuple_;
+};
+
 class FunctionSchema {
  public:
   FunctionSchema() = default;
-  FunctionSchema(const std::string& signature, const FunctionDef* def, size_t max_pos_nargs)
-      : signature_(signature), def_(def), max_pos_nargs_(max_pos_nargs) {}
+  FunctionSchema(const std::string& signature, const FunctionDef* def, size_t max_pos_nargs);
 
   const std::string& signature() const { return signature_; }
 
-  bool Parse(PyObject* args, PyObject* kwargs, PythonArg* parsed_args, bool raise_exception) const;
+  bool Parse(const PythonArguments& args, PythonArg* parsed_args, bool raise_exception) const;
 
  private:
-  void ReportKwargsError(PyObject* kwargs, size_t nargs) const;
+  void ReportKwargsError(const PythonArguments& args) const;
 
   std::string signature_;
   const FunctionDef* def_;
   size_t max_pos_nargs_;
+  // the interned argument names, keyword arguments are looked up by them
+  std::vector<PyObject*> arg_names_;
 };
 
 template<typename... SchemaT>
@@ -72,11 +100,16 @@ class PythonArgParser {
   }
 
   int Parse(PyObject* args, PyObject* kwargs, ParsedArgs<N>* parsed_args) const {
+    return Parse(PythonArguments(args, kwargs), parsed_args);
+  }
+
+  // The parsed arguments may refer to the tuple `args` creates, so they shouldn't outlive it.
+  int Parse(const PythonArguments& args, ParsedArgs<N>* parsed_args) const {
     bool raise_exception = (kSchemaSize == 1);
     for (int i = 0; i < kSchemaSize; ++i) {
-      if (schema_[i].Parse(args, kwargs, parsed_args->data, raise_exception)) { return i; }
+      if (schema_[i].Parse(args, parsed_args->data, raise_exception)) { return i; }
     }
-    ReportInvalidArgsError(args, kwargs);
+    ReportInvalidArgsError();
     return -1;
   }
 
@@ -89,7 +122,7 @@ class PythonArgParser {
          0)...};
   }
 
-  void ReportInvalidArgsError(PyObject* args, PyObject* kwargs) const {
+  void ReportInvalidArgsError() const {
     std::ostringstream ss;
     ss << name_ << "(): received an invalid combination of arguments. The valid signatures are:";
     for (int i = 0; i < kSchemaSize; ++i) { ss << "\n\t*" << i << ": " << schema_[i].signature(); }
@@ -105,4 +138,15 @@ class PythonArgParser {
 }  // namespace one
 }  // namespace oneflow
 
+// The method def of a functional API taking `func(self, args, kwargs)`, or the vectorcall
+// `fastcall_func(self, args, nargs, kwnames)` where supported, which skips building a tuple and a
+// dict of the arguments.
+#if PY_VERSION_HEX >= 0x03070000
+#define ONEFLOW_FUNCTIONAL_METHOD_DEF(name, func, fastcall_func) \
+  { name, (PyCFunction)(fastcall_func), METH_FASTCALL | METH_KEYWORDS, NULL }
+#else
+#define ONEFLOW_FUNCTIONAL_METHOD_DEF(name, func, fastcall_func) \
+  { name, (PyCFunction)(func), METH_VARARGS | METH_KEYWORDS, NULL }
+#endif
+
 #endif  // ONEFLOW_API_PYTHON_FUNCTIONAL_PYTHON_ARG_PARSER_H_
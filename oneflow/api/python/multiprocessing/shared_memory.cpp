@@ -17,6 +17,7 @@ limitations under the License.
 #include <pybind11/stl.h>
 #include "oneflow/api/python/of_api_registry.h"
 #include "oneflow/core/ipc/shared_memory.h"
+#include "oneflow/core/ipc/shared_memory_pool.h"
 
 namespace oneflow {
 
@@ -37,8 +38,30 @@ ONEFLOW_API_PYBIND11_MODULE("multiprocessing", m) {
                              })
       .def_property_readonly("name", &ipc::SharedMemory::name)
       .def_property_readonly("size", &ipc::SharedMemory::size);
-  m.def("unlink_all_shared_memory",
-        []() { return ipc::SharedMemoryManager::get().UnlinkAllShms(); });
+  m.def("unlink_all_shared_memory", []() {
+    ipc::SharedMemoryPool::get().UnlinkAll().GetOrThrow();
+    return ipc::SharedMemoryManager::get().UnlinkAllShms();
+  });
+  m.attr("pooled_shared_memory_header_size") = ipc::SharedMemoryPool::kHeaderSize;
+  m.def("acquire_pooled_shared_memory", [](size_t size) {
+    return ipc::SharedMemoryPool::get().Acquire(size).GetPtrOrThrow();
+  });
+  m.def("attach_pooled_shared_memory", [](const std::string& name) {
+    return ipc::SharedMemoryPool::get().Attach(name).GetPtrOrThrow();
+  });
+  m.def("release_pooled_shared_memory", [](const std::string& name) {
+    return ipc::SharedMemoryPool::get().Release(name).GetOrThrow();
+  });
+  m.def("pooled_shared_memory_stats", []() {
+    const ipc::SharedMemoryPoolStats stats = ipc::SharedMemoryPool::get().stats();
+    py::dict dict;
+    dict["acquire_cnt"] = stats.acquire_cnt;
+    dict["create_cnt"] = stats.create_cnt;
+    dict["evict_cnt"] = stats.evict_cnt;
+    dict["segment_num"] = stats.segment_num;
+    dict["segment_bytes"] = stats.segment_bytes;
+    return dict;
+  });
 }
 
 }  // namespace oneflow
@@ -0,0 +1,322 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/auto_parallel/sbp_graph.h"
+#include <numeric>
+#include "oneflow/core/common/data_type.h"
+
+namespace oneflow {
+
+namespace {
+
+// the remaining nodes are enumerated if they have at most so many combinations of choices
+constexpr int64_t kMaxEnumeratedCombinationNum = 1 << 16;
+constexpr int32_t kMaxImprovementRoundNum = 64;
+
+// The graph being reduced by Search, the edges are oriented from the smaller node id.
+class ReducibleGraph final {
+ public:
+  struct Edge {
+    int32_t src;
+    int32_t dst;
+    std::vector<double> cost;
+  };
+  // The best choice of an eliminated node for each choice of its neighbors.
+  struct Elimination {
+    int32_t node;
+    int32_t first;
+    // -1 for a leaf
+    int32_t second;
+    std::vector<int32_t> best_choices;
+  };
+
+  explicit ReducibleGraph(const std::vector<std::vector<double>>& node_costs)
+      : node_costs_(node_costs), adjacency_(node_costs.size()), alive_(node_costs.size(), true) {}
+
+  int32_t candidate_num(int32_t node) const { return node_costs_.at(node).size(); }
+
+  double EdgeCost(const Edge& edge, int32_t node, int32_t choice, int32_t neighbor_choice) const {
+    if (edge.src == node) { return edge.cost[choice * candidate_num(edge.dst) + neighbor_choice]; }
+    return edge.cost[neighbor_choice * candidate_num(edge.dst) + choice];
+  }
+
+  // Adds Cost(choice of u, choice of v) to the edge between u and v.
+  template<typename CostFn>
+  void AddEdgeCost(int32_t u, int32_t v, const CostFn& Cost) {
+    const int32_t src = std::min(u, v);
+    const int32_t dst = std::max(u, v);
+    auto it = adjacency_.at(src).find(dst);
+    if (it == adjacency_.at(src).end()) {
+      edges_.emplace_back(
+          Edge{src, dst, std::vector<double>(candidate_num(src) * candidate_num(dst))});
+      it = adjacency_.at(src).emplace(dst, edges_.size() - 1).first;
+      adjacency_.at(dst).emplace(src, edges_.size() - 1);
+    }
+    Edge& edge = edges_.at(it->second);
+    for (int32_t i = 0; i < candidate_num(src); ++i) {
+      for (int32_t j = 0; j < candidate_num(dst); ++j) {
+        edge.cost[i * candidate_num(dst) + j] += src == u ? Cost(i, j) : Cost(j, i);
+      }
+    }
+  }
+
+  void Reduce() {
+    std::vector<int32_t> worklist(node_costs_.size());
+    std::iota(worklist.begin(), worklist.end(), 0);
+    while (!worklist.empty()) {
+      const int32_t node = worklist.back();
+      worklist.pop_back();
+      if (!alive_.at(node)) { continue; }
+      const auto& neighbors = adjacency_.at(node);
+      if (neighbors.size() == 1) {
+        const int32_t first = neighbors.begin()->first;
+        EliminateLeaf(node);
+        worklist.emplace_back(first);
+      } else if (neighbors.size() == 2) {
+        const int32_t first = neighbors.begin()->first;
+        const int32_t second = std::next(neighbors.begin())->first;
+        EliminateSeries(node);
+        worklist.emplace_back(first);
+        worklist.emplace_back(second);
+      }
+    }
+  }
+
+  // The cost of `node` choosing `choice` with its neighbors choosing `choices`.
+  double LocalCost(int32_t node, int32_t choice, const std::vector<int32_t>& choices) const {
+    double cost = node_costs_.at(node).at(choice);
+    for (const auto& pair : adjacency_.at(node)) {
+      cost += EdgeCost(edges_.at(pair.second), node, choice, choices.at(pair.first));
+    }
+    return cost;
+  }
+
+  double RemainingCost(const std::vector<int32_t>& choices) const {
+    double cost = 0;
+    for (int32_t node = 0; node < node_costs_.size(); ++node) {
+      if (!alive_.at(node)) { continue; }
+      cost += node_costs_.at(node).at(choices.at(node));
+      for (const auto& pair : adjacency_.at(node)) {
+        if (pair.first < node) { continue; }
+        cost += EdgeCost(edges_.at(pair.second), node, choices.at(node), choices.at(pair.first));
+      }
+    }
+    return cost;
+  }
+
+  std::vector<int32_t> RemainingNodes() const {
+    std::vector<int32_t> nodes;
+    for (int32_t node = 0; node < alive_.size(); ++node) {
+      if (alive_.at(node)) { nodes.emplace_back(node); }
+    }
+    return nodes;
+  }
+
+  // Decides the eliminated nodes from the choices of the remaining ones.
+  void Restore(std::vector<int32_t>* choices) const {
+    for (auto it = eliminations_.rbegin(); it != eliminations_.rend(); ++it) {
+      int32_t index = choices->at(it->first);
+      if (it->second >= 0) { index = index * candidate_num(it->second) + choices->at(it->second); }
+      choices->at(it->node) = it->best_choices.at(index);
+    }
+  }
+
+  int32_t leaf_elimination_num() const { return leaf_elimination_num_; }
+  int32_t series_elimination_num() const { return eliminations_.size() - leaf_elimination_num_; }
+
+ private:
+  void Detach(int32_t node) {
+    for (const auto& pair : adjacency_.at(node)) { adjacency_.at(pair.first).erase(node); }
+    adjacency_.at(node).clear();
+    alive_.at(node) = false;
+  }
+
+  void EliminateLeaf(int32_t node) {
+    const auto& pair = *adjacency_.at(node).begin();
+    const int32_t neighbor = pair.first;
+    const Edge& edge = edges_.at(pair.second);
+    Elimination elimination{node, neighbor, -1, std::vector<int32_t>(candidate_num(neighbor))};
+    for (int32_t j = 0; j < candidate_num(neighbor); ++j) {
+      double min_cost = GetMaxVal<double>();
+      for (int32_t i = 0; i < candidate_num(node); ++i) {
+        const double cost = node_costs_.at(node).at(i) + EdgeCost(edge, node, i, j);
+        if (cost < min_cost) {
+          min_cost = cost;
+          elimination.best_choices.at(j) = i;
+        }
+      }
+      node_costs_.at(neighbor).at(j) += min_cost;
+    }
+    Detach(node);
+    eliminations_.emplace_back(std::move(elimination));
+    leaf_elimination_num_ += 1;
+  }
+
+  void EliminateSeries(int32_t node) {
+    auto it = adjacency_.at(node).begin();
+    const int32_t first = it->first;
+    const Edge& first_edge = edges_.at(it->second);
+    ++it;
+    const int32_t second = it->first;
+    const Edge& second_edge = edges_.at(it->second);
+    const int32_t second_num = candidate_num(second);
+    Elimination elimination{node, first, second,
+                            std::vector<int32_t>(candidate_num(first) * second_num)};
+    std::vector<double> min_costs(elimination.best_choices.size(), GetMaxVal<double>());
+    for (int32_t j = 0; j < candidate_num(first); ++j) {
+      for (int32_t k = 0; k < second_num; ++k) {
+        for (int32_t i = 0; i < candidate_num(node); ++i) {
+          const double cost = node_costs_.at(node).at(i) + EdgeCost(first_edge, node, i, j)
+                              + EdgeCost(second_edge, node, i, k);
+          if (cost < min_costs.at(j * second_num + k)) {
+            min_costs.at(j * second_num + k) = cost;
+            elimination.best_choices.at(j * second_num + k) = i;
+          }
+        }
+      }
+    }
+    Detach(node);
+    AddEdgeCost(first, second,
+                [&](int32_t j, int32_t k) { return min_costs.at(j * second_num + k); });
+    eliminations_.emplace_back(std::move(elimination));
+  }
+
+  std::vector<std::vector<double>> node_costs_;
+  // neighbor -> index in edges_
+  std::vector<std::map<int32_t, int32_t>> adjacency_;
+  std::vector<bool> alive_;
+  std::vector<Edge> edges_;
+  std::vector<Elimination> eliminations_;
+  int32_t leaf_elimination_num_ = 0;
+};
+
+void Enumerate(const ReducibleGraph& graph, const std::vector<int32_t>& nodes,
+               std::vector<int32_t>* choices) {
+  std::vector<int32_t> current(*choices);
+  for (int32_t node : nodes) { current.at(node) = 0; }
+  double min_cost = graph.RemainingCost(*choices);
+  while (true) {
+    const double cost = graph.RemainingCost(current);
+    if (cost < min_cost) {
+      min_cost = cost;
+      *choices = current;
+    }
+    // the next combination in mixed radix
+    size_t i = 0;
+    for (; i < nodes.size(); ++i) {
+      int32_t& choice = current.at(nodes.at(i));
+      if (++choice < graph.candidate_num(nodes.at(i))) { break; }
+      choice = 0;
+    }
+    if (i == nodes.size()) { break; }
+  }
+}
+
+void Improve(const ReducibleGraph& graph, const std::vector<int32_t>& nodes,
+             std::vector<int32_t>* choices) {
+  for (int32_t round = 0; round < kMaxImprovementRoundNum; ++round) {
+    bool changed = false;
+    for (int32_t node : nodes) {
+      int32_t& choice = choices->at(node);
+      double min_cost = graph.LocalCost(node, choice, *choices);
+      for (int32_t i = 0; i < graph.candidate_num(node); ++i) {
+        const double cost = graph.LocalCost(node, i, *choices);
+        if (cost < min_cost) {
+          min_cost = cost;
+          choice = i;
+          changed = true;
+        }
+      }
+    }
+    if (!changed) { break; }
+  }
+}
+
+}  // namespace
+
+int32_t SbpGraph::AddNode(const std::vector<double>& candidate_costs) {
+  CHECK(!candidate_costs.empty());
+  node_costs_.emplace_back(candidate_costs);
+  return node_costs_.size() - 1;
+}
+
+void SbpGraph::AddEdgeCost(int32_t src, int32_t dst, const std::vector<double>& cost) {
+  CHECK_NE(src, dst);
+  const int32_t src_num = candidate_num(src);
+  const int32_t dst_num = candidate_num(dst);
+  CHECK_EQ(cost.size(), src_num * dst_num);
+  const auto key = std::make_pair(std::min(src, dst), std::max(src, dst));
+  auto it = node_pair2edge_id_.find(key);
+  if (it == node_pair2edge_id_.end()) {
+    edges_.emplace_back(Edge{key.first, key.second, std::vector<double>(cost.size())});
+    it = node_pair2edge_id_.emplace(key, edges_.size() - 1).first;
+  }
+  Edge& edge = edges_.at(it->second);
+  for (int32_t i = 0; i < src_num; ++i) {
+    for (int32_t j = 0; j < dst_num; ++j) {
+      if (edge.src == src) {
+        edge.cost.at(i * dst_num + j) += cost.at(i * dst_num + j);
+      } else {
+        edge.cost.at(j * src_num + i) += cost.at(i * dst_num + j);
+      }
+    }
+  }
+}
+
+double SbpGraph::Cost(const std::vector<int32_t>& choices) const {
+  CHECK_EQ(choices.size(), node_num());
+  double cost = 0;
+  for (int32_t node = 0; node < node_num(); ++node) {
+    cost += node_costs_.at(node).at(choices.at(node));
+  }
+  for (const Edge& edge : edges_) {
+    cost += edge.cost.at(choices.at(edge.src) * candidate_num(edge.dst) + choices.at(edge.dst));
+  }
+  return cost;
+}
+
+void SbpGraph::Search(const std::vector<int32_t>& init_choices, std::vector<int32_t>* choices,
+                      SbpGraphSearchStats* stats) const {
+  CHECK_EQ(init_choices.size(), node_num());
+  ReducibleGraph graph(node_costs_);
+  for (const Edge& edge : edges_) {
+    const int32_t dst_num = candidate_num(edge.dst);
+    graph.AddEdgeCost(edge.src, edge.dst,
+                      [&](int32_t i, int32_t j) { return edge.cost.at(i * dst_num + j); });
+  }
+  graph.Reduce();
+  *choices = init_choices;
+  const std::vector<int32_t> remaining_nodes = graph.RemainingNodes();
+  int64_t combination_num = 1;
+  for (int32_t node : remaining_nodes) {
+    combination_num *= graph.candidate_num(node);
+    if (combination_num > kMaxEnumeratedCombinationNum) { break; }
+  }
+  const bool exhaustive = combination_num <= kMaxEnumeratedCombinationNum;
+  if (exhaustive) {
+    Enumerate(graph, remaining_nodes, choices);
+  } else {
+    Improve(graph, remaining_nodes, choices);
+  }
+  graph.Restore(choices);
+  if (stats != nullptr) {
+    stats->leaf_elimination_num = graph.leaf_elimination_num();
+    stats->series_elimination_num = graph.series_elimination_num();
+    stats->remaining_node_num = remaining_nodes.size();
+    stats->exhaustive = exhaustive;
+  }
+}
+
+}  // namespace oneflow
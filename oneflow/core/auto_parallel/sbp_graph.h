@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_AUTO_PARALLEL_SBP_GRAPH_H_
+#define ONEFLOW_CORE_AUTO_PARALLEL_SBP_GRAPH_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+struct SbpGraphSearchStats {
+  // nodes eliminated into a neighbor with degree 1
+  int32_t leaf_elimination_num = 0;
+  // nodes with degree 2 eliminated into an edge between their neighbors
+  int32_t series_elimination_num = 0;
+  // nodes left after the eliminations
+  int32_t remaining_node_num = 0;
+  // whether the choices of the remaining nodes were enumerated rather than improved greedily
+  bool exhaustive = false;
+};
+
+// An undirected graph in which each node picks one of its candidates, e.g. the sbp signatures of
+// an op. A node costs what its choice costs, an edge costs what the choices of its two ends cost
+// together, e.g. the boxing between a producer and a consumer.
+//
+// The search eliminates the nodes of degree 1 into their neighbor and the nodes of degree 2 into
+// an edge between their neighbors, each time keeping the best choice of the eliminated node for
+// every choice of its neighbors, which is exact on trees and series-parallel graphs. The choices
+// of the nodes left are enumerated if there are few of them, otherwise improved one node at a
+// time from `init_choices`, so the result never costs more than `init_choices`.
+class SbpGraph final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SbpGraph);
+  SbpGraph() = default;
+  ~SbpGraph() = default;
+
+  // Adds a node with the cost of each of its candidates and returns its id.
+  int32_t AddNode(const std::vector<double>& candidate_costs);
+  // Adds cost[i * m + j] to the edge between `src` choosing i and `dst` choosing j, m being the
+  // candidate number of `dst`. Costs added between the same nodes accumulate.
+  void AddEdgeCost(int32_t src, int32_t dst, const std::vector<double>& cost);
+
+  int32_t node_num() const { return node_costs_.size(); }
+  int32_t candidate_num(int32_t node) const { return node_costs_.at(node).size(); }
+
+  // Total cost of the nodes and the edges for the given choices.
+  double Cost(const std::vector<int32_t>& choices) const;
+  void Search(const std::vector<int32_t>& init_choices, std::vector<int32_t>* choices,
+              SbpGraphSearchStats* stats) const;
+
+ private:
+  struct Edge {
+    int32_t src;
+    int32_t dst;
+    // cost[i * candidate_num(dst) + j]
+    std::vector<double> cost;
+  };
+
+  std::vector<std::vector<double>> node_costs_;
+  std::vector<Edge> edges_;
+  // (src, dst) with src < dst -> index in edges_
+  std::map<std::pair<int32_t, int32_t>, int32_t> node_pair2edge_id_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_AUTO_PARALLEL_SBP_GRAPH_H_
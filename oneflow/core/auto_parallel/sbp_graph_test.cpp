@@ -0,0 +1,133 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/auto_parallel/sbp_graph.h"
+
+namespace oneflow {
+
+namespace {
+
+void AddRandomNodes(int32_t node_num, std::mt19937* gen, SbpGraph* graph) {
+  std::uniform_int_distribution<int32_t> candidate_num(1, 4);
+  std::uniform_real_distribution<double> cost(0, 10);
+  for (int32_t i = 0; i < node_num; ++i) {
+    std::vector<double> costs(candidate_num(*gen));
+    for (double& c : costs) { c = cost(*gen); }
+    graph->AddNode(costs);
+  }
+}
+
+void AddRandomEdge(int32_t src, int32_t dst, std::mt19937* gen, SbpGraph* graph) {
+  std::uniform_real_distribution<double> cost(0, 20);
+  std::vector<double> costs(graph->candidate_num(src) * graph->candidate_num(dst));
+  for (double& c : costs) { c = cost(*gen); }
+  graph->AddEdgeCost(src, dst, costs);
+}
+
+double BruteForceMinCost(const SbpGraph& graph) {
+  std::vector<int32_t> choices(graph.node_num(), 0);
+  double min_cost = graph.Cost(choices);
+  while (true) {
+    int32_t i = 0;
+    for (; i < graph.node_num(); ++i) {
+      if (++choices.at(i) < graph.candidate_num(i)) { break; }
+      choices.at(i) = 0;
+    }
+    if (i == graph.node_num()) { break; }
+    min_cost = std::min(min_cost, graph.Cost(choices));
+  }
+  return min_cost;
+}
+
+double SearchCost(const SbpGraph& graph, SbpGraphSearchStats* stats) {
+  std::vector<int32_t> choices;
+  graph.Search(std::vector<int32_t>(graph.node_num(), 0), &choices, stats);
+  return graph.Cost(choices);
+}
+
+}  // namespace
+
+TEST(SbpGraph, tree) {
+  std::mt19937 gen(1);
+  for (int32_t t = 0; t < 20; ++t) {
+    SbpGraph graph;
+    AddRandomNodes(9, &gen, &graph);
+    for (int32_t i = 1; i < graph.node_num(); ++i) {
+      AddRandomEdge(std::uniform_int_distribution<int32_t>(0, i - 1)(gen), i, &gen, &graph);
+    }
+    SbpGraphSearchStats stats;
+    ASSERT_NEAR(SearchCost(graph, &stats), BruteForceMinCost(graph), 1e-9);
+    ASSERT_LE(stats.remaining_node_num, 1);
+  }
+}
+
+TEST(SbpGraph, series_parallel) {
+  // a diamond of chains with a skip edge and parallel edges, reduced by the eliminations alone
+  std::mt19937 gen(2);
+  for (int32_t t = 0; t < 20; ++t) {
+    SbpGraph graph;
+    AddRandomNodes(8, &gen, &graph);
+    const std::vector<std::pair<int32_t, int32_t>> edges{{0, 1}, {1, 2}, {2, 7}, {0, 3},
+                                                         {3, 4}, {4, 7}, {0, 5}, {5, 6},
+                                                         {6, 7}, {0, 7}, {3, 4}};
+    for (const auto& edge : edges) { AddRandomEdge(edge.first, edge.second, &gen, &graph); }
+    SbpGraphSearchStats stats;
+    ASSERT_NEAR(SearchCost(graph, &stats), BruteForceMinCost(graph), 1e-9);
+    ASSERT_LE(stats.remaining_node_num, 1);
+  }
+}
+
+TEST(SbpGraph, irreducible) {
+  std::mt19937 gen(3);
+  for (int32_t t = 0; t < 20; ++t) {
+    SbpGraph graph;
+    AddRandomNodes(8, &gen, &graph);
+    // K4 on the first nodes with a tail on the other ones
+    for (int32_t i = 0; i < 4; ++i) {
+      for (int32_t j = i + 1; j < 4; ++j) { AddRandomEdge(i, j, &gen, &graph); }
+    }
+    for (int32_t i = 4; i < graph.node_num(); ++i) { AddRandomEdge(i - 1, i, &gen, &graph); }
+    SbpGraphSearchStats stats;
+    ASSERT_NEAR(SearchCost(graph, &stats), BruteForceMinCost(graph), 1e-9);
+    ASSERT_EQ(stats.remaining_node_num, 4);
+    ASSERT_TRUE(stats.exhaustive);
+  }
+}
+
+TEST(SbpGraph, improve_from_init_choices) {
+  // a grid too large to enumerate
+  constexpr int32_t kSide = 12;
+  std::mt19937 gen(4);
+  SbpGraph graph;
+  AddRandomNodes(kSide * kSide, &gen, &graph);
+  for (int32_t r = 0; r < kSide; ++r) {
+    for (int32_t c = 0; c < kSide; ++c) {
+      if (c + 1 < kSide) { AddRandomEdge(r * kSide + c, r * kSide + c + 1, &gen, &graph); }
+      if (r + 1 < kSide) { AddRandomEdge(r * kSide + c, (r + 1) * kSide + c, &gen, &graph); }
+    }
+  }
+  std::vector<int32_t> init_choices(graph.node_num());
+  for (int32_t i = 0; i < graph.node_num(); ++i) {
+    init_choices.at(i) = std::uniform_int_distribution<int32_t>(0, graph.candidate_num(i) - 1)(gen);
+  }
+  std::vector<int32_t> choices;
+  SbpGraphSearchStats stats;
+  graph.Search(init_choices, &choices, &stats);
+  ASSERT_FALSE(stats.exhaustive);
+  ASSERT_LT(graph.Cost(choices), graph.Cost(init_choices));
+}
+
+}  // namespace oneflow
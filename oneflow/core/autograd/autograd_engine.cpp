@@ -16,7 +16,6 @@ limitations under the License.
 
 #include <memory>
 #include <stack>
-#include <queue>
 #include "oneflow/core/autograd/autograd_engine.h"
 #include "oneflow/core/autograd/autograd_meta.h"
 #include "oneflow/core/framework/tensor.h"
@@ -27,14 +26,133 @@ limitations under the License.
 #include "oneflow/core/functional/functional.h"
 #include "oneflow/core/framework/nd_sbp.h"
 #include "oneflow/core/framework/global_param_grad_sync_mode.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/core/common/container_util.h"
+#include "oneflow/core/common/env_var/env_var.h"
+#include "oneflow/core/thread/thread_pool.h"
 #include "oneflow/core/profiler/profiler.h"
 
 namespace oneflow {
+
+// Max number of backward plans cached per thread, 0 disables the cache.
+DEFINE_ENV_INTEGER(ONEFLOW_AUTOGRAD_PLAN_CACHE_SIZE, 16);
+// Applies independent branches of the backward graph on a thread pool.
+DEFINE_ENV_BOOL(ONEFLOW_AUTOGRAD_ENABLE_CONCURRENT_BRANCHES, false);
+DEFINE_ENV_INTEGER(ONEFLOW_AUTOGRAD_BRANCH_THREAD_NUM, 4);
+
 namespace one {
 
+struct BackwardPlan {
+  int32_t root_num;
+  // Adjacency of the nodes numbered by GraphTask in CSR format, together with root_num it is the
+  // key of the plan.
+  std::vector<int32_t> edge_offsets;
+  std::vector<int32_t> edge_dsts;
+  std::vector<int32_t> in_degrees;
+  // The order nodes are applied in when a queue is used from the roots.
+  std::vector<int32_t> topo_order;
+  // topo_order grouped by the longest distance from the roots, nodes in one level are independent.
+  std::vector<int32_t> level_order;
+  std::vector<int32_t> level_offsets;
+  int32_t max_level_width;
+};
+
 namespace {
 
+std::shared_ptr<const BackwardPlan> MakeBackwardPlan(int32_t root_num,
+                                                     std::vector<int32_t>&& edge_offsets,
+                                                     std::vector<int32_t>&& edge_dsts) {
+  auto plan = std::make_shared<BackwardPlan>();
+  const int32_t node_num = edge_offsets.size() - 1;
+  plan->root_num = root_num;
+  plan->edge_offsets = std::move(edge_offsets);
+  plan->edge_dsts = std::move(edge_dsts);
+  plan->in_degrees.assign(node_num, 0);
+  for (int32_t dst : plan->edge_dsts) { plan->in_degrees.at(dst) += 1; }
+
+  std::vector<int32_t> dependencies(plan->in_degrees);
+  std::vector<int32_t> levels(node_num, 0);
+  plan->topo_order.reserve(node_num);
+  for (int32_t i = 0; i < root_num; ++i) {
+    if (dependencies.at(i) == 0) { plan->topo_order.emplace_back(i); }
+  }
+  for (int32_t cursor = 0; cursor < plan->topo_order.size(); ++cursor) {
+    const int32_t src = plan->topo_order.at(cursor);
+    for (int32_t e = plan->edge_offsets.at(src); e < plan->edge_offsets.at(src + 1); ++e) {
+      const int32_t dst = plan->edge_dsts.at(e);
+      levels.at(dst) = std::max(levels.at(dst), levels.at(src) + 1);
+      dependencies.at(dst) -= 1;
+      if (dependencies.at(dst) == 0) { plan->topo_order.emplace_back(dst); }
+    }
+  }
+
+  int32_t level_num = 0;
+  for (int32_t index : plan->topo_order) { level_num = std::max(level_num, levels.at(index) + 1); }
+  plan->level_offsets.assign(level_num + 1, 0);
+  for (int32_t index : plan->topo_order) { plan->level_offsets.at(levels.at(index) + 1) += 1; }
+  plan->max_level_width = 0;
+  for (int32_t i = 0; i < level_num; ++i) {
+    plan->max_level_width = std::max(plan->max_level_width, plan->level_offsets.at(i + 1));
+    plan->level_offsets.at(i + 1) += plan->level_offsets.at(i);
+  }
+  plan->level_order.resize(plan->topo_order.size());
+  std::vector<int32_t> cursors(plan->level_offsets.begin(), plan->level_offsets.end() - 1);
+  for (int32_t index : plan->topo_order) {
+    plan->level_order.at(cursors.at(levels.at(index))++) = index;
+  }
+  return plan;
+}
+
+class BackwardPlanCache final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(BackwardPlanCache);
+  BackwardPlanCache() = default;
+  ~BackwardPlanCache() = default;
+
+  // `hash` is the hash of the topology, computed while the graph is walked.
+  std::shared_ptr<const BackwardPlan> GetOrCreate(size_t hash, int32_t root_num,
+                                                  std::vector<int32_t>&& edge_offsets,
+                                                  std::vector<int32_t>&& edge_dsts) {
+    static const int64_t capacity = EnvInteger<ONEFLOW_AUTOGRAD_PLAN_CACHE_SIZE>();
+    if (capacity <= 0) {
+      return MakeBackwardPlan(root_num, std::move(edge_offsets), std::move(edge_dsts));
+    }
+    for (auto it = plans_.begin(); it != plans_.end(); ++it) {
+      const auto& plan = it->second;
+      if (it->first == hash && plan->root_num == root_num && plan->edge_offsets == edge_offsets
+          && plan->edge_dsts == edge_dsts) {
+        plans_.splice(plans_.begin(), plans_, it);
+        return plans_.front().second;
+      }
+    }
+    auto plan = MakeBackwardPlan(root_num, std::move(edge_offsets), std::move(edge_dsts));
+    plans_.emplace_front(hash, plan);
+    while (plans_.size() > capacity) { plans_.pop_back(); }
+    return plan;
+  }
+
+ private:
+  // Most recently used first, the cache is small so a linear scan is fine.
+  std::list<std::pair<size_t, std::shared_ptr<const BackwardPlan>>> plans_;
+};
+
+BackwardPlanCache* ThreadLocalBackwardPlanCache() {
+  thread_local BackwardPlanCache cache;
+  return &cache;
+}
+
+int64_t NewGraphTaskId() {
+  static std::atomic<int64_t> next_id(0);
+  return next_id++;
+}
+
+ThreadPool* BranchThreadPool() {
+  // NOTE: not the ThreadPool singleton used by kernels, a backward node may wait for them.
+  static ThreadPool thread_pool(EnvInteger<ONEFLOW_AUTOGRAD_BRANCH_THREAD_NUM>());
+  return &thread_pool;
+}
+
 void GatherFunctionNodes(FunctionNode* node, std::stack<std::shared_ptr<FunctionNode>>& stack) {
   for (auto& prev_node : node->next_functions()) {
     if (prev_node) {
@@ -172,7 +290,7 @@ void FunctionNode::ReleaseOutTensorArgs() {
   }
 }
 
-Maybe<bool> FunctionNode::Apply(bool create_graph) {
+Maybe<bool> FunctionNode::Apply(bool create_graph, std::mutex* push_grad_mutex) {
   CHECK_NOTNULL_OR_RETURN(backward_fn_)
       << "This FunctionNode with name `" << name() << "` has been released.\n"
       << "Maybe you try to backward through the node a second time. Specify retain_graph=True when "
@@ -190,6 +308,8 @@ Maybe<bool> FunctionNode::Apply(bool create_graph) {
     }
   }
   JUST(backward_fn_->body(output_grads, &input_grads, create_graph));
+  std::unique_lock<std::mutex> lock;
+  if (push_grad_mutex != nullptr) { lock = std::unique_lock<std::mutex>(*push_grad_mutex); }
   for (int i = 0; i < input_meta_data_.size(); ++i) {
     if (JUST(VectorAt(input_grads, i))) {
       CHECK_NOTNULL_OR_RETURN(input_meta_data_.at(i))
@@ -242,112 +362,153 @@ GraphFunctionNode::GraphFunctionNode(const std::string& name,
 }
 
 GraphTask::GraphTask(const TensorTuple& outputs, bool retain_graph, bool create_graph)
-    : retain_graph_(retain_graph), create_graph_(create_graph) {
+    : id_(NewGraphTaskId()), retain_graph_(retain_graph), create_graph_(create_graph) {
   roots_.reserve(outputs.size());
   for (const auto& out_tensor : outputs) {
     FunctionNode* node = out_tensor->mut_grad_fn_node().get();
     roots_.emplace_back(node);
-    dependencies_.insert(std::make_pair(node, 0));
   }
 }
 
-// Computes the number of dependencies for each FunctionNode
-Maybe<void> GraphTask::ComputeDependencies() {
-  HashSet<FunctionNode*> seen;
-  std::stack<FunctionNode*> stack;
-  for (FunctionNode* node : roots_) { stack.push(node); }
-
-  while (!stack.empty()) {
-    FunctionNode* node = stack.top();
-    stack.pop();
-    if (/*bool has_seen=*/!seen.insert(node).second) { continue; }
-    for (const auto& next_grad_fn : node->next_functions()) {
-      FunctionNode* next_node = next_grad_fn.get();
-      dependencies_[next_node] += 1;
-      if (seen.find(next_node) == seen.end()) { stack.push(next_node); }
+Maybe<void> GraphTask::WalkGraphAndGetPlan() {
+  const auto Visit = [&](FunctionNode* node) -> int32_t {
+    if (node->visited_task_id_ != id_) {
+      node->visited_task_id_ = id_;
+      node->task_index_ = nodes_.size();
+      nodes_.emplace_back(node);
     }
+    return node->task_index_;
+  };
+  for (FunctionNode* root : roots_) { Visit(root); }
+  const int32_t root_num = nodes_.size();
+  std::vector<int32_t> edge_offsets{0};
+  std::vector<int32_t> edge_dsts;
+  // NOTE: the key of the plan is hashed during the walk, which has to number the nodes anyway
+  // since every forward creates new nodes. Hashing adds a few integer ops per edge to the pointer
+  // chasing of the walk, while building a plan takes several passes and allocations.
+  size_t hash = std::hash<int32_t>()(root_num);
+  // NOTE: nodes_ is also the queue of the BFS.
+  for (int32_t cursor = 0; cursor < nodes_.size(); ++cursor) {
+    for (const auto& next_grad_fn : nodes_.at(cursor)->next_functions()) {
+      const int32_t dst = Visit(next_grad_fn.get());
+      edge_dsts.emplace_back(dst);
+      HashCombine(&hash, dst);
+    }
+    edge_offsets.emplace_back(edge_dsts.size());
+    HashCombine(&hash, edge_dsts.size());
+  }
+  plan_ = ThreadLocalBackwardPlanCache()->GetOrCreate(hash, root_num, std::move(edge_offsets),
+                                                      std::move(edge_dsts));
+  dependencies_.reset(new std::atomic<int32_t>[nodes_.size()]);
+  for (int32_t i = 0; i < nodes_.size(); ++i) {
+    dependencies_[i].store(plan_->in_degrees.at(i), std::memory_order_relaxed);
   }
   return Maybe<void>::Ok();
 }
 
+// Computes the number of dependencies for each FunctionNode
+Maybe<void> GraphTask::ComputeDependencies() { return WalkGraphAndGetPlan(); }
+
 // Computes the number of dependencies for each FunctionNode and prunes useless FunctionNode
 // according to input tensors
 Maybe<void> GraphTask::ComputeDependenciesAndPruneNode(const TensorTuple& inputs) {
-  struct NodeFrame {
-    explicit NodeFrame(FunctionNode* node) : node_(node), next_function_idx_(0) {}
-    FunctionNode* node_;
-    size_t next_function_idx_;
-
-    FunctionNode* GetNextFunction() {
-      if (next_function_idx_ < node_->next_functions().size()) {
-        next_function_idx_ += 1;
-        return node_->next_functions().at(next_function_idx_ - 1).get();
-      } else {
-        return nullptr;
+  JUST(WalkGraphAndGetPlan());
+  if (inputs.empty()) { return Maybe<void>::Ok(); }
+  need_execute_.assign(nodes_.size(), false);
+  for (const auto& input : inputs) {
+    FunctionNode* node = input->mut_grad_fn_node().get();
+    CHECK_NOTNULL_OR_RETURN(node);
+    if (node->visited_task_id_ == id_) { need_execute_.at(node->task_index_) = true; }
+  }
+  // Note: a FunctionNode should execute if any of its next functions should, and next functions
+  // always come later in the topological order.
+  for (auto it = plan_->topo_order.rbegin(); it != plan_->topo_order.rend(); ++it) {
+    const int32_t index = *it;
+    if (need_execute_.at(index)) { continue; }
+    for (int32_t e = plan_->edge_offsets.at(index); e < plan_->edge_offsets.at(index + 1); ++e) {
+      if (need_execute_.at(plan_->edge_dsts.at(e))) {
+        need_execute_.at(index) = true;
+        break;
       }
     }
-  };
-
-  for (const auto& input : inputs) {
-    CHECK_NOTNULL_OR_RETURN(input->mut_grad_fn_node().get());
-    need_execute_.insert(input->mut_grad_fn_node().get());
   }
+  return Maybe<void>::Ok();
+}
 
-  HashSet<FunctionNode*> seen;
-  std::stack<NodeFrame> stack;
+Maybe<void> GraphTask::ApplyNode(int32_t index, bool save_grad_for_leaf,
+                                 std::mutex* push_grad_mutex) {
+  // A node is not applied if any node before it was not, e.g. it got no grad or was pruned.
+  if (dependencies_[index].load(std::memory_order_acquire) != 0) { return Maybe<void>::Ok(); }
+  FunctionNode* node = nodes_.at(index);
+  if (!need_execute_.empty() && !need_execute_.at(index)) {
+    node->ReleaseOutTensorArgs();
+    return Maybe<void>::Ok();
+  }
+  if (/*bool not_ready_to_apply=*/!(JUST(node->Apply(create_graph_, push_grad_mutex)))) {
+    return Maybe<void>::Ok();
+  }
+  if (save_grad_for_leaf) { JUST(node->AccGrad4LeafTensor(create_graph_)); }
+  JUST(node->AccGrad4RetainGradTensor());
+  node->ReleaseOutTensorArgs();
+  if (!retain_graph_) { node->ReleaseData(); }
 
-  // Note: dfs to determine each FunctionNode should execute or not.
-  for (const auto& root : roots_) { stack.push(NodeFrame(root)); }
-  while (!stack.empty()) {
-    NodeFrame& frame = stack.top();
-    if (/*bool has_seen=*/seen.find(frame.node_) != seen.end()) {
-      stack.pop();
-      continue;
-    }
-    if (FunctionNode* node = frame.GetNextFunction()) {
-      dependencies_[node] += 1;
-      if (seen.find(node) == seen.end()) {
-        stack.push(NodeFrame(node));
-        continue;  // recurse
-      }
-    } else {
-      bool need_execute =
-          std::any_of(frame.node_->next_functions().begin(), frame.node_->next_functions().end(),
-                      [&](const std::shared_ptr<FunctionNode>& fn) {
-                        return need_execute_.find(fn.get()) != need_execute_.end();
-                      });
-      if (need_execute) { need_execute_.insert(frame.node_); }
-      seen.insert(frame.node_);
-      stack.pop();
-    }
+  for (int32_t e = plan_->edge_offsets.at(index); e < plan_->edge_offsets.at(index + 1); ++e) {
+    dependencies_[plan_->edge_dsts.at(e)].fetch_sub(1, std::memory_order_acq_rel);
   }
   return Maybe<void>::Ok();
 }
 
 Maybe<void> GraphTask::Apply(bool save_grad_for_leaf) {
-  std::queue<FunctionNode*> queue;
-  for (FunctionNode* node : roots_) {
-    if (dependencies_[node] == 0) { queue.push(node); }
+  static const bool concurrent_branches = EnvBool<ONEFLOW_AUTOGRAD_ENABLE_CONCURRENT_BRANCHES>();
+  if (concurrent_branches && plan_->max_level_width > 1) {
+    return ApplyConcurrently(save_grad_for_leaf);
   }
+  for (int32_t index : plan_->topo_order) {
+    JUST(ApplyNode(index, save_grad_for_leaf, /*push_grad_mutex=*/nullptr));
+  }
+  return Maybe<void>::Ok();
+}
 
-  while (!queue.empty()) {
-    FunctionNode* node = queue.front();
-    queue.pop();
-    if (!need_execute_.empty() && need_execute_.find(node) == need_execute_.end()) {
-      node->ReleaseOutTensorArgs();
+// Applies the nodes level by level, the nodes in one level are split among the branch threads.
+// Only pushing grads to the next functions is serialized, as different branches may share them.
+Maybe<void> GraphTask::ApplyConcurrently(bool save_grad_for_leaf) {
+  ThreadPool* thread_pool = BranchThreadPool();
+  const bool grad_mode = autograd::GradMode::is_enabled();
+  const bool grad_sync_mode = GlobalGradSyncMode::is_enabled();
+  std::mutex push_grad_mutex;
+  const int32_t level_num = plan_->level_offsets.size() - 1;
+  for (int32_t level = 0; level < level_num; ++level) {
+    const int32_t begin = plan_->level_offsets.at(level);
+    const int32_t end = plan_->level_offsets.at(level + 1);
+    const int64_t shard_num = std::min<int64_t>(end - begin, thread_pool->thread_num());
+    if (shard_num <= 1) {
+      for (int32_t i = begin; i < end; ++i) {
+        JUST(ApplyNode(plan_->level_order.at(i), save_grad_for_leaf, nullptr));
+      }
       continue;
     }
-    if (/*bool not_ready_to_apply=*/!(JUST(node->Apply(create_graph_)))) { continue; }
-    if (save_grad_for_leaf) { JUST(node->AccGrad4LeafTensor(create_graph_)); }
-    JUST(node->AccGrad4RetainGradTensor());
-    node->ReleaseOutTensorArgs();
-    if (!retain_graph_) { node->ReleaseData(); }
-
-    for (const auto& next_grad_fn : node->next_functions()) {
-      FunctionNode* next_node = next_grad_fn.get();
-      dependencies_[next_node] -= 1;
-      if (dependencies_[next_node] == 0) { queue.push(next_node); }
+    BalancedSplitter bs(end - begin, shard_num);
+    BlockingCounter counter(shard_num);
+    std::vector<std::unique_ptr<Maybe<void>>> results(shard_num);
+    for (int64_t i = 0; i < shard_num; ++i) {
+      thread_pool->AddWork([&, i]() {
+        autograd::AutoGradMode mode(grad_mode);
+        GlobalParamGradSyncMode sync_mode(grad_sync_mode);
+        DisableCheckGlobalTensorMetaScope disable_meta_check;
+        const auto ApplyShard = [&]() -> Maybe<void> {
+          const Range range = bs.At(i);
+          for (int64_t j = begin + range.begin(); j < begin + range.end(); ++j) {
+            JUST(ApplyNode(plan_->level_order.at(j), save_grad_for_leaf, &push_grad_mutex));
+          }
+          return Maybe<void>::Ok();
+        };
+        results.at(i).reset(new Maybe<void>(TRY(ApplyShard())));
+        counter.Decrease();
+      });
     }
+    // NOTE: the foreign lock is released while waiting, the branches may run python hooks.
+    JUST(counter.WaitUntilCntEqualZero([]() -> Maybe<bool> { return false; }));
+    for (const auto& result : results) { JUST(*result); }
   }
   return Maybe<void>::Ok();
 }
@@ -17,9 +17,11 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_AUTOGRAD_AUTOGRAD_ENGINE_H_
 #define ONEFLOW_CORE_AUTOGRAD_AUTOGRAD_ENGINE_H_
 
+#include <atomic>
 #include <list>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <functional>
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/autograd/autograd_meta.h"
@@ -43,7 +45,9 @@ class FunctionNode {
  public:
   virtual ~FunctionNode() = default;
 
-  Maybe<bool> Apply(bool create_graph);
+  // `push_grad_mutex` guards pushing the input grads, it is only needed when nodes are applied
+  // concurrently.
+  Maybe<bool> Apply(bool create_graph, std::mutex* push_grad_mutex = nullptr);
   Maybe<void> AccGrad4LeafTensor(bool create_graph);
   Maybe<void> AccGrad4RetainGradTensor();
   void ReleaseOutTensorArgs();
@@ -70,6 +74,13 @@ class FunctionNode {
 
   // Actual backward function builds in `AutogradInterpreter` to calculate one backward op
   std::shared_ptr<BackwardFunction> backward_fn_;
+
+ private:
+  friend class GraphTask;
+  // Set by the GraphTask walking the graph, `task_index_` is only valid if `visited_task_id_`
+  // equals the id of that task. Avoids a node to index HashMap for every backward.
+  int64_t visited_task_id_ = -1;
+  int32_t task_index_ = -1;
 };
 
 class AutogradEngine {
@@ -121,6 +132,10 @@ class GraphFunctionNode final : public FunctionNode {
                     const TensorTuple& inputs, const TensorTuple& outputs);
 };
 
+// Execution order of a backward graph, only depends on the topology of the graph so that it is
+// computed once and reused by every backward of a fixed-topology model.
+struct BackwardPlan;
+
 class GraphTask final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(GraphTask);
@@ -132,11 +147,20 @@ class GraphTask final {
   Maybe<void> Apply(bool save_grad_for_leaf);
 
  private:
+  // Numbers the reachable nodes in BFS order and looks up or builds the plan of this topology.
+  Maybe<void> WalkGraphAndGetPlan();
+  Maybe<void> ApplyNode(int32_t index, bool save_grad_for_leaf, std::mutex* push_grad_mutex);
+  Maybe<void> ApplyConcurrently(bool save_grad_for_leaf);
+
+  int64_t id_;
   bool retain_graph_;
   bool create_graph_;
   std::vector<FunctionNode*> roots_;
-  HashMap<FunctionNode*, int> dependencies_;
-  HashSet<FunctionNode*> need_execute_;
+  std::vector<FunctionNode*> nodes_;
+  std::shared_ptr<const BackwardPlan> plan_;
+  std::unique_ptr<std::atomic<int32_t>[]> dependencies_;
+  // Empty if no node is pruned.
+  std::vector<bool> need_execute_;
 };
 
 class GraphAutogradEngine final : public AutogradEngine {
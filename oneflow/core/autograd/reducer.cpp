@@ -0,0 +1,204 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/autograd/reducer.h"
+#include "oneflow/core/autograd/autograd_engine.h"
+#include "oneflow/core/autograd/autograd_meta.h"
+#include "oneflow/core/autograd/autograd_mode.h"
+#include "oneflow/core/common/data_type.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_methods.h"
+#include "oneflow/core/functional/functional.h"
+
+namespace oneflow {
+namespace one {
+
+Reducer::Reducer(const TensorTuple& params, double grad_scale)
+    : grad_scale_(grad_scale), next_bucket_(0) {
+  for (const auto& param : params) {
+    if (param->requires_grad()) { params_.emplace_back(param); }
+  }
+}
+
+/* static */ Maybe<Reducer> Reducer::New(const TensorTuple& params, int64_t bucket_cap_bytes,
+                                         double grad_scale) {
+  CHECK_GT_OR_RETURN(bucket_cap_bytes, 0) << "bucket_cap_bytes should be positive";
+  std::shared_ptr<Reducer> reducer(new Reducer(params, grad_scale));
+  JUST(reducer->InitBuckets(bucket_cap_bytes));
+  JUST(reducer->RegisterHooks());
+  return reducer;
+}
+
+Maybe<void> Reducer::InitBuckets(int64_t bucket_cap_bytes) {
+  const int64_t param_num = params_.size();
+  param2bucket_.assign(param_num, -1);
+  grad_views_.resize(param_num);
+  param_ready_.assign(param_num, false);
+  if (param_num == 0) { return Maybe<void>::Ok(); }
+  const auto& dtype = params_.at(0)->dtype();
+  const auto& device = JUST(params_.at(0)->device());
+  const int64_t elem_size = GetSizeOfDataType(dtype->data_type());
+  // NOTE: every grad starts at an aligned offset so the views are valid inputs for cuda kernels.
+  const auto AlignedElemCnt = [&](const std::shared_ptr<Tensor>& param) -> int64_t {
+    return RoundUp(param->shape()->elem_cnt() * elem_size, kCudaMemAllocAlignSize) / elem_size;
+  };
+  std::vector<int64_t> offsets(param_num, 0);
+  std::vector<int64_t> bucket_elem_cnts;
+  for (int64_t i = param_num - 1; i >= 0; --i) {
+    const auto& param = params_.at(i);
+    CHECK_OR_RETURN(param->is_local()) << "Reducer only supports local tensors";
+    CHECK_OR_RETURN(param->is_leaf()) << "Reducer only supports leaf tensors";
+    CHECK_OR_RETURN(param->dtype() == dtype) << "all parameters should have the same dtype";
+    CHECK_OR_RETURN(JUST(param->device()) == device)
+        << "all parameters should be on the same device";
+    const int64_t elem_cnt = AlignedElemCnt(param);
+    if (buckets_.empty()
+        || (!buckets_.back().param_indices.empty()
+            && (bucket_elem_cnts.back() + elem_cnt) * elem_size > bucket_cap_bytes)) {
+      buckets_.emplace_back(Bucket{nullptr, {}, 0});
+      bucket_elem_cnts.emplace_back(0);
+    }
+    offsets.at(i) = bucket_elem_cnts.back();
+    bucket_elem_cnts.back() += elem_cnt;
+    buckets_.back().param_indices.emplace_back(i);
+    param2bucket_.at(i) = buckets_.size() - 1;
+  }
+  autograd::AutoGradMode mode(false);
+  for (int64_t b = 0; b < bucket_num(); ++b) {
+    auto& bucket = buckets_.at(b);
+    bucket.flat =
+        JUST(functional::Constant(Shape({bucket_elem_cnts.at(b)}), Scalar(0), dtype, device));
+    CHECK_OR_RETURN(view::IsViewApplicable(bucket.flat))
+        << "Reducer requires the view mechanism, unset ONEFLOW_DISABLE_VIEW";
+    bucket.pending_cnt = bucket.param_indices.size();
+    for (int64_t i : bucket.param_indices) {
+      const auto& param = params_.at(i);
+      const int64_t start = offsets.at(i);
+      const auto& slice = JUST(functional::SliceView1dContiguous(
+          bucket.flat, start, start + param->shape()->elem_cnt()));
+      grad_views_.at(i) = JUST(functional::View(slice, *param->shape()));
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> Reducer::RegisterHooks() {
+  // NOTE: hooks are owned by the parameters, capture a weak pointer to avoid a reference cycle
+  // when the reducer holds the parameters.
+  std::weak_ptr<Reducer> weak_reducer = shared_from_this();
+  const int64_t param_num = params_.size();
+  for (int64_t i = 0; i < param_num; ++i) {
+    const auto& param = params_.at(i);
+    if (!param->grad_fn_node()) { JUST(AddAccumulateFunctionNode(param)); }
+    auto autograd_meta = param->mut_autograd_meta();
+    autograd_meta->add_hook(
+        [weak_reducer, i](const std::shared_ptr<const Tensor>&) -> std::shared_ptr<Tensor> {
+          if (const auto& reducer = weak_reducer.lock()) { CHECK_JUST(reducer->BindGrad(i)); }
+          return nullptr;
+        });
+    autograd_meta->add_post_grad_accumulation_hook(
+        [weak_reducer, i](const std::shared_ptr<const Tensor>&) -> std::shared_ptr<Tensor> {
+          if (const auto& reducer = weak_reducer.lock()) { CHECK_JUST(reducer->MarkGradReady(i)); }
+          return nullptr;
+        });
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> Reducer::BindGrad(int64_t param_index) {
+  auto autograd_meta = params_.at(param_index)->mut_autograd_meta();
+  if (autograd_meta->acc_grad()) { return Maybe<void>::Ok(); }
+  const auto& grad_view = grad_views_.at(param_index);
+  // The bucket still holds the reduced grads of the previous iteration if the grad was set to
+  // None instead of being zeroed.
+  JUST(functional::Fill(grad_view, Scalar(0)));
+  JUST(autograd_meta->set_acc_grad(grad_view));
+  autograd_meta->set_is_grad_acc_inplace(true);
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> Reducer::RebindGrad(int64_t param_index) {
+  auto autograd_meta = params_.at(param_index)->mut_autograd_meta();
+  const auto& grad_view = grad_views_.at(param_index);
+  const std::shared_ptr<Tensor> acc_grad = autograd_meta->acc_grad();
+  if (acc_grad == grad_view) { return Maybe<void>::Ok(); }
+  // The grad was reassigned outside its bucket, e.g. by `param.grad = ...` in python, so the
+  // accumulation went to that tensor instead of the bucket.
+  CHECK_OR_RETURN(*acc_grad->shape() == *grad_view->shape())
+      << "the grad of a parameter should have the same shape as the parameter";
+  autograd::AutoGradMode mode(false);
+  JUST(functional::Fill(grad_view, Scalar(0)));
+  JUST(functional::Add(grad_view, acc_grad, /*alpha=*/1, /*inplace=*/true));
+  JUST(autograd_meta->set_acc_grad(grad_view));
+  autograd_meta->set_is_grad_acc_inplace(true);
+  return Maybe<void>::Ok();
+}
+
+void Reducer::PrepareForBackward() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::fill(param_ready_.begin(), param_ready_.end(), false);
+  for (auto& bucket : buckets_) { bucket.pending_cnt = bucket.param_indices.size(); }
+  next_bucket_ = 0;
+}
+
+Maybe<void> Reducer::MarkGradReady(int64_t param_index) {
+  JUST(RebindGrad(param_index));
+  bool all_launched = false;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // A grad accumulated twice in one backward (e.g. a shared parameter) is only counted once.
+    if (param_ready_.at(param_index)) { return Maybe<void>::Ok(); }
+    param_ready_.at(param_index) = true;
+    auto& bucket = buckets_.at(param2bucket_.at(param_index));
+    CHECK_GT_OR_RETURN(bucket.pending_cnt, 0);
+    bucket.pending_cnt -= 1;
+    JUST(LaunchReadyBuckets());
+    all_launched = next_bucket_ == bucket_num();
+  }
+  if (all_launched) { PrepareForBackward(); }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> Reducer::LaunchReadyBuckets() {
+  while (next_bucket_ < bucket_num() && buckets_.at(next_bucket_).pending_cnt == 0) {
+    JUST(LaunchBucket(next_bucket_));
+    next_bucket_ += 1;
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> Reducer::FinalizeBackward() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (next_bucket_ < bucket_num()) {
+      JUST(LaunchBucket(next_bucket_));
+      next_bucket_ += 1;
+    }
+  }
+  PrepareForBackward();
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> Reducer::LaunchBucket(int64_t bucket_index) {
+  autograd::AutoGradMode mode(false);
+  const auto& flat = buckets_.at(bucket_index).flat;
+  if (grad_scale_ != 1.0) { JUST(functional::ScalarMul(flat, Scalar(grad_scale_), true)); }
+  // NOTE: dispatched to the vm, so backward goes on while the ccl::AllReduce is running.
+  JUST(functional::LocalAllReduce(flat, /*inplace=*/true));
+  return Maybe<void>::Ok();
+}
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,91 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_AUTOGRAD_REDUCER_H_
+#define ONEFLOW_CORE_AUTOGRAD_REDUCER_H_
+
+#include <mutex>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+
+namespace oneflow {
+namespace one {
+
+class Tensor;
+
+// Gradient bucketing for eager data parallelism.
+//
+// Parameters are grouped into flat buckets of at most `bucket_cap_bytes` in reverse registration
+// order, which is roughly the order their grads become ready in backward. The acc_grad of every
+// parameter is a view of its bucket, so accumulation writes into the bucket in place. Once all the
+// grads of a bucket are accumulated, the bucket is scaled by `grad_scale` and all-reduced in
+// place. Buckets are always launched in index order so that the collectives match across ranks,
+// and the all-reduce is dispatched asynchronously so it overlaps the rest of backward.
+class Reducer final : public std::enable_shared_from_this<Reducer> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(Reducer);
+  ~Reducer() = default;
+
+  static Maybe<Reducer> New(const TensorTuple& params, int64_t bucket_cap_bytes,
+                            double grad_scale);
+
+  // Clears the ready state of the current iteration. Called automatically once every bucket is
+  // launched, call it explicitly if a previous backward was interrupted.
+  void PrepareForBackward();
+  // Launches the buckets which are still pending, e.g. those holding parameters that received no
+  // grad in this iteration.
+  Maybe<void> FinalizeBackward();
+
+  int64_t bucket_num() const { return buckets_.size(); }
+  const std::shared_ptr<Tensor>& bucket(int64_t i) const { return buckets_.at(i).flat; }
+  const std::vector<int64_t>& bucket_param_indices(int64_t i) const {
+    return buckets_.at(i).param_indices;
+  }
+
+ private:
+  struct Bucket {
+    std::shared_ptr<Tensor> flat;
+    std::vector<int64_t> param_indices;
+    int64_t pending_cnt;
+  };
+
+  Reducer(const TensorTuple& params, double grad_scale);
+
+  Maybe<void> InitBuckets(int64_t bucket_cap_bytes);
+  Maybe<void> RegisterHooks();
+  // Makes the acc_grad of param i a view of its bucket before the first accumulation.
+  Maybe<void> BindGrad(int64_t param_index);
+  // Makes the acc_grad of param i a view of its bucket again before the bucket is all-reduced, in
+  // case the grad was reassigned.
+  Maybe<void> RebindGrad(int64_t param_index);
+  Maybe<void> MarkGradReady(int64_t param_index);
+  Maybe<void> LaunchReadyBuckets();
+  Maybe<void> LaunchBucket(int64_t bucket_index);
+
+  TensorTuple params_;
+  double grad_scale_;
+  std::vector<Bucket> buckets_;
+  std::vector<int64_t> param2bucket_;
+  std::vector<std::shared_ptr<Tensor>> grad_views_;
+  std::vector<bool> param_ready_;
+  int64_t next_bucket_;
+  std::mutex mutex_;
+};
+
+}  // namespace one
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_AUTOGRAD_REDUCER_H_
@@ -26,8 +26,16 @@ limitations under the License.
 #include "oneflow/core/job/eager_nccl_comm_manager.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
 #include "oneflow/core/common/constant.h"
+#include "oneflow/core/common/env_var/env_var.h"
+#include "oneflow/core/ipc/shared_memory.h"
 
 namespace oneflow {
+
+// Bytes of one pipelined chunk of the cpu ring collectives.
+DEFINE_ENV_INTEGER(ONEFLOW_CCL_CPU_CHUNK_SIZE, 1 << 20);
+// All-reduce of at most this many bytes uses recursive doubling or a tree instead of the ring.
+DEFINE_ENV_INTEGER(ONEFLOW_CCL_CPU_SMALL_MESSAGE_SIZE, 64 << 10);
+
 namespace ccl {
 
 namespace {
@@ -61,6 +69,464 @@ void VecAdd(size_t size, T* out, const T* in0, const T* in1) {
   });
 }
 
+enum class CpuCclAlgo {
+  kRing = 0,
+  kRecursiveDoubling,
+  kTree,
+  kShm,
+};
+
+bool AllRanksOnThisNode(const ParallelDesc& parallel_desc) {
+  if (parallel_desc.parallel_num() != parallel_desc.sorted_machine_ids().size()) {
+    return false;
+  }
+  for (int64_t machine_id : parallel_desc.sorted_machine_ids()) {
+    if (GlobalProcessCtx::NodeId(machine_id) != GlobalProcessCtx::ThisNodeId()) { return false; }
+  }
+  return true;
+}
+
+// ONEFLOW_CCL_CPU_ALGO is one of auto, ring, recursive_doubling, tree and shm. Collectives other
+// than all-reduce only have the ring and shm algorithms and use the ring for the others.
+Maybe<CpuCclAlgo> GetCpuCclAlgo(const ParallelDesc& parallel_desc, size_t buffer_size,
+                                bool is_all_reduce) {
+  // NOTE: read once, the algorithm is picked for every collective.
+  static const std::string algo = GetStringFromEnv("ONEFLOW_CCL_CPU_ALGO", "auto");
+  static const int64_t small_message_size = EnvInteger<ONEFLOW_CCL_CPU_SMALL_MESSAGE_SIZE>();
+  const bool is_small = static_cast<int64_t>(buffer_size) <= small_message_size;
+  const int64_t parallel_num = parallel_desc.parallel_num();
+  const bool is_power_of_2 = (parallel_num & (parallel_num - 1)) == 0;
+  if (algo == "auto") {
+    if (AllRanksOnThisNode(parallel_desc)) { return CpuCclAlgo::kShm; }
+    if (is_all_reduce && is_small) {
+      return is_power_of_2 ? CpuCclAlgo::kRecursiveDoubling : CpuCclAlgo::kTree;
+    }
+    return CpuCclAlgo::kRing;
+  } else if (algo == "shm") {
+    CHECK_OR_RETURN(AllRanksOnThisNode(parallel_desc))
+        << "shm algorithm requires all ranks of " << parallel_desc.parallel_conf().DebugString()
+        << " on one node";
+    return CpuCclAlgo::kShm;
+  } else if (algo == "ring" || !is_all_reduce) {
+    return CpuCclAlgo::kRing;
+  } else if (algo == "recursive_doubling") {
+    CHECK_OR_RETURN(is_power_of_2) << "recursive doubling requires power of 2 ranks";
+    return CpuCclAlgo::kRecursiveDoubling;
+  } else if (algo == "tree") {
+    return CpuCclAlgo::kTree;
+  }
+  UNIMPLEMENTED_THEN_RETURN() << "invalid ONEFLOW_CCL_CPU_ALGO: " << algo;
+}
+
+using TransportCtxPtr = std::unique_ptr<NaiveAsyncTransportCtx>;
+
+TransportCtxPtr NewSendCtx(const TransportToken& transport_token, const void* ptr, size_t size) {
+  return std::make_unique<NaiveAsyncTransportCtx>(
+      transport_token,
+      [ptr, size](void** buffer, std::size_t* buffer_size, std::function<void()>* Cb)
+          -> Maybe<void> {
+        *buffer = const_cast<void*>(ptr);
+        *buffer_size = size;
+        *Cb = [] {};
+        return Maybe<void>::Ok();
+      },
+      [](void** buffer, std::size_t* buffer_size, std::function<void()>* Cb) -> Maybe<void> {
+        UNIMPLEMENTED_THEN_RETURN();
+      });
+}
+
+TransportCtxPtr NewRecvCtx(const TransportToken& transport_token, void* ptr, size_t size) {
+  return std::make_unique<NaiveAsyncTransportCtx>(
+      transport_token,
+      [](void** buffer, std::size_t* buffer_size, std::function<void()>* Cb) -> Maybe<void> {
+        UNIMPLEMENTED_THEN_RETURN();
+      },
+      [ptr, size](void** buffer, std::size_t* buffer_size, std::function<void()>* Cb)
+          -> Maybe<void> {
+        *buffer = ptr;
+        *buffer_size = size;
+        *Cb = [] {};
+        return Maybe<void>::Ok();
+      });
+}
+
+// The Async* functions below leave ctx empty for empty buffers, the peer skips them too.
+Maybe<void> AsyncSendToNextRankInRing(Symbol<RankGroup> rank_group,
+                                      const TransportToken& transport_token, const void* ptr,
+                                      size_t size, TransportCtxPtr* ctx) {
+  CHECK_OR_RETURN(!*ctx);
+  if (size == 0) { return Maybe<void>::Ok(); }
+  *ctx = NewSendCtx(transport_token, ptr, size);
+  return TransportUtil::SendToNextRankInRing(rank_group, transport_token, ctx->get());
+}
+
+Maybe<void> AsyncReceiveFromPrevRankInRing(Symbol<RankGroup> rank_group,
+                                           const TransportToken& transport_token, void* ptr,
+                                           size_t size, TransportCtxPtr* ctx) {
+  CHECK_OR_RETURN(!*ctx);
+  if (size == 0) { return Maybe<void>::Ok(); }
+  *ctx = NewRecvCtx(transport_token, ptr, size);
+  return TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, ctx->get());
+}
+
+Maybe<void> AsyncSendDataToRank(int64_t rank, const TransportToken& transport_token,
+                                const void* ptr, size_t size, TransportCtxPtr* ctx) {
+  CHECK_OR_RETURN(!*ctx);
+  if (size == 0) { return Maybe<void>::Ok(); }
+  *ctx = NewSendCtx(transport_token, ptr, size);
+  return TransportUtil::SendDataToRank(rank, transport_token, ctx->get());
+}
+
+Maybe<void> AsyncReceiveDataFromRank(int64_t rank, const TransportToken& transport_token,
+                                     void* ptr, size_t size, TransportCtxPtr* ctx) {
+  CHECK_OR_RETURN(!*ctx);
+  if (size == 0) { return Maybe<void>::Ok(); }
+  *ctx = NewRecvCtx(transport_token, ptr, size);
+  return TransportUtil::ReceiveDataFromRank(rank, transport_token, ctx->get());
+}
+
+Maybe<void> WaitDone(TransportCtxPtr* ctx) {
+  if (*ctx) {
+    JUST((*ctx)->WaitDone());
+    ctx->reset();
+  }
+  return Maybe<void>::Ok();
+}
+
+// Splits every part of a ring collective into the same number of chunks. Chunk i of any part
+// fits the i-th slot of a buffer of chunk_num() * slot_size() elements.
+class RingChunks final {
+ public:
+  RingChunks(const BalancedSplitter& bs, int64_t parallel_num, size_t elem_size)
+      : bs_(bs), parallel_num_(parallel_num) {
+    const int64_t max_part_size = bs_.At(0).size();
+    static const int64_t chunk_size = EnvInteger<ONEFLOW_CCL_CPU_CHUNK_SIZE>();
+    const int64_t chunk_elem_cnt = std::max<int64_t>(chunk_size / elem_size, 1);
+    chunk_num_ = std::max<int64_t>((max_part_size + chunk_elem_cnt - 1) / chunk_elem_cnt, 1);
+    slot_size_ = BalancedSplitter(max_part_size, chunk_num_).At(0).size();
+  }
+
+  int64_t chunk_num() const { return chunk_num_; }
+  int64_t slot_size() const { return slot_size_; }
+  // Part sent at the step-th step when first_part is sent at the first step.
+  int64_t Part4Step(int64_t first_part, int64_t step) const {
+    return ((first_part - step) % parallel_num_ + parallel_num_) % parallel_num_;
+  }
+  // Absolute range of the chunk.
+  Range ChunkRange(int64_t part, int64_t chunk) const {
+    const Range part_range = bs_.At(part);
+    const Range range = BalancedSplitter(part_range.size(), chunk_num_).At(chunk);
+    return Range(part_range.begin() + range.begin(), part_range.begin() + range.end());
+  }
+
+ private:
+  const BalancedSplitter& bs_;
+  int64_t parallel_num_;
+  int64_t chunk_num_;
+  int64_t slot_size_;
+};
+
+// Ring reduce-scatter, pipelined by chunks: a chunk is reduced as soon as it arrives and is
+// forwarded right away, so reduction overlaps with the transfer of the following chunks.
+// first_send_part of in is sent at the first step, the part which is fully reduced at the end is
+// RingIncrease(first_send_part) and is written to part_out.
+template<typename T>
+Maybe<void> PipelinedRingReduceScatter(const T* in, T* part_out, const BalancedSplitter& bs,
+                                       int64_t parallel_num, int64_t first_send_part,
+                                       Symbol<RankGroup> rank_group,
+                                       const TransportToken& transport_token) {
+  const RingChunks chunks(bs, parallel_num, sizeof(T));
+  const int64_t step_num = parallel_num - 1;
+  const int64_t chunk_num = chunks.chunk_num();
+  const int64_t slot_size = chunks.slot_size();
+  // Partial sums are kept in per chunk slots, so a slot is only reused by the same chunk index.
+  auto recv_buffer = std::make_unique<T[]>(chunk_num * slot_size);
+  auto acc_buffer = std::make_unique<T[]>(chunk_num * slot_size);
+  std::vector<TransportCtxPtr> send_ctxs(chunk_num);
+  std::vector<TransportCtxPtr> recv_ctxs(chunk_num);
+  auto PostStep = [&](int64_t step, int64_t chunk) -> Maybe<void> {
+    const int64_t send_part = chunks.Part4Step(first_send_part, step);
+    const Range send_range = chunks.ChunkRange(send_part, chunk);
+    const T* send_ptr = step == 0 ? &in[send_range.begin()] : &acc_buffer[chunk * slot_size];
+    JUST(AsyncSendToNextRankInRing(rank_group, transport_token, send_ptr,
+                                   send_range.size() * sizeof(T), &send_ctxs.at(chunk)));
+    const Range recv_range = chunks.ChunkRange(RingDecrease(send_part, parallel_num), chunk);
+    JUST(AsyncReceiveFromPrevRankInRing(rank_group, transport_token,
+                                        &recv_buffer[chunk * slot_size],
+                                        recv_range.size() * sizeof(T), &recv_ctxs.at(chunk)));
+    return Maybe<void>::Ok();
+  };
+  for (int64_t chunk = 0; chunk < chunk_num; ++chunk) { JUST(PostStep(0, chunk)); }
+  for (int64_t step = 0; step < step_num; ++step) {
+    const int64_t recv_part = RingDecrease(chunks.Part4Step(first_send_part, step), parallel_num);
+    const bool is_last_step = step + 1 == step_num;
+    for (int64_t chunk = 0; chunk < chunk_num; ++chunk) {
+      JUST(WaitDone(&recv_ctxs.at(chunk)));
+      // The acc slot of this chunk is being sent in this step.
+      JUST(WaitDone(&send_ctxs.at(chunk)));
+      const Range range = chunks.ChunkRange(recv_part, chunk);
+      T* chunk_out = is_last_step ? &part_out[range.begin() - bs.At(recv_part).begin()]
+                                  : &acc_buffer[chunk * slot_size];
+      if (range.size() > 0) {
+        VecAdd(range.size(), chunk_out, &in[range.begin()], &recv_buffer[chunk * slot_size]);
+      }
+      if (!is_last_step) { JUST(PostStep(step + 1, chunk)); }
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
+// Ring all-gather, pipelined by chunks: a chunk is forwarded as soon as it arrives. Part
+// first_send_part of out must be filled and is sent at the first step.
+template<typename T>
+Maybe<void> PipelinedRingAllGather(T* out, const BalancedSplitter& bs, int64_t parallel_num,
+                                   int64_t first_send_part, Symbol<RankGroup> rank_group,
+                                   const TransportToken& transport_token) {
+  const RingChunks chunks(bs, parallel_num, sizeof(T));
+  const int64_t step_num = parallel_num - 1;
+  const int64_t chunk_num = chunks.chunk_num();
+  std::vector<TransportCtxPtr> send_ctxs(step_num * chunk_num);
+  std::vector<TransportCtxPtr> recv_ctxs(chunk_num);
+  auto PostStep = [&](int64_t step, int64_t chunk) -> Maybe<void> {
+    const int64_t send_part = chunks.Part4Step(first_send_part, step);
+    const Range send_range = chunks.ChunkRange(send_part, chunk);
+    JUST(AsyncSendToNextRankInRing(rank_group, transport_token, &out[send_range.begin()],
+                                   send_range.size() * sizeof(T),
+                                   &send_ctxs.at(step * chunk_num + chunk)));
+    const Range recv_range = chunks.ChunkRange(RingDecrease(send_part, parallel_num), chunk);
+    JUST(AsyncReceiveFromPrevRankInRing(rank_group, transport_token, &out[recv_range.begin()],
+                                        recv_range.size() * sizeof(T), &recv_ctxs.at(chunk)));
+    return Maybe<void>::Ok();
+  };
+  for (int64_t chunk = 0; chunk < chunk_num; ++chunk) { JUST(PostStep(0, chunk)); }
+  for (int64_t step = 0; step < step_num; ++step) {
+    for (int64_t chunk = 0; chunk < chunk_num; ++chunk) {
+      JUST(WaitDone(&recv_ctxs.at(chunk)));
+      if (step + 1 < step_num) { JUST(PostStep(step + 1, chunk)); }
+    }
+  }
+  for (auto& ctx : send_ctxs) { JUST(WaitDone(&ctx)); }
+  return Maybe<void>::Ok();
+}
+
+// log2(parallel_num) full size exchanges, each rank adds the buffer of rank (parallel_id ^ mask).
+template<typename T>
+Maybe<void> RecursiveDoublingAllReduce(const T* in, T* out, size_t elem_cnt,
+                                       const ParallelDesc& parallel_desc, int64_t parallel_id,
+                                       const TransportToken& transport_token) {
+  if (in != out) { std::memcpy(out, in, elem_cnt * sizeof(T)); }
+  auto recv_buffer = std::make_unique<T[]>(elem_cnt);
+  for (int64_t mask = 1; mask < parallel_desc.parallel_num(); mask <<= 1) {
+    const int64_t peer = JUST(parallel_desc.MachineId4ParallelId(parallel_id ^ mask));
+    TransportCtxPtr send_ctx;
+    TransportCtxPtr recv_ctx;
+    JUST(AsyncSendDataToRank(peer, transport_token, out, elem_cnt * sizeof(T), &send_ctx));
+    JUST(AsyncReceiveDataFromRank(peer, transport_token, recv_buffer.get(), elem_cnt * sizeof(T),
+                                  &recv_ctx));
+    JUST(WaitDone(&recv_ctx));
+    JUST(WaitDone(&send_ctx));
+    VecAdd(elem_cnt, out, out, recv_buffer.get());
+  }
+  return Maybe<void>::Ok();
+}
+
+// Binomial tree reduce to parallel id 0 followed by a broadcast along the same tree.
+template<typename T>
+Maybe<void> TreeAllReduce(const T* in, T* out, size_t elem_cnt, const ParallelDesc& parallel_desc,
+                          int64_t parallel_id, const TransportToken& transport_token) {
+  if (in != out) { std::memcpy(out, in, elem_cnt * sizeof(T)); }
+  const int64_t parallel_num = parallel_desc.parallel_num();
+  const size_t size = elem_cnt * sizeof(T);
+  auto recv_buffer = std::make_unique<T[]>(elem_cnt);
+  for (int64_t mask = 1; mask < parallel_num; mask <<= 1) {
+    if (parallel_id & mask) {
+      const int64_t parent = JUST(parallel_desc.MachineId4ParallelId(parallel_id - mask));
+      TransportCtxPtr send_ctx;
+      JUST(AsyncSendDataToRank(parent, transport_token, out, size, &send_ctx));
+      JUST(WaitDone(&send_ctx));
+      break;
+    } else if (parallel_id + mask < parallel_num) {
+      const int64_t child = JUST(parallel_desc.MachineId4ParallelId(parallel_id + mask));
+      TransportCtxPtr recv_ctx;
+      JUST(AsyncReceiveDataFromRank(child, transport_token, recv_buffer.get(), size, &recv_ctx));
+      JUST(WaitDone(&recv_ctx));
+      VecAdd(elem_cnt, out, out, recv_buffer.get());
+    }
+  }
+  int64_t lowbit = parallel_id & -parallel_id;
+  if (parallel_id == 0) {
+    lowbit = 1;
+    while (lowbit < parallel_num) { lowbit <<= 1; }
+  } else {
+    const int64_t parent = JUST(parallel_desc.MachineId4ParallelId(parallel_id - lowbit));
+    TransportCtxPtr recv_ctx;
+    JUST(AsyncReceiveDataFromRank(parent, transport_token, out, size, &recv_ctx));
+    JUST(WaitDone(&recv_ctx));
+  }
+  std::vector<TransportCtxPtr> send_ctxs;
+  for (int64_t mask = lowbit >> 1; mask > 0; mask >>= 1) {
+    if (parallel_id + mask >= parallel_num) { continue; }
+    const int64_t child = JUST(parallel_desc.MachineId4ParallelId(parallel_id + mask));
+    send_ctxs.emplace_back();
+    JUST(AsyncSendDataToRank(child, transport_token, out, size, &send_ctxs.back()));
+  }
+  for (auto& ctx : send_ctxs) { JUST(WaitDone(&ctx)); }
+  return Maybe<void>::Ok();
+}
+
+// Ranks on one node exchange data through POSIX shared memory. Every rank owns a segment made of
+// a barrier counter and a data region and maps the segments of the other ranks, the transport is
+// only used to exchange segment names when the segments grow.
+class CpuShmComm final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuShmComm);
+  CpuShmComm(int64_t parallel_id, int64_t parallel_num)
+      : parallel_id_(parallel_id), parallel_num_(parallel_num), barrier_cnt_(0), capacity_(0) {}
+  ~CpuShmComm() = default;
+
+  // Segments are cached per thread since the transport tokens are thread local too.
+  static Maybe<CpuShmComm*> Get(Symbol<ParallelDesc> parallel_desc, size_t size) {
+    static thread_local HashMap<Symbol<ParallelDesc>, std::unique_ptr<CpuShmComm>>
+        parallel_desc2comm;
+    auto& comm = parallel_desc2comm[parallel_desc];
+    if (!comm) {
+      const auto& opt_parallel_id = JUST(GetParallelId4CurrentProcessCtx(parallel_desc));
+      CHECK_OR_RETURN(opt_parallel_id->has_value());
+      comm.reset(new CpuShmComm(JUST(*opt_parallel_id), parallel_desc->parallel_num()));
+    }
+    JUST(comm->Reserve(parallel_desc, size));
+    return comm.get();
+  }
+
+  int64_t parallel_id() const { return parallel_id_; }
+  int64_t parallel_num() const { return parallel_num_; }
+  char* mut_data(int64_t parallel_id) {
+    return segments_.at(parallel_id)->mut_buf() + kHeaderSize;
+  }
+
+  void Barrier() {
+    barrier_cnt_ += 1;
+    Counter(parallel_id_)->store(barrier_cnt_, std::memory_order_release);
+    for (int64_t i = 0; i < parallel_num_; ++i) {
+      while (Counter(i)->load(std::memory_order_acquire) < barrier_cnt_) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+ private:
+  static constexpr size_t kHeaderSize = 128;
+  static constexpr size_t kMaxNameSize = 64;
+
+  std::atomic<int64_t>* Counter(int64_t parallel_id) {
+    return reinterpret_cast<std::atomic<int64_t>*>(segments_.at(parallel_id)->mut_buf());
+  }
+
+  Maybe<void> Reserve(Symbol<ParallelDesc> parallel_desc, size_t size) {
+    if (!segments_.empty() && size <= capacity_) { return Maybe<void>::Ok(); }
+    // NOTE: all ranks grow at the same call since they see the same sizes.
+    const size_t capacity = RoundUp(std::max(size, capacity_ * 2), 4096);
+    std::shared_ptr<ipc::SharedMemory> own_segment =
+        JUST(ipc::SharedMemory::Open(kHeaderSize + capacity, /*create=*/true));
+    CHECK_LT_OR_RETURN(own_segment->name().size(), kMaxNameSize);
+    std::vector<char> names(parallel_num_ * kMaxNameSize, 0);
+    std::memcpy(&names[parallel_id_ * kMaxNameSize], own_segment->name().data(),
+                own_segment->name().size());
+    const auto& rank_group = JUST(RankGroup::New(parallel_desc));
+    TransportToken transport_token =
+        JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
+    BalancedSplitter bs(names.size(), parallel_num_);
+    JUST(PipelinedRingAllGather(names.data(), bs, parallel_num_, parallel_id_, rank_group,
+                                transport_token));
+    // Every rank has left the previous collective once names are exchanged, so the old segments
+    // are not used any more.
+    segments_.clear();
+    for (int64_t i = 0; i < parallel_num_; ++i) {
+      if (i == parallel_id_) {
+        segments_.emplace_back(own_segment);
+      } else {
+        segments_.emplace_back(
+            JUST(ipc::SharedMemory::Open(std::string(&names[i * kMaxNameSize]), false)));
+      }
+    }
+    barrier_cnt_ = 0;
+    capacity_ = capacity;
+    Barrier();
+    // Every rank has mapped the segment, the name is not needed any more.
+    JUST(own_segment->Unlink());
+    return Maybe<void>::Ok();
+  }
+
+  int64_t parallel_id_;
+  int64_t parallel_num_;
+  int64_t barrier_cnt_;
+  size_t capacity_;
+  std::vector<std::shared_ptr<ipc::SharedMemory>> segments_;
+};
+
+// Each rank reduces its own part reading the inputs of all ranks, then gathers the reduced parts.
+template<typename T>
+Maybe<void> ShmAllReduce(const T* in, T* out, size_t elem_cnt,
+                         Symbol<ParallelDesc> parallel_desc) {
+  CpuShmComm* comm = JUST(CpuShmComm::Get(parallel_desc, elem_cnt * sizeof(T)));
+  const int64_t parallel_num = comm->parallel_num();
+  const int64_t parallel_id = comm->parallel_id();
+  std::vector<T*> bufs(parallel_num);
+  for (int64_t i = 0; i < parallel_num; ++i) {
+    bufs[i] = reinterpret_cast<T*>(comm->mut_data(i));
+  }
+  std::memcpy(bufs[parallel_id], in, elem_cnt * sizeof(T));
+  comm->Barrier();
+  BalancedSplitter bs(elem_cnt, parallel_num);
+  const Range range = bs.At(parallel_id);
+  T* own_part = &bufs[parallel_id][range.begin()];
+  if (range.size() > 0) {
+    for (int64_t i = 1; i < parallel_num; ++i) {
+      const int64_t src = (parallel_id + i) % parallel_num;
+      VecAdd(range.size(), own_part, own_part, &bufs[src][range.begin()]);
+    }
+  }
+  comm->Barrier();
+  for (int64_t i = 0; i < parallel_num; ++i) {
+    const Range part = bs.At(i);
+    std::memcpy(&out[part.begin()], &bufs[i][part.begin()], part.size() * sizeof(T));
+  }
+  // Peers may still read the segment of this rank.
+  comm->Barrier();
+  return Maybe<void>::Ok();
+}
+
+template<typename T>
+Maybe<void> ShmReduceScatter(const T* in, T* out, size_t elem_cnt,
+                             Symbol<ParallelDesc> parallel_desc) {
+  const int64_t parallel_num = parallel_desc->parallel_num();
+  CpuShmComm* comm = JUST(CpuShmComm::Get(parallel_desc, elem_cnt * parallel_num * sizeof(T)));
+  const int64_t parallel_id = comm->parallel_id();
+  std::memcpy(comm->mut_data(parallel_id), in, elem_cnt * parallel_num * sizeof(T));
+  comm->Barrier();
+  const size_t offset = parallel_id * elem_cnt;
+  std::memcpy(out, &reinterpret_cast<const T*>(comm->mut_data(parallel_id))[offset],
+              elem_cnt * sizeof(T));
+  for (int64_t i = 1; i < parallel_num; ++i) {
+    const int64_t src = (parallel_id + i) % parallel_num;
+    VecAdd(elem_cnt, out, out, &reinterpret_cast<const T*>(comm->mut_data(src))[offset]);
+  }
+  comm->Barrier();
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> ShmAllGather(const void* in, void* out, size_t size,
+                         Symbol<ParallelDesc> parallel_desc) {
+  CpuShmComm* comm = JUST(CpuShmComm::Get(parallel_desc, size));
+  std::memcpy(comm->mut_data(comm->parallel_id()), in, size);
+  comm->Barrier();
+  for (int64_t i = 0; i < comm->parallel_num(); ++i) {
+    std::memcpy(reinterpret_cast<char*>(out) + i * size, comm->mut_data(i), size);
+  }
+  comm->Barrier();
+  return Maybe<void>::Ok();
+}
+
 }  // namespace
 
 template<typename T, ReduceType reduce_type>
@@ -77,81 +543,25 @@ struct DtypeAllReduce<T, kSum> {
     }
     const T* in = reinterpret_cast<const T*>(void_in);
     T* out = reinterpret_cast<T*>(void_out);
-    BalancedSplitter bs(elem_cnt, parallel_num);
-    auto recv_buffer = std::make_unique<T[]>(bs.At(0).size());
+    const CpuCclAlgo algo = JUST(GetCpuCclAlgo(*parallel_desc, elem_cnt * sizeof(T), true));
+    if (algo == CpuCclAlgo::kShm) { return ShmAllReduce(in, out, elem_cnt, parallel_desc); }
     Optional<int64_t> parallel_id;
     JUST(GetTensorDevice4CurrentProcessCtx(parallel_desc, &parallel_id));
-    const auto& rank_group = JUST(RankGroup::New(parallel_desc));
     TransportToken transport_token =
         JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
-    for (int64_t i = 0, part_id = JUST(parallel_id); i < parallel_num - 1;
-         ++i, part_id = RingDecrease(part_id, parallel_num)) {
-      int64_t send_part_id = part_id;
-      const T* send_ptr = nullptr;
-      if (i == 0) {
-        send_ptr = &in[bs.At(send_part_id).begin()];
-      } else {
-        send_ptr = &out[bs.At(send_part_id).begin()];
-      }
-      size_t send_size = bs.At(send_part_id).size();
-      int64_t recv_part_id = RingDecrease(part_id, parallel_num);
-      T* recv_ptr = recv_buffer.get();
-      size_t recv_size = bs.At(recv_part_id).size();
-      NaiveAsyncTransportCtx ctx(
-          transport_token,
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = const_cast<T*>(send_ptr);
-            *size = send_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          },
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = recv_ptr;
-            *size = recv_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          });
-      if (send_size > 0) {
-        JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-      }
-      if (recv_size > 0) {
-        JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-      }
-      JUST(ctx.WaitDone());
-      const T* cur_in = &in[bs.At(recv_part_id).begin()];
-      T* cur_out = &out[bs.At(recv_part_id).begin()];
-      if (recv_size > 0) { VecAdd(recv_size, cur_out, cur_in, recv_ptr); }
-    }
-    for (int64_t i = 0, part_id = RingIncrease(JUST(parallel_id), parallel_num);
-         i < parallel_num - 1; ++i, part_id = RingDecrease(part_id, parallel_num)) {
-      int64_t send_part_id = part_id;
-      const T* send_ptr = &out[bs.At(send_part_id).begin()];
-      size_t send_size = bs.At(send_part_id).size();
-      int64_t recv_part_id = RingDecrease(part_id, parallel_num);
-      T* recv_ptr = &out[bs.At(recv_part_id).begin()];
-      size_t recv_size = bs.At(recv_part_id).size();
-      NaiveAsyncTransportCtx ctx(
-          transport_token,
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = const_cast<T*>(send_ptr);
-            *size = send_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          },
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = recv_ptr;
-            *size = recv_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          });
-      if (send_size > 0) {
-        JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-      }
-      if (recv_size > 0) {
-        JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-      }
-      JUST(ctx.WaitDone());
+    if (algo == CpuCclAlgo::kRecursiveDoubling) {
+      return RecursiveDoublingAllReduce(in, out, elem_cnt, *parallel_desc, JUST(parallel_id),
+                                        transport_token);
+    } else if (algo == CpuCclAlgo::kTree) {
+      return TreeAllReduce(in, out, elem_cnt, *parallel_desc, JUST(parallel_id), transport_token);
     }
+    BalancedSplitter bs(elem_cnt, parallel_num);
+    const auto& rank_group = JUST(RankGroup::New(parallel_desc));
+    const int64_t reduced_part = RingIncrease(JUST(parallel_id), parallel_num);
+    JUST(PipelinedRingReduceScatter(in, &out[bs.At(reduced_part).begin()], bs, parallel_num,
+                                    JUST(parallel_id), rank_group, transport_token));
+    JUST(PipelinedRingAllGather(out, bs, parallel_num, reduced_part, rank_group,
+                                transport_token));
     return Maybe<void>::Ok();
   }
 };
@@ -185,55 +595,20 @@ struct DtypeReduceScatter<T, kSum> {
 
     const T* in = reinterpret_cast<const T*>(void_in);
     T* out = reinterpret_cast<T*>(void_out);
+    const CpuCclAlgo algo =
+        JUST(GetCpuCclAlgo(*parallel_desc, elem_cnt * parallel_num * sizeof(T), false));
+    if (algo == CpuCclAlgo::kShm) { return ShmReduceScatter(in, out, elem_cnt, parallel_desc); }
 
     BalancedSplitter bs(elem_cnt * parallel_num, parallel_num);
     const auto& opt_parallel_id = JUST(GetParallelId4CurrentProcessCtx(parallel_desc));
     CHECK_OR_RETURN(opt_parallel_id->has_value());
     int64_t parallel_id = JUST(*opt_parallel_id);
-
-    auto recv_buffer = std::make_unique<T[]>(bs.At(0).size());
     const auto& rank_group = JUST(RankGroup::New(parallel_desc));
-
     TransportToken transport_token =
         JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
-    for (int64_t i = 0, part_id = RingDecrease(parallel_id, parallel_num); i < parallel_num - 1;
-         ++i, part_id = RingDecrease(part_id, parallel_num)) {
-      int64_t send_part_id = part_id;
-      const T* send_ptr = nullptr;
-      if (i == 0) {
-        send_ptr = &in[bs.At(send_part_id).begin()];
-      } else {
-        send_ptr = out;
-      }
-      size_t send_size = bs.At(send_part_id).size();
-      int64_t recv_part_id = RingDecrease(part_id, parallel_num);
-      T* recv_ptr = recv_buffer.get();
-      size_t recv_size = bs.At(recv_part_id).size();
-      NaiveAsyncTransportCtx ctx(
-          transport_token,
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = const_cast<T*>(send_ptr);
-            *size = send_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          },
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = recv_ptr;
-            *size = recv_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          });
-      if (send_size > 0) {
-        JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-      }
-      if (recv_size > 0) {
-        JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-      }
-      JUST(ctx.WaitDone());
-      const T* cur_in = &in[bs.At(recv_part_id).begin()];
-      if (recv_size > 0) { VecAdd(recv_size, out, cur_in, recv_ptr); }
-    }
-    return Maybe<void>::Ok();
+    return PipelinedRingReduceScatter(in, out, bs, parallel_num,
+                                      RingDecrease(parallel_id, parallel_num), rank_group,
+                                      transport_token);
   }
 };
 
@@ -262,6 +637,8 @@ Maybe<void> AllGather<DeviceType::kCPU>(const void* in, void* out, size_t elem_c
   }
   char* char_out = reinterpret_cast<char*>(out);
   size_t chunk_size = elem_cnt * GetSizeOfDataType(dtype);
+  const CpuCclAlgo algo = JUST(GetCpuCclAlgo(*parallel_desc, chunk_size * parallel_num, false));
+  if (algo == CpuCclAlgo::kShm) { return ShmAllGather(in, out, chunk_size, parallel_desc); }
   BalancedSplitter bs(chunk_size * parallel_num, parallel_num);
   const auto& opt_parallel_id = JUST(GetParallelId4CurrentProcessCtx(parallel_desc));
   CHECK_OR_RETURN(opt_parallel_id->has_value());
@@ -272,37 +649,8 @@ Maybe<void> AllGather<DeviceType::kCPU>(const void* in, void* out, size_t elem_c
   if (in != &char_out[parallel_id * chunk_size]) {
     memcpy(&char_out[parallel_id * chunk_size], in, chunk_size);
   }
-  for (int64_t i = 0, part_id = parallel_id; i < parallel_num - 1;
-       ++i, part_id = RingDecrease(part_id, parallel_num)) {
-    int64_t send_part_id = part_id;
-    const void* send_ptr = &char_out[bs.At(send_part_id).begin()];
-    size_t send_size = bs.At(send_part_id).size();
-    int64_t recv_part_id = RingDecrease(part_id, parallel_num);
-    void* recv_ptr = &char_out[bs.At(recv_part_id).begin()];
-    size_t recv_size = bs.At(recv_part_id).size();
-    NaiveAsyncTransportCtx ctx(
-        transport_token,
-        [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-          *buffer = const_cast<void*>(send_ptr);
-          *size = send_size;
-          *Cb = [] {};
-          return Maybe<void>::Ok();
-        },
-        [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-          *buffer = recv_ptr;
-          *size = recv_size;
-          *Cb = [] {};
-          return Maybe<void>::Ok();
-        });
-    if (send_size > 0) {
-      JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-    }
-    if (recv_size > 0) {
-      JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-    }
-    JUST(ctx.WaitDone());
-  }
-  return Maybe<void>::Ok();
+  return PipelinedRingAllGather(char_out, bs, parallel_num, parallel_id, rank_group,
+                                transport_token);
 }
 
 template<>
@@ -372,49 +720,14 @@ struct DtypeReduce<T, kSum> {
       tmp_out = tmp_out_buffer.get();
     }
 
-    auto recv_buffer = std::make_unique<T[]>(bs.At(0).size());
     Optional<int64_t> parallel_id;
     JUST(GetTensorDevice4CurrentProcessCtx(parallel_desc, &parallel_id));
     const auto& rank_group = JUST(RankGroup::New(parallel_desc));
     TransportToken transport_token =
         JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
-    for (int64_t i = 0, part_id = RingDecrease(JUST(parallel_id), parallel_num);
-         i < parallel_num - 1; ++i, part_id = RingDecrease(part_id, parallel_num)) {
-      int64_t send_part_id = part_id;
-      const T* send_ptr = nullptr;
-      if (i == 0) {
-        send_ptr = &in[bs.At(send_part_id).begin()];
-      } else {
-        send_ptr = tmp_out;
-      }
-      size_t send_size = bs.At(send_part_id).size();
-      int64_t recv_part_id = RingDecrease(part_id, parallel_num);
-      T* recv_ptr = recv_buffer.get();
-      size_t recv_size = bs.At(recv_part_id).size();
-      NaiveAsyncTransportCtx ctx(
-          transport_token,
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = const_cast<T*>(send_ptr);
-            *size = send_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          },
-          [&](void** buffer, std::size_t* size, std::function<void()>* Cb) -> Maybe<void> {
-            *buffer = recv_ptr;
-            *size = recv_size * sizeof(T);
-            *Cb = [] {};
-            return Maybe<void>::Ok();
-          });
-      if (send_size > 0) {
-        JUST(TransportUtil::SendToNextRankInRing(rank_group, transport_token, &ctx));
-      }
-      if (recv_size > 0) {
-        JUST(TransportUtil::ReceiveFromPrevRankInRing(rank_group, transport_token, &ctx));
-      }
-      JUST(ctx.WaitDone());
-      const T* cur_in = &in[bs.At(recv_part_id).begin()];
-      if (recv_size > 0) { VecAdd(recv_size, tmp_out, cur_in, recv_ptr); }
-    }
+    JUST(PipelinedRingReduceScatter(in, tmp_out, bs, parallel_num,
+                                    RingDecrease(JUST(parallel_id), parallel_num), rank_group,
+                                    transport_token));
 
     if (root == GlobalProcessCtx::Rank() && void_in == void_out) {
       memcpy(&out[bs.At(parallel_id_of_root).begin()], tmp_out,
@@ -21,6 +21,8 @@ limitations under the License.
 namespace oneflow {
 
 DEFINE_THREAD_LOCAL_ENV_BOOL(ONEFLOW_VM_WORKLOAD_ON_SCHEDULER_THREAD, false);
+// The number of worker threads of the cpu compute stream.
+DEFINE_ENV_INTEGER(ONEFLOW_VM_CPU_COMPUTE_STREAM_WIDTH, 1);
 
 }
 #endif  // ONEFLOW_CORE_COMMON_ENV_VAR_VM_H_
@@ -0,0 +1,156 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_LOCK_FREE_CHANNEL_H_
+#define ONEFLOW_CORE_COMMON_LOCK_FREE_CHANNEL_H_
+
+#include <atomic>
+#include "oneflow/core/common/channel.h"
+
+namespace oneflow {
+
+// Multi-producer single-consumer channel. Senders push onto a lock-free stack and the receiver
+// detaches the whole stack at once, so the only lock taken is the one used to park/wake the
+// receiver when the channel transits from empty to non-empty.
+// NOTE: Receive and ReceiveMany must be called from one thread at a time.
+template<typename T>
+class LockFreeChannel final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(LockFreeChannel);
+  LockFreeChannel() : head_(nullptr), is_closed_(false) {}
+  ~LockFreeChannel();
+
+  template<typename U>
+  ChannelStatus Send(U&& item);
+  ChannelStatus Receive(T* item);
+  ChannelStatus ReceiveMany(std::queue<T>* items);
+  void Close();
+
+ private:
+  struct Node {
+    template<typename U>
+    explicit Node(U&& item) : value(std::forward<U>(item)), next(nullptr) {}
+    T value;
+    Node* next;
+  };
+
+  // Detaches all pending nodes, blocking until there is at least one or the channel is closed.
+  // Returned list is in FIFO order.
+  Node* WaitAndDetachAll();
+
+  std::atomic<Node*> head_;
+  std::atomic<bool> is_closed_;
+  std::queue<T> pending_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};
+
+template<typename T>
+LockFreeChannel<T>::~LockFreeChannel() {
+  Node* node = head_.exchange(nullptr);
+  while (node != nullptr) {
+    Node* next = node->next;
+    delete node;
+    node = next;
+  }
+}
+
+template<typename T>
+template<typename U>
+ChannelStatus LockFreeChannel<T>::Send(U&& item) {
+  if (is_closed_.load(std::memory_order_acquire)) { return kChannelStatusErrorClosed; }
+  Node* node = new Node(std::forward<U>(item));
+  Node* old_head = head_.load(std::memory_order_relaxed);
+  do {
+    node->next = old_head;
+  } while (!head_.compare_exchange_weak(old_head, node, std::memory_order_release,
+                                        std::memory_order_relaxed));
+  if (old_head == nullptr) {
+    // NOTE: notify under the lock, otherwise the wakeup may be lost between the receiver checking
+    // the predicate and going to sleep.
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.notify_one();
+  }
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+typename LockFreeChannel<T>::Node* LockFreeChannel<T>::WaitAndDetachAll() {
+  Node* head = head_.exchange(nullptr, std::memory_order_acquire);
+  if (head == nullptr) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() {
+      return head_.load(std::memory_order_acquire) != nullptr
+             || is_closed_.load(std::memory_order_acquire);
+    });
+    head = head_.exchange(nullptr, std::memory_order_acquire);
+  }
+  Node* reversed = nullptr;
+  while (head != nullptr) {
+    Node* next = head->next;
+    head->next = reversed;
+    reversed = head;
+    head = next;
+  }
+  return reversed;
+}
+
+template<typename T>
+ChannelStatus LockFreeChannel<T>::Receive(T* item) {
+  if (pending_.empty()) {
+    Node* node = WaitAndDetachAll();
+    if (node == nullptr) { return kChannelStatusErrorClosed; }
+    while (node != nullptr) {
+      Node* next = node->next;
+      pending_.push(std::move(node->value));
+      delete node;
+      node = next;
+    }
+  }
+  *item = std::move(pending_.front());
+  pending_.pop();
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+ChannelStatus LockFreeChannel<T>::ReceiveMany(std::queue<T>* items) {
+  if (!pending_.empty()) {
+    while (!pending_.empty()) {
+      items->push(std::move(pending_.front()));
+      pending_.pop();
+    }
+    return kChannelStatusSuccess;
+  }
+  Node* node = WaitAndDetachAll();
+  if (node == nullptr) { return kChannelStatusErrorClosed; }
+  while (node != nullptr) {
+    Node* next = node->next;
+    items->push(std::move(node->value));
+    delete node;
+    node = next;
+  }
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+void LockFreeChannel<T>::Close() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  is_closed_.store(true, std::memory_order_release);
+  cond_.notify_all();
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_LOCK_FREE_CHANNEL_H_
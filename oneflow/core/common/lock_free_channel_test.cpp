@@ -0,0 +1,136 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include "gtest/gtest.h"
+#include "oneflow/core/common/lock_free_channel.h"
+#include "oneflow/core/common/range.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace {
+
+void SendRange(LockFreeChannel<int>* channel, Range range) {
+  for (int i = range.begin(); i < range.end(); ++i) {
+    if (channel->Send(i) != kChannelStatusSuccess) { break; }
+  }
+}
+
+struct ChainMsg {
+  int64_t dst_actor_id;
+  int64_t hop;
+};
+
+// A synthetic chain plan: actor i lives on thread (i % thread_num) and forwards every message it
+// receives to actor (i + 1). The actor table is either a HashMap keyed by actor id (the old
+// dispatch) or a dense vector indexed by the per-thread actor index.
+template<template<typename> class ChannelT, bool dense_actor_table>
+double RunChainPlan(int64_t thread_num, int64_t actor_num, int64_t msg_num) {
+  std::vector<std::unique_ptr<ChannelT<ChainMsg>>> channels(thread_num);
+  for (auto& channel : channels) { channel.reset(new ChannelT<ChainMsg>()); }
+  std::atomic<int64_t> remaining(msg_num);
+  auto ThreadLoop = [&](int64_t thrd_idx) {
+    HashMap<int64_t, int64_t> id2next;
+    std::vector<int64_t> index2next;
+    for (int64_t actor_id = thrd_idx; actor_id < actor_num; actor_id += thread_num) {
+      const int64_t next = (actor_id + 1) % actor_num;
+      if (dense_actor_table) {
+        index2next.push_back(next);
+      } else {
+        id2next.emplace(actor_id, next);
+      }
+    }
+    std::queue<ChainMsg> local_queue;
+    while (channels.at(thrd_idx)->ReceiveMany(&local_queue) == kChannelStatusSuccess) {
+      while (!local_queue.empty()) {
+        ChainMsg msg = local_queue.front();
+        local_queue.pop();
+        const int64_t next = dense_actor_table ? index2next[msg.dst_actor_id / thread_num]
+                                               : id2next.at(msg.dst_actor_id);
+        if (msg.hop + 1 == actor_num) {
+          if (remaining.fetch_sub(1) == 1) {
+            for (auto& channel : channels) { channel->Close(); }
+          }
+          continue;
+        }
+        channels.at(next % thread_num)->Send(ChainMsg{next, msg.hop + 1});
+      }
+    }
+  };
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int64_t i = 0; i < thread_num; ++i) { threads.emplace_back(ThreadLoop, i); }
+  for (int64_t i = 0; i < msg_num; ++i) { channels.at(0)->Send(ChainMsg{0, 0}); }
+  for (auto& thread : threads) { thread.join(); }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return static_cast<double>(msg_num * actor_num) / seconds;
+}
+
+}  // namespace
+
+TEST(LockFreeChannel, 30sender1receiver) {
+  LockFreeChannel<int> channel;
+  std::vector<std::thread> senders;
+  int sender_num = 30;
+  int range_num = 200;
+  std::vector<int> visit(range_num, 0);
+  for (int i = 0; i < sender_num; ++i) {
+    senders.emplace_back(SendRange, &channel, Range(0, range_num));
+  }
+  std::thread receiver([&]() {
+    std::queue<int> items;
+    while (channel.ReceiveMany(&items) == kChannelStatusSuccess) {
+      while (!items.empty()) {
+        ++visit.at(items.front());
+        items.pop();
+      }
+    }
+  });
+  for (std::thread& this_thread : senders) { this_thread.join(); }
+  channel.Close();
+  receiver.join();
+  for (int i = 0; i < range_num; ++i) { ASSERT_EQ(visit[i], sender_num); }
+}
+
+TEST(LockFreeChannel, fifo_per_sender) {
+  LockFreeChannel<int> channel;
+  std::thread sender(SendRange, &channel, Range(0, 10000));
+  int expected = 0;
+  int item = -1;
+  while (expected < 10000 && channel.Receive(&item) == kChannelStatusSuccess) {
+    ASSERT_EQ(item, expected);
+    ++expected;
+  }
+  sender.join();
+  channel.Close();
+  ASSERT_EQ(channel.Receive(&item), kChannelStatusErrorClosed);
+}
+
+TEST(LockFreeChannel, chain_plan_benchmark) {
+  if (!ParseBooleanFromEnv("ONEFLOW_TEST_BENCHMARK", false)) {
+    GTEST_SKIP() << "set ONEFLOW_TEST_BENCHMARK=1 to run";
+  }
+  const int64_t thread_num = 4;
+  const int64_t actor_num = 64;
+  const int64_t msg_num = 2000;
+  const double baseline = RunChainPlan<Channel, false>(thread_num, actor_num, msg_num);
+  const double lock_free = RunChainPlan<LockFreeChannel, true>(thread_num, actor_num, msg_num);
+  RecordProperty("channel_and_hash_map_msgs_per_sec", std::to_string(baseline));
+  RecordProperty("lock_free_channel_and_dense_table_msgs_per_sec", std::to_string(lock_free));
+}
+
+}  // namespace oneflow
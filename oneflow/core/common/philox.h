@@ -0,0 +1,115 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_PHILOX_H_
+#define ONEFLOW_CORE_COMMON_PHILOX_H_
+
+#include <cstdint>
+
+namespace oneflow {
+
+// The counter based Philox4x32-10 generator of Random123. Block i of the stream of a seed is the
+// encryption of the counter {lo(i), hi(i), 0, 0} by the key {lo(seed), hi(seed)}, so any range
+// of blocks can be generated independently of the others.
+class Philox4x32 final {
+ public:
+  static constexpr int kBlockSize = 4;
+  static constexpr int kLaneNum = 8;
+
+  Philox4x32() : Philox4x32(0) {}
+  explicit Philox4x32(uint64_t seed)
+      : key_{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)} {}
+  ~Philox4x32() = default;
+
+  static void Block(const uint32_t* counter, const uint32_t* key, uint32_t* out) {
+    uint32_t c[kBlockSize] = {counter[0], counter[1], counter[2], counter[3]};
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+    for (int round = 0; round < kRoundNum; ++round) {
+      const uint64_t p0 = static_cast<uint64_t>(kM0) * c[0];
+      const uint64_t p1 = static_cast<uint64_t>(kM1) * c[2];
+      c[0] = static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k0;
+      c[1] = static_cast<uint32_t>(p1);
+      c[2] = static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k1;
+      c[3] = static_cast<uint32_t>(p0);
+      k0 += kW0;
+      k1 += kW1;
+    }
+    for (int i = 0; i < kBlockSize; ++i) { out[i] = c[i]; }
+  }
+
+  // Writes the blocks [block_index, block_index + block_num) to out, kBlockSize words per block.
+  void Generate(uint64_t block_index, int64_t block_num, uint32_t* out) const {
+    int64_t i = 0;
+    for (; i + kLaneNum <= block_num; i += kLaneNum) {
+      GenerateLanes(block_index + i, out + i * kBlockSize);
+    }
+    for (; i < block_num; ++i) {
+      const uint64_t index = block_index + i;
+      const uint32_t counter[kBlockSize] = {static_cast<uint32_t>(index),
+                                            static_cast<uint32_t>(index >> 32), 0, 0};
+      Block(counter, key_, out + i * kBlockSize);
+    }
+  }
+
+ private:
+  static constexpr int kRoundNum = 10;
+  static constexpr uint32_t kM0 = 0xD2511F53;
+  static constexpr uint32_t kM1 = 0xCD9E8D57;
+  static constexpr uint32_t kW0 = 0x9E3779B9;
+  static constexpr uint32_t kW1 = 0xBB67AE85;
+
+  // Block with the words of kLaneNum consecutive counters in separate arrays, which the compiler
+  // keeps in vector registers.
+  void GenerateLanes(uint64_t block_index, uint32_t* out) const {
+    uint32_t c0[kLaneNum];
+    uint32_t c1[kLaneNum];
+    uint32_t c2[kLaneNum];
+    uint32_t c3[kLaneNum];
+    for (int lane = 0; lane < kLaneNum; ++lane) {
+      const uint64_t index = block_index + lane;
+      c0[lane] = static_cast<uint32_t>(index);
+      c1[lane] = static_cast<uint32_t>(index >> 32);
+      c2[lane] = 0;
+      c3[lane] = 0;
+    }
+    uint32_t k0 = key_[0];
+    uint32_t k1 = key_[1];
+    for (int round = 0; round < kRoundNum; ++round) {
+      for (int lane = 0; lane < kLaneNum; ++lane) {
+        const uint64_t p0 = static_cast<uint64_t>(kM0) * c0[lane];
+        const uint64_t p1 = static_cast<uint64_t>(kM1) * c2[lane];
+        c0[lane] = static_cast<uint32_t>(p1 >> 32) ^ c1[lane] ^ k0;
+        c1[lane] = static_cast<uint32_t>(p1);
+        c2[lane] = static_cast<uint32_t>(p0 >> 32) ^ c3[lane] ^ k1;
+        c3[lane] = static_cast<uint32_t>(p0);
+      }
+      k0 += kW0;
+      k1 += kW1;
+    }
+    for (int lane = 0; lane < kLaneNum; ++lane) {
+      out[lane * kBlockSize + 0] = c0[lane];
+      out[lane * kBlockSize + 1] = c1[lane];
+      out[lane * kBlockSize + 2] = c2[lane];
+      out[lane * kBlockSize + 3] = c3[lane];
+    }
+  }
+
+  uint32_t key_[2];
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_PHILOX_H_
@@ -0,0 +1,144 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include "oneflow/core/common/philox.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace {
+
+// Calls Consume(first_block, batch_size, bits) for batches of the blocks [0, block_num) on
+// thread_num threads, which take contiguous ranges of blocks as the kernels do.
+template<typename F>
+void ParallelGenerate(const Philox4x32& philox, int64_t block_num, int64_t thread_num,
+                      const F& Consume) {
+  const int64_t chunk = (block_num + thread_num - 1) / thread_num;
+  std::vector<std::thread> threads;
+  for (int64_t begin = 0; begin < block_num; begin += chunk) {
+    const int64_t end = std::min(block_num, begin + chunk);
+    threads.emplace_back([&philox, &Consume, begin, end]() {
+      constexpr int64_t kBatch = 256;
+      uint32_t bits[kBatch * Philox4x32::kBlockSize];
+      for (int64_t b = begin; b < end; b += kBatch) {
+        const int64_t batch_size = std::min(kBatch, end - b);
+        philox.Generate(b, batch_size, bits);
+        Consume(b, batch_size, bits);
+      }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+}
+
+}  // namespace
+
+TEST(Philox4x32, known_answers) {
+  // the known answer tests of Random123
+  const uint32_t counters[3][4] = {{0, 0, 0, 0},
+                                   {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+                                   {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}};
+  const uint32_t keys[3][2] = {{0, 0}, {0xffffffff, 0xffffffff}, {0xa4093822, 0x299f31d0}};
+  const uint32_t expected[3][4] = {{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+                                   {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+                                   {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+  for (int i = 0; i < 3; ++i) {
+    uint32_t out[4];
+    Philox4x32::Block(counters[i], keys[i], out);
+    for (int j = 0; j < 4; ++j) { ASSERT_EQ(out[j], expected[i][j]) << i << " " << j; }
+  }
+}
+
+TEST(Philox4x32, lanes_same_as_blocks) {
+  const uint64_t seed = 0x0123456789abcdefULL;
+  const uint32_t key[2] = {0x89abcdef, 0x01234567};
+  const Philox4x32 philox(seed);
+  // crosses a carry into the high word of the counter
+  const uint64_t first = 0xfffffff0ULL;
+  const int64_t block_num = 37;
+  std::vector<uint32_t> out(block_num * Philox4x32::kBlockSize);
+  philox.Generate(first, block_num, out.data());
+  for (int64_t i = 0; i < block_num; ++i) {
+    const uint64_t index = first + i;
+    const uint32_t counter[4] = {static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32),
+                                 0, 0};
+    uint32_t expected[4];
+    Philox4x32::Block(counter, key, expected);
+    for (int j = 0; j < 4; ++j) { ASSERT_EQ(out[i * 4 + j], expected[j]) << i << " " << j; }
+  }
+}
+
+TEST(Philox4x32, same_for_any_thread_num) {
+  const Philox4x32 philox(2022);
+  const int64_t block_num = 100003;
+  std::vector<uint32_t> expected(block_num * Philox4x32::kBlockSize);
+  philox.Generate(0, block_num, expected.data());
+  for (int64_t thread_num : {2, 3, 8}) {
+    std::vector<uint32_t> out(expected.size());
+    ParallelGenerate(philox, block_num, thread_num,
+                     [&](int64_t first, int64_t batch_size, const uint32_t* bits) {
+                       std::copy(bits, bits + batch_size * Philox4x32::kBlockSize,
+                                 out.data() + first * Philox4x32::kBlockSize);
+                     });
+    ASSERT_EQ(out, expected) << thread_num;
+  }
+  std::vector<uint32_t> other(expected.size());
+  Philox4x32(2023).Generate(0, block_num, other.data());
+  ASSERT_NE(other, expected);
+}
+
+TEST(Philox4x32, benchmark) {
+  if (!ParseBooleanFromEnv("ONEFLOW_TEST_BENCHMARK", false)) {
+    GTEST_SKIP() << "set ONEFLOW_TEST_BENCHMARK=1 to run";
+  }
+  const int64_t sample_num = 1 << 24;
+  const int64_t block_num = sample_num / Philox4x32::kBlockSize;
+  std::vector<float> samples(sample_num);
+  auto SamplesPerSecond = [&](const std::function<void()>& Run) {
+    Run();
+    const auto start = std::chrono::steady_clock::now();
+    Run();
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return sample_num / seconds;
+  };
+  std::mt19937 engine(0);
+  std::uniform_real_distribution<float> distribution(0, 1);
+  RecordProperty("mt19937_uniform_samples_per_sec", std::to_string(SamplesPerSecond([&]() {
+                   for (int64_t i = 0; i < sample_num; ++i) { samples[i] = distribution(engine); }
+                 })));
+  const Philox4x32 philox(0);
+  const int64_t max_thread_num = std::max<int64_t>(std::thread::hardware_concurrency(), 1);
+  for (int64_t thread_num = 1; thread_num <= max_thread_num; thread_num *= 2) {
+    const double samples_per_second = SamplesPerSecond([&]() {
+      ParallelGenerate(philox, block_num, thread_num,
+                       [&](int64_t first, int64_t batch_size, const uint32_t* bits) {
+                         float* out = samples.data() + first * Philox4x32::kBlockSize;
+                         for (int64_t i = 0; i < batch_size * Philox4x32::kBlockSize; ++i) {
+                           out[i] = (bits[i] >> 8) * (1.0f / (1 << 24));
+                         }
+                       });
+    });
+    RecordProperty("philox_uniform_" + std::to_string(thread_num) + "_threads_samples_per_sec",
+                   std::to_string(samples_per_second));
+  }
+}
+
+}  // namespace oneflow
@@ -16,10 +16,14 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_COMMON_SYMBOL_H_
 #define ONEFLOW_CORE_COMMON_SYMBOL_H_
 
+#include <algorithm>
+#include <atomic>
 #include <mutex>
 #include <memory>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include <glog/logging.h>
 #include "oneflow/core/common/type_traits.h"
 #include "oneflow/core/common/hash_eq_trait_ptr.h"
@@ -67,61 +71,167 @@ struct IsScalarType<Symbol<T>> final {
   static const bool value = true;
 };
 
+// The counts of a symbol table, those of the other threads are added every few lookups.
+struct SymbolTableStats {
+  size_t symbol_num;
+  size_t lookup_num;
+  // lookups served by the thread local caches
+  size_t local_hit_num;
+};
+
+// Symbols are interned in a global table sharded by hash, each shard is read under a shared lock.
+// A thread looks a symbol up in its own set associative cache first, the least recently used way
+// of a set is replaced. The cache starts small and doubles while a quarter of the lookups miss it,
+// up to kThreadLocalCacheMaxSize entries, so that a thread cycling through a few thousand symbols
+// takes no lock either. Cache entries refer to the entries of the global table, they are never
+// erased.
 template<typename T>
 struct SymbolUtil final {
   using SymbolMap = std::unordered_map<HashEqTraitPtr<const T>, std::shared_ptr<const T>>;
 
-  static SymbolMap* GlobalSymbolMap() {
-    static SymbolMap symbol_map;
-    return &symbol_map;
+  static constexpr int kShardNumLog2 = 6;
+  static constexpr size_t kThreadLocalCacheWayNum = 4;
+  static constexpr size_t kThreadLocalCacheSize = 256;
+  static constexpr size_t kThreadLocalCacheMaxSize = 8192;
+  static constexpr size_t kStatsFlushInterval = 1024;
+
+  struct Shard {
+    std::shared_timed_mutex mutex;
+    SymbolMap symbol_map;
+  };
+
+  struct GlobalStats {
+    std::atomic<size_t> symbol_num{0};
+    std::atomic<size_t> lookup_num{0};
+    std::atomic<size_t> local_hit_num{0};
+  };
+
+  struct ThreadLocalCache {
+    // the ways of a set are ordered from the most to the least recently used
+    struct Entry {
+      size_t hash_value;
+      const std::shared_ptr<const T>* symbol;
+    };
+
+    ThreadLocalCache() : entries(kThreadLocalCacheSize) {}
+    ~ThreadLocalCache() { FlushStats(); }
+
+    Entry* Set4HashValue(size_t hash_value) {
+      const size_t set_num = entries.size() / kThreadLocalCacheWayNum;
+      return &entries[(hash_value & (set_num - 1)) * kThreadLocalCacheWayNum];
+    }
+
+    // puts the entry into the first way of its set, the last way is evicted
+    void Insert(const Entry& entry) {
+      Entry* set = Set4HashValue(entry.hash_value);
+      std::move_backward(set, set + kThreadLocalCacheWayNum - 1, set + kThreadLocalCacheWayNum);
+      set[0] = entry;
+    }
+
+    // doubles the sets when more than a quarter of the lookups since the last flush missed, every
+    // set splits into two so no entry is evicted
+    void GrowIfThrashing() {
+      if (entries.size() >= kThreadLocalCacheMaxSize) { return; }
+      if ((lookup_num - local_hit_num) * 4 <= lookup_num) { return; }
+      std::vector<Entry> old_entries(entries.size() * 2);
+      old_entries.swap(entries);
+      for (size_t i = 0; i < old_entries.size(); i += kThreadLocalCacheWayNum) {
+        for (size_t way = kThreadLocalCacheWayNum; way > 0; --way) {
+          const Entry& entry = old_entries[i + way - 1];
+          if (entry.symbol != nullptr) { Insert(entry); }
+        }
+      }
+    }
+
+    void FlushStats() {
+      GetGlobalStats()->lookup_num += lookup_num;
+      GetGlobalStats()->local_hit_num += local_hit_num;
+      lookup_num = 0;
+      local_hit_num = 0;
+    }
+
+    std::vector<Entry> entries;
+    size_t lookup_num = 0;
+    size_t local_hit_num = 0;
+  };
+
+  static Shard* GetShard(size_t hash_value) {
+    // leaked, the symbols may be used by the destructors of other static objects
+    static Shard* shards = new Shard[1 << kShardNumLog2];
+    // the high bits of a multiplicative hash, the maps and the caches use the low bits of the hash
+    return &shards[(static_cast<uint64_t>(hash_value) * 0x9E3779B97F4A7C15ULL)
+                   >> (64 - kShardNumLog2)];
   }
 
-  static std::mutex* GlobalSymbolMapMutex() {
-    static std::mutex mutex;
-    return &mutex;
+  static GlobalStats* GetGlobalStats() {
+    static GlobalStats* stats = new GlobalStats();
+    return stats;
   }
 
-  static SymbolMap* ThreadLocalSymbolMap() {
-    static thread_local SymbolMap thread_local_symbol_map;
-    return &thread_local_symbol_map;
+  static ThreadLocalCache* GetThreadLocalCache() {
+    static thread_local ThreadLocalCache cache;
+    return &cache;
   }
 
-  static std::unordered_set<const T*>* ThreadLocalSymbolPtrSet() {
-    static thread_local std::unordered_set<const T*> thread_local_symbol_ptr_set;
-    return &thread_local_symbol_ptr_set;
+  static SymbolTableStats GetStats() {
+    GetThreadLocalCache()->FlushStats();
+    SymbolTableStats stats;
+    stats.symbol_num = GetGlobalStats()->symbol_num;
+    stats.lookup_num = GetGlobalStats()->lookup_num;
+    stats.local_hit_num = GetGlobalStats()->local_hit_num;
+    return stats;
   }
 
-  template<typename SymbolMap::iterator (*GetIter4ObjectAndHashValue)(const T&, size_t)>
+  template<const std::shared_ptr<const T>* (*GetGlobal4ObjectAndHashValue)(const T&, size_t)>
   static const std::shared_ptr<const T>& LocalThreadGetOr(const T& obj) {
-    auto* thread_local_symbol_map = ThreadLocalSymbolMap();
+    ThreadLocalCache* cache = GetThreadLocalCache();
+    if (++cache->lookup_num >= kStatsFlushInterval) {
+      cache->GrowIfThrashing();
+      cache->FlushStats();
+    }
     size_t hash_value = std::hash<T>()(obj);
-    HashEqTraitPtr<const T> obj_ptr_wraper(&obj, hash_value);
-    const auto& local_iter = thread_local_symbol_map->find(obj_ptr_wraper);
-    if (local_iter != thread_local_symbol_map->end()) { return local_iter->second; }
-    const auto& iter = GetIter4ObjectAndHashValue(obj, hash_value);
-    (*thread_local_symbol_map)[iter->first] = iter->second;
-    CHECK(ThreadLocalSymbolPtrSet()->emplace(iter->second.get()).second);
-    return iter->second;
+    auto* set = cache->Set4HashValue(hash_value);
+    for (size_t way = 0; way < kThreadLocalCacheWayNum; ++way) {
+      const auto entry = set[way];
+      if (entry.symbol != nullptr && entry.hash_value == hash_value && **entry.symbol == obj) {
+        ++cache->local_hit_num;
+        std::move_backward(set, set + way, set + way + 1);
+        set[0] = entry;
+        return *entry.symbol;
+      }
+    }
+    const std::shared_ptr<const T>* symbol = GetGlobal4ObjectAndHashValue(obj, hash_value);
+    cache->Insert({hash_value, symbol});
+    return *symbol;
   }
 
-  static typename SymbolMap::iterator FindGlobalSymbol(const T& obj, size_t hash_value) {
-    HashEqTraitPtr<const T> new_obj_ptr_wraper(&obj, hash_value);
-    auto* symbol_map = GlobalSymbolMap();
-    std::unique_lock<std::mutex> lock(*GlobalSymbolMapMutex());
-    const auto& iter = symbol_map->find(new_obj_ptr_wraper);
-    CHECK(iter != symbol_map->end());
-    return iter;
+  static const std::shared_ptr<const T>* FindGlobalSymbol(const T& obj, size_t hash_value) {
+    HashEqTraitPtr<const T> obj_ptr_wraper(&obj, hash_value);
+    Shard* shard = GetShard(hash_value);
+    std::shared_lock<std::shared_timed_mutex> lock(shard->mutex);
+    const auto& iter = shard->symbol_map.find(obj_ptr_wraper);
+    CHECK(iter != shard->symbol_map.end());
+    return &iter->second;
   }
 
   static const std::shared_ptr<const T>& SharedFromObject(const T& obj) {
     return LocalThreadGetOr<FindGlobalSymbol>(obj);
   }
 
-  static typename SymbolMap::iterator CreateGlobalSymbol(const T& obj, size_t hash_value) {
+  static const std::shared_ptr<const T>* CreateGlobalSymbol(const T& obj, size_t hash_value) {
+    Shard* shard = GetShard(hash_value);
+    {
+      HashEqTraitPtr<const T> obj_ptr_wraper(&obj, hash_value);
+      std::shared_lock<std::shared_timed_mutex> lock(shard->mutex);
+      const auto& iter = shard->symbol_map.find(obj_ptr_wraper);
+      if (iter != shard->symbol_map.end()) { return &iter->second; }
+    }
     std::shared_ptr<const T> ptr(new T(obj));
     HashEqTraitPtr<const T> new_obj_ptr_wraper(ptr.get(), hash_value);
-    std::unique_lock<std::mutex> lock(*GlobalSymbolMapMutex());
-    return GlobalSymbolMap()->emplace(new_obj_ptr_wraper, ptr).first;
+    std::unique_lock<std::shared_timed_mutex> lock(shard->mutex);
+    const auto& pair = shard->symbol_map.emplace(new_obj_ptr_wraper, ptr);
+    if (pair.second) { ++GetGlobalStats()->symbol_num; }
+    return &pair.first->second;
   }
 
   static const std::shared_ptr<const T>& GetOrCreatePtr(const T& obj) {
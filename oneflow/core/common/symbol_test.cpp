@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "gtest/gtest.h"
+#include <chrono>
+#include <thread>
 #include "oneflow/core/common/symbol.h"
 #include "oneflow/core/common/util.h"
 
@@ -34,6 +36,58 @@ class SymObject {
   std::string name_;
 };
 
+struct IntObject {
+  int64_t value;
+  bool operator==(const IntObject& other) const { return value == other.value; }
+};
+
+struct BenchObject {
+  int64_t value;
+  bool operator==(const BenchObject& other) const { return value == other.value; }
+};
+
+// The symbol table before sharding: a global map behind a mutex and unbounded thread local maps.
+template<typename T>
+struct LegacySymbolUtil final {
+  using SymbolMap = std::unordered_map<HashEqTraitPtr<const T>, std::shared_ptr<const T>>;
+
+  static const T* GetOrCreatePtr(const T& obj) {
+    static thread_local SymbolMap thread_local_symbol_map;
+    size_t hash_value = std::hash<T>()(obj);
+    HashEqTraitPtr<const T> obj_ptr_wraper(&obj, hash_value);
+    const auto& local_iter = thread_local_symbol_map.find(obj_ptr_wraper);
+    if (local_iter != thread_local_symbol_map.end()) { return local_iter->second.get(); }
+    static SymbolMap symbol_map;
+    static std::mutex mutex;
+    std::shared_ptr<const T> ptr(new T(obj));
+    HashEqTraitPtr<const T> new_obj_ptr_wraper(ptr.get(), hash_value);
+    std::unique_lock<std::mutex> lock(mutex);
+    const auto& iter = symbol_map.emplace(new_obj_ptr_wraper, ptr).first;
+    thread_local_symbol_map[iter->first] = iter->second;
+    return iter->second.get();
+  }
+};
+
+template<typename GetPtr>
+double NanosecondsPerLookup(int64_t thread_num, int64_t lookup_num, int64_t distinct_num,
+                            const GetPtr& Get) {
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int64_t t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&, t]() {
+      int64_t sum = 0;
+      for (int64_t i = 0; i < lookup_num; ++i) {
+        sum += Get(BenchObject{(i * 7919 + t) % distinct_num})->value;
+      }
+      CHECK_GE(sum, 0);
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return seconds * 1e9 / (thread_num * lookup_num);
+}
+
 }  // namespace detail
 
 TEST(Symbol, shared_from_symbol) {
@@ -42,6 +96,97 @@ TEST(Symbol, shared_from_symbol) {
               == SymbolOf(detail::SymObject("SymbolObjectFoo")).shared_from_symbol().get());
 }
 
+TEST(Symbol, same_symbol_across_threads) {
+  const int64_t thread_num = 8;
+  const int64_t object_num = 2000;
+  std::vector<std::vector<const detail::IntObject*>> thread_ptrs(thread_num);
+  std::vector<std::thread> threads;
+  for (int64_t t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&, t]() {
+      // more objects than a thread local cache holds, and in different orders
+      for (int64_t i = 0; i < object_num; ++i) {
+        const int64_t value = t % 2 == 0 ? i : object_num - 1 - i;
+        thread_ptrs.at(t).emplace_back(&*SymbolOf(detail::IntObject{value}));
+      }
+      if (t % 2 == 1) { std::reverse(thread_ptrs.at(t).begin(), thread_ptrs.at(t).end()); }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  for (int64_t i = 0; i < object_num; ++i) {
+    const auto symbol = SymbolOf(detail::IntObject{i});
+    ASSERT_EQ(symbol->value, i);
+    ASSERT_EQ(symbol.shared_from_symbol().get(), &*symbol);
+    for (int64_t t = 0; t < thread_num; ++t) { ASSERT_EQ(thread_ptrs.at(t).at(i), &*symbol); }
+  }
+  const SymbolTableStats stats = SymbolUtil<detail::IntObject>::GetStats();
+  ASSERT_EQ(stats.symbol_num, object_num);
+  ASSERT_GE(stats.lookup_num, 2 * object_num);
+  ASSERT_LE(stats.local_hit_num, stats.lookup_num);
+}
+
+TEST(Symbol, cycle_through_more_symbols_than_cache) {
+  using Util = SymbolUtil<detail::BenchObject>;
+  // a fresh thread, so that the thread local cache starts at its initial size
+  auto CycleInNewThread = [](int64_t distinct_num, int64_t pass_num, size_t* cache_size,
+                             int64_t* last_pass_hit_num) {
+    std::thread([&]() {
+      int64_t hit_num = 0;
+      for (int64_t pass = 0; pass < pass_num; ++pass) {
+        const auto before = Util::GetStats();
+        for (int64_t i = 0; i < distinct_num; ++i) {
+          ASSERT_EQ(SymbolOf(detail::BenchObject{i})->value, i);
+        }
+        const auto after = Util::GetStats();
+        ASSERT_EQ(after.lookup_num - before.lookup_num, distinct_num);
+        hit_num = after.local_hit_num - before.local_hit_num;
+      }
+      *cache_size = Util::GetThreadLocalCache()->entries.size();
+      *last_pass_hit_num = hit_num;
+    }).join();
+  };
+  const size_t initial_size = Util::kThreadLocalCacheSize;
+  const size_t max_size = Util::kThreadLocalCacheMaxSize;
+  size_t cache_size = 0;
+  int64_t hit_num = 0;
+  // a few symbols keep the cache at its initial size
+  CycleInNewThread(16, 100, &cache_size, &hit_num);
+  ASSERT_EQ(cache_size, initial_size);
+  ASSERT_EQ(hit_num, 16);
+  // more symbols than the initial cache holds, it grows until they all hit
+  const int64_t distinct_num = max_size / 2;
+  CycleInNewThread(distinct_num, 4, &cache_size, &hit_num);
+  ASSERT_GT(cache_size, initial_size);
+  ASSERT_LE(cache_size, max_size);
+  ASSERT_EQ(hit_num, distinct_num);
+  // far more symbols than the cache may hold, it stays bounded
+  CycleInNewThread(4 * max_size, 2, &cache_size, &hit_num);
+  ASSERT_EQ(cache_size, max_size);
+}
+
+TEST(Symbol, benchmark) {
+  if (!ParseBooleanFromEnv("ONEFLOW_TEST_BENCHMARK", false)) {
+    GTEST_SKIP() << "set ONEFLOW_TEST_BENCHMARK=1 to run";
+  }
+  const int64_t thread_num = std::max<int64_t>(2, std::thread::hardware_concurrency());
+  const int64_t lookup_num = 1 << 20;
+  for (int64_t distinct_num : {16, 4096}) {
+    const auto before = SymbolUtil<detail::BenchObject>::GetStats();
+    const double sharded_ns = detail::NanosecondsPerLookup(
+        thread_num, lookup_num, distinct_num,
+        [](const detail::BenchObject& obj) { return &*SymbolOf(obj); });
+    const auto after = SymbolUtil<detail::BenchObject>::GetStats();
+    const double legacy_ns = detail::NanosecondsPerLookup(
+        thread_num, lookup_num, distinct_num,
+        &detail::LegacySymbolUtil<detail::BenchObject>::GetOrCreatePtr);
+    const std::string prefix = "distinct_" + std::to_string(distinct_num);
+    RecordProperty(prefix + "_sharded_ns_per_lookup", std::to_string(sharded_ns));
+    RecordProperty(prefix + "_legacy_ns_per_lookup", std::to_string(legacy_ns));
+    RecordProperty(prefix + "_local_hit_rate",
+                   std::to_string(double(after.local_hit_num - before.local_hit_num)
+                                  / (after.lookup_num - before.lookup_num)));
+  }
+}
+
 }  // namespace test
 }  // namespace oneflow
 
@@ -54,4 +199,18 @@ struct hash<oneflow::test::detail::SymObject> final {
   }
 };
 
+template<>
+struct hash<oneflow::test::detail::IntObject> final {
+  size_t operator()(const oneflow::test::detail::IntObject& obj) const {
+    return std::hash<int64_t>()(obj.value);
+  }
+};
+
+template<>
+struct hash<oneflow::test::detail::BenchObject> final {
+  size_t operator()(const oneflow::test::detail::BenchObject& obj) const {
+    return std::hash<int64_t>()(obj.value);
+  }
+};
+
 }  // namespace std
@@ -51,8 +51,10 @@ struct OpCallInstructionUtil final {
       InferTempStorageSize(operand);
       JUST(TryAllocateTempStorage(operand, allocator));
       // Since memory block is cached in allocator, it's safe to deallocate tmp buffer before
-      // kernel executed.
-      DeallocateTempStorage(operand, allocator);
+      // kernel executed, unless the kernels of the stream run concurrently.
+      if (likely(!instruction->stream().is_multi_threaded())) {
+        DeallocateTempStorage(operand, allocator);
+      }
     }
     return Maybe<void>::Ok();
   }
@@ -71,6 +73,10 @@ struct OpCallInstructionUtil final {
       TryInitOpKernelStateAndCache(operand, stream, &state, &cache);
     }
     OpKernelCompute(operand, stream, state, cache);
+    if (unlikely(operand->need_temp_storage() && instruction->stream().is_multi_threaded())) {
+      vm::Allocator* allocator = instruction->mut_stream()->mut_stream_policy()->mut_allocator();
+      DeallocateTempStorage(operand, allocator);
+    }
   }
 
   static inline OpCallPhyInstrOperand* GetCallPhyInstrOperand(const vm::Instruction& instruction) {
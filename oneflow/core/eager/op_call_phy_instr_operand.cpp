@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/eager/dev_vm_dep_object_consume_mode.h"
 #include "oneflow/core/framework/stream_is_comm_net_stream.h"
 #include "oneflow/core/vm/stream.h"
+#include "oneflow/core/common/cpp_attribute.h"
 
 namespace oneflow {
 namespace vm {
@@ -49,7 +50,13 @@ OpCallPhyInstrOperand::OpCallPhyInstrOperand(
 }
 
 Maybe<void> OpCallPhyInstrOperand::Init() {
-  return mut_opkernel()->ChooseOpKernel(&call_ctx_, &user_opkernel_, &need_temp_storage_);
+  JUST(mut_opkernel()->ChooseOpKernel(&call_ctx_, &user_opkernel_, &need_temp_storage_));
+  if (unlikely(vm_stream_->is_multi_threaded() && user_opkernel_->has_state_or_cache())) {
+    // Sequentialize kernels with states or caches, which are not safe to be used by concurrent
+    // instructions, e.g. the random generators shared by kernels.
+    stream_sequential_dependence_ = vm_stream_->schedule_local_dep_object().get();
+  }
+  return Maybe<void>::Ok();
 }
 
 void OpCallPhyInstrOperand::ForEachConstDependence(
@@ -67,8 +74,11 @@ void OpCallPhyInstrOperand::InitStreamSequentialDependence() {
     // Sequantialize nccl instructions to avoid deadlock
     stream_sequential_dependence_ = device_schedule_dep_object;
   } else {
-    // Sequantialize instructions to avoid explosive memory allocation of source ops
-    if (dev_vm_dep_object_consume_mode() == one::DevVmDepObjectConsumeMode::MUTABLE) {
+    // Sequantialize instructions to avoid explosive memory allocation of source ops. Only source
+    // ops are sequentialized on multi-threaded streams, so that the other instructions are run
+    // concurrently.
+    if (dev_vm_dep_object_consume_mode() == one::DevVmDepObjectConsumeMode::MUTABLE
+        && !vm_stream_->is_multi_threaded()) {
       stream_sequential_dependence_ = device_schedule_dep_object;
     } else if (opkernel().input_tuple_indexes4const_ibns().empty()
                && opkernel().input_tuple_indexes4mut_ibns().empty()) {
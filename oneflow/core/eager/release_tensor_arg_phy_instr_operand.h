@@ -40,7 +40,8 @@ class ReleaseTensorArgPhyInstrOperand : public PhyInstrOperand {
                                   const Optional<vm::Stream*>& stream)
       : eager_blob_object_(eager_blob_object), output_dependences_() {
     output_dependences_.push_back(CHECK_JUST(eager_blob_object->compute_local_dep_object()));
-    if (stream.has_value()) {
+    // The instructions of multi-threaded streams are not sequentialized by releasing tensors.
+    if (stream.has_value() && !CHECK_JUST(stream)->is_multi_threaded()) {
       stream_sequential_dependence_ = CHECK_JUST(stream)->schedule_local_dep_object().get();
     }
   }
@@ -36,6 +36,7 @@ limitations under the License.
 #endif
 
 #ifdef WITH_ONEDNN
+#include <mutex>
 #include <oneapi/dnnl/dnnl.hpp>
 #endif
 
@@ -173,6 +174,8 @@ class OneDnnExecutor {
 
   template<typename F>
   void Launch(const F& f) {
+    // The kernels of a multi-threaded vm stream share the dnnl stream.
+    std::lock_guard<std::mutex> lock(mutex_);
     CpuNumThreadsGuard guard(cpu_stream_->device()->GetNumThreads());
     f(engine_.get(), stream_.get());
     stream_->wait();
@@ -182,6 +185,7 @@ class OneDnnExecutor {
   CpuStream* cpu_stream_ = nullptr;
   std::unique_ptr<dnnl::engine> engine_;
   std::unique_ptr<dnnl::stream> stream_;
+  std::mutex mutex_;
 };
 
 #endif
@@ -0,0 +1,391 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/include/primitive/reduce.h"
+#include "oneflow/core/ep/common/primitive/util.h"
+#include "oneflow/core/ep/cpu/primitive/type_seq.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+constexpr size_t kMaxNumDims = 8;
+// independent accumulators of a row, which the compiler keeps in a vector register
+constexpr int64_t kLaneNum = 8;
+// columns accumulated together when reducing the outer axes of contiguous columns, wide enough
+// for the reduced rows to be read in long runs rather than a page each
+constexpr int64_t kColBlockSize = 2048;
+// elements a task of the parallel loops reduces at least
+constexpr int64_t kMinTaskElemCnt = 32768;
+
+int64_t DivUp(int64_t x, int64_t y) { return (x + y - 1) / y; }
+
+template<BinaryOp op, typename T>
+struct ReduceFunctor;
+
+template<typename T>
+struct ReduceFunctor<BinaryOp::kAdd, T> {
+  static T Identity() { return static_cast<T>(0); }
+  static T Apply(T x, T y) { return x + y; }
+};
+
+template<typename T>
+struct ReduceFunctor<BinaryOp::kMul, T> {
+  static T Identity() { return static_cast<T>(1); }
+  static T Apply(T x, T y) { return x * y; }
+};
+
+template<typename T>
+struct ReduceFunctor<BinaryOp::kMax, T> {
+  static T Identity() { return std::numeric_limits<T>::lowest(); }
+  static T Apply(T x, T y) { return x > y ? x : y; }
+};
+
+template<typename T>
+struct ReduceFunctor<BinaryOp::kMin, T> {
+  static T Identity() { return std::numeric_limits<T>::max(); }
+  static T Apply(T x, T y) { return x < y ? x : y; }
+};
+
+template<typename T>
+struct ReduceFunctor<BinaryOp::kLogicalAnd, T> {
+  static T Identity() { return true; }
+  static T Apply(T x, T y) { return x && y; }
+};
+
+template<typename T>
+struct ReduceFunctor<BinaryOp::kLogicalOr, T> {
+  static T Identity() { return false; }
+  static T Apply(T x, T y) { return x || y; }
+};
+
+// float16 accumulates in float, the logical reductions in bool
+template<typename Src, typename Dst>
+using AccType = typename std::conditional<
+    std::is_same<Dst, bool>::value, bool,
+    typename std::conditional<std::is_same<Src, float16>::value, float, Src>::type>::type;
+
+template<typename Acc, typename Src>
+struct Loader {
+  static Acc Load(Src x) { return static_cast<Acc>(x); }
+};
+
+template<typename Src>
+struct Loader<bool, Src> {
+  static bool Load(Src x) { return x != static_cast<Src>(0); }
+};
+
+struct StridedDims {
+  size_t num_dims = 0;
+  int64_t dims[kMaxNumDims];
+  int64_t strides[kMaxNumDims];
+
+  void Push(int64_t dim, int64_t stride) {
+    dims[num_dims] = dim;
+    strides[num_dims] = stride;
+    num_dims += 1;
+  }
+  int64_t Count() const { return GetElementCount(num_dims, dims); }
+  // offset of the index-th element in row major order
+  int64_t Offset(int64_t index) const {
+    int64_t offset = 0;
+    for (int64_t i = static_cast<int64_t>(num_dims) - 1; i >= 0; --i) {
+      offset += (index % dims[i]) * strides[i];
+      index /= dims[i];
+    }
+    return offset;
+  }
+};
+
+template<BinaryOp op, typename Src, typename Dst>
+class ReduceImpl : public Reduce {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ReduceImpl);
+  ReduceImpl() = default;
+  ~ReduceImpl() override = default;
+
+  using Acc = AccType<Src, Dst>;
+  using Functor = ReduceFunctor<op, Acc>;
+
+  void Launch(Stream* stream, size_t num_dims, const int64_t* src_dims, const void* src,
+              const int64_t* dst_dims, void* dst) override {
+    CHECK_LE(num_dims, kMaxNumDims);
+    CpuStream* cpu_stream = stream->As<CpuStream>();
+    Dst* y = reinterpret_cast<Dst*>(dst);
+    if (GetElementCount(num_dims, src_dims) == 0) {
+      const int64_t dst_count = GetElementCount(num_dims, dst_dims);
+      std::fill(y, y + dst_count, static_cast<Dst>(Functor::Identity()));
+      return;
+    }
+    // merge the neighbouring axes which are both reduced or both kept
+    size_t merged_num_dims = 0;
+    int64_t merged_dims[kMaxNumDims];
+    bool merged_reduced[kMaxNumDims];
+    for (size_t i = 0; i < num_dims; ++i) {
+      CHECK(dst_dims[i] == src_dims[i] || dst_dims[i] == 1);
+      if (src_dims[i] == 1) { continue; }
+      const bool reduced = dst_dims[i] != src_dims[i];
+      if (merged_num_dims > 0 && merged_reduced[merged_num_dims - 1] == reduced) {
+        merged_dims[merged_num_dims - 1] *= src_dims[i];
+      } else {
+        merged_dims[merged_num_dims] = src_dims[i];
+        merged_reduced[merged_num_dims] = reduced;
+        merged_num_dims += 1;
+      }
+    }
+    const Src* x = reinterpret_cast<const Src*>(src);
+    if (merged_num_dims == 0 || (merged_num_dims == 1 && !merged_reduced[0])) {
+      const int64_t count = merged_num_dims == 0 ? 1 : merged_dims[0];
+      cpu_stream->ParallelFor(0, count, [x, y](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) { y[i] = Store(Loader<Acc, Src>::Load(x[i])); }
+      });
+      return;
+    }
+    // the outer axes, all but the innermost one
+    StridedDims kept;
+    StridedDims reduced;
+    int64_t stride = merged_dims[merged_num_dims - 1];
+    for (int64_t i = static_cast<int64_t>(merged_num_dims) - 2; i >= 0; --i) {
+      StridedDims* outer = merged_reduced[i] ? &reduced : &kept;
+      outer->Push(merged_dims[i], stride);
+      stride *= merged_dims[i];
+    }
+    std::reverse(kept.dims, kept.dims + kept.num_dims);
+    std::reverse(kept.strides, kept.strides + kept.num_dims);
+    std::reverse(reduced.dims, reduced.dims + reduced.num_dims);
+    std::reverse(reduced.strides, reduced.strides + reduced.num_dims);
+    const int64_t thread_num = cpu_stream->device()->GetNumThreads();
+    if (merged_reduced[merged_num_dims - 1]) {
+      ReduceRows(cpu_stream, thread_num, kept, reduced, merged_dims[merged_num_dims - 1], x, y);
+    } else {
+      ReduceCols(cpu_stream, thread_num, kept, reduced, merged_dims[merged_num_dims - 1], x, y);
+    }
+  }
+
+ private:
+  static Dst Store(Acc acc) { return static_cast<Dst>(acc); }
+
+  static Acc ReduceRow(const Src* x, int64_t n) {
+    Acc lanes[kLaneNum];
+    for (int64_t l = 0; l < kLaneNum; ++l) { lanes[l] = Functor::Identity(); }
+    int64_t i = 0;
+    for (; i + kLaneNum <= n; i += kLaneNum) {
+      for (int64_t l = 0; l < kLaneNum; ++l) {
+        lanes[l] = Functor::Apply(lanes[l], Loader<Acc, Src>::Load(x[i + l]));
+      }
+    }
+    Acc acc = Functor::Identity();
+    for (int64_t l = 0; l < kLaneNum; ++l) { acc = Functor::Apply(acc, lanes[l]); }
+    for (; i < n; ++i) { acc = Functor::Apply(acc, Loader<Acc, Src>::Load(x[i])); }
+    return acc;
+  }
+
+  // Reduces the elements [begin, end) of the reduced axes followed by the contiguous row.
+  static Acc ReduceRowRange(const Src* x, const StridedDims& reduced, int64_t row_size,
+                            int64_t begin, int64_t end) {
+    Acc acc = Functor::Identity();
+    while (begin < end) {
+      const int64_t col = begin % row_size;
+      const int64_t n = std::min(row_size - col, end - begin);
+      acc = Functor::Apply(acc, ReduceRow(x + reduced.Offset(begin / row_size) + col, n));
+      begin += n;
+    }
+    return acc;
+  }
+
+  // The innermost axis is reduced: an output is a reduction of rows.
+  static void ReduceRows(CpuStream* cpu_stream, int64_t thread_num, const StridedDims& kept,
+                         const StridedDims& reduced, int64_t row_size, const Src* x, Dst* y) {
+    const int64_t out_count = kept.Count();
+    const int64_t reduce_count = reduced.Count() * row_size;
+    // a few outputs are split into parts reduced by different threads
+    const int64_t part_num =
+        out_count >= thread_num
+            ? 1
+            : std::max<int64_t>(1, std::min(DivUp(thread_num, out_count),
+                                             DivUp(reduce_count, kMinTaskElemCnt)));
+    if (part_num == 1) {
+      cpu_stream->ParallelFor(
+          0, out_count,
+          [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; ++i) {
+              y[i] = Store(ReduceRowRange(x + kept.Offset(i), reduced, row_size, 0, reduce_count));
+            }
+          },
+          std::max<int64_t>(1, kMinTaskElemCnt / reduce_count));
+      return;
+    }
+    // not a std::vector, whose bool specialization can't be written by different threads
+    std::unique_ptr<Acc[]> parts(new Acc[out_count * part_num]);
+    cpu_stream->ParallelFor(
+        0, out_count * part_num,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t t = begin; t < end; ++t) {
+            const int64_t part = t % part_num;
+            parts[t] = ReduceRowRange(x + kept.Offset(t / part_num), reduced, row_size,
+                                      reduce_count * part / part_num,
+                                      reduce_count * (part + 1) / part_num);
+          }
+        },
+        1);
+    for (int64_t i = 0; i < out_count; ++i) {
+      Acc acc = parts[i * part_num];
+      for (int64_t part = 1; part < part_num; ++part) {
+        acc = Functor::Apply(acc, parts[i * part_num + part]);
+      }
+      y[i] = Store(acc);
+    }
+  }
+
+  // The innermost axis is kept: the outputs are reductions of contiguous columns.
+  static void ReduceCols(CpuStream* cpu_stream, int64_t thread_num, const StridedDims& kept,
+                         const StridedDims& reduced, int64_t col_num, const Src* x, Dst* y) {
+    const int64_t block_num = DivUp(col_num, kColBlockSize);
+    const int64_t unit_num = kept.Count() * block_num;
+    const int64_t reduce_count = reduced.Count();
+    const int64_t block_size = std::min(col_num, kColBlockSize);
+    // a few column blocks are split into parts of rows reduced by different threads
+    const int64_t part_num =
+        unit_num >= thread_num
+            ? 1
+            : std::max<int64_t>(1, std::min(DivUp(thread_num, unit_num),
+                                            DivUp(reduce_count * block_size, kMinTaskElemCnt)));
+    std::unique_ptr<Acc[]> parts(part_num == 1 ? nullptr
+                                               : new Acc[unit_num * part_num * kColBlockSize]);
+    const auto ReduceBlock = [&](int64_t t) {
+      const int64_t part = t % part_num;
+      const int64_t unit = t / part_num;
+      const int64_t out_offset = (unit / block_num) * col_num + (unit % block_num) * kColBlockSize;
+      const int64_t width = std::min(kColBlockSize, col_num - (unit % block_num) * kColBlockSize);
+      const Src* block = x + kept.Offset(unit / block_num) + (unit % block_num) * kColBlockSize;
+      Acc acc[kColBlockSize];
+      for (int64_t j = 0; j < width; ++j) { acc[j] = Functor::Identity(); }
+      const int64_t end = reduce_count * (part + 1) / part_num;
+      for (int64_t i = reduce_count * part / part_num; i < end; ++i) {
+        const Src* row = block + reduced.Offset(i);
+        for (int64_t j = 0; j < width; ++j) {
+          acc[j] = Functor::Apply(acc[j], Loader<Acc, Src>::Load(row[j]));
+        }
+      }
+      if (part_num == 1) {
+        for (int64_t j = 0; j < width; ++j) { y[out_offset + j] = Store(acc[j]); }
+      } else {
+        std::copy(acc, acc + width, parts.get() + t * kColBlockSize);
+      }
+    };
+    cpu_stream->ParallelFor(
+        0, unit_num * part_num,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t t = begin; t < end; ++t) { ReduceBlock(t); }
+        },
+        part_num == 1 ? std::max<int64_t>(1, kMinTaskElemCnt / (reduce_count * block_size)) : 1);
+    if (part_num == 1) { return; }
+    for (int64_t unit = 0; unit < unit_num; ++unit) {
+      const int64_t out_offset = (unit / block_num) * col_num + (unit % block_num) * kColBlockSize;
+      const int64_t width = std::min(kColBlockSize, col_num - (unit % block_num) * kColBlockSize);
+      const Acc* unit_parts = parts.get() + unit * part_num * kColBlockSize;
+      for (int64_t j = 0; j < width; ++j) {
+        Acc acc = unit_parts[j];
+        for (int64_t part = 1; part < part_num; ++part) {
+          acc = Functor::Apply(acc, unit_parts[part * kColBlockSize + j]);
+        }
+        y[out_offset + j] = Store(acc);
+      }
+    }
+  }
+};
+
+template<BinaryOp op, typename Src, typename Dst>
+std::unique_ptr<Reduce> NewReduce() {
+  return std::unique_ptr<Reduce>(new ReduceImpl<op, Src, Dst>());
+}
+
+#define CPU_PRIMITIVE_REDUCE_MATH_OP_SEQ \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kAdd)   \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMul)   \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMax)   \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMin)
+
+#define CPU_PRIMITIVE_REDUCE_LOGICAL_OP_SEQ     \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLogicalAnd) \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLogicalOr)
+
+#define CPU_PRIMITIVE_REDUCE_MATH_TYPE_SEQ \
+  CPU_PRIMITIVE_INT8_TYPE_SEQ              \
+  CPU_PRIMITIVE_UINT8_TYPE_SEQ             \
+  CPU_PRIMITIVE_INT32_TYPE_SEQ             \
+  CPU_PRIMITIVE_INT64_TYPE_SEQ             \
+  CPU_PRIMITIVE_FLOAT_TYPE_SEQ             \
+  CPU_PRIMITIVE_DOUBLE_TYPE_SEQ            \
+  CPU_PRIMITIVE_FLOAT16_TYPE_SEQ
+
+#define CPU_PRIMITIVE_REDUCE_LOGICAL_TYPE_SEQ \
+  CPU_PRIMITIVE_BOOL_TYPE_SEQ                 \
+  CPU_PRIMITIVE_REDUCE_MATH_TYPE_SEQ
+
+class ReduceFactoryImpl : public ReduceFactory {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ReduceFactoryImpl);
+  ReduceFactoryImpl() = default;
+  ~ReduceFactoryImpl() override = default;
+
+  std::unique_ptr<Reduce> New(BinaryOp op, DataType src_type, DataType dst_type,
+                              size_t max_num_dims) override {
+    if (max_num_dims > kMaxNumDims) { return nullptr; }
+#define MAKE_NEW_REDUCE_MATH_ENTRY(op, data_type_pair)                                 \
+  {std::make_tuple(op, OF_PP_PAIR_SECOND(data_type_pair), OF_PP_PAIR_SECOND(data_type_pair)), \
+   NewReduce<op, OF_PP_PAIR_FIRST(data_type_pair), OF_PP_PAIR_FIRST(data_type_pair)>},
+
+#define MAKE_NEW_REDUCE_LOGICAL_ENTRY(op, src_data_type_pair, dst_data_type_pair)           \
+  {std::make_tuple(op, OF_PP_PAIR_SECOND(src_data_type_pair),                               \
+                   OF_PP_PAIR_SECOND(dst_data_type_pair)),                                  \
+   NewReduce<op, OF_PP_PAIR_FIRST(src_data_type_pair), OF_PP_PAIR_FIRST(dst_data_type_pair)>},
+
+    static const std::map<std::tuple<BinaryOp, DataType, DataType>,
+                          std::function<std::unique_ptr<Reduce>()>>
+        new_reduce_handle{
+            OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(MAKE_NEW_REDUCE_MATH_ENTRY,
+                                             CPU_PRIMITIVE_REDUCE_MATH_OP_SEQ,
+                                             CPU_PRIMITIVE_REDUCE_MATH_TYPE_SEQ)
+                OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(MAKE_NEW_REDUCE_LOGICAL_ENTRY,
+                                                 CPU_PRIMITIVE_REDUCE_LOGICAL_OP_SEQ,
+                                                 CPU_PRIMITIVE_REDUCE_LOGICAL_TYPE_SEQ,
+                                                 CPU_PRIMITIVE_BOOL_TYPE_SEQ)};
+
+#undef MAKE_NEW_REDUCE_LOGICAL_ENTRY
+#undef MAKE_NEW_REDUCE_MATH_ENTRY
+
+    const auto iter = new_reduce_handle.find(std::make_tuple(op, src_type, dst_type));
+    if (iter != new_reduce_handle.end()) {
+      return iter->second();
+    } else {
+      return nullptr;
+    }
+  }
+};
+
+REGISTER_PRIMITIVE_FACTORY(DeviceType::kCPU, ReduceFactory, ReduceFactoryImpl);
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
@@ -0,0 +1,55 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_PRIMITIVE_REDUCE_H_
+#define ONEFLOW_CORE_EP_PRIMITIVE_REDUCE_H_
+
+#include "oneflow/core/ep/include/primitive/primitive.h"
+#include "oneflow/core/ep/include/primitive/binary_op.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+class Reduce : public Primitive {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(Reduce);
+  Reduce() = default;
+  ~Reduce() override = default;
+
+  // Reduces the axes whose dst_dims[i] is 1 and src_dims[i] is not, dst keeps the other axes.
+  virtual void Launch(Stream* stream, size_t num_dims, const int64_t* src_dims, const void* src,
+                      const int64_t* dst_dims, void* dst) = 0;
+};
+
+class ReduceFactory : public Factory<Reduce> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ReduceFactory);
+  ReduceFactory() = default;
+  ~ReduceFactory() override = default;
+
+  // op is one of kAdd, kMul, kMax, kMin, kLogicalAnd and kLogicalOr, the dst_type of the logical
+  // ones is kBool and of the others is src_type.
+  virtual std::unique_ptr<Reduce> New(BinaryOp op, DataType src_type, DataType dst_type,
+                                      size_t max_num_dims) = 0;
+};
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_PRIMITIVE_REDUCE_H_
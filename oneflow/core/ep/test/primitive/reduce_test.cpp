@@ -0,0 +1,278 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <thread>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/ep/test/primitive/primitive_test.h"
+#include "oneflow/core/ep/include/primitive/reduce.h"
+#include "oneflow/core/ep/common/primitive/util.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+#include "oneflow/core/ndarray/ndarray_util.h"
+
+namespace oneflow {
+
+namespace ep {
+
+namespace primitive {
+
+namespace test {
+
+namespace {
+
+struct ReduceCase {
+  std::vector<int64_t> src_dims;
+  std::vector<int64_t> dst_dims;
+};
+
+std::vector<ReduceCase> ReduceCases() {
+  std::vector<ReduceCase> cases;
+  // every subset of the axes
+  const std::vector<int64_t> dims = {2, 3, 4, 5};
+  for (int mask = 0; mask < (1 << dims.size()); ++mask) {
+    std::vector<int64_t> dst_dims = dims;
+    for (int i = 0; i < dims.size(); ++i) {
+      if (mask & (1 << i)) { dst_dims[i] = 1; }
+    }
+    cases.push_back({dims, dst_dims});
+  }
+  // a few long rows or columns, which are split among threads
+  cases.push_back({{1000003}, {1}});
+  cases.push_back({{3, 100000}, {3, 1}});
+  cases.push_back({{100000, 3}, {1, 3}});
+  // reduced outer axes of rows and kept outer axes of columns
+  cases.push_back({{7, 300, 5}, {1, 300, 1}});
+  cases.push_back({{300, 7, 600}, {300, 1, 600}});
+  cases.push_back({{64, 1, 513}, {1, 1, 513}});
+  cases.push_back({{0, 5}, {1, 5}});
+  return cases;
+}
+
+double ReferenceApply(BinaryOp op, double x, double y) {
+  switch (op) {
+    case BinaryOp::kAdd: return x + y;
+    case BinaryOp::kMul: return x * y;
+    case BinaryOp::kMax: return std::max(x, y);
+    case BinaryOp::kMin: return std::min(x, y);
+    case BinaryOp::kLogicalAnd: return (x != 0) && (y != 0);
+    case BinaryOp::kLogicalOr: return (x != 0) || (y != 0);
+    default: UNIMPLEMENTED(); return 0;
+  }
+}
+
+double ReferenceIdentity(BinaryOp op) {
+  switch (op) {
+    case BinaryOp::kAdd: return 0;
+    case BinaryOp::kMul: return 1;
+    case BinaryOp::kMax: return -std::numeric_limits<double>::infinity();
+    case BinaryOp::kMin: return std::numeric_limits<double>::infinity();
+    case BinaryOp::kLogicalAnd: return 1;
+    case BinaryOp::kLogicalOr: return 0;
+    default: UNIMPLEMENTED(); return 0;
+  }
+}
+
+std::vector<double> ReferenceReduce(BinaryOp op, const ReduceCase& reduce_case,
+                                    const std::vector<double>& src) {
+  const size_t num_dims = reduce_case.src_dims.size();
+  std::vector<double> dst(GetElementCount(num_dims, reduce_case.dst_dims.data()),
+                          ReferenceIdentity(op));
+  for (int64_t i = 0; i < src.size(); ++i) {
+    int64_t src_index = i;
+    int64_t dst_index = 0;
+    int64_t dst_stride = 1;
+    for (int64_t d = num_dims - 1; d >= 0; --d) {
+      const int64_t coord = src_index % reduce_case.src_dims.at(d);
+      src_index /= reduce_case.src_dims.at(d);
+      if (reduce_case.dst_dims.at(d) != 1) { dst_index += coord * dst_stride; }
+      dst_stride *= reduce_case.dst_dims.at(d);
+    }
+    dst.at(dst_index) = ReferenceApply(op, dst.at(dst_index), src.at(i));
+  }
+  return dst;
+}
+
+// Values for which sums, products and logical reductions of many elements stay meaningful.
+double RandomValue(BinaryOp op, DataType data_type, std::mt19937* gen) {
+  std::uniform_int_distribution<int> dist(0, 999);
+  const int r = dist(*gen);
+  switch (op) {
+    case BinaryOp::kMul: return 1.0 + (r - 500) * 1e-6;
+    case BinaryOp::kLogicalAnd: return r != 0;
+    case BinaryOp::kLogicalOr: return r == 0;
+    default:
+      if (data_type == DataType::kFloat16) { return (r % 16) / 8.0; }
+      return r % 100;
+  }
+}
+
+template<DataType src_data_type, typename Src, DataType dst_data_type, typename Dst>
+void TestReduce(DeviceManagerRegistry* registry, const std::set<DeviceType>& device_types,
+                BinaryOp op, double rtol) {
+  std::mt19937 gen(0);
+  for (const auto& device_type : device_types) {
+    auto device = registry->GetDevice(device_type, 0);
+    if (device_type == DeviceType::kCPU) {
+      dynamic_cast<CpuDevice*>(device.get())->SetNumThreads(4);
+    }
+    const std::vector<ReduceCase> cases = ReduceCases();
+    for (size_t case_index = 0; case_index < cases.size(); ++case_index) {
+      const ReduceCase& reduce_case = cases.at(case_index);
+      const size_t num_dims = reduce_case.src_dims.size();
+      std::unique_ptr<Reduce> reduce =
+          NewPrimitive<ReduceFactory>(device_type, op, src_data_type, dst_data_type, num_dims);
+      // only the CPU implements it
+      if (!reduce) { continue; }
+      const int64_t src_count = GetElementCount(num_dims, reduce_case.src_dims.data());
+      const int64_t dst_count = GetElementCount(num_dims, reduce_case.dst_dims.data());
+      std::vector<double> src(src_count);
+      for (double& value : src) {
+        value = static_cast<double>(static_cast<Src>(RandomValue(op, src_data_type, &gen)));
+      }
+      const std::vector<double> expected = ReferenceReduce(op, reduce_case, src);
+      ep::test::DeviceMemoryGuard device_src(device.get(),
+                                             std::max<int64_t>(src_count, 1) * sizeof(Src));
+      ep::test::DeviceMemoryGuard device_dst(device.get(), dst_count * sizeof(Dst));
+      ep::test::StreamGuard stream(device.get());
+      for (int64_t i = 0; i < src_count; ++i) {
+        device_src.ptr<Src>()[i] = static_cast<Src>(src.at(i));
+      }
+      reduce->Launch(stream.stream(), num_dims, reduce_case.src_dims.data(), device_src.ptr(),
+                     reduce_case.dst_dims.data(), device_dst.ptr());
+      CHECK_JUST(stream.stream()->Sync());
+      for (int64_t i = 0; i < dst_count; ++i) {
+        const double value = static_cast<double>(device_dst.ptr<Dst>()[i]);
+        // the identity of an empty max or min is the limit of the type, or an infinity
+        if (std::isinf(expected.at(i)) && expected.at(i) < 0) {
+          ASSERT_LE(value, static_cast<double>(std::numeric_limits<Dst>::lowest()));
+        } else if (std::isinf(expected.at(i))) {
+          ASSERT_GE(value, static_cast<double>(std::numeric_limits<Dst>::max()));
+        } else {
+          ASSERT_NEAR(value, expected.at(i), rtol * std::max(1.0, std::abs(expected.at(i))))
+              << "output " << i << " of case " << case_index;
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST_F(PrimitiveTest, TestReduce) {
+  for (BinaryOp op : {BinaryOp::kAdd, BinaryOp::kMul, BinaryOp::kMax, BinaryOp::kMin}) {
+    TestReduce<DataType::kFloat, float, DataType::kFloat, float>(
+        &device_manager_registry_, available_device_types_, op, 1e-4);
+    TestReduce<DataType::kDouble, double, DataType::kDouble, double>(
+        &device_manager_registry_, available_device_types_, op, 1e-9);
+  }
+  for (BinaryOp op : {BinaryOp::kAdd, BinaryOp::kMax, BinaryOp::kMin}) {
+    TestReduce<DataType::kInt32, int32_t, DataType::kInt32, int32_t>(
+        &device_manager_registry_, available_device_types_, op, 0);
+    TestReduce<DataType::kInt64, int64_t, DataType::kInt64, int64_t>(
+        &device_manager_registry_, available_device_types_, op, 0);
+  }
+  for (BinaryOp op : {BinaryOp::kMax, BinaryOp::kMin}) {
+    TestReduce<DataType::kInt8, int8_t, DataType::kInt8, int8_t>(
+        &device_manager_registry_, available_device_types_, op, 0);
+  }
+  // accumulated in float, only the result is rounded
+  for (BinaryOp op : {BinaryOp::kAdd, BinaryOp::kMax}) {
+    TestReduce<DataType::kFloat16, float16, DataType::kFloat16, float16>(
+        &device_manager_registry_, available_device_types_, op, 1e-3);
+  }
+  for (BinaryOp op : {BinaryOp::kLogicalAnd, BinaryOp::kLogicalOr}) {
+    TestReduce<DataType::kBool, bool, DataType::kBool, bool>(
+        &device_manager_registry_, available_device_types_, op, 0);
+    TestReduce<DataType::kFloat, float, DataType::kBool, bool>(
+        &device_manager_registry_, available_device_types_, op, 0);
+    TestReduce<DataType::kInt32, int32_t, DataType::kBool, bool>(
+        &device_manager_registry_, available_device_types_, op, 0);
+  }
+}
+
+TEST_F(PrimitiveTest, TestReduceBenchmark) {
+  if (!ParseBooleanFromEnv("ONEFLOW_TEST_BENCHMARK", false)) {
+    GTEST_SKIP() << "set ONEFLOW_TEST_BENCHMARK=1 to run";
+  }
+  if (available_device_types_.count(DeviceType::kCPU) == 0) { return; }
+  auto device = device_manager_registry_.GetDevice(DeviceType::kCPU, 0);
+  CpuDevice* cpu_device = dynamic_cast<CpuDevice*>(device.get());
+  const size_t old_thread_num = cpu_device->GetNumThreads();
+  const std::vector<ReduceCase> cases = {
+      {{4096, 4096}, {4096, 1}},        {{4096, 4096}, {1, 4096}},
+      {{4096, 4096}, {1, 1}},           {{32, 64, 56, 56}, {1, 64, 1, 1}},
+      {{1024, 1024, 16}, {1024, 1, 16}}, {{16, 1024, 1024}, {16, 1024, 1}},
+  };
+  const int64_t thread_num = std::max<int64_t>(1, std::thread::hardware_concurrency());
+  const int iter_num = 10;
+  std::unique_ptr<Reduce> reduce;
+  for (size_t case_index = 0; case_index < cases.size(); ++case_index) {
+    const ReduceCase& reduce_case = cases.at(case_index);
+    const size_t num_dims = reduce_case.src_dims.size();
+    const int64_t src_count = GetElementCount(num_dims, reduce_case.src_dims.data());
+    const int64_t dst_count = GetElementCount(num_dims, reduce_case.dst_dims.data());
+    std::vector<float> src(src_count, 1.0f);
+    std::vector<float> dst(dst_count);
+    std::vector<float> tmp(src_count);
+    ep::test::StreamGuard stream(device.get());
+    auto GBPerSecond = [&](const std::function<void()>& Run) {
+      Run();
+      const auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iter_num; ++i) { Run(); }
+      const double seconds =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      return iter_num * src_count * sizeof(float) / seconds / 1e9;
+    };
+    const Shape src_shape(DimVector(reduce_case.src_dims.begin(), reduce_case.src_dims.end()));
+    const Shape dst_shape(DimVector(reduce_case.dst_dims.begin(), reduce_case.dst_dims.end()));
+    const double ndarray_gbps = GBPerSecond([&]() {
+      NdarrayReduce<DeviceType::kCPU, float, BinaryFuncSum>::Reduce(
+          stream.stream(), XpuVarNdarray<float>(dst_shape, dst.data()),
+          XpuVarNdarray<const float>(src_shape, src.data()),
+          XpuVarNdarray<float>(src_shape, tmp.data()));
+    });
+    reduce = NewPrimitive<ReduceFactory>(DeviceType::kCPU, BinaryOp::kAdd, DataType::kFloat,
+                                         DataType::kFloat, num_dims);
+    ASSERT_TRUE(reduce.operator bool());
+    auto RunPrimitive = [&]() {
+      reduce->Launch(stream.stream(), num_dims, reduce_case.src_dims.data(), src.data(),
+                     reduce_case.dst_dims.data(), dst.data());
+    };
+    cpu_device->SetNumThreads(1);
+    const double single_thread_gbps = GBPerSecond(RunPrimitive);
+    cpu_device->SetNumThreads(thread_num);
+    const double multi_thread_gbps = GBPerSecond(RunPrimitive);
+    cpu_device->SetNumThreads(old_thread_num);
+    ASSERT_EQ(dst.at(0), static_cast<float>(src_count / dst_count));
+    RecordProperty("case_" + std::to_string(case_index),
+                   src_shape.ToString() + " -> " + dst_shape.ToString() + ": NdarrayReduce "
+                       + std::to_string(ndarray_gbps) + " GB/s, Reduce "
+                       + std::to_string(single_thread_gbps) + " GB/s on 1 thread, "
+                       + std::to_string(multi_thread_gbps) + " GB/s on "
+                       + std::to_string(thread_num) + " threads");
+  }
+}
+
+}  // namespace test
+
+}  // namespace primitive
+
+}  // namespace ep
+
+}  // namespace oneflow
@@ -47,6 +47,8 @@ struct CPUGeneratorState {
   static constexpr int64_t state_size = std::mt19937::state_size;  // 624
   int64_t states[state_size] = {};
   int64_t seed = 0;
+  // appended after the states of older versions, which SetState still accepts
+  int64_t philox_offset = 0;
 };
 constexpr int64_t CPUGeneratorState::state_size;
 
@@ -54,6 +56,8 @@ void CPUGeneratorImpl::set_current_seed(uint64_t seed) {
   CHECK_JUST(CPUSynchronize());
   seed_ = seed;
   engine_.seed(seed_);
+  philox_ = Philox4x32(seed_);
+  philox_offset_ = 0;
 }
 
 Maybe<Tensor> CPUGeneratorImpl::GetState() const {
@@ -77,6 +81,7 @@ Maybe<Tensor> CPUGeneratorImpl::GetState() const {
     state.states[i] = std::atoll(splits.at(i).data());
   }
   state.seed = current_seed();
+  state.philox_offset = static_cast<int64_t>(philox_offset_);
 
   const auto& callback = [&](uint64_t of_blob_ptr) {
     auto* of_blob = reinterpret_cast<OfBlob*>(of_blob_ptr);
@@ -96,19 +101,21 @@ Maybe<void> CPUGeneratorImpl::SetState(const std::shared_ptr<Tensor>& tensor_sta
     return Error::RuntimeError() << "Generator state should be dtype=flow.uint8";
   }
   CPUGeneratorState state;
-  if (tensor_state->shape()->elem_cnt() != sizeof(state)) {
+  const size_t state_bytes = tensor_state->shape()->elem_cnt();
+  if (state_bytes != sizeof(state) && state_bytes != offsetof(CPUGeneratorState, philox_offset)) {
     return Error::RuntimeError() << "Tensor state size is not match for CPU generator. It needs "
-                                 << sizeof(state) << ", but got "
-                                 << tensor_state->shape()->elem_cnt();
+                                 << sizeof(state) << ", but got " << state_bytes;
   }
   const auto& callback = [&](uint64_t of_blob_ptr) {
     auto* of_blob = reinterpret_cast<OfBlob*>(of_blob_ptr);
-    memcpy(reinterpret_cast<void*>(&state), of_blob->blob().dptr<uint8_t>(), sizeof(state));
+    memcpy(reinterpret_cast<void*>(&state), of_blob->blob().dptr<uint8_t>(), state_bytes);
   };
   JUST(SyncAccessTensorWithTimeOut(tensor_state, callback, "const"));
 
   // set_current_seed(state.seed);
   seed_ = state.seed;
+  philox_ = Philox4x32(seed_);
+  philox_offset_ = static_cast<uint64_t>(state.philox_offset);
 
   std::stringstream ss;
   for (int i = 0; i < CPUGeneratorState::state_size; ++i) { ss << state.states[i] << " "; }
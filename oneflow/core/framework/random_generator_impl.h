@@ -22,6 +22,7 @@ limitations under the License.
 
 #include "oneflow/core/common/device_type.h"
 #include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/philox.h"
 #include "oneflow/core/framework/device.h"
 #ifdef WITH_CUDA
 #include <curand.h>
@@ -94,7 +95,10 @@ class DeviceGeneratorImpl : public GeneratorImpl {
 class CPUGeneratorImpl : public DeviceGeneratorImpl {
  public:
   explicit CPUGeneratorImpl(uint64_t seed)
-      : DeviceGeneratorImpl(seed, DeviceType::kCPU, 0), engine_(seed) {}
+      : DeviceGeneratorImpl(seed, DeviceType::kCPU, 0),
+        engine_(seed),
+        philox_(seed),
+        philox_offset_(0) {}
 
   virtual ~CPUGeneratorImpl() = default;
 
@@ -102,6 +106,16 @@ class CPUGeneratorImpl : public DeviceGeneratorImpl {
 
   std::mt19937& engine() { return engine_; }
 
+  // The counter based stream of the current seed, which kernels sample in parallel. Every kernel
+  // reserves the blocks it uses, so that consecutive kernels get different random numbers.
+  const Philox4x32& philox() const { return philox_; }
+  // Returns the index of the first of block_num reserved blocks.
+  uint64_t ReservePhiloxBlocks(uint64_t block_num) {
+    const uint64_t offset = philox_offset_;
+    philox_offset_ += block_num;
+    return offset;
+  }
+
   Maybe<Symbol<Device>> device() const override { return Device::New("cpu", device_index()); }
 
   Maybe<Tensor> GetState() const override;
@@ -109,6 +123,10 @@ class CPUGeneratorImpl : public DeviceGeneratorImpl {
 
  public:
   std::mt19937 engine_;
+
+ private:
+  Philox4x32 philox_;
+  uint64_t philox_offset_;
 };
 
 #ifdef WITH_CUDA
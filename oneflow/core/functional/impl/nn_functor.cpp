@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include "oneflow/core/autograd/autograd_mode.h"
 #include "oneflow/core/common/container_util.h"
 #include "oneflow/core/common/data_type.pb.h"
 #include "oneflow/core/common/error.h"
@@ -2082,6 +2083,27 @@ class NormalizationAddReluFunctor {
                                                              .Output("inv_variance")
                                                              .Attr("training", true)
                                                              .Build());
+    fused_norm_eval_op_ = CHECK_JUST(one::OpBuilder("normalization_add_relu")
+                                         .Input("x")
+                                         .Input("moving_mean")
+                                         .Input("moving_variance")
+                                         .Input("gamma")
+                                         .Input("beta")
+                                         .Output("y")
+                                         .Output("reserve_space")
+                                         .Attr("training", false)
+                                         .Build());
+    fused_addend_norm_eval_op_ = CHECK_JUST(one::OpBuilder("normalization_add_relu")
+                                                .Input("x")
+                                                .Input("addend")
+                                                .Input("moving_mean")
+                                                .Input("moving_variance")
+                                                .Input("gamma")
+                                                .Input("beta")
+                                                .Output("y")
+                                                .Output("reserve_space")
+                                                .Attr("training", false)
+                                                .Build());
   }
   Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& x,
                            const Optional<one::Tensor>& addend,
@@ -2103,6 +2125,18 @@ class NormalizationAddReluFunctor {
     if (!is_training) {
       CHECK_OR_RETURN(moving_mean && moving_variance)
           << Error::RuntimeError() << "Must have moving_mean and moving_variance in eval mode.";
+      // The cpu kernel fuses the relu into the inference, whose autograd has no dx yet.
+      if (JUST(IsFusedEvalOnCpu(x, addend, gamma, beta))) {
+        if (addend) {
+          return OpInterpUtil::Dispatch<one::Tensor>(
+              *fused_addend_norm_eval_op_,
+              {x, JUST(addend), JUST(moving_mean), JUST(moving_variance), gamma, beta}, attrs);
+        } else {
+          return OpInterpUtil::Dispatch<one::Tensor>(
+              *fused_norm_eval_op_, {x, JUST(moving_mean), JUST(moving_variance), gamma, beta},
+              attrs);
+        }
+      }
       const auto& normalize_result = JUST(OpInterpUtil::Dispatch<one::Tensor>(
           *norm_eval_op_, {x, JUST(moving_mean), JUST(moving_variance), gamma, beta}, attrs));
       if (addend) {
@@ -2134,6 +2168,18 @@ class NormalizationAddReluFunctor {
   }
 
  private:
+  static Maybe<bool> IsFusedEvalOnCpu(const std::shared_ptr<one::Tensor>& x,
+                                      const Optional<one::Tensor>& addend,
+                                      const std::shared_ptr<one::Tensor>& gamma,
+                                      const std::shared_ptr<one::Tensor>& beta) {
+    if (LazyMode::is_enabled() || !x->is_local()) { return false; }
+    if (JUST(x->device())->enum_type() != DeviceType::kCPU) { return false; }
+    if (!autograd::GradMode::is_enabled()) { return true; }
+    bool requires_grad = x->requires_grad() || gamma->requires_grad() || beta->requires_grad();
+    if (addend) { requires_grad = requires_grad || JUST(addend)->requires_grad(); }
+    return !requires_grad;
+  }
+
   std::shared_ptr<OpExpr> norm_eval_op_;
   std::shared_ptr<OpExpr> relu_op_;
   std::shared_ptr<OpExpr> add_op_;
@@ -2141,6 +2187,8 @@ class NormalizationAddReluFunctor {
   std::shared_ptr<OpExpr> fused_addend_norm_training_stats_op_;
   std::shared_ptr<OpExpr> fused_norm_training_no_stats_op_;
   std::shared_ptr<OpExpr> fused_addend_norm_training_no_stats_op_;
+  std::shared_ptr<OpExpr> fused_norm_eval_op_;
+  std::shared_ptr<OpExpr> fused_addend_norm_eval_op_;
 };
 
 class PadFunctor {
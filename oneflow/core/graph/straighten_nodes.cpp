@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/job/job_desc.h"
 #include "oneflow/core/common/protobuf.h"
 #include "oneflow/core/job/task.pb.h"
+#include "oneflow/core/memory/memory_case_util.h"
 
 namespace oneflow {
 
@@ -31,6 +32,8 @@ enum TaskClassifier : int {
   kRunALAP = 3
 };
 
+struct RegstMemory;
+
 class TopoStruct {
  public:
   TaskNode* node = nullptr;
@@ -40,6 +43,15 @@ class TopoStruct {
   int32_t counter = 0;
   int32_t min_distance2transfer = -1;
   TopoStruct* next_same_node = nullptr;
+  // the reused registers produced and consumed by the node, for kCompressMemory
+  std::vector<RegstMemory*> produced_regsts;
+  std::vector<RegstMemory*> consumed_regsts;
+  // bytes allocated by running the node, and freed since it is the last consumer
+  int64_t produced_size = 0;
+  int64_t freed_size = 0;
+  bool executed = false;
+  // small goes first, 0 unless compressing memory
+  double priority = 0;
   // We can have some other nodes in it for example
   // SbpNode<NdSbpSignature>* node;
   // SbpEdge<NdSbpSignature>* node;
@@ -249,9 +261,127 @@ void FindMainstem(HashMap<TaskNode*, TopoStruct>* task_node2topo_struct) {
   }
 }
 
+// A register whose memory is reused by IntraJobMemSharingUtil, it lives from the start of its
+// producer to the end of its last consumer.
+struct RegstMemory {
+  int64_t size = 0;
+  int64_t mem_zone_id = 0;
+  std::vector<TopoStruct*> consumers;
+  int32_t remaining_consumer_num = 0;
+};
+
+int64_t ReusedRegstSize(RegstDesc* regst) {
+  if (!regst->regst_desc_type().has_data_regst_desc() || !regst->enable_reuse_mem()
+      || regst->mem_case().has_host_mem() || regst->min_register_num() != 1) {
+    return 0;
+  }
+  int64_t size = 0;
+  regst->ForEachLbi(
+      [&](const LogicalBlobId& lbi) { size += regst->GetBlobDesc(lbi)->AlignedTotalByteSize(); });
+  return size;
+}
+
+void InitRegstMemory(HashMap<TaskNode*, TopoStruct>* task_node2topo_struct,
+                     HashMap<const RegstDesc*, RegstMemory>* regst2memory) {
+  for (auto& pair : *task_node2topo_struct) {
+    for (const auto& name7regst : pair.first->produced_regsts()) {
+      RegstDesc* regst = name7regst.second.get();
+      const int64_t size = ReusedRegstSize(regst);
+      if (size == 0) { continue; }
+      RegstMemory* memory = &(*regst2memory)[regst];
+      memory->size = size;
+      memory->mem_zone_id =
+          MemoryCaseUtil::GenMemZoneUniqueId(pair.first->machine_id(), regst->mem_case());
+      pair.second.produced_regsts.emplace_back(memory);
+    }
+  }
+  for (auto& pair : *task_node2topo_struct) {
+    auto& consumed_regsts = pair.second.consumed_regsts;
+    for (const auto& name7regsts : pair.first->consumed_regsts()) {
+      for (const auto& regst : name7regsts.second) {
+        auto it = regst2memory->find(regst.get());
+        if (it == regst2memory->end()) { continue; }
+        // A register consumed with several names is released once
+        if (std::find(consumed_regsts.begin(), consumed_regsts.end(), &it->second)
+            != consumed_regsts.end()) {
+          continue;
+        }
+        consumed_regsts.emplace_back(&it->second);
+        it->second.consumers.emplace_back(&pair.second);
+      }
+    }
+  }
+  for (auto& pair : *regst2memory) {
+    RegstMemory* memory = &pair.second;
+    memory->remaining_consumer_num = memory->consumers.size();
+    if (memory->consumers.size() == 1) { memory->consumers.front()->freed_size += memory->size; }
+  }
+  for (auto& pair : *task_node2topo_struct) {
+    for (const RegstMemory* memory : pair.second.produced_regsts) {
+      // a register without consumers is freed right after its producer
+      if (!memory->consumers.empty()) { pair.second.produced_size += memory->size; }
+    }
+  }
+}
+
+// The peak live bytes of the reused registers in each memory zone if the nodes run in `order`
+std::map<int64_t, int64_t> PredictPeakMemory(
+    const std::vector<TaskNode*>& order,
+    const HashMap<TaskNode*, TopoStruct>& task_node2topo_struct) {
+  HashMap<const RegstMemory*, size_t> regst2consumed_num;
+  HashMap<int64_t, int64_t> mem_zone2live_size;
+  std::map<int64_t, int64_t> mem_zone2peak_size;
+  for (TaskNode* node : order) {
+    const TopoStruct& topo_struct = task_node2topo_struct.at(node);
+    // the inputs and the outputs of a node live together
+    for (const RegstMemory* memory : topo_struct.produced_regsts) {
+      int64_t& live_size = mem_zone2live_size[memory->mem_zone_id];
+      live_size += memory->size;
+      int64_t& peak_size = mem_zone2peak_size[memory->mem_zone_id];
+      peak_size = std::max(peak_size, live_size);
+    }
+    for (const RegstMemory* memory : topo_struct.produced_regsts) {
+      if (memory->consumers.empty()) { mem_zone2live_size[memory->mem_zone_id] -= memory->size; }
+    }
+    for (const RegstMemory* memory : topo_struct.consumed_regsts) {
+      if (++regst2consumed_num[memory] == memory->consumers.size()) {
+        mem_zone2live_size[memory->mem_zone_id] -= memory->size;
+      }
+    }
+  }
+  return mem_zone2peak_size;
+}
+
+// Reports how straightening changes the predicted peak memory against the topological order
+void LogPredictedPeakMemory(TaskGraph* task_graph, const std::vector<TaskNode*>& ordered_task_nodes,
+                            const HashMap<TaskNode*, TopoStruct>& task_node2topo_struct,
+                            bool verbose) {
+  std::vector<TaskNode*> topo_order;
+  task_graph->TopoForEachNode([&](TaskNode* node) { topo_order.emplace_back(node); });
+  const auto topo_peak_sizes = PredictPeakMemory(topo_order, task_node2topo_struct);
+  const auto straightened_peak_sizes =
+      PredictPeakMemory(ordered_task_nodes, task_node2topo_struct);
+  for (const auto& pair : topo_peak_sizes) {
+    std::ostringstream report;
+    report << "Straighten predicted peak memory of the reused registers on machine "
+           << (pair.first >> 32) << " mem zone " << (pair.first & 0xFFFFFFFF) << ": "
+           << pair.second / 1048576.0 << " MB in topological order, "
+           << straightened_peak_sizes.at(pair.first) / 1048576.0 << " MB straightened";
+    if (verbose) {
+      LOG(INFO) << report.str();
+    } else {
+      VLOG(1) << report.str();
+    }
+  }
+}
+
 }  // anonymous namespace
 
-void StraightenNodes(TaskGraph* task_graph, std::vector<TaskNode*>* ordered_task_nodes) {
+void StraightenNodes(TaskGraph* task_graph, std::vector<TaskNode*>* ordered_task_nodes,
+                     StraightenAlgorithmTag tag, double memory_weight) {
+  const bool compress_memory = tag == StraightenAlgorithmTag::kCompressMemory;
+  CHECK(memory_weight >= 0 && memory_weight <= 1)
+      << "straighten memory weight should be in [0, 1], but got " << memory_weight;
   // The function for settle the order in the graph
   int64_t order_in_graph = 0;
 
@@ -323,6 +453,32 @@ void StraightenNodes(TaskGraph* task_graph, std::vector<TaskNode*>* ordered_task
 
   // Generate other parameters in the topological data structure
   FindMainstem(&task_node2topo_struct);
+  HashMap<const RegstDesc*, RegstMemory> regst2memory;
+  InitRegstMemory(&task_node2topo_struct, &regst2memory);
+
+  // Compressing memory, a node goes first if it frees more bytes than it allocates, weighed
+  // against the overlap order below scaled to (-1, 0].
+  int64_t max_regst_size = 1;
+  for (const auto& pair : regst2memory) {
+    max_regst_size = std::max(max_regst_size, pair.second.size);
+  }
+  int32_t max_min_layer = 0;
+  int32_t max_tributary_layer = 0;
+  for (const auto& pair : task_node2topo_struct) {
+    max_min_layer = std::max(max_min_layer, pair.second.min_layer);
+    max_tributary_layer = std::max(max_tributary_layer, pair.second.tributary_layer);
+  }
+  auto UpdatePriority = [&](TopoStruct* topo_struct) {
+    if (!compress_memory) { return; }
+    const double overlap_priority =
+        -(topo_struct->min_layer * (max_tributary_layer + 1.0) + topo_struct->tributary_layer)
+        / ((max_min_layer + 1.0) * (max_tributary_layer + 1.0));
+    const double memory_priority =
+        static_cast<double>(topo_struct->produced_size - topo_struct->freed_size) / max_regst_size;
+    topo_struct->priority =
+        memory_weight * memory_priority + (1 - memory_weight) * overlap_priority;
+  };
+  for (auto& pair : task_node2topo_struct) { UpdatePriority(&pair.second); }
 
   VLOG(3) << "Straightening order: " << 5 << ", " << 3;
 
@@ -330,6 +486,7 @@ void StraightenNodes(TaskGraph* task_graph, std::vector<TaskNode*>* ordered_task
   // Decide which node should run first
   struct comp {
     bool operator()(const TopoStruct* a, const TopoStruct* b) const {
+      if (a->priority != b->priority) { return a->priority < b->priority; }
       // NOTE: Leave these code for debugging in the future
       // static std::vector<int64_t> decide_parameters({ParseIntegerFromEnv("Parameter0", 5),
       //                                                ParseIntegerFromEnv("Parameter1", 3),
@@ -357,10 +514,28 @@ void StraightenNodes(TaskGraph* task_graph, std::vector<TaskNode*>* ordered_task
 
   std::vector<int32_t> remain_task_nums(num_classifier, 0);
 
+  // The last consumer of a register frees it, which moves the consumer forward
+  auto ReleaseConsumedRegsts = [&](TopoStruct* topo_struct) {
+    topo_struct->executed = true;
+    for (RegstMemory* memory : topo_struct->consumed_regsts) {
+      if (--memory->remaining_consumer_num != 1) { continue; }
+      for (TopoStruct* consumer : memory->consumers) {
+        if (consumer->executed) { continue; }
+        // Re-sort the consumer if it is waiting
+        auto& waiting_list = waiting_lists[GetTaskClassifier(consumer->node)];
+        const bool waiting = waiting_list.erase(consumer) > 0;
+        consumer->freed_size += memory->size;
+        UpdatePriority(consumer);
+        if (waiting) { waiting_list.insert(consumer); }
+      }
+    }
+  };
+
   auto SetOrderInGraph = [&](TaskNode* task_node) {
     task_node->set_order_in_graph(order_in_graph);
     ordered_task_nodes->emplace_back(task_node);
     ++order_in_graph;
+    if (compress_memory) { ReleaseConsumedRegsts(&task_node2topo_struct[task_node]); }
   };
 
   // wait in the list
@@ -464,6 +639,10 @@ void StraightenNodes(TaskGraph* task_graph, std::vector<TaskNode*>* ordered_task
                              / (waiting_lists[TaskClassifier::kWaitingTransfer].size())),
                      remain_task_nums[TaskClassifier::kWaitingComputation]
                          / remain_task_nums[TaskClassifier::kWaitingTransfer]);
+        // A held transfer keeps its registers alive, overlap less for memory
+        if (compress_memory) {
+          computation_num = static_cast<int32_t>(computation_num * (1 - memory_weight));
+        }
         // Holding the transfer
         std::vector<TaskNode*> transfer_execution_list;
         move2execution_list(waiting_lists[TaskClassifier::kWaitingTransfer],
@@ -480,6 +659,8 @@ void StraightenNodes(TaskGraph* task_graph, std::vector<TaskNode*>* ordered_task
       execute(TaskClassifier::kRunASAP, waiting_lists[TaskClassifier::kRunASAP].size());
     }
   }
+
+  LogPredictedPeakMemory(task_graph, *ordered_task_nodes, task_node2topo_struct, compress_memory);
 }
 
 }  // namespace oneflow
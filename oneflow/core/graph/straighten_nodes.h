@@ -17,10 +17,15 @@ limitations under the License.
 #define ONEFLOW_CORE_GRAPH_STRAIGHTEN_NODES_H_
 
 #include "oneflow/core/graph/task_graph.h"
+#include "oneflow/core/job/job_conf.pb.h"
 
 namespace oneflow {
 
-void StraightenNodes(TaskGraph* task_graph, std::vector<TaskNode*>* ordered_task_nodes);
+// Orders the task nodes so that the transfers overlap with computation, or, with kCompressMemory,
+// so that the reused registers live shortly and their peak size is low. `memory_weight` in [0, 1]
+// weighs the memory of kCompressMemory against the overlap.
+void StraightenNodes(TaskGraph* task_graph, std::vector<TaskNode*>* ordered_task_nodes,
+                     StraightenAlgorithmTag tag, double memory_weight);
 
 }  // namespace oneflow
 
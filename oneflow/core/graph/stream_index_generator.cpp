@@ -49,4 +49,32 @@ StreamIndexGenerator::stream_index_t StreamIndexGenerator::GenerateNamedRoundRob
   return cur_stream_index;
 }
 
+void StreamIndexGenerator::SaveState(StreamIndexGeneratorState* state) {
+  std::unique_lock<std::mutex> lck(mtx_);
+  state->set_next_stream_index(next_stream_index_);
+  std::vector<std::string> names;
+  for (const auto& pair : name2rr_range_) { names.emplace_back(pair.first); }
+  std::sort(names.begin(), names.end());
+  state->clear_round_robin_range();
+  for (const std::string& name : names) {
+    const RoundRobinRange& range = name2rr_range_.at(name);
+    StreamIndexRoundRobinState* range_state = state->add_round_robin_range();
+    range_state->set_name(name);
+    range_state->set_begin(range.begin);
+    range_state->set_size(range.size);
+    range_state->set_offset(range.offset);
+  }
+}
+
+void StreamIndexGenerator::LoadState(const StreamIndexGeneratorState& state) {
+  std::unique_lock<std::mutex> lck(mtx_);
+  next_stream_index_ = state.next_stream_index();
+  name2rr_range_.clear();
+  for (const auto& range_state : state.round_robin_range()) {
+    RoundRobinRange range(range_state.begin(), range_state.size());
+    range.offset = range_state.offset();
+    name2rr_range_.emplace(range_state.name(), range);
+  }
+}
+
 }  // namespace oneflow
@@ -421,7 +421,7 @@ void ForEachOpGraphNecessaryCtrlEdge(
 
 }  // namespace
 
-TaskGraph::TaskGraph(bool enable_straighten_algorithm) {
+TaskGraph::TaskGraph() {
   OpGraph* op_graph = Singleton<OpGraph>::Get();
   sub_tsk_gph_builder_ctx_.reset(new SubTskGphBuilderCtx(this));
   boxing_logger_ = CreateBoxingLogger();
@@ -452,11 +452,6 @@ TaskGraph::TaskGraph(bool enable_straighten_algorithm) {
     }
   });
 
-  if (enable_straighten_algorithm && GlobalProcessCtx::WorldSize() > 1) {
-    StraightenNodes(this, &ordered_task_nodes_);
-  } else {
-    SetOrderInGraphForEachNode();
-  }
   if (Singleton<ResourceDesc, ForSession>::Get()->enable_debug_mode()) { ToDotWithAutoFilePath(); }
 }
 
@@ -553,6 +548,19 @@ void TaskGraph::RemoveEmptyRegsts() {
   ForEachNode([&](TaskNode* node) { node->UnbindBnWithEmptyRegst(); });
 }
 
+void TaskGraph::DecideExecutionOrder(const JobConfigProto& job_conf) {
+  CHECK(ordered_task_nodes_.empty());
+  const StraightenAlgorithmTag tag = job_conf.straighten_algorithm_tag_in_task_graph();
+  // NOTE: straightening for overlap raises the memory, it only pays off with several devices.
+  if (job_conf.enable_straighten_algorithm_in_task_graph()
+      && (GlobalProcessCtx::WorldSize() > 1 || tag == StraightenAlgorithmTag::kCompressMemory)) {
+    StraightenNodes(this, &ordered_task_nodes_, tag,
+                    job_conf.straighten_memory_weight_in_task_graph());
+  } else {
+    SetOrderInGraphForEachNode();
+  }
+}
+
 void TaskGraph::MergeChainAndAddOrderingCtrlEdgeInSameChain() {
   MergeChain();
   BuildCtrlRegstDescInSameChain();
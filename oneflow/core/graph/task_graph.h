@@ -43,10 +43,13 @@ class TaskGraph final : public Graph<TaskNode, TaskEdge> {
   OF_DISALLOW_COPY_AND_MOVE(TaskGraph);
   ~TaskGraph() override;
 
-  explicit TaskGraph(bool enable_straighten_algorithm);
+  TaskGraph();
 
   const char* TypeName() const override { return "TaskGraph"; }
   void RemoveEmptyRegsts();
+  // Sets order_in_graph of the nodes, after the regsts are built since the straighten algorithm
+  // may order by their sizes.
+  void DecideExecutionOrder(const JobConfigProto& job_conf);
   void MergeChainAndAddOrderingCtrlEdgeInSameChain();
 
   void EnableInplaceMemSharing(const std::function<bool(const std::string&, const std::string&)>&
@@ -78,4 +78,8 @@ int64_t ThrdId4ActorId(int64_t actor_id) {
   return EncodeStreamIdToInt64(DecodeTaskIdFromInt64(actor_id).stream_id());
 }
 
+TaskId::task_index_t TaskIndex4ActorId(int64_t actor_id) {
+  return static_cast<TaskId::task_index_t>(actor_id & kTaskIndexInt64Mask);
+}
+
 }  // namespace oneflow
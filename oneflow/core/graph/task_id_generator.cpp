@@ -0,0 +1,42 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/graph/task_id_generator.h"
+
+namespace oneflow {
+
+void TaskIdGenerator::SaveIdState(IdState* id_state) const {
+  std::vector<std::pair<int64_t, task_index_t>> task_index_states;
+  for (const auto& pair : stream_id2task_index_counter_) {
+    task_index_states.emplace_back(EncodeStreamIdToInt64(pair.first), pair.second);
+  }
+  std::sort(task_index_states.begin(), task_index_states.end());
+  id_state->clear_task_index_state();
+  for (const auto& pair : task_index_states) {
+    TaskIndexState* task_index_state = id_state->add_task_index_state();
+    task_index_state->set_stream_id(pair.first);
+    task_index_state->set_task_index(pair.second);
+  }
+}
+
+void TaskIdGenerator::LoadIdState(const IdState& id_state) {
+  stream_id2task_index_counter_.clear();
+  for (const auto& task_index_state : id_state.task_index_state()) {
+    stream_id2task_index_counter_[DecodeStreamIdFromInt64(task_index_state.stream_id())] =
+        task_index_state.task_index();
+  }
+}
+
+}  // namespace oneflow
@@ -17,6 +17,7 @@ limitations under the License.
 #define ONEFLOW_CORE_GRAPH_TASK_ID_GENERATOR_H_
 
 #include "oneflow/core/graph/task_id.h"
+#include "oneflow/core/job/id_state.pb.h"
 
 namespace oneflow {
 
@@ -29,6 +30,8 @@ class TaskIdGenerator final {
   ~TaskIdGenerator() = default;
 
   TaskId Generate(const StreamId& stream_id);
+  void SaveIdState(IdState* id_state) const;
+  void LoadIdState(const IdState& id_state);
 
  private:
   HashMap<StreamId, task_index_t> stream_id2task_index_counter_;
@@ -48,6 +48,37 @@ TaskStreamIndexManager::stream_index_t TaskStreamIndexManager::GetNamedTaskStrea
   return generator->GenerateNamed(name);
 }
 
+void TaskStreamIndexManager::SaveIdState(IdState* id_state) {
+  std::unique_lock<std::mutex> lck(mtx_);
+  std::vector<std::pair<int64_t, DeviceId>> devices;
+  for (const auto& pair : generators_) {
+    devices.emplace_back(EncodeStreamIdToInt64(StreamId(pair.first, 0)), pair.first);
+  }
+  std::sort(devices.begin(), devices.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+  id_state->clear_stream_index_generator_state();
+  for (const auto& pair : devices) {
+    const DeviceId& device_id = pair.second;
+    StreamIndexGeneratorState* state = id_state->add_stream_index_generator_state();
+    state->set_rank(device_id.rank());
+    state->set_device_type(device_id.device_type());
+    state->set_device_index(device_id.device_index());
+    generators_.at(device_id)->SaveState(state);
+  }
+}
+
+void TaskStreamIndexManager::LoadIdState(const IdState& id_state) {
+  std::unique_lock<std::mutex> lck(mtx_);
+  generators_.clear();
+  for (const auto& state : id_state.stream_index_generator_state()) {
+    DeviceId device_id(state.rank(), static_cast<DeviceType>(state.device_type()),
+                       state.device_index());
+    auto* generator = new StreamIndexGenerator();
+    generator->LoadState(state);
+    CHECK(generators_.emplace(device_id, std::unique_ptr<StreamIndexGenerator>(generator)).second);
+  }
+}
+
 void TaskStreamIndexGetterRegistry::Register(const key_t& key, const stream_index_getter& getter) {
   bool insert_success = stream_index_getter_map_.emplace(key, getter).second;
   if (!insert_success) {
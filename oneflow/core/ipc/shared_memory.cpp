@@ -56,8 +56,9 @@ int ShmOpen(std::string* shm_name, int* fd, bool create) {
   return err;
 }
 
-int ShmMap(int fd, const size_t shm_size, void** ptr) {
-  *ptr = mmap(NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+int ShmMap(int fd, const size_t shm_size, bool populate, void** ptr) {
+  *ptr = mmap(NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED | (populate ? MAP_POPULATE : 0),
+              fd, 0);
   return (*ptr == MAP_FAILED) ? errno : 0;
 }
 
@@ -69,7 +70,8 @@ Maybe<void*> ShmSetUp(std::string* shm_name, size_t shm_size, bool create) {
   PCHECK_OR_RETURN(ShmOpen(shm_name, &fd, create));
   PCHECK_OR_RETURN(posix_fallocate(fd, 0, shm_size)) << ReturnEmptyStr([&] { close(fd); });
   void* ptr = nullptr;
-  PCHECK_OR_RETURN(ShmMap(fd, shm_size, &ptr)) << ReturnEmptyStr([&] { close(fd); });
+  PCHECK_OR_RETURN(ShmMap(fd, shm_size, /*populate=*/false, &ptr))
+      << ReturnEmptyStr([&] { close(fd); });
   close(fd);
   std::memset(ptr, 0, shm_size);
   return ptr;
@@ -78,7 +80,8 @@ Maybe<void*> ShmSetUp(std::string* shm_name, size_t shm_size, bool create) {
 #endif
 }
 
-Maybe<void*> ShmSetUp(const std::string& shm_name, size_t* shm_size, bool create) {
+Maybe<void*> ShmSetUp(const std::string& shm_name, size_t* shm_size, bool create,
+                      bool populate) {
 #ifdef __linux__
   int fd = 0;
   PCHECK_OR_RETURN(ShmOpen(shm_name, &fd, create));
@@ -86,7 +89,7 @@ Maybe<void*> ShmSetUp(const std::string& shm_name, size_t* shm_size, bool create
   PCHECK_OR_RETURN(fstat(fd, &st)) << ReturnEmptyStr([&] { close(fd); });
   *shm_size = st.st_size;
   void* ptr = nullptr;
-  PCHECK_OR_RETURN(ShmMap(fd, *shm_size, &ptr)) << ReturnEmptyStr([&] { close(fd); });
+  PCHECK_OR_RETURN(ShmMap(fd, *shm_size, populate, &ptr)) << ReturnEmptyStr([&] { close(fd); });
   close(fd);
   return ptr;
 #else
@@ -176,9 +179,9 @@ Maybe<SharedMemory> SharedMemory::Open(size_t shm_size, bool create) {
   return std::shared_ptr<SharedMemory>(new SharedMemory(ptr, shm_name, shm_size));
 }
 
-Maybe<SharedMemory> SharedMemory::Open(const std::string& shm_name, bool create) {
+Maybe<SharedMemory> SharedMemory::Open(const std::string& shm_name, bool create, bool populate) {
   size_t shm_size = 0;
-  char* ptr = static_cast<char*>(JUST(ShmSetUp(shm_name, &shm_size, create)));
+  char* ptr = static_cast<char*>(JUST(ShmSetUp(shm_name, &shm_size, create, populate)));
   return std::shared_ptr<SharedMemory>(new SharedMemory(ptr, shm_name, shm_size));
 }
 
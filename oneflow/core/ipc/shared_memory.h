@@ -48,7 +48,8 @@ class SharedMemory final {
   ~SharedMemory();
 
   static Maybe<SharedMemory> Open(size_t size, bool create);
-  static Maybe<SharedMemory> Open(const std::string& name, bool create);
+  // `populate` faults all the pages of the segment in when mapping it.
+  static Maybe<SharedMemory> Open(const std::string& name, bool create, bool populate = false);
 
   const char* buf() const { return buf_; }
   char* mut_buf() { return buf_; }
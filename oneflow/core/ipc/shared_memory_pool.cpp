@@ -0,0 +1,182 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ipc/shared_memory_pool.h"
+#include <atomic>
+#include "oneflow/core/common/env_var/env_var.h"
+
+namespace oneflow {
+
+// bytes of free and in-use segments a producer keeps before unlinking free ones
+DEFINE_ENV_INTEGER(ONEFLOW_SHM_POOL_BUDGET_BYTES, 1LL << 30);
+
+namespace ipc {
+
+namespace {
+
+// Lives in the first bytes of a segment, shared by the producer and the consumer.
+struct SegmentHeader {
+  std::atomic<int32_t> in_use;
+  std::atomic<int32_t> retired;
+};
+static_assert(sizeof(SegmentHeader) <= SharedMemoryPool::kHeaderSize, "");
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "the header is shared by processes");
+
+SegmentHeader* Header(SharedMemory* shm) {
+  return reinterpret_cast<SegmentHeader*>(shm->mut_buf());
+}
+
+size_t ClassSize(size_t size) {
+  size_t class_size = SharedMemoryPool::kMinClassSize;
+  while (class_size < size) { class_size <<= 1; }
+  return class_size;
+}
+
+}  // namespace
+
+constexpr size_t SharedMemoryPool::kHeaderSize;
+constexpr size_t SharedMemoryPool::kMinClassSize;
+
+SharedMemoryPool& SharedMemoryPool::get() {
+  // Like SharedMemoryManager, a static variable survives in subprocesses
+  static SharedMemoryPool shared_memory_pool;
+  return shared_memory_pool;
+}
+
+Maybe<SharedMemory> SharedMemoryPool::Acquire(size_t size) {
+  const size_t class_size = ClassSize(size + kHeaderSize);
+  std::unique_lock<std::mutex> lock(mutex_);
+  stats_.acquire_cnt += 1;
+  auto& ring = rings_[class_size];
+  size_t& cursor = cursors_[class_size];
+  for (size_t i = 0; i < ring.size(); ++i) {
+    const size_t index = (cursor + i) % ring.size();
+    int32_t expected = 0;
+    if (Header(ring.at(index).get())
+            ->in_use.compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+      cursor = index + 1;
+      return ring.at(index);
+    }
+  }
+  const size_t budget = EnvInteger<ONEFLOW_SHM_POOL_BUDGET_BYTES>();
+  if (static_cast<size_t>(stats_.segment_bytes) + class_size > budget) {
+    EvictFreeSegments(class_size, budget);
+  }
+  auto maybe_shm = SharedMemory::Open(class_size, /*create=*/true);
+  std::shared_ptr<SharedMemory> shm;
+  if (maybe_shm.IsOk()) {
+    shm = JUST(maybe_shm);
+  } else {
+    // e.g. /dev/shm is full, make room with the free segments of the other classes
+    EvictFreeSegments(class_size, 0);
+    shm = JUST(SharedMemory::Open(class_size, /*create=*/true));
+  }
+  SegmentHeader* header = new (shm->mut_buf()) SegmentHeader();
+  header->retired.store(0, std::memory_order_relaxed);
+  header->in_use.store(1, std::memory_order_relaxed);
+  ring.emplace_back(shm);
+  stats_.create_cnt += 1;
+  stats_.segment_num += 1;
+  stats_.segment_bytes += class_size;
+  return shm;
+}
+
+void SharedMemoryPool::EvictFreeSegments(size_t size, size_t budget) {
+  for (auto& pair : rings_) {
+    auto& ring = pair.second;
+    for (auto it = ring.begin(); it != ring.end();) {
+      if (static_cast<size_t>(stats_.segment_bytes) + size <= budget) { return; }
+      SegmentHeader* header = Header(it->get());
+      int32_t expected = 0;
+      if (!header->in_use.compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+        ++it;
+        continue;
+      }
+      header->retired.store(1, std::memory_order_release);
+      header->in_use.store(0, std::memory_order_release);
+      // the consumers which mapped the segment keep it until they drop their mappings
+      CHECK_JUST((*it)->Unlink());
+      stats_.evict_cnt += 1;
+      stats_.segment_num -= 1;
+      stats_.segment_bytes -= (*it)->size();
+      it = ring.erase(it);
+    }
+    cursors_[pair.first] = 0;
+  }
+}
+
+Maybe<void> SharedMemoryPool::UnlinkAll() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (auto& pair : rings_) {
+    for (auto& shm : pair.second) {
+      Header(shm.get())->retired.store(1, std::memory_order_release);
+      JUST(shm->Unlink());
+    }
+  }
+  // the segments are unmapped here unless an attachment of this process holds them
+  rings_.clear();
+  cursors_.clear();
+  stats_.segment_num = 0;
+  stats_.segment_bytes = 0;
+  return Maybe<void>::Ok();
+}
+
+SharedMemoryPoolStats SharedMemoryPool::stats() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+Maybe<SharedMemory> SharedMemoryPool::Attach(const std::string& name) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  DropRetiredAttachments();
+  auto it = attachments_.find(name);
+  if (it == attachments_.end()) {
+    Attachment attachment;
+    attachment.shm = JUST(SharedMemory::Open(name, /*create=*/false, /*populate=*/true));
+    attachment.attached = false;
+    it = attachments_.emplace(name, attachment).first;
+  }
+  CHECK_OR_RETURN(!it->second.attached) << "shared memory " << name << " is attached twice";
+  it->second.attached = true;
+  return it->second.shm;
+}
+
+Maybe<void> SharedMemoryPool::Release(const std::string& name) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = attachments_.find(name);
+  CHECK_OR_RETURN(it != attachments_.end() && it->second.attached)
+      << "shared memory " << name << " was not attached but attempted to be released";
+  it->second.attached = false;
+  SegmentHeader* header = Header(it->second.shm.get());
+  const bool retired = header->retired.load(std::memory_order_acquire) != 0;
+  // the producer may overwrite the segment from here on
+  header->in_use.store(0, std::memory_order_release);
+  if (retired) { attachments_.erase(it); }
+  return Maybe<void>::Ok();
+}
+
+void SharedMemoryPool::DropRetiredAttachments() {
+  for (auto it = attachments_.begin(); it != attachments_.end();) {
+    if (!it->second.attached
+        && Header(it->second.shm.get())->retired.load(std::memory_order_acquire) != 0) {
+      it = attachments_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace ipc
+}  // namespace oneflow
@@ -0,0 +1,87 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_IPC_SHARED_MEMORY_POOL_H_
+#define ONEFLOW_CORE_IPC_SHARED_MEMORY_POOL_H_
+
+#include "oneflow/core/ipc/shared_memory.h"
+
+namespace oneflow {
+namespace ipc {
+
+struct SharedMemoryPoolStats {
+  int64_t acquire_cnt = 0;
+  // acquisitions which had to create a segment
+  int64_t create_cnt = 0;
+  int64_t evict_cnt = 0;
+  int64_t segment_num = 0;
+  int64_t segment_bytes = 0;
+};
+
+// Shared memory segments reused across transfers, a transfer through a warm pool opens, maps and
+// faults nothing.
+//
+// The producer acquires a segment from the ring of a power-of-two size class, writes the data
+// after the header of the segment and sends the name of the segment. The consumer attaches to the
+// segment, which it maps at the first transfer only, and releases it by clearing the in-use flag
+// of the header, no message goes back to the producer. When the pool outgrows its budget, free
+// segments are unlinked and marked retired in their header, so the consumers unmap them as well.
+class SharedMemoryPool final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SharedMemoryPool);
+  ~SharedMemoryPool() = default;
+
+  // The data of a segment starts after its header.
+  static constexpr size_t kHeaderSize = 64;
+  static constexpr size_t kMinClassSize = 4096;
+
+  static SharedMemoryPool& get();
+
+  // Producer side, returns a segment with room for `size` bytes of data, marked in use.
+  Maybe<SharedMemory> Acquire(size_t size);
+  // Producer side, called at the exit of the producer: marks every segment retired, unlinks and
+  // unmaps it. The consumers keep their mappings of the segments in use until they release them.
+  Maybe<void> UnlinkAll();
+  SharedMemoryPoolStats stats();
+
+  // Consumer side, returns the segment `name` mapped in this process.
+  Maybe<SharedMemory> Attach(const std::string& name);
+  // Consumer side, hands the segment `name` back to its producer.
+  Maybe<void> Release(const std::string& name);
+
+ private:
+  struct Attachment {
+    std::shared_ptr<SharedMemory> shm;
+    bool attached;
+  };
+
+  SharedMemoryPool() = default;
+  // Unlinks free segments until `size` more bytes fit in `budget`.
+  void EvictFreeSegments(size_t size, size_t budget);
+  // Unmaps the retired segments this process doesn't hold.
+  void DropRetiredAttachments();
+
+  // class size -> segments of the class, and the position to start looking for a free one
+  std::map<size_t, std::vector<std::shared_ptr<SharedMemory>>> rings_;
+  std::map<size_t, size_t> cursors_;
+  std::map<std::string, Attachment> attachments_;
+  SharedMemoryPoolStats stats_;
+  std::mutex mutex_;
+};
+
+}  // namespace ipc
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_IPC_SHARED_MEMORY_POOL_H_
@@ -0,0 +1,122 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <stdlib.h>
+#include <unistd.h>
+#include <cstring>
+#include "gtest/gtest.h"
+#include "oneflow/core/ipc/shared_memory_pool.h"
+
+namespace oneflow {
+namespace ipc {
+
+#ifdef __linux__
+
+namespace {
+
+bool ShmExists(const std::string& name) { return access(("/dev/shm/" + name).c_str(), F_OK) == 0; }
+
+char* Data(SharedMemory* shm) { return shm->mut_buf() + SharedMemoryPool::kHeaderSize; }
+
+}  // namespace
+
+// The pool is a process-wide singleton, every test leaves it empty.
+
+TEST(SharedMemoryPool, reuse_released_segment) {
+  SharedMemoryPool& pool = SharedMemoryPool::get();
+  const SharedMemoryPoolStats before = pool.stats();
+
+  auto producer_shm = CHECK_JUST(pool.Acquire(1000));
+  std::strcpy(Data(producer_shm.get()), "first batch");
+  auto consumer_shm = CHECK_JUST(pool.Attach(producer_shm->name()));
+  ASSERT_STREQ(Data(consumer_shm.get()), "first batch");
+  // a segment in use is neither acquired nor attached again
+  auto other_shm = CHECK_JUST(pool.Acquire(1000));
+  ASSERT_NE(other_shm->name(), producer_shm->name());
+  ASSERT_FALSE(TRY(pool.Attach(producer_shm->name())).IsOk());
+  CHECK_JUST(pool.Release(producer_shm->name()));
+
+  // the released segment comes back without creating or mapping anything
+  auto reused_shm = CHECK_JUST(pool.Acquire(1000));
+  ASSERT_EQ(reused_shm->name(), producer_shm->name());
+  std::strcpy(Data(reused_shm.get()), "second batch");
+  auto reattached_shm = CHECK_JUST(pool.Attach(reused_shm->name()));
+  ASSERT_EQ(reattached_shm.get(), consumer_shm.get());
+  ASSERT_STREQ(Data(reattached_shm.get()), "second batch");
+  CHECK_JUST(pool.Release(reused_shm->name()));
+  ASSERT_FALSE(TRY(pool.Release(reused_shm->name())).IsOk());
+
+  // a larger size class gets segments of its own
+  auto large_shm = CHECK_JUST(pool.Acquire(5000));
+  ASSERT_GE(large_shm->size(), 5000 + SharedMemoryPool::kHeaderSize);
+
+  const SharedMemoryPoolStats after = pool.stats();
+  ASSERT_EQ(after.acquire_cnt - before.acquire_cnt, 4);
+  ASSERT_EQ(after.create_cnt - before.create_cnt, 3);
+  ASSERT_EQ(after.segment_num, 3);
+  CHECK_JUST(pool.UnlinkAll());
+}
+
+TEST(SharedMemoryPool, evict_over_budget) {
+  SharedMemoryPool& pool = SharedMemoryPool::get();
+  const SharedMemoryPoolStats before = pool.stats();
+  const std::string busy_name = CHECK_JUST(pool.Acquire(100))->name();
+  CHECK_JUST(pool.Attach(busy_name));
+  CHECK_JUST(pool.Release(busy_name));
+  ASSERT_EQ(CHECK_JUST(pool.Acquire(100))->name(), busy_name);
+  auto other_shm = CHECK_JUST(pool.Acquire(100));
+  CHECK_JUST(pool.Attach(other_shm->name()));
+  CHECK_JUST(pool.Release(other_shm->name()));
+
+  // only the free segment is unlinked to make room
+  ASSERT_EQ(setenv("ONEFLOW_SHM_POOL_BUDGET_BYTES", "12288", 1), 0);
+  auto large_shm = CHECK_JUST(pool.Acquire(5000));
+  ASSERT_EQ(unsetenv("ONEFLOW_SHM_POOL_BUDGET_BYTES"), 0);
+  ASSERT_TRUE(ShmExists(busy_name));
+  ASSERT_FALSE(ShmExists(other_shm->name()));
+  ASSERT_TRUE(ShmExists(large_shm->name()));
+  const SharedMemoryPoolStats after = pool.stats();
+  ASSERT_EQ(after.evict_cnt - before.evict_cnt, 1);
+  ASSERT_EQ(after.segment_num, 2);
+  CHECK_JUST(pool.UnlinkAll());
+}
+
+TEST(SharedMemoryPool, unlink_all) {
+  SharedMemoryPool& pool = SharedMemoryPool::get();
+  auto attached_shm = CHECK_JUST(pool.Acquire(100));
+  const std::string attached_name = attached_shm->name();
+  std::strcpy(Data(attached_shm.get()), "in flight");
+  auto consumer_shm = CHECK_JUST(pool.Attach(attached_name));
+  const std::string pending_name = CHECK_JUST(pool.Acquire(100))->name();
+  attached_shm.reset();
+
+  CHECK_JUST(pool.UnlinkAll());
+  ASSERT_FALSE(ShmExists(attached_name));
+  ASSERT_FALSE(ShmExists(pending_name));
+  ASSERT_EQ(pool.stats().segment_num, 0);
+  ASSERT_EQ(pool.stats().segment_bytes, 0);
+  // the consumer reads a batch in flight until it releases it
+  ASSERT_STREQ(Data(consumer_shm.get()), "in flight");
+  CHECK_JUST(pool.Release(attached_name));
+  const int64_t create_cnt = pool.stats().create_cnt;
+  CHECK_JUST(pool.Acquire(100));
+  ASSERT_EQ(pool.stats().create_cnt, create_cnt + 1);
+  CHECK_JUST(pool.UnlinkAll());
+}
+
+#endif  // __linux__
+
+}  // namespace ipc
+}  // namespace oneflow
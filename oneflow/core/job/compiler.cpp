@@ -21,30 +21,96 @@ limitations under the License.
 #include "oneflow/core/graph/op_graph.h"
 #include "oneflow/core/job_rewriter/job_completer.h"
 #include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/common/balanced_splitter.h"
 #include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/common/env_var/env_var.h"
 
 namespace oneflow {
 
-void CreateOpAttributeRef(Plan* plan, int64_t job_id, TaskProto* task_proto) {
-  auto* job_id2op_attribute_ref_table = plan->mutable_job_id2op_attribute_ref_table();
+DEFINE_ENV_BOOL(ONEFLOW_ENABLE_PARALLEL_TASK_GRAPH_BUILD, true);
+
+namespace {
+
+void CreateOpAttributeRef(HashMap<std::string, OpAttribute>* op_name2op_attribute,
+                          TaskProto* task_proto) {
   CHECK(task_proto->exec_sequence().exec_node_size() == 1);
   auto* exec_node = task_proto->mutable_exec_sequence()->mutable_exec_node(0);
   CHECK(exec_node->kernel_conf().has_op_attribute());
   const std::string op_name = exec_node->kernel_conf().op_attribute().op_conf().name();
-  auto* op_name2op_attribute =
-      (*job_id2op_attribute_ref_table)[job_id].mutable_op_name2op_attribute();
+  auto* kernel_conf = exec_node->mutable_kernel_conf();
   auto find_it = op_name2op_attribute->find(op_name);
   if (find_it == op_name2op_attribute->end()) {
-    op_name2op_attribute->insert(
-        {op_name, task_proto->exec_sequence().exec_node(0).kernel_conf().op_attribute()});
+    op_name2op_attribute->emplace(op_name, std::move(*kernel_conf->mutable_op_attribute()));
   }
-  auto* kernel_conf =
-      task_proto->mutable_exec_sequence()->mutable_exec_node(0)->mutable_kernel_conf();
   kernel_conf->set_op_attribute_ref(op_name);
   // NOTE(levi): memory of op_attribute_ is released here.
-  kernel_conf->set_allocated_op_attribute(nullptr);
+  kernel_conf->clear_op_attribute();
 }
 
+// Part of the plan generated by one worker, merged into the plan without locking.
+struct PlanShard {
+  std::vector<TaskProto> tasks;
+  HashMap<std::string, OpAttribute> op_name2op_attribute;
+};
+
+// Groups nodes by the length of the longest path from a source node. There is no path between
+// two nodes of the same level, so a handler which only writes the node itself and reads its
+// predecessors can run on a whole level concurrently.
+std::vector<std::vector<TaskNode*>> GetTopoLevels(const TaskGraph& task_gph) {
+  std::vector<std::vector<TaskNode*>> levels;
+  HashMap<TaskNode*, size_t> node2level;
+  task_gph.TopoForEachNode([&](TaskNode* node) {
+    size_t level = 0;
+    node->ForEachNodeOnInEdge(
+        [&](TaskNode* in_node) { level = std::max(level, node2level.at(in_node) + 1); });
+    node2level.emplace(node, level);
+    if (levels.size() <= level) { levels.resize(level + 1); }
+    levels.at(level).emplace_back(node);
+  });
+  return levels;
+}
+
+void WavefrontForEachNode(const std::vector<std::vector<TaskNode*>>& levels,
+                          ThreadPool* thread_pool, const std::function<void(TaskNode*)>& Handler) {
+  for (const auto& level : levels) {
+    const int64_t shard_num = std::min<int64_t>(level.size(), thread_pool->thread_num());
+    if (shard_num <= 1) {
+      for (TaskNode* node : level) { Handler(node); }
+      continue;
+    }
+    BalancedSplitter bs(level.size(), shard_num);
+    BlockingCounter counter(shard_num);
+    for (int64_t i = 0; i < shard_num; ++i) {
+      thread_pool->AddWork([&, i]() {
+        const Range range = bs.At(i);
+        for (int64_t j = range.begin(); j < range.end(); ++j) { Handler(level.at(j)); }
+        counter.Decrease();
+      });
+    }
+    counter.WaitForeverUntilCntEqualZero();
+  }
+}
+
+class CompilePhaseTimer final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CompilePhaseTimer);
+  explicit CompilePhaseTimer(int64_t job_id) : job_id_(job_id), last_time_(GetCurTime()) {}
+  ~CompilePhaseTimer() = default;
+
+  void Tick(const std::string& phase) {
+    const double now = GetCurTime();
+    VLOG(1) << "Job " << job_id_ << " compile phase " << phase
+            << " time: " << (now - last_time_) / 1000000000.0 << " seconds.";
+    last_time_ = now;
+  }
+
+ private:
+  int64_t job_id_;
+  double last_time_;
+};
+
+}  // namespace
+
 void Compiler::Compile(Job* job, Plan* plan) const {
   // Step1: new Singleton<OpGraph> and set log configs.
   Singleton<OpGraph>::New(*job);
@@ -58,47 +124,88 @@ void Compiler::Compile(Job* job, Plan* plan) const {
 
   // Step2: build task_gph.
   // TODO(levi): we can rewrite this part of code in visitor pattern.
-  auto task_gph =
-      std::make_unique<TaskGraph>(job->job_conf().enable_straighten_algorithm_in_task_graph());
+  CompilePhaseTimer timer(job_desc.job_id());
+  auto task_gph = std::make_unique<TaskGraph>();
+  timer.Tick("BuildTaskGraph");
+  const int64_t node_num = task_gph->node_num();
+  const int64_t cpu_num = std::thread::hardware_concurrency();
+  const int64_t thread_pool_size = std::max<int64_t>(std::min(node_num, cpu_num), 1);
+  ThreadPool thread_pool(thread_pool_size);
+  // NOTE: producing and consuming regsts allocate regst desc ids and add consumers to regsts of
+  // other nodes, they stay serial to keep ids deterministic.
   using std::placeholders::_1;
   task_gph->ForEachNode(std::bind(&TaskNode::ProduceAllRegstsAndBindEdges, _1));
   task_gph->ForEachNode(std::bind(&TaskNode::ConsumeAllRegsts, _1));
   task_gph->ForEachNode(std::bind(&TaskNode::PinConsumedRegst, _1));
-  task_gph->TopoForEachNode(&TaskNode::Build);
+  timer.Tick("ProduceAndConsumeRegsts");
+  const bool parallel_build = EnvBool<ONEFLOW_ENABLE_PARALLEL_TASK_GRAPH_BUILD>();
+  if (parallel_build) {
+    WavefrontForEachNode(GetTopoLevels(*task_gph), &thread_pool, &TaskNode::Build);
+  } else {
+    task_gph->TopoForEachNode(&TaskNode::Build);
+  }
+  timer.Tick("Build");
   task_gph->RemoveEmptyRegsts();
+  task_gph->DecideExecutionOrder(job->job_conf());
   task_gph->MergeChainAndAddOrderingCtrlEdgeInSameChain();
   auto IsReachable = Singleton<OpGraph>::Get()->MakePredicatorIsOpNameDataOrCtrlReachable();
   if (job_desc.enable_inplace()) { task_gph->EnableInplaceMemSharing(IsReachable); }
-  task_gph->TopoForEachNode(&TaskNode::InferTimeShapeIfMeaningful);
+  timer.Tick("MergeChainAndInplace");
+  if (parallel_build) {
+    // NOTE: ctrl edges were added above, so levels are computed again.
+    WavefrontForEachNode(GetTopoLevels(*task_gph), &thread_pool,
+                         &TaskNode::InferTimeShapeIfMeaningful);
+  } else {
+    task_gph->TopoForEachNode(&TaskNode::InferTimeShapeIfMeaningful);
+  }
   task_gph->ForEachEdge([&](TaskEdge* task_edge) { task_edge->CheckRegstLbiValid(); });
+  timer.Tick("InferTimeShape");
 
   // Step3: put infomation from task_gph into plan.
-  const int64_t node_num = task_gph->node_num();
-  const int64_t cpu_num = std::thread::hardware_concurrency();
-  const int64_t thread_pool_size = std::min(node_num, cpu_num);
-  BlockingCounter counter(node_num);
-  std::mutex mtx;
-  ThreadPool thread_pool(thread_pool_size);
+  std::vector<TaskNode*> task_nodes;
+  task_nodes.reserve(node_num);
   task_gph->ForEachNode([&](TaskNode* task_node) {
-    thread_pool.AddWork([task_node, plan, &job_desc, &counter, &mtx]() {
-      if (!task_node->IsMeaningLess()) {
-        TaskProto task_proto;
-        task_node->ToProto(&task_proto);
-        {
-          std::unique_lock<std::mutex> guard(mtx);
-          if (task_node->GetTaskType() == kNormalForward || task_node->GetTaskType() == kRepeat
-              || task_node->GetTaskType() == kAcc) {
-            CreateOpAttributeRef(plan, job_desc.job_id(), &task_proto);
-          }
-          plan->mutable_task()->Add(std::move(task_proto));
-        }  // guard(mtx)
+    if (!task_node->IsMeaningLess()) { task_nodes.emplace_back(task_node); }
+  });
+  // NOTE: more shards than threads to balance the load, each worker fills its own shard.
+  const int64_t shard_num =
+      std::max<int64_t>(std::min<int64_t>(task_nodes.size(), thread_pool_size * 4), 1);
+  std::vector<PlanShard> shards(shard_num);
+  BalancedSplitter bs(task_nodes.size(), shard_num);
+  BlockingCounter counter(shard_num);
+  for (int64_t i = 0; i < shard_num; ++i) {
+    thread_pool.AddWork([&, i]() {
+      PlanShard* shard = &shards.at(i);
+      const Range range = bs.At(i);
+      shard->tasks.resize(range.size());
+      for (int64_t j = range.begin(); j < range.end(); ++j) {
+        TaskNode* task_node = task_nodes.at(j);
+        TaskProto* task_proto = &shard->tasks.at(j - range.begin());
+        task_node->ToProto(task_proto);
+        if (task_node->GetTaskType() == kNormalForward || task_node->GetTaskType() == kRepeat
+            || task_node->GetTaskType() == kAcc) {
+          CreateOpAttributeRef(&shard->op_name2op_attribute, task_proto);
+        }
       }
       counter.Decrease();
     } /* thread_pool.AddWork */);
-  } /* task_gph->ForEachNode */);
+  }
   counter.WaitForeverUntilCntEqualZero();
   // NOTE(levi): release task_gph here to decrise memory peak.
   task_gph.reset();
+  auto* op_name2op_attribute =
+      (*plan->mutable_job_id2op_attribute_ref_table())[job_desc.job_id()]
+          .mutable_op_name2op_attribute();
+  plan->mutable_task()->Reserve(plan->task_size() + task_nodes.size());
+  for (PlanShard& shard : shards) {
+    for (auto& pair : shard.op_name2op_attribute) {
+      if (op_name2op_attribute->find(pair.first) == op_name2op_attribute->end()) {
+        (*op_name2op_attribute)[pair.first] = std::move(pair.second);
+      }
+    }
+    for (TaskProto& task_proto : shard.tasks) { plan->mutable_task()->Add(std::move(task_proto)); }
+  }
+  timer.Tick("GenTaskProtos");
 
   // Step4: post-process for plan and delete Singleton<OpGraph>.
   auto* job_id2job_conf = plan->mutable_job_confs()->mutable_job_id2job_conf();
@@ -106,6 +213,7 @@ void Compiler::Compile(Job* job, Plan* plan) const {
   // NOTE(chengcheng): infer mem blob id & set inplace & add ctrl
   IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(plan, IsReachable);
   PlanUtil::SetUniqueMemBlockId4UnreusedMemRegst(plan);
+  timer.Tick("InferMemBlockId");
   Singleton<OpGraph>::Delete();
 }
 
@@ -35,6 +35,9 @@ class IDMgr final {
 
   TaskIdGenerator* GetTaskIdGenerator() { return &task_id_gen_; }
 
+  void SaveIdState(IdState* id_state) const;
+  void LoadIdState(const IdState& id_state);
+
  private:
   friend class Singleton<IDMgr>;
   IDMgr();
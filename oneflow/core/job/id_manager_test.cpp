@@ -72,4 +72,24 @@ TEST(IDMgr, compile_regst_desc_id) {
   Delete();
 }
 
+TEST(IDMgr, save_and_load_id_state) {
+  New();
+  IDMgr* id_mgr = Singleton<IDMgr>::Get();
+  const StreamId stream_id(DeviceId(0, DeviceType::kCPU, 0), 1);
+  id_mgr->NewRegstDescId();
+  id_mgr->NewMemBlockId();
+  id_mgr->GetTaskIdGenerator()->Generate(stream_id);
+  IdState id_state;
+  id_mgr->SaveIdState(&id_state);
+  const int64_t regst_desc_id = id_mgr->NewRegstDescId();
+  const int64_t mem_block_id = id_mgr->NewMemBlockId();
+  const TaskId task_id = id_mgr->GetTaskIdGenerator()->Generate(stream_id);
+  id_mgr->NewRegstDescId();
+  id_mgr->LoadIdState(id_state);
+  ASSERT_EQ(id_mgr->NewRegstDescId(), regst_desc_id);
+  ASSERT_EQ(id_mgr->NewMemBlockId(), mem_block_id);
+  ASSERT_EQ(id_mgr->GetTaskIdGenerator()->Generate(stream_id), task_id);
+  Delete();
+}
+
 }  // namespace oneflow
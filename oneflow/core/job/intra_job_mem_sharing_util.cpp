@@ -18,6 +18,8 @@ limitations under the License.
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/common/shape.h"
 #include "oneflow/core/job/id_manager.h"
+#include "oneflow/core/job/mem_offset_planner.h"
+#include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/core/register/runtime_register_desc.h"
 #include "oneflow/core/thread/thread_pool.h"
 #include "oneflow/core/graph/task_node.h"
@@ -29,6 +31,9 @@ enum MemAllocAlgoType {
   kMemSizeFirstAlgo = 0,
   kMutualExclusionFirstAlgo = 1,
   kTimeLineAlgo = 2,
+  kMemSizeBestFitAlgo = 3,
+  kMemVolumeFirstAlgo = 4,
+  kRandomizedMemSizeFirstAlgo = 5,
 };
 
 }  // namespace oneflow
@@ -48,11 +53,6 @@ namespace oneflow {
 
 namespace {
 
-struct MemBlockResultInfo {
-  size_t mem_block_size;
-  HashMap<RegstDescProto*, int64_t> regst_desc2offset;
-};
-
 int64_t GenDeviceUniqueId(int64_t machine_id, int64_t device_id) {
   return (machine_id << 32) | device_id;
 }
@@ -299,18 +299,14 @@ void GenMemChainTasksAndRegsts(
   }
 }
 
-void GenRegstAllocFreeTimeLineAndRegstMutualExclusions(
+void GenRegstAllocFreeTimeLineAndMemOffsetPlanItems(
     const std::vector<TaskProto*>& sorted_tasks, const HashSet<RegstDescProto*>& mem_reused_regsts,
     const HashMap<int64_t, RegstDescProto*>& regst_desc_id2regst_desc,
-    std::vector<HashSet<RegstDescProto*>>* alloc_regsts_timeline,
-    std::vector<HashSet<RegstDescProto*>>* free_regsts_timeline,
-    HashMap<RegstDescProto*, std::vector<RegstDescProto*>>* regst2mutual_exclusion_regsts,
+    std::vector<RegstDescProto*>* regsts, std::vector<MemOffsetPlanItem>* items,
     HashMap<RegstDescProto*, RegstDescProto*>* consumer2inplaced_regst) {
-  CHECK(alloc_regsts_timeline->empty() && free_regsts_timeline->empty());
-  CHECK(regst2mutual_exclusion_regsts->empty());
+  CHECK(regsts->empty() && items->empty());
   CHECK(consumer2inplaced_regst->empty());
-  alloc_regsts_timeline->resize(sorted_tasks.size());
-  free_regsts_timeline->resize(sorted_tasks.size());
+  std::vector<std::vector<RegstDescProto*>> alloc_regsts_timeline(sorted_tasks.size());
   HashMap<int64_t, int64_t> task_id2sorted_id;
   for (int64_t i = 0; i < sorted_tasks.size(); ++i) {
     TaskProto* task = sorted_tasks.at(i);
@@ -355,9 +351,8 @@ void GenRegstAllocFreeTimeLineAndRegstMutualExclusions(
       continue;
     }
 
-    CHECK(alloc_regsts_timeline->at(task_id2sorted_id.at(regst_desc->producer_task_id()))
-              .insert(regst_desc)
-              .second);
+    alloc_regsts_timeline.at(task_id2sorted_id.at(regst_desc->producer_task_id()))
+        .emplace_back(regst_desc);
     CHECK(regst_desc_id2free_index
               .emplace(regst_desc->regst_desc_id(), FindLastFreeIndexInSortedTasks(regst_desc))
               .second);
@@ -371,366 +366,69 @@ void GenRegstAllocFreeTimeLineAndRegstMutualExclusions(
         std::max(regst_desc_id2free_index.at(inplaced_regst_desc_id),
                  FindLastFreeIndexInSortedTasks(consumer_regst_desc));
   }
-  for (const auto& pair : regst_desc_id2free_index) {
-    CHECK(free_regsts_timeline->at(pair.second)
-              .insert(regst_desc_id2regst_desc.at(pair.first))
-              .second);
-  }
 
-  HashSet<RegstDescProto*> remain_regsts;
+  // NOTE(chengcheng): insert time line to regst proto
   for (int64_t i = 0; i < sorted_tasks.size(); ++i) {
-    for (RegstDescProto* alloc_regst : alloc_regsts_timeline->at(i)) {
-      CHECK(regst2mutual_exclusion_regsts->emplace(alloc_regst, std::vector<RegstDescProto*>())
-                .second);
-      for (RegstDescProto* remain_regst : remain_regsts) {
-        regst2mutual_exclusion_regsts->at(alloc_regst).emplace_back(remain_regst);
-        regst2mutual_exclusion_regsts->at(remain_regst).emplace_back(alloc_regst);
-      }
-      CHECK(remain_regsts.insert(alloc_regst).second);
-      // NOTE(chengcheng): insert time line to regst proto
+    for (RegstDescProto* alloc_regst : alloc_regsts_timeline.at(i)) {
+      const int64_t free_index = regst_desc_id2free_index.at(alloc_regst->regst_desc_id());
       alloc_regst->set_mem_block_total_actor_count(sorted_tasks.size());
       alloc_regst->set_alloc_before_actor(i);
-    }
-    for (RegstDescProto* free_regst : free_regsts_timeline->at(i)) {
-      CHECK_EQ(remain_regsts.erase(free_regst), 1);
-      free_regst->set_free_after_actor(i);
-    }
-  }
-  CHECK(remain_regsts.empty());
-}
-
-struct Piece {
-  int64_t begin;
-  int64_t end;
-  bool is_free;
-};
-using PieceIt = std::list<Piece>::iterator;
-
-class MemBlockBuffer final {
- public:
-  MemBlockBuffer(size_t size) : buffer_size_(size) {
-    Piece start_piece;
-    start_piece.begin = 0;
-    start_piece.end = size;
-    start_piece.is_free = true;
-    piece_list_.emplace_back(start_piece);
-  };
-  ~MemBlockBuffer() = default;
-
-  void Occupy(int64_t begin, int64_t end);
-  void FindFreeOffsetAndNewBufferSize(int64_t size, int64_t* offset, size_t* new_buffer_size);
-
- private:
-  void CheckValid() {
-    CHECK(piece_list_.size() >= 1);
-    CHECK(piece_list_.begin()->begin == 0);
-    CHECK(std::prev(piece_list_.end())->end == buffer_size_);
-    for (auto it = std::next(piece_list_.begin()); it != piece_list_.end(); ++it) {
-      auto pre_it = std::prev(it);
-      CHECK(pre_it->begin < pre_it->end && pre_it->end == it->begin);
-    }
-  }
-
-  void MergePieceAndCheckValid() {
-    CheckValid();
-    for (auto it = std::next(piece_list_.begin()); it != piece_list_.end(); ++it) {
-      auto pre_it = std::prev(it);
-      if (it->is_free == pre_it->is_free) {
-        it->begin = pre_it->begin;
-        CHECK(piece_list_.erase(pre_it) == it);
-      }
-    }
-    CheckValid();
-  }
-
-  std::list<Piece> piece_list_;
-  size_t buffer_size_;
-};
-
-void MemBlockBuffer::Occupy(int64_t begin, int64_t end) {
-  CHECK(begin <= end && end <= buffer_size_);
-  for (auto it = piece_list_.begin(); it != piece_list_.end(); ++it) {
-    if (it->end <= begin) { continue; }
-    if (end <= it->begin) { break; }
-    if (it->is_free) {
-      if (begin != it->begin) {
-        CHECK(it->begin < begin);
-        CHECK(begin < it->end);
-        Piece free_piece;
-        free_piece.begin = it->begin;
-        free_piece.end = begin;
-        free_piece.is_free = true;
-        it->begin = begin;
-        it = piece_list_.insert(it, free_piece);
-      } else if (end < it->end) {
-        Piece busy_piece;
-        busy_piece.begin = it->begin;
-        busy_piece.end = end;
-        busy_piece.is_free = false;
-        it->begin = end;
-        it = piece_list_.insert(it, busy_piece);
-        begin = end;
-      } else {
-        it->is_free = false;
-        begin = it->end;
-      }
-    } else {
-      begin = it->end;
-      end = std::max(begin, end);
-    }
-  }
-  MergePieceAndCheckValid();
-}
-
-void MemBlockBuffer::FindFreeOffsetAndNewBufferSize(int64_t size, int64_t* offset,
-                                                    size_t* new_buffer_size) {
-  CheckValid();
-  for (auto it = piece_list_.begin(); it != piece_list_.end(); ++it) {
-    if (it->is_free && (it->end - it->begin) >= size) {
-      *offset = it->begin;
-      *new_buffer_size = buffer_size_;
-      return;
-    }
-  }
-  auto last_it = std::prev(piece_list_.end());
-  if (last_it->is_free) {
-    *offset = last_it->begin;
-    *new_buffer_size = buffer_size_ + size - (last_it->end - last_it->begin);
-  } else {
-    *offset = buffer_size_;
-    *new_buffer_size = buffer_size_ + size;
-  }
-}
-
-void MemReusedAlgorithm_AllocateByOrderAndMutualExclusion(
-    const std::vector<RegstDescProto*>& order,
-    const HashMap<RegstDescProto*, int64_t>& regst_desc2size,
-    const HashMap<RegstDescProto*, std::vector<RegstDescProto*>>& regst2mutual_exclusion_regsts,
-    MemBlockResultInfo* result) {
-  HashMap<RegstDescProto*, int64_t>* regst_desc2offset = &(result->regst_desc2offset);
-  size_t buffer_size = 1;
-  for (RegstDescProto* regst_desc : order) {
-    MemBlockBuffer buffer(buffer_size);
-    for (RegstDescProto* mutual_regst : regst2mutual_exclusion_regsts.at(regst_desc)) {
-      if (regst_desc2offset->find(mutual_regst) != regst_desc2offset->end()) {
-        int64_t begin = regst_desc2offset->at(mutual_regst);
-        int64_t end = begin + regst_desc2size.at(mutual_regst);
-        buffer.Occupy(begin, end);
-      }
-    }
-    int64_t offset = -1;
-    buffer.FindFreeOffsetAndNewBufferSize(regst_desc2size.at(regst_desc), &offset, &buffer_size);
-    CHECK(offset >= 0 && offset <= buffer_size);
-    CHECK(regst_desc2offset->emplace(regst_desc, offset).second);
-  }
-  result->mem_block_size = buffer_size;
-}
-
-void MemReusedAlgorithm_MemSizeFirstAlgo(
-    const HashMap<RegstDescProto*, std::vector<RegstDescProto*>>& regst2mutual_exclusion_regsts,
-    const HashMap<RegstDescProto*, int64_t>& regst2alloc_order, MemBlockResultInfo* result) {
-  std::vector<RegstDescProto*> order;
-  order.reserve(regst2mutual_exclusion_regsts.size());
-  HashMap<RegstDescProto*, int64_t> regst_desc2size;
-  for (const auto& pair : regst2mutual_exclusion_regsts) {
-    order.emplace_back(pair.first);
-    CHECK(regst_desc2size.emplace(pair.first, RtRegstDesc(*pair.first).TotalMainByteSize4AllRegst())
-              .second);
-  }
-  std::sort(order.begin(), order.end(), [&](RegstDescProto* lhs, RegstDescProto* rhs) {
-    int64_t l_size = regst_desc2size.at(lhs);
-    int64_t r_size = regst_desc2size.at(rhs);
-    if (l_size == r_size) { return regst2alloc_order.at(lhs) < regst2alloc_order.at(rhs); }
-    return l_size > r_size;
-  });
-  MemReusedAlgorithm_AllocateByOrderAndMutualExclusion(order, regst_desc2size,
-                                                       regst2mutual_exclusion_regsts, result);
-}
-
-void MemReusedAlgorithm_MutualExclusionFirstAlgo(
-    const HashMap<RegstDescProto*, std::vector<RegstDescProto*>>& regst2mutual_exclusion_regsts,
-    const HashMap<RegstDescProto*, int64_t>& regst2alloc_order, MemBlockResultInfo* result) {
-  std::vector<RegstDescProto*> order;
-  order.reserve(regst2mutual_exclusion_regsts.size());
-  HashMap<RegstDescProto*, int64_t> regst_desc2size;
-  for (const auto& pair : regst2mutual_exclusion_regsts) {
-    order.emplace_back(pair.first);
-    CHECK(regst_desc2size.emplace(pair.first, RtRegstDesc(*pair.first).TotalMainByteSize4AllRegst())
-              .second);
-  }
-  std::sort(order.begin(), order.end(), [&](RegstDescProto* lhs, RegstDescProto* rhs) {
-    int64_t l_size = regst2mutual_exclusion_regsts.at(lhs).size();
-    int64_t r_size = regst2mutual_exclusion_regsts.at(rhs).size();
-    if (l_size == r_size) { return regst2alloc_order.at(lhs) < regst2alloc_order.at(rhs); }
-    return l_size > r_size;
-  });
-  MemReusedAlgorithm_AllocateByOrderAndMutualExclusion(order, regst_desc2size,
-                                                       regst2mutual_exclusion_regsts, result);
-}
-
-class BfcAllocator final {
- public:
-  BfcAllocator(int64_t size) : buffer_size_(size) {
-    Piece start_piece;
-    start_piece.begin = 0;
-    start_piece.end = size;
-    start_piece.is_free = true;
-    piece_list_.emplace_back(start_piece);
-  };
-  ~BfcAllocator() = default;
-
-  // Return offset of the buffer for this allocate size memory
-  int64_t AllocateRaw(int64_t size);
-  void FreeRaw(int64_t offset, int64_t size);
-  int64_t buffer_size() const { return buffer_size_; }
-
- private:
-  void CheckValid() {
-    CHECK(piece_list_.size() >= 1);
-    CHECK(piece_list_.front().begin == 0);
-    CHECK(piece_list_.back().end == buffer_size_);
-    for (auto it = std::next(piece_list_.begin()); it != piece_list_.end(); ++it) {
-      auto pre_it = std::prev(it);
-      CHECK(pre_it->begin < pre_it->end && pre_it->end == it->begin);
-      CHECK(!(pre_it->is_free && it->is_free));
+      alloc_regst->set_free_after_actor(free_index);
+      regsts->emplace_back(alloc_regst);
+      MemOffsetPlanItem item;
+      item.size = RtRegstDesc(*alloc_regst).TotalMainByteSize4AllRegst();
+      item.alloc_step = i;
+      item.free_step = free_index;
+      items->emplace_back(item);
     }
   }
-
-  void MergeFreePieceAndCheckValid() {
-    for (auto it = std::next(piece_list_.begin()); it != piece_list_.end(); ++it) {
-      auto pre_it = std::prev(it);
-      if (it->is_free && pre_it->is_free) {
-        it->begin = pre_it->begin;
-        CHECK(piece_list_.erase(pre_it) == it);
-      }
-    }
-    CheckValid();
-  }
-
-  std::list<Piece> piece_list_;
-  int64_t buffer_size_;
-  HashMap<int64_t, PieceIt> offset2occupied_piece_;
-};
-
-int64_t BfcAllocator::AllocateRaw(int64_t size) {
-  int64_t offset = -1;
-  PieceIt candidate_piece = piece_list_.end();
-  for (auto it = piece_list_.begin(); it != piece_list_.end(); ++it) {
-    int64_t piece_size = it->end - it->begin;
-    if (it->is_free && piece_size >= size) {
-      if (candidate_piece == piece_list_.end()
-          || piece_size < (candidate_piece->end - candidate_piece->begin)) {
-        candidate_piece = it;
-      }
-    }
-  }
-  if (candidate_piece == piece_list_.end()) {
-    auto last_it = std::prev(piece_list_.end());
-    if (last_it->is_free) {
-      offset = last_it->begin;
-      buffer_size_ += size - (last_it->end - last_it->begin);
-      last_it->end = buffer_size_;
-      last_it->is_free = false;
-      CHECK(offset2occupied_piece_.emplace(offset, last_it).second);
-    } else {
-      offset = last_it->end;
-      buffer_size_ += size;
-      Piece new_piece;
-      new_piece.begin = last_it->end;
-      new_piece.end = buffer_size_;
-      new_piece.is_free = false;
-      piece_list_.emplace_back(new_piece);
-      CHECK(offset2occupied_piece_.emplace(offset, std::prev(piece_list_.end())).second);
-    }
-  } else {
-    int64_t piece_size = candidate_piece->end - candidate_piece->begin;
-    offset = candidate_piece->begin;
-    if (piece_size > size) {
-      Piece new_piece;
-      new_piece.begin = candidate_piece->begin;
-      new_piece.end = candidate_piece->begin + size;
-      new_piece.is_free = false;
-      candidate_piece->begin = new_piece.end;
-      PieceIt new_it = piece_list_.insert(candidate_piece, new_piece);
-      CHECK(offset2occupied_piece_.emplace(offset, new_it).second);
-    } else {
-      CHECK_EQ(size, piece_size);
-      candidate_piece->is_free = false;
-      CHECK(offset2occupied_piece_.emplace(offset, candidate_piece).second);
-    }
-  }
-  CheckValid();
-  CHECK_NE(offset, -1);
-  CHECK(offset2occupied_piece_.find(offset) != offset2occupied_piece_.end());
-  return offset;
-}
-
-void BfcAllocator::FreeRaw(int64_t offset, int64_t size) {
-  CHECK(offset2occupied_piece_.find(offset) != offset2occupied_piece_.end());
-  PieceIt occupied_piece = offset2occupied_piece_.at(offset);
-  CHECK(occupied_piece->is_free == false);
-  CHECK_EQ((occupied_piece->end - occupied_piece->begin), size);
-  occupied_piece->is_free = true;
-  CHECK(offset2occupied_piece_.erase(offset) == 1);
-  MergeFreePieceAndCheckValid();
+  CHECK_EQ(regsts->size(), regst_desc_id2free_index.size());
 }
 
-void MemReusedAlgorithm_TimeLineAlgo(
-    const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
-    const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline, MemBlockResultInfo* result) {
-  HashMap<RegstDescProto*, int64_t>* regst_desc2offset = &(result->regst_desc2offset);
-  regst_desc2offset->clear();
-  int64_t buffer_size = 1;
-  BfcAllocator bfc_allocator(buffer_size);
-
-  auto GetRegstSize = [](const RegstDescProto* regst) -> int64_t {
-    return RtRegstDesc(*regst).TotalMainByteSize4AllRegst();
-  };
-
-  CHECK_EQ(alloc_regsts_timeline.size(), free_regsts_timeline.size());
-  for (int64_t i = 0; i < alloc_regsts_timeline.size(); ++i) {
-    for (RegstDescProto* alloc_regst : alloc_regsts_timeline.at(i)) {
-      CHECK(regst_desc2offset
-                ->emplace(alloc_regst, bfc_allocator.AllocateRaw(GetRegstSize(alloc_regst)))
-                .second);
-    }
-    for (RegstDescProto* free_regst : free_regsts_timeline.at(i)) {
-      CHECK(regst_desc2offset->find(free_regst) != regst_desc2offset->end());
-      bfc_allocator.FreeRaw(regst_desc2offset->at(free_regst), GetRegstSize(free_regst));
-    }
+void DumpMemOffsetPlanItems(int64_t mem_chain_id, const std::vector<MemOffsetPlanItem>& items) {
+  // one regst per line: size alloc_step free_step
+  std::string lifetimes;
+  for (const auto& item : items) {
+    lifetimes += std::to_string(item.size) + " " + std::to_string(item.alloc_step) + " "
+                 + std::to_string(item.free_step) + "\n";
   }
-  result->mem_block_size = bfc_allocator.buffer_size();
+  TeePersistentLogStream::Create(StrCat("mem_chain_lifetimes_", GlobalJobDesc().job_id()) + "_"
+                                 + std::to_string(mem_chain_id))
+      ->Write(lifetimes);
 }
 
-void SelectAlgorithmGenMemBlockOffset4Regsts(
-    MemAllocAlgoType algo_id, const std::vector<HashSet<RegstDescProto*>>& alloc_regsts_timeline,
-    const std::vector<HashSet<RegstDescProto*>>& free_regsts_timeline,
-    const HashMap<RegstDescProto*, std::vector<RegstDescProto*>>& regst2mutual_exclusion_regsts,
-    MemBlockResultInfo* result) {
+void SelectAlgorithmGenMemBlockOffset4Regsts(MemAllocAlgoType algo_id,
+                                             const std::vector<MemOffsetPlanItem>& items,
+                                             MemOffsetPlan* result) {
   CHECK_EQ(result->mem_block_size, 0);
-  CHECK(result->regst_desc2offset.empty());
+  CHECK(result->offsets.empty());
 
-  // NOTE(chengcheng): When mem size or exclusion num equal, there need second order by allocate.
-  HashMap<RegstDescProto*, int64_t> regst2alloc_order;
-  for (int64_t i = 0; i < alloc_regsts_timeline.size(); ++i) {
-    const auto& regsts = alloc_regsts_timeline.at(i);
-    for (RegstDescProto* regst : regsts) { CHECK(regst2alloc_order.emplace(regst, i).second); }
-  }
   switch (algo_id) {
     case kMemSizeFirstAlgo:
-      MemReusedAlgorithm_MemSizeFirstAlgo(regst2mutual_exclusion_regsts, regst2alloc_order, result);
+      PlanMemOffsetsByOrder(items, MemSizeFirstOrder(items), /*best_fit=*/false, result);
       break;
     case kMutualExclusionFirstAlgo:
-      MemReusedAlgorithm_MutualExclusionFirstAlgo(regst2mutual_exclusion_regsts, regst2alloc_order,
-                                                  result);
+      PlanMemOffsetsByOrder(items, MutualExclusionFirstOrder(items), /*best_fit=*/false, result);
+      break;
+    case kTimeLineAlgo: PlanMemOffsetsByTimeLine(items, result); break;
+    case kMemSizeBestFitAlgo:
+      PlanMemOffsetsByOrder(items, MemSizeFirstOrder(items), /*best_fit=*/true, result);
       break;
-    case kTimeLineAlgo:
-      MemReusedAlgorithm_TimeLineAlgo(alloc_regsts_timeline, free_regsts_timeline, result);
+    case kMemVolumeFirstAlgo:
+      PlanMemOffsetsByOrder(items, MemVolumeFirstOrder(items), /*best_fit=*/true, result);
+      break;
+    case kRandomizedMemSizeFirstAlgo:
+      PlanMemOffsetsByRandomizedMemSize(items,
+                                        GlobalJobDesc()
+                                            .job_conf()
+                                            .memory_allocation_algorithm_conf()
+                                            .randomized_mem_size_first_trial_num(),
+                                        /*seed=*/0, result);
       break;
     default: UNIMPLEMENTED();
   }
   CHECK_GT(result->mem_block_size, 0);
-  CHECK(!result->regst_desc2offset.empty());
+  CHECK_EQ(result->offsets.size(), items.size());
 }
 
 int64_t CountMemAllocAlgoNum() {
@@ -740,22 +438,34 @@ int64_t CountMemAllocAlgoNum() {
   if (mem_alloc_algo_conf.use_mem_size_first_algo()) { ++ret; }
   if (mem_alloc_algo_conf.use_mutual_exclusion_first_algo()) { ++ret; }
   if (mem_alloc_algo_conf.use_time_line_algo()) { ++ret; }
+  if (mem_alloc_algo_conf.use_mem_size_best_fit_algo()) { ++ret; }
+  if (mem_alloc_algo_conf.use_mem_volume_first_algo()) { ++ret; }
+  if (mem_alloc_algo_conf.randomized_mem_size_first_trial_num() > 0) { ++ret; }
   CHECK_GE(ret, 0);
   return ret;
 }
 
-void InitAlgo2Result(HashMap<MemAllocAlgoType, MemBlockResultInfo>* algo2result) {
+void InitAlgo2Result(HashMap<MemAllocAlgoType, MemOffsetPlan>* algo2result) {
   CHECK(algo2result->empty());
   const MemoryAllocationAlgorithmConf& mem_alloc_algo_conf =
       GlobalJobDesc().job_conf().memory_allocation_algorithm_conf();
   if (mem_alloc_algo_conf.use_mem_size_first_algo()) {
-    CHECK(algo2result->emplace(kMemSizeFirstAlgo, MemBlockResultInfo()).second);
+    CHECK(algo2result->emplace(kMemSizeFirstAlgo, MemOffsetPlan()).second);
   }
   if (mem_alloc_algo_conf.use_mutual_exclusion_first_algo()) {
-    CHECK(algo2result->emplace(kMutualExclusionFirstAlgo, MemBlockResultInfo()).second);
+    CHECK(algo2result->emplace(kMutualExclusionFirstAlgo, MemOffsetPlan()).second);
   }
   if (mem_alloc_algo_conf.use_time_line_algo()) {
-    CHECK(algo2result->emplace(kTimeLineAlgo, MemBlockResultInfo()).second);
+    CHECK(algo2result->emplace(kTimeLineAlgo, MemOffsetPlan()).second);
+  }
+  if (mem_alloc_algo_conf.use_mem_size_best_fit_algo()) {
+    CHECK(algo2result->emplace(kMemSizeBestFitAlgo, MemOffsetPlan()).second);
+  }
+  if (mem_alloc_algo_conf.use_mem_volume_first_algo()) {
+    CHECK(algo2result->emplace(kMemVolumeFirstAlgo, MemOffsetPlan()).second);
+  }
+  if (mem_alloc_algo_conf.randomized_mem_size_first_trial_num() > 0) {
+    CHECK(algo2result->emplace(kRandomizedMemSizeFirstAlgo, MemOffsetPlan()).second);
   }
 }
 
@@ -774,25 +484,24 @@ void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(
   for (const auto& pair : mem_chain2mem_reused_regsts) { mem_chains.insert(pair.first); }
   HashMap<int64_t, RegstDescProto*> regst_desc_id2regst_desc;
   GenRegstDescId2RegstDesc(plan, &regst_desc_id2regst_desc);
-  // info for algorithm
-  HashMap<int64_t, std::vector<HashSet<RegstDescProto*>>> mem_chain2task2alloc_regsts;
-  HashMap<int64_t, std::vector<HashSet<RegstDescProto*>>> mem_chain2task2free_regsts;
-  HashMap<int64_t, HashMap<RegstDescProto*, std::vector<RegstDescProto*>>>
-      mem_chain2regst2mutual_exclusion_regsts;
+  // info for algorithm, the lifetime and size of mem_chain2regsts[i][j] is in items[i][j]
+  HashMap<int64_t, std::vector<RegstDescProto*>> mem_chain2regsts;
+  HashMap<int64_t, std::vector<MemOffsetPlanItem>> mem_chain2items;
   // info for inplace
   HashMap<int64_t, HashMap<RegstDescProto*, RegstDescProto*>> mem_chain2consumer2inplaced_regst;
 
-  // step 1: generate regst alloc/free queue AND regst mutual exclusions
+  // step 1: generate regst alloc/free time line
+  const bool enable_debug_mode = Singleton<ResourceDesc, ForSession>::Get()->enable_debug_mode();
   for (const auto& pair : mem_chain2mem_reused_regsts) {
-    GenRegstAllocFreeTimeLineAndRegstMutualExclusions(
+    GenRegstAllocFreeTimeLineAndMemOffsetPlanItems(
         mem_chain2sorted_tasks.at(pair.first), pair.second, regst_desc_id2regst_desc,
-        &mem_chain2task2alloc_regsts[pair.first], &mem_chain2task2free_regsts[pair.first],
-        &mem_chain2regst2mutual_exclusion_regsts[pair.first],
+        &mem_chain2regsts[pair.first], &mem_chain2items[pair.first],
         &mem_chain2consumer2inplaced_regst[pair.first]);
+    if (enable_debug_mode) { DumpMemOffsetPlanItems(pair.first, mem_chain2items.at(pair.first)); }
   }
 
   // step 2: multi-thread run several algorithm for each mem chain
-  HashMap<int64_t, HashMap<MemAllocAlgoType, MemBlockResultInfo>> mem_chain2algo2result;
+  HashMap<int64_t, HashMap<MemAllocAlgoType, MemOffsetPlan>> mem_chain2algo2result;
   {
     int64_t work_size = mem_chain2mem_reused_regsts.size() * CountMemAllocAlgoNum();
     int64_t thread_pool_size = std::min<int64_t>(work_size, std::thread::hardware_concurrency());
@@ -802,14 +511,10 @@ void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(
       InitAlgo2Result(&mem_chain2algo2result[mem_chain_id]);
       for (auto& pair : mem_chain2algo2result.at(mem_chain_id)) {
         MemAllocAlgoType algo_id = pair.first;
-        MemBlockResultInfo* result = &pair.second;
-        thread_pool.AddWork([algo_id, mem_chain_id, &mem_chain2task2alloc_regsts,
-                             &mem_chain2task2free_regsts, &mem_chain2regst2mutual_exclusion_regsts,
-                             result, &counter]() {
-          SelectAlgorithmGenMemBlockOffset4Regsts(
-              algo_id, mem_chain2task2alloc_regsts.at(mem_chain_id),
-              mem_chain2task2free_regsts.at(mem_chain_id),
-              mem_chain2regst2mutual_exclusion_regsts.at(mem_chain_id), result);
+        MemOffsetPlan* result = &pair.second;
+        thread_pool.AddWork([algo_id, mem_chain_id, &mem_chain2items, result, &counter]() {
+          SelectAlgorithmGenMemBlockOffset4Regsts(algo_id, mem_chain2items.at(mem_chain_id),
+                                                  result);
           counter.Decrease();
         });
       }
@@ -819,22 +524,24 @@ void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(
 
   // step 3: choose best one for each mem chain and set offset for inplace consumer regst
   for (const auto& pair : mem_chain2algo2result) {
-    const MemBlockResultInfo* best_result = nullptr;
+    const MemOffsetPlan* best_result = nullptr;
     for (const auto& algo_result_pair : pair.second) {
+      VLOG(3) << "mem chain " << pair.first << " algorithm " << algo_result_pair.first
+              << " mem block size " << algo_result_pair.second.mem_block_size;
       if (!best_result || algo_result_pair.second.mem_block_size < best_result->mem_block_size) {
         best_result = &algo_result_pair.second;
       }
     }
     CHECK(best_result != nullptr);
     int64_t mem_block_id = Singleton<IDMgr>::Get()->NewMemBlockId();
+    const std::vector<RegstDescProto*>& regsts = mem_chain2regsts.at(pair.first);
     CHECK_EQ(mem_chain2mem_reused_regsts.at(pair.first).size(),
-             (best_result->regst_desc2offset.size()
-              + mem_chain2consumer2inplaced_regst.at(pair.first).size()));
-    for (const auto& regst_offset_pair : best_result->regst_desc2offset) {
-      RegstDescProto* regst_desc = regst_offset_pair.first;
+             (regsts.size() + mem_chain2consumer2inplaced_regst.at(pair.first).size()));
+    for (int64_t i = 0; i < regsts.size(); ++i) {
+      RegstDescProto* regst_desc = regsts.at(i);
       CHECK_EQ(regst_desc->mem_block_id(), -1);
       regst_desc->set_mem_block_id(mem_block_id);
-      regst_desc->set_mem_block_offset(regst_offset_pair.second);
+      regst_desc->set_mem_block_offset(best_result->offsets.at(i));
     }
     // set inplace
     for (auto& consumer_inplace_pair : mem_chain2consumer2inplaced_regst.at(pair.first)) {
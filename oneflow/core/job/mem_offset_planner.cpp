@@ -0,0 +1,279 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/mem_offset_planner.h"
+#include <limits>
+#include <map>
+#include <numeric>
+#include <random>
+#include <set>
+
+namespace oneflow {
+
+namespace {
+
+int64_t StepNum(const std::vector<MemOffsetPlanItem>& items) {
+  int64_t step_num = 0;
+  for (const auto& item : items) {
+    CHECK_LE(item.alloc_step, item.free_step);
+    CHECK_GE(item.alloc_step, 0);
+    step_num = std::max(step_num, item.free_step + 1);
+  }
+  return step_num;
+}
+
+// The placed items by lifetime. The items alive at a step are found by a segment tree over the
+// steps, the items allocated within some steps by their alloc step.
+class LifetimeIndex final {
+ public:
+  explicit LifetimeIndex(int64_t step_num) : step_num_(step_num), node2ids_(2 * step_num) {}
+  ~LifetimeIndex() = default;
+
+  void Insert(int64_t id, const MemOffsetPlanItem& item) {
+    int64_t begin = item.alloc_step + step_num_;
+    int64_t end = item.free_step + 1 + step_num_;
+    for (; begin < end; begin >>= 1, end >>= 1) {
+      if (begin & 1) { node2ids_.at(begin++).emplace_back(id); }
+      if (end & 1) { node2ids_.at(--end).emplace_back(id); }
+    }
+    alloc_step2ids_.emplace(item.alloc_step, id);
+  }
+
+  // Visits the inserted items whose lifetime overlaps with the lifetime of `item`.
+  template<typename Handler>
+  void ForEachOverlapping(const MemOffsetPlanItem& item, const Handler& DoEach) const {
+    // alive at the alloc step of `item`
+    for (int64_t node = item.alloc_step + step_num_; node > 0; node >>= 1) {
+      for (int64_t id : node2ids_.at(node)) { DoEach(id); }
+    }
+    // allocated after the alloc step of `item` and before it is freed
+    for (auto it = alloc_step2ids_.upper_bound(item.alloc_step);
+         it != alloc_step2ids_.end() && it->first <= item.free_step; ++it) {
+      DoEach(it->second);
+    }
+  }
+
+ private:
+  int64_t step_num_;
+  std::vector<std::vector<int64_t>> node2ids_;
+  std::multimap<int64_t, int64_t> alloc_step2ids_;
+};
+
+// A best fit allocator growing at the end, with the free pieces indexed by offset and by size.
+class BestFitOffsetAllocator final {
+ public:
+  explicit BestFitOffsetAllocator(int64_t size) : buffer_size_(size) { InsertFree(0, size); }
+  ~BestFitOffsetAllocator() = default;
+
+  int64_t Allocate(int64_t size) {
+    // the smallest piece that fits, the lowest one among the pieces of the same size
+    const auto it =
+        free_size_offset_.lower_bound(std::make_pair(size, std::numeric_limits<int64_t>::min()));
+    if (it != free_size_offset_.end()) {
+      const int64_t piece_size = it->first;
+      const int64_t offset = it->second;
+      EraseFree(offset, piece_size);
+      if (piece_size > size) { InsertFree(offset + size, piece_size - size); }
+      return offset;
+    }
+    int64_t offset = buffer_size_;
+    if (!free_offset2size_.empty()) {
+      const auto last = std::prev(free_offset2size_.end());
+      if (last->first + last->second == buffer_size_) {
+        offset = last->first;
+        EraseFree(last->first, last->second);
+      }
+    }
+    buffer_size_ = offset + size;
+    return offset;
+  }
+
+  void Free(int64_t offset, int64_t size) {
+    int64_t begin = offset;
+    int64_t end = offset + size;
+    const auto next = free_offset2size_.find(end);
+    if (next != free_offset2size_.end()) {
+      end += next->second;
+      EraseFree(next->first, next->second);
+    }
+    const auto after = free_offset2size_.lower_bound(begin);
+    if (after != free_offset2size_.begin()) {
+      const auto prev = std::prev(after);
+      CHECK_LE(prev->first + prev->second, begin);
+      if (prev->first + prev->second == begin) {
+        begin = prev->first;
+        EraseFree(prev->first, prev->second);
+      }
+    }
+    InsertFree(begin, end - begin);
+  }
+
+  int64_t buffer_size() const { return buffer_size_; }
+
+ private:
+  void InsertFree(int64_t offset, int64_t size) {
+    CHECK(free_offset2size_.emplace(offset, size).second);
+    CHECK(free_size_offset_.emplace(size, offset).second);
+  }
+  void EraseFree(int64_t offset, int64_t size) {
+    CHECK_EQ(free_offset2size_.erase(offset), 1);
+    CHECK_EQ(free_size_offset_.erase(std::make_pair(size, offset)), 1);
+  }
+
+  int64_t buffer_size_;
+  std::map<int64_t, int64_t> free_offset2size_;
+  std::set<std::pair<int64_t, int64_t>> free_size_offset_;
+};
+
+template<typename T>
+std::vector<int64_t> OrderByKeyDesc(const std::vector<MemOffsetPlanItem>& items,
+                                    const std::vector<T>& keys) {
+  std::vector<int64_t> order(items.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int64_t lhs, int64_t rhs) {
+    if (keys.at(lhs) != keys.at(rhs)) { return keys.at(lhs) > keys.at(rhs); }
+    if (items.at(lhs).alloc_step != items.at(rhs).alloc_step) {
+      return items.at(lhs).alloc_step < items.at(rhs).alloc_step;
+    }
+    return lhs < rhs;
+  });
+  return order;
+}
+
+}  // namespace
+
+void PlanMemOffsetsByOrder(const std::vector<MemOffsetPlanItem>& items,
+                           const std::vector<int64_t>& order, bool best_fit, MemOffsetPlan* plan) {
+  CHECK_EQ(order.size(), items.size());
+  LifetimeIndex lifetime_index(StepNum(items));
+  plan->offsets.assign(items.size(), -1);
+  int64_t buffer_size = 1;
+  // [begin, end) of the placed items overlapping with the current one
+  std::vector<std::pair<int64_t, int64_t>> occupied;
+  for (int64_t id : order) {
+    const MemOffsetPlanItem& item = items.at(id);
+    CHECK_EQ(plan->offsets.at(id), -1);
+    occupied.clear();
+    lifetime_index.ForEachOverlapping(item, [&](int64_t placed_id) {
+      const int64_t begin = plan->offsets.at(placed_id);
+      occupied.emplace_back(begin, begin + items.at(placed_id).size);
+    });
+    std::sort(occupied.begin(), occupied.end());
+    int64_t offset = -1;
+    int64_t min_gap = std::numeric_limits<int64_t>::max();
+    int64_t cursor = 0;
+    const auto TryGap = [&](int64_t end) -> bool {
+      const int64_t gap = end - cursor;
+      if (gap > 0 && gap >= item.size && gap < min_gap) {
+        offset = cursor;
+        min_gap = gap;
+        return !best_fit;
+      }
+      return false;
+    };
+    bool found = false;
+    for (const auto& interval : occupied) {
+      if (TryGap(interval.first)) {
+        found = true;
+        break;
+      }
+      cursor = std::max(cursor, interval.second);
+    }
+    if (!found && !TryGap(buffer_size) && offset == -1) {
+      // the block grows, over its free end if any
+      offset = cursor;
+      buffer_size = cursor + item.size;
+    }
+    plan->offsets.at(id) = offset;
+    lifetime_index.Insert(id, item);
+  }
+  plan->mem_block_size = buffer_size;
+}
+
+void PlanMemOffsetsByTimeLine(const std::vector<MemOffsetPlanItem>& items, MemOffsetPlan* plan) {
+  const int64_t step_num = StepNum(items);
+  std::vector<std::vector<int64_t>> step2alloc_ids(step_num);
+  std::vector<std::vector<int64_t>> step2free_ids(step_num);
+  for (int64_t id = 0; id < items.size(); ++id) {
+    step2alloc_ids.at(items.at(id).alloc_step).emplace_back(id);
+    step2free_ids.at(items.at(id).free_step).emplace_back(id);
+  }
+  plan->offsets.assign(items.size(), -1);
+  BestFitOffsetAllocator allocator(1);
+  for (int64_t step = 0; step < step_num; ++step) {
+    for (int64_t id : step2alloc_ids.at(step)) {
+      plan->offsets.at(id) = allocator.Allocate(items.at(id).size);
+    }
+    for (int64_t id : step2free_ids.at(step)) {
+      allocator.Free(plan->offsets.at(id), items.at(id).size);
+    }
+  }
+  plan->mem_block_size = allocator.buffer_size();
+}
+
+void PlanMemOffsetsByRandomizedMemSize(const std::vector<MemOffsetPlanItem>& items,
+                                       int64_t trial_num, int64_t seed, MemOffsetPlan* plan) {
+  CHECK_GT(trial_num, 0);
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> noise(1.0, 1.25);
+  std::vector<double> keys(items.size());
+  MemOffsetPlan trial_plan;
+  for (int64_t trial = 0; trial < trial_num; ++trial) {
+    for (int64_t id = 0; id < items.size(); ++id) { keys.at(id) = items.at(id).size * noise(gen); }
+    PlanMemOffsetsByOrder(items, OrderByKeyDesc(items, keys), /*best_fit=*/true, &trial_plan);
+    if (trial == 0 || trial_plan.mem_block_size < plan->mem_block_size) {
+      std::swap(*plan, trial_plan);
+    }
+  }
+}
+
+std::vector<int64_t> MemSizeFirstOrder(const std::vector<MemOffsetPlanItem>& items) {
+  std::vector<int64_t> keys;
+  for (const auto& item : items) { keys.emplace_back(item.size); }
+  return OrderByKeyDesc(items, keys);
+}
+
+std::vector<int64_t> MutualExclusionFirstOrder(const std::vector<MemOffsetPlanItem>& items) {
+  // an item overlaps with the items neither freed before nor allocated after its lifetime
+  std::vector<int64_t> alloc_steps;
+  std::vector<int64_t> free_steps;
+  for (const auto& item : items) {
+    alloc_steps.emplace_back(item.alloc_step);
+    free_steps.emplace_back(item.free_step);
+  }
+  std::sort(alloc_steps.begin(), alloc_steps.end());
+  std::sort(free_steps.begin(), free_steps.end());
+  std::vector<int64_t> keys;
+  for (const auto& item : items) {
+    const int64_t freed_before =
+        std::lower_bound(free_steps.begin(), free_steps.end(), item.alloc_step)
+        - free_steps.begin();
+    const int64_t allocated_after =
+        alloc_steps.end()
+        - std::upper_bound(alloc_steps.begin(), alloc_steps.end(), item.free_step);
+    keys.emplace_back(items.size() - 1 - freed_before - allocated_after);
+  }
+  return OrderByKeyDesc(items, keys);
+}
+
+std::vector<int64_t> MemVolumeFirstOrder(const std::vector<MemOffsetPlanItem>& items) {
+  std::vector<double> keys;
+  for (const auto& item : items) {
+    keys.emplace_back(static_cast<double>(item.size) * (item.free_step - item.alloc_step + 1));
+  }
+  return OrderByKeyDesc(items, keys);
+}
+
+}  // namespace oneflow
@@ -0,0 +1,59 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_MEM_OFFSET_PLANNER_H_
+#define ONEFLOW_CORE_JOB_MEM_OFFSET_PLANNER_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// A buffer of a memory block, allocated before step `alloc_step` and freed after step
+// `free_step` of a mem chain. Two buffers may share memory if their steps don't overlap.
+struct MemOffsetPlanItem {
+  int64_t size;
+  int64_t alloc_step;
+  int64_t free_step;
+};
+
+struct MemOffsetPlan {
+  int64_t mem_block_size = 0;
+  // offsets[i] of items[i]
+  std::vector<int64_t> offsets;
+};
+
+// Places the items one by one in `order`, each in the lowest gap (first fit) or the smallest gap
+// (best fit) left by the items placed before whose lifetime overlaps with its own. The block
+// grows at its end if no gap fits.
+void PlanMemOffsetsByOrder(const std::vector<MemOffsetPlanItem>& items,
+                           const std::vector<int64_t>& order, bool best_fit, MemOffsetPlan* plan);
+// Allocates the items step by step with a best fit allocator, which frees them after their last
+// step. The items of a step are allocated in index order.
+void PlanMemOffsetsByTimeLine(const std::vector<MemOffsetPlanItem>& items, MemOffsetPlan* plan);
+// The best of `trial_num` plans by order of randomly perturbed sizes with best fit.
+void PlanMemOffsetsByRandomizedMemSize(const std::vector<MemOffsetPlanItem>& items,
+                                       int64_t trial_num, int64_t seed, MemOffsetPlan* plan);
+
+// Orders for PlanMemOffsetsByOrder, ties are ordered by alloc step.
+// larger sizes first
+std::vector<int64_t> MemSizeFirstOrder(const std::vector<MemOffsetPlanItem>& items);
+// items overlapping with more items first
+std::vector<int64_t> MutualExclusionFirstOrder(const std::vector<MemOffsetPlanItem>& items);
+// larger sizes times lifetimes first
+std::vector<int64_t> MemVolumeFirstOrder(const std::vector<MemOffsetPlanItem>& items);
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_MEM_OFFSET_PLANNER_H_
@@ -0,0 +1,281 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include <fstream>
+#include <list>
+#include <random>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/job/mem_offset_planner.h"
+
+namespace oneflow {
+
+namespace {
+
+bool IsLifetimeOverlapping(const MemOffsetPlanItem& lhs, const MemOffsetPlanItem& rhs) {
+  return lhs.alloc_step <= rhs.free_step && rhs.alloc_step <= lhs.free_step;
+}
+
+// The first fit planner on a list of pieces before the lifetime index, it is quadratic.
+struct Piece {
+  int64_t begin;
+  int64_t end;
+  bool is_free;
+};
+
+void MergePieces(std::list<Piece>* pieces, bool merge_busy) {
+  for (auto it = std::next(pieces->begin()); it != pieces->end(); ++it) {
+    auto pre_it = std::prev(it);
+    if (it->is_free == pre_it->is_free && (it->is_free || merge_busy)) {
+      it->begin = pre_it->begin;
+      pieces->erase(pre_it);
+    }
+  }
+}
+
+void ListFirstFitPlan(const std::vector<MemOffsetPlanItem>& items,
+                      const std::vector<int64_t>& order, MemOffsetPlan* plan) {
+  plan->offsets.assign(items.size(), -1);
+  int64_t buffer_size = 1;
+  for (int64_t id : order) {
+    std::list<Piece> pieces{Piece{0, buffer_size, true}};
+    for (int64_t placed = 0; placed < items.size(); ++placed) {
+      if (placed == id || plan->offsets.at(placed) == -1) { continue; }
+      if (!IsLifetimeOverlapping(items.at(id), items.at(placed))) { continue; }
+      int64_t begin = plan->offsets.at(placed);
+      int64_t end = begin + items.at(placed).size;
+      for (auto it = pieces.begin(); it != pieces.end(); ++it) {
+        if (it->end <= begin) { continue; }
+        if (end <= it->begin) { break; }
+        if (it->is_free) {
+          if (begin != it->begin) {
+            const Piece free_piece{it->begin, begin, true};
+            it->begin = begin;
+            it = pieces.insert(it, free_piece);
+          } else if (end < it->end) {
+            const Piece busy_piece{it->begin, end, false};
+            it->begin = end;
+            it = pieces.insert(it, busy_piece);
+            begin = end;
+          } else {
+            it->is_free = false;
+            begin = it->end;
+          }
+        } else {
+          begin = it->end;
+          end = std::max(begin, end);
+        }
+      }
+      MergePieces(&pieces, /*merge_busy=*/true);
+    }
+    int64_t offset = -1;
+    for (const auto& piece : pieces) {
+      if (piece.is_free && piece.end - piece.begin >= items.at(id).size) {
+        offset = piece.begin;
+        break;
+      }
+    }
+    if (offset == -1) {
+      const Piece& last = pieces.back();
+      offset = last.is_free ? last.begin : buffer_size;
+      buffer_size = offset + items.at(id).size;
+    }
+    plan->offsets.at(id) = offset;
+  }
+  plan->mem_block_size = buffer_size;
+}
+
+// The best fit allocator on a list of pieces before the free piece indexes.
+void ListTimeLinePlan(const std::vector<MemOffsetPlanItem>& items, MemOffsetPlan* plan) {
+  int64_t step_num = 0;
+  for (const auto& item : items) { step_num = std::max(step_num, item.free_step + 1); }
+  plan->offsets.assign(items.size(), -1);
+  std::list<Piece> pieces{Piece{0, 1, true}};
+  for (int64_t step = 0; step < step_num; ++step) {
+    for (int64_t id = 0; id < items.size(); ++id) {
+      if (items.at(id).alloc_step != step) { continue; }
+      const int64_t size = items.at(id).size;
+      auto candidate = pieces.end();
+      for (auto it = pieces.begin(); it != pieces.end(); ++it) {
+        if (it->is_free && it->end - it->begin >= size
+            && (candidate == pieces.end()
+                || it->end - it->begin < candidate->end - candidate->begin)) {
+          candidate = it;
+        }
+      }
+      if (candidate == pieces.end()) {
+        Piece& last = pieces.back();
+        if (last.is_free) {
+          last.end = last.begin + size;
+          last.is_free = false;
+          plan->offsets.at(id) = last.begin;
+        } else {
+          plan->offsets.at(id) = last.end;
+          pieces.emplace_back(Piece{last.end, last.end + size, false});
+        }
+      } else {
+        plan->offsets.at(id) = candidate->begin;
+        if (candidate->end - candidate->begin > size) {
+          pieces.insert(candidate, Piece{candidate->begin, candidate->begin + size, false});
+          candidate->begin += size;
+        } else {
+          candidate->is_free = false;
+        }
+      }
+    }
+    for (int64_t id = 0; id < items.size(); ++id) {
+      if (items.at(id).free_step != step) { continue; }
+      for (auto& piece : pieces) {
+        if (piece.begin == plan->offsets.at(id) && !piece.is_free) { piece.is_free = true; }
+      }
+      MergePieces(&pieces, /*merge_busy=*/false);
+    }
+  }
+  plan->mem_block_size = pieces.back().end;
+}
+
+// Forward steps allocate activations freed by the mirrored backward steps, every step allocates
+// some temporary buffers as well.
+std::vector<MemOffsetPlanItem> GenTrainingLifetimes(int64_t layer_num, int64_t seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int64_t> size_log2(8, 22);
+  std::uniform_int_distribution<int64_t> temp_num(0, 3);
+  std::uniform_int_distribution<int64_t> temp_life(0, 2);
+  const int64_t step_num = 2 * layer_num;
+  std::vector<MemOffsetPlanItem> items;
+  for (int64_t step = 0; step < step_num; ++step) {
+    if (step < layer_num) {
+      const int64_t size = int64_t(1) << size_log2(gen);
+      items.emplace_back(MemOffsetPlanItem{size, step, step_num - 1 - step});
+    }
+    for (int64_t i = temp_num(gen); i > 0; --i) {
+      items.emplace_back(MemOffsetPlanItem{(int64_t(1) << size_log2(gen)) + size_log2(gen), step,
+                                           std::min(step_num - 1, step + temp_life(gen))});
+    }
+  }
+  return items;
+}
+
+// One item per line: size alloc_step free_step, as dumped by the memory sharing in debug mode.
+std::vector<MemOffsetPlanItem> LoadLifetimes(const std::string& path) {
+  std::vector<MemOffsetPlanItem> items;
+  std::ifstream in(path);
+  MemOffsetPlanItem item;
+  while (in >> item.size >> item.alloc_step >> item.free_step) { items.emplace_back(item); }
+  return items;
+}
+
+void CheckPlan(const std::vector<MemOffsetPlanItem>& items, const MemOffsetPlan& plan) {
+  ASSERT_EQ(plan.offsets.size(), items.size());
+  for (int64_t i = 0; i < items.size(); ++i) {
+    ASSERT_GE(plan.offsets.at(i), 0);
+    ASSERT_LE(plan.offsets.at(i) + items.at(i).size, plan.mem_block_size);
+    for (int64_t j = i + 1; j < items.size(); ++j) {
+      if (!IsLifetimeOverlapping(items.at(i), items.at(j))) { continue; }
+      const bool disjoint = plan.offsets.at(i) + items.at(i).size <= plan.offsets.at(j)
+                            || plan.offsets.at(j) + items.at(j).size <= plan.offsets.at(i);
+      ASSERT_TRUE(disjoint) << "items " << i << " and " << j;
+    }
+  }
+}
+
+template<typename PlanFn>
+double Seconds(const PlanFn& DoPlan) {
+  const auto start = std::chrono::steady_clock::now();
+  DoPlan();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+TEST(MemOffsetPlanner, same_as_list_planners) {
+  for (int64_t seed = 0; seed < 8; ++seed) {
+    const auto items = GenTrainingLifetimes(40, seed);
+    MemOffsetPlan plan;
+    MemOffsetPlan expected;
+    for (const auto& order : {MemSizeFirstOrder(items), MutualExclusionFirstOrder(items)}) {
+      PlanMemOffsetsByOrder(items, order, /*best_fit=*/false, &plan);
+      ListFirstFitPlan(items, order, &expected);
+      ASSERT_EQ(plan.offsets, expected.offsets);
+      ASSERT_EQ(plan.mem_block_size, expected.mem_block_size);
+    }
+    PlanMemOffsetsByTimeLine(items, &plan);
+    ListTimeLinePlan(items, &expected);
+    ASSERT_EQ(plan.offsets, expected.offsets);
+    ASSERT_EQ(plan.mem_block_size, expected.mem_block_size);
+  }
+}
+
+TEST(MemOffsetPlanner, valid_plans) {
+  for (int64_t seed = 0; seed < 8; ++seed) {
+    const auto items = GenTrainingLifetimes(60, seed);
+    MemOffsetPlan plan;
+    for (bool best_fit : {false, true}) {
+      for (const auto& order : {MemSizeFirstOrder(items), MutualExclusionFirstOrder(items),
+                                MemVolumeFirstOrder(items)}) {
+        PlanMemOffsetsByOrder(items, order, best_fit, &plan);
+        CheckPlan(items, plan);
+      }
+    }
+    PlanMemOffsetsByTimeLine(items, &plan);
+    CheckPlan(items, plan);
+    PlanMemOffsetsByRandomizedMemSize(items, 4, seed, &plan);
+    CheckPlan(items, plan);
+  }
+}
+
+TEST(MemOffsetPlanner, mutual_exclusion_first_order) {
+  const std::vector<MemOffsetPlanItem> items{{8, 0, 0}, {8, 0, 3}, {8, 1, 2}, {8, 3, 3}};
+  // overlapping with 1, 3, 1 and 1 other items
+  ASSERT_EQ(MutualExclusionFirstOrder(items), (std::vector<int64_t>{1, 0, 2, 3}));
+}
+
+TEST(MemOffsetPlanner, benchmark) {
+  if (!ParseBooleanFromEnv("ONEFLOW_TEST_BENCHMARK", false)) {
+    GTEST_SKIP() << "set ONEFLOW_TEST_BENCHMARK=1 to run";
+  }
+  // ONEFLOW_MEM_PLANNER_BENCHMARK_LIFETIMES may name a file of lifetimes recorded in debug mode
+  const char* path = getenv("ONEFLOW_MEM_PLANNER_BENCHMARK_LIFETIMES");
+  const auto items = path != nullptr ? LoadLifetimes(path) : GenTrainingLifetimes(400, 0);
+  ASSERT_FALSE(items.empty());
+  MemOffsetPlan plan;
+  auto Report = [&](const std::string& name, double seconds) {
+    CheckPlan(items, plan);
+    RecordProperty(name + "_ms", std::to_string(seconds * 1000));
+    RecordProperty(name + "_mem_block_size", std::to_string(plan.mem_block_size));
+  };
+  const auto size_first_order = MemSizeFirstOrder(items);
+  Report("list_first_fit_by_size",
+         Seconds([&]() { ListFirstFitPlan(items, size_first_order, &plan); }));
+  Report("list_time_line", Seconds([&]() { ListTimeLinePlan(items, &plan); }));
+  Report("first_fit_by_size", Seconds([&]() {
+           PlanMemOffsetsByOrder(items, MemSizeFirstOrder(items), false, &plan);
+         }));
+  Report("first_fit_by_mutual_exclusion", Seconds([&]() {
+           PlanMemOffsetsByOrder(items, MutualExclusionFirstOrder(items), false, &plan);
+         }));
+  Report("time_line", Seconds([&]() { PlanMemOffsetsByTimeLine(items, &plan); }));
+  Report("best_fit_by_size", Seconds([&]() {
+           PlanMemOffsetsByOrder(items, MemSizeFirstOrder(items), true, &plan);
+         }));
+  Report("best_fit_by_volume", Seconds([&]() {
+           PlanMemOffsetsByOrder(items, MemVolumeFirstOrder(items), true, &plan);
+         }));
+  Report("best_of_16_randomized_sizes",
+         Seconds([&]() { PlanMemOffsetsByRandomizedMemSize(items, 16, 0, &plan); }));
+}
+
+}  // namespace oneflow
@@ -0,0 +1,152 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/plan_cache.h"
+#include <unistd.h>
+#include <fstream>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/graph/task_stream_index_manager.h"
+#include "oneflow/core/job/id_manager.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/version.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+namespace {
+
+std::string PlanCacheDir() {
+  static const std::string dir = GetStringFromEnv("ONEFLOW_PLAN_CACHE_DIR", "");
+  return dir;
+}
+
+// Map fields have no defined order unless serialized deterministically.
+std::string SerializeDeterministically(const PbMessage& msg) {
+  std::string bytes;
+  {
+    google::protobuf::io::StringOutputStream string_stream(&bytes);
+    google::protobuf::io::CodedOutputStream coded_stream(&string_stream);
+    coded_stream.SetSerializationDeterministic(true);
+    CHECK(msg.SerializeToCodedStream(&coded_stream));
+  }
+  return bytes;
+}
+
+uint64_t Fnv1aHash(const std::string& bytes) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (const char c : bytes) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+std::string HexString(uint64_t value) {
+  static const char* kDigits = "0123456789abcdef";
+  std::string str(16, '0');
+  for (int i = 15; i >= 0; --i) {
+    str[i] = kDigits[value & 0xf];
+    value >>= 4;
+  }
+  return str;
+}
+
+// Plans of large graphs exceed the default total bytes limit of protobuf parsing.
+bool TryParseEntryFromFile(const std::string& file_path, PlanCacheEntry* entry) {
+  std::ifstream in_stream(file_path, std::ifstream::in | std::ifstream::binary);
+  if (!in_stream.is_open()) { return false; }
+  google::protobuf::io::IstreamInputStream input_stream(&in_stream);
+  google::protobuf::io::CodedInputStream coded_stream(&input_stream);
+  coded_stream.SetTotalBytesLimit(std::numeric_limits<int>::max());
+  return entry->ParseFromCodedStream(&coded_stream);
+}
+
+IdState CurrentIdState() {
+  IdState id_state;
+  Singleton<IDMgr>::Get()->SaveIdState(&id_state);
+  Singleton<TaskStreamIndexManager>::Get()->SaveIdState(&id_state);
+  return id_state;
+}
+
+}  // namespace
+
+PlanCache::PlanCache(const Job& job, int64_t job_id,
+                     const HashSet<std::string>& variable_op_names) {
+  key_.set_oneflow_version(GetOneFlowGitVersion());
+  *key_.mutable_job() = job;
+  key_.set_job_id(job_id);
+  *key_.mutable_resource() = Singleton<ResourceDesc, ForSession>::Get()->resource();
+  key_.set_world_size(GlobalProcessCtx::WorldSize());
+  key_.set_num_process_per_node(GlobalProcessCtx::NumOfProcessPerNode());
+  std::vector<std::string> sorted_variable_op_names(variable_op_names.begin(),
+                                                    variable_op_names.end());
+  std::sort(sorted_variable_op_names.begin(), sorted_variable_op_names.end());
+  for (const auto& name : sorted_variable_op_names) { key_.add_variable_op_name(name); }
+  *key_.mutable_id_state() = CurrentIdState();
+  serialized_key_ = SerializeDeterministically(key_);
+  if (Enabled()) {
+    // NOTE: two independent hashes make accidental collisions negligible, a collision is still
+    // detected when loading since the full key is stored in the entry.
+    const std::string file_name = HexString(std::hash<std::string>()(serialized_key_))
+                                  + HexString(Fnv1aHash(serialized_key_)) + ".plan";
+    file_path_ = JoinPath(PlanCacheDir(), file_name);
+  }
+}
+
+bool PlanCache::Enabled() { return !PlanCacheDir().empty(); }
+
+bool PlanCache::TryLoad(Plan* plan) const {
+  if (!Enabled() || !LocalFS()->FileExists(file_path_)) { return false; }
+  PlanCacheEntry entry;
+  if (!TryParseEntryFromFile(file_path_, &entry)
+      || SerializeDeterministically(entry.key()) != serialized_key_) {
+    LOG(WARNING) << "Plan cache entry " << file_path_ << " is corrupted or stale, removed.";
+    LocalFS()->DelFile(file_path_);
+    return false;
+  }
+  Singleton<IDMgr>::Get()->LoadIdState(entry.id_state());
+  Singleton<TaskStreamIndexManager>::Get()->LoadIdState(entry.id_state());
+  *plan = std::move(*entry.mutable_plan());
+  VLOG(1) << "Plan cache hit: " << file_path_;
+  return true;
+}
+
+void PlanCache::Store(const Plan& plan) const {
+  if (!Enabled()) { return; }
+  PlanCacheEntry entry;
+  *entry.mutable_key() = key_;
+  *entry.mutable_plan() = plan;
+  *entry.mutable_id_state() = CurrentIdState();
+  LocalFS()->RecursivelyCreateDirIfNotExist(PlanCacheDir());
+  // NOTE: write to a temp file and rename, so concurrent readers never see a partial entry.
+  const std::string tmp_path = file_path_ + ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream out_stream(tmp_path, std::ofstream::out | std::ofstream::binary);
+    const std::string bytes = SerializeDeterministically(entry);
+    out_stream.write(bytes.data(), bytes.size());
+    if (!out_stream.good()) {
+      LOG(WARNING) << "Failed to write plan cache entry " << tmp_path;
+      return;
+    }
+  }
+  LocalFS()->RenameFile(tmp_path, file_path_);
+  VLOG(1) << "Plan cache stored: " << file_path_;
+}
+
+}  // namespace oneflow
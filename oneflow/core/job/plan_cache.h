@@ -0,0 +1,50 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_PLAN_CACHE_H_
+#define ONEFLOW_CORE_JOB_PLAN_CACHE_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/job/plan_cache.pb.h"
+
+namespace oneflow {
+
+// On-disk cache of the plan compiled on the master rank, enabled by setting
+// ONEFLOW_PLAN_CACHE_DIR. The key covers the completed job, the resource and process layout,
+// the oneflow version and the id counters before compiling, so a hit yields exactly the plan the
+// compiler would have generated, including its task/regst/mem block ids.
+class PlanCache final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(PlanCache);
+  // Snapshots the id state, so it must be constructed right before compiling.
+  PlanCache(const Job& job, int64_t job_id, const HashSet<std::string>& variable_op_names);
+  ~PlanCache() = default;
+
+  static bool Enabled();
+
+  // On hit, fills plan and advances the id counters as if the plan had been compiled.
+  bool TryLoad(Plan* plan) const;
+  // Must be called right after compiling, before any other id is generated.
+  void Store(const Plan& plan) const;
+
+ private:
+  PlanCacheKey key_;
+  std::string serialized_key_;
+  std::string file_path_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_PLAN_CACHE_H_
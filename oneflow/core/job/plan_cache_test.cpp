@@ -0,0 +1,156 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <stdlib.h>
+#include <fstream>
+#include "gtest/gtest.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/graph/task_stream_index_manager.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/id_manager.h"
+#include "oneflow/core/job/plan_cache.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+namespace {
+
+EnvProto GetEnvProto() {
+  EnvProto ret;
+  auto* machine = ret.add_machine();
+  machine->set_id(0);
+  machine->set_addr("127.0.0.1");
+  ret.set_ctrl_port(9527);
+  return ret;
+}
+
+Resource GetResource() {
+  Resource ret;
+  ret.set_machine_num(1);
+  ret.set_cpu_device_num(1);
+  return ret;
+}
+
+std::string CreateTempDirectory() {
+  const char* tmp_env = getenv("TMPDIR");
+  const char* tmp_dir = tmp_env == nullptr ? "/tmp" : tmp_env;
+  std::string tpl = std::string(tmp_dir) + "/test_plan_cache_XXXXXX";
+  char* path = mkdtemp(const_cast<char*>(tpl.c_str()));
+  PCHECK(path != nullptr);
+  return std::string(path);
+}
+
+void New() {
+  Singleton<EnvDesc>::New(GetEnvProto());
+  Singleton<ProcessCtx>::New();
+  Singleton<ProcessCtx>::Get()->mutable_ctrl_addr()->Add();
+  Singleton<ProcessCtx>::Get()->set_rank(0);
+  Singleton<ProcessCtx>::Get()->set_node_size(1);
+  Singleton<ResourceDesc, ForSession>::New(GetResource(), GlobalProcessCtx::NumOfProcessPerNode());
+  Singleton<IDMgr>::New();
+  Singleton<TaskStreamIndexManager>::New();
+}
+
+void Delete() {
+  Singleton<TaskStreamIndexManager>::Delete();
+  Singleton<IDMgr>::Delete();
+  Singleton<ResourceDesc, ForSession>::Delete();
+  Singleton<ProcessCtx>::Delete();
+  Singleton<EnvDesc>::Delete();
+}
+
+void LoadIdState(const IdState& id_state) {
+  Singleton<IDMgr>::Get()->LoadIdState(id_state);
+  Singleton<TaskStreamIndexManager>::Get()->LoadIdState(id_state);
+}
+
+Job NewJob(const std::string& job_name) {
+  Job job;
+  job.mutable_job_conf()->set_job_name(job_name);
+  return job;
+}
+
+Plan NewPlan(const std::string& job_name) {
+  Plan plan;
+  plan.mutable_block_chunk_list();
+  plan.mutable_collective_boxing_plan();
+  plan.mutable_ctrl_regst_desc_info();
+  (*plan.mutable_job_confs()->mutable_job_id2job_conf())[0].set_job_name(job_name);
+  return plan;
+}
+
+}  // namespace
+
+TEST(PlanCache, store_and_load) {
+  // NOTE: the cache dir is read once, so every test of PlanCache shares it.
+  const std::string cache_dir = CreateTempDirectory();
+  ASSERT_EQ(setenv("ONEFLOW_PLAN_CACHE_DIR", cache_dir.c_str(), 1), 0);
+  ASSERT_TRUE(PlanCache::Enabled());
+  New();
+  IDMgr* id_mgr = Singleton<IDMgr>::Get();
+  const StreamId stream_id(DeviceId(0, DeviceType::kCPU, 0), 0);
+  IdState id_state;
+  id_mgr->SaveIdState(&id_state);
+  Singleton<TaskStreamIndexManager>::Get()->SaveIdState(&id_state);
+
+  // A cold run compiles and stores the plan.
+  Plan plan;
+  int64_t regst_desc_id = -1;
+  TaskId task_id(stream_id, 0);
+  {
+    PlanCache cache(NewJob("job"), 0, {"variable"});
+    ASSERT_FALSE(cache.TryLoad(&plan));
+    id_mgr->NewRegstDescId();
+    id_mgr->GetTaskIdGenerator()->Generate(stream_id);
+    cache.Store(NewPlan("compiled"));
+    regst_desc_id = id_mgr->NewRegstDescId();
+    task_id = id_mgr->GetTaskIdGenerator()->Generate(stream_id);
+  }
+
+  // A warm run loads it and continues with the ids the cold run would have generated.
+  LoadIdState(id_state);
+  {
+    PlanCache cache(NewJob("job"), 0, {"variable"});
+    ASSERT_TRUE(cache.TryLoad(&plan));
+    ASSERT_EQ(plan.job_confs().job_id2job_conf().at(0).job_name(), "compiled");
+    ASSERT_EQ(id_mgr->NewRegstDescId(), regst_desc_id);
+    ASSERT_EQ(id_mgr->GetTaskIdGenerator()->Generate(stream_id), task_id);
+  }
+
+  // Any change of the key misses.
+  LoadIdState(id_state);
+  ASSERT_FALSE(PlanCache(NewJob("other_job"), 0, {"variable"}).TryLoad(&plan));
+  ASSERT_FALSE(PlanCache(NewJob("job"), 1, {"variable"}).TryLoad(&plan));
+  ASSERT_FALSE(PlanCache(NewJob("job"), 0, {"other_variable"}).TryLoad(&plan));
+  id_mgr->NewMemBlockId();
+  ASSERT_FALSE(PlanCache(NewJob("job"), 0, {"variable"}).TryLoad(&plan));
+  LoadIdState(id_state);
+  ASSERT_TRUE(PlanCache(NewJob("job"), 0, {"variable"}).TryLoad(&plan));
+
+  // A corrupted entry misses and is removed.
+  const std::vector<std::string> file_names = LocalFS()->ListDir(cache_dir);
+  ASSERT_EQ(file_names.size(), 1);
+  std::ofstream(JoinPath(cache_dir, file_names.front()), std::ofstream::trunc) << "corrupted";
+  LoadIdState(id_state);
+  ASSERT_FALSE(PlanCache(NewJob("job"), 0, {"variable"}).TryLoad(&plan));
+  ASSERT_TRUE(LocalFS()->ListDir(cache_dir).empty());
+
+  Delete();
+  LocalFS()->RecursivelyDeleteDir(cache_dir);
+}
+
+}  // namespace oneflow
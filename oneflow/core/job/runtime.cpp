@@ -25,6 +25,7 @@ limitations under the License.
 #include "oneflow/core/job/runtime_job_descs.h"
 #include "oneflow/core/job/eager_nccl_comm_manager.h"
 #include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/core/lazy/actor/actor_tracer.h"
 #include "oneflow/core/graph/task_node.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/memory/memory_allocator.h"
@@ -68,6 +69,7 @@ Runtime::Runtime(
     Singleton<RegstMgr>::Get()->AddPlan(plan, variable_op_name2eager_blob_object);
     Singleton<ThreadMgr>::Get()->AddThreads(thread_ids_);
     Singleton<RuntimeJobDescs>::Get()->AddPlan(plan);
+    Singleton<ActorMsgBus>::Get()->AddPlan(plan);
     collective_boxing_scheduler_plan_token_ =
         Singleton<boxing::collective::Scheduler>::Get()->AddPlan(plan);
 #ifdef WITH_CUDA
@@ -114,9 +116,16 @@ Runtime::~Runtime() {
     Singleton<RuntimeCtx>::Get()->WaitUntilCntEqualZero(GetRunningActorCountKeyByJobId(pair.first));
   }
   OF_SESSION_BARRIER();
+  if (ActorTracer::Enabled()) {
+    std::string name = "job";
+    for (const auto& pair : job_id2actor_size_) { name += "_" + std::to_string(pair.first); }
+    ActorTracer::Dump(name);
+  }
   Singleton<ThreadMgr>::Get()->DeleteThreads(independent_thread_ids_);
   Singleton<boxing::collective::Scheduler>::Get()->DeletePlan(
       collective_boxing_scheduler_plan_token_);
+  // After the threads of this runtime are deleted, so that their buffers are released too.
+  if (ActorTracer::Enabled()) { ActorTracer::Reset(); }
 }
 
 void Runtime::DumpThreadIdsFromPlan(const Plan& plan) {
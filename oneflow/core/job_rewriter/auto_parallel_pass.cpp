@@ -0,0 +1,251 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/auto_parallel/sbp_graph.h"
+#include "oneflow/core/common/data_type.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/framework/nd_sbp.h"
+#include "oneflow/core/framework/sbp_infer_util.h"
+#include "oneflow/core/job_rewriter/job_pass.h"
+
+namespace oneflow {
+
+namespace {
+
+// The sbp signatures an op may take, with the one OpGraph inferred for it.
+struct OpCandidates {
+  const OpNode* op_node;
+  // false if the op keeps the inferred signature
+  bool searched;
+  std::vector<NdSbpSignature> signatures;
+  int32_t inferred_index;
+};
+
+bool RequiresSameSbp(const OpNode* consumer, const std::string& ibn) {
+  const auto& modifier = consumer->op().InputBlobModifier4Ibn(ibn);
+  const LogicalBlobId& lbi = consumer->op().BnInOp2Lbi(ibn);
+  return (modifier.has_is_mutable() && modifier.is_mutable())
+         || NotSupportBoxingDataType(consumer->LogicalBlobDesc4Lbi(lbi).data_type());
+}
+
+double Bytes4NdSbp(const NdSbp& nd_sbp, const BlobDesc& blob_desc,
+                   const ParallelDesc& parallel_desc) {
+  Shape shape = blob_desc.shape();
+  return Storage4NdSbp(nd_sbp, shape, *parallel_desc.hierarchy())
+         * GetSizeOfDataType(blob_desc.data_type());
+}
+
+bool SameInputNdSbps(const Operator& op, const NdSbpSignature& lhs, const NdSbpSignature& rhs) {
+  for (const auto& ibn : op.input_bns()) {
+    if (lhs.bn_in_op2nd_sbp().at(ibn) != rhs.bn_in_op2nd_sbp().at(ibn)) { return false; }
+  }
+  return true;
+}
+
+Maybe<void> InitOpCandidates(const OpNode* op_node, bool searched, OpCandidates* candidates) {
+  const Operator& op = op_node->op();
+  const ParallelDesc& parallel_desc = op_node->parallel_desc();
+  candidates->op_node = op_node;
+  candidates->searched = searched;
+  if (searched) {
+    const auto LogicalBlobDesc4Ibn = [&](const std::string& ibn) -> Maybe<const BlobDesc&> {
+      return Maybe<const BlobDesc&>(op_node->LogicalBlobDesc4Lbi(op.BnInOp2Lbi(ibn)));
+    };
+    std::vector<NdSbpSignature> signatures;
+    JUST(op.GetValidNdSbpSignatureList(LogicalBlobDesc4Ibn, parallel_desc, &signatures));
+    for (auto& signature : signatures) {
+      // OpGraph infers an n-d signature from the input nd_sbps of the configured one, among the
+      // signatures with the same inputs it takes the first
+      if (parallel_desc.hierarchy()->NumAxes() > 1
+          && std::any_of(candidates->signatures.begin(), candidates->signatures.end(),
+                         [&](const NdSbpSignature& candidate) {
+                           return SameInputNdSbps(op, candidate, signature);
+                         })) {
+        continue;
+      }
+      candidates->signatures.emplace_back(std::move(signature));
+    }
+  }
+  const NdSbpSignature& inferred = op_node->nd_sbp_signature();
+  const auto it =
+      std::find(candidates->signatures.begin(), candidates->signatures.end(), inferred);
+  candidates->inferred_index = it - candidates->signatures.begin();
+  if (it == candidates->signatures.end()) { candidates->signatures.emplace_back(inferred); }
+  return Maybe<void>::Ok();
+}
+
+std::vector<double> NodeCosts(const OpCandidates& candidates, double computation_cost_ratio,
+                              double memory_weight) {
+  const OpNode* op_node = candidates.op_node;
+  const Operator& op = op_node->op();
+  std::vector<double> costs;
+  for (const auto& signature : candidates.signatures) {
+    double cost = 0;
+    for (const auto& ibn : op.input_bns()) {
+      cost += computation_cost_ratio
+              * Bytes4NdSbp(signature.bn_in_op2nd_sbp().at(ibn),
+                            op_node->LogicalBlobDesc4Lbi(op.BnInOp2Lbi(ibn)),
+                            op_node->parallel_desc());
+    }
+    for (const auto& obn : op.output_bns()) {
+      cost += memory_weight
+              * Bytes4NdSbp(signature.bn_in_op2nd_sbp().at(obn),
+                            op_node->LogicalBlobDesc4Lbi(op.BnInOp2Lbi(obn)),
+                            op_node->parallel_desc());
+    }
+    costs.emplace_back(cost);
+  }
+  return costs;
+}
+
+// The distinct nd_sbps of `bn` among the candidates, and the index of the nd_sbp of each
+// candidate, many candidates share the nd_sbp of a blob.
+void DistinctNdSbps4Bn(const OpCandidates& candidates, const std::string& bn,
+                       std::vector<NdSbp>* nd_sbps, std::vector<int32_t>* indices) {
+  for (const auto& signature : candidates.signatures) {
+    const NdSbp& nd_sbp = signature.bn_in_op2nd_sbp().at(bn);
+    const auto it = std::find(nd_sbps->begin(), nd_sbps->end(), nd_sbp);
+    indices->emplace_back(it - nd_sbps->begin());
+    if (it == nd_sbps->end()) { nd_sbps->emplace_back(nd_sbp); }
+  }
+}
+
+// Boxing cost of the blob consumed by `ibn` of the consumer, for each candidate of the producer
+// and of the consumer.
+Maybe<std::vector<double>> BoxingCosts(const OpCandidates& producer,
+                                       const OpCandidates& consumer, const std::string& ibn) {
+  const Operator& consumer_op = consumer.op_node->op();
+  const LogicalBlobId& lbi = consumer_op.BnInOp2Lbi(ibn);
+  const std::string& obn = *JUST(producer.op_node->op().obn4lbi(lbi));
+  const BlobDesc& blob_desc = consumer.op_node->LogicalBlobDesc4Lbi(lbi);
+  const auto producer_parallel_desc = JUST(producer.op_node->op().GetParallelDesc4BnInOp(obn));
+  const auto consumer_parallel_desc = JUST(consumer_op.GetParallelDesc4BnInOp(ibn));
+  const bool requires_same_sbp = RequiresSameSbp(consumer.op_node, ibn);
+  std::vector<NdSbp> producer_nd_sbps;
+  std::vector<int32_t> producer_indices;
+  DistinctNdSbps4Bn(producer, obn, &producer_nd_sbps, &producer_indices);
+  std::vector<NdSbp> consumer_nd_sbps;
+  std::vector<int32_t> consumer_indices;
+  DistinctNdSbps4Bn(consumer, ibn, &consumer_nd_sbps, &consumer_indices);
+  std::vector<double> distinct_costs;
+  for (const auto& producer_nd_sbp : producer_nd_sbps) {
+    for (const auto& consumer_nd_sbp : consumer_nd_sbps) {
+      distinct_costs.emplace_back(JUST(ComputeCopyCostWithMiddleNodes(
+          producer_nd_sbp, consumer_nd_sbp, blob_desc, *producer_parallel_desc,
+          *consumer_parallel_desc, requires_same_sbp)));
+    }
+  }
+  std::vector<double> costs;
+  for (int32_t producer_index : producer_indices) {
+    for (int32_t consumer_index : consumer_indices) {
+      costs.emplace_back(
+          distinct_costs.at(producer_index * consumer_nd_sbps.size() + consumer_index));
+    }
+  }
+  return costs;
+}
+
+class AutoParallelPass final : public JobPass {
+ public:
+  AutoParallelPass() = default;
+  ~AutoParallelPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_auto_parallel();
+  }
+  Maybe<void> Apply(const OpGraph& op_graph, const JobConfigProto& job_conf,
+                    JobBuilder* job_builder) const;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(op_graph, ctx->job_desc().job_conf(), &job_builder);
+  }
+};
+
+Maybe<void> AutoParallelPass::Apply(const OpGraph& op_graph, const JobConfigProto& job_conf,
+                                    JobBuilder* job_builder) const {
+  const auto& job_parallel_view_conf = job_builder->job().job_parallel_view_conf();
+  // the signatures configured before the pass are constraints, e.g. sbp hints
+  const auto IsSearched = [&](const OpNode* op_node) -> bool {
+    const std::string& op_name = op_node->op().op_name();
+    if (op_node->parallel_desc().parallel_num() == 1) { return false; }
+    if (op_node->parallel_desc().hierarchy()->NumAxes() > 2) { return false; }
+    if (job_parallel_view_conf.op_name2nd_sbp_signature_conf().count(op_name) > 0) {
+      return false;
+    }
+    const auto& op_name2is_local = job_parallel_view_conf.op_name2is_local_parallel_view();
+    const auto it = op_name2is_local.find(op_name);
+    return it == op_name2is_local.end() || !it->second;
+  };
+  std::vector<OpCandidates> op_candidates;
+  HashMap<const OpNode*, int32_t> op_node2id;
+  SbpGraph sbp_graph;
+  JUST(op_graph.TopoForEachNodeWithErrorCaptured([&](const OpNode* op_node) -> Maybe<void> {
+    OpCandidates candidates;
+    JUST(InitOpCandidates(op_node, IsSearched(op_node), &candidates));
+    const int32_t id = sbp_graph.AddNode(NodeCosts(
+        candidates, job_conf.auto_parallel_computation_cost_ratio(),
+        job_conf.auto_parallel_memory_weight()));
+    op_node2id.emplace(op_node, id);
+    op_candidates.emplace_back(std::move(candidates));
+    for (const auto& ibn : op_node->op().input_bns()) {
+      const int32_t producer_id = op_node2id.at(&op_node->SrcNode4Ibn(ibn));
+      const auto& costs =
+          JUST(BoxingCosts(op_candidates.at(producer_id), op_candidates.at(id), ibn));
+      sbp_graph.AddEdgeCost(producer_id, id, *costs);
+    }
+    return Maybe<void>::Ok();
+  }));
+
+  std::vector<int32_t> inferred_choices;
+  for (const auto& candidates : op_candidates) {
+    inferred_choices.emplace_back(candidates.inferred_index);
+  }
+  std::vector<int32_t> choices;
+  SbpGraphSearchStats stats;
+  sbp_graph.Search(inferred_choices, &choices, &stats);
+  const double inferred_cost = sbp_graph.Cost(inferred_choices);
+  const double cost = sbp_graph.Cost(choices);
+  if (cost >= inferred_cost) { choices = inferred_choices; }
+  int32_t changed_num = 0;
+  for (int32_t id = 0; id < op_candidates.size(); ++id) {
+    const OpCandidates& candidates = op_candidates.at(id);
+    if (!candidates.searched) { continue; }
+    // every searched op is configured, otherwise OpGraph would infer it again from the inputs
+    const NdSbpSignature& signature = candidates.signatures.at(choices.at(id));
+    job_builder->AddNdSbpSignature4OpName(candidates.op_node->op().op_name(), signature);
+    if (choices.at(id) != inferred_choices.at(id)) {
+      changed_num += 1;
+      VLOG(2) << "auto parallel changes the sbp signature of "
+              << candidates.op_node->op().op_name() << " to " << signature.DebugString();
+    }
+  }
+  LOG(INFO) << "auto parallel of job " << job_conf.job_name() << " searched "
+            << op_candidates.size() << " ops, eliminated " << stats.leaf_elimination_num
+            << " leaves and " << stats.series_elimination_num << " series nodes, "
+            << (stats.exhaustive ? "enumerated " : "improved ") << stats.remaining_node_num
+            << " remaining ops and changed " << changed_num
+            << " sbp signatures, predicted cost: " << inferred_cost << " -> "
+            << std::min(cost, inferred_cost);
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("AutoParallelPass", AutoParallelPass);
+
+}  // namespace oneflow
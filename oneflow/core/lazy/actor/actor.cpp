@@ -132,6 +132,7 @@ void Actor::Init(const JobDesc* job_desc, ActorContext* actor_ctx) {
   actor_id_ = task_proto.task_id();
   thrd_id_ = ThrdId4ActorId(actor_id_);
   job_id_ = task_proto.job_id();
+  if (ActorTracer::Enabled()) { trace_state_.reset(new ActorTraceState(actor_id_)); }
   for (const ExecNodeProto& node : task_proto.exec_sequence().exec_node()) {
     ExecKernel ek;
     ek.kernel_ctx.reset(new KernelContextImpl(actor_ctx));
@@ -421,6 +422,7 @@ int Actor::HandlerZombie(const ActorMsg& msg) {
 
 void Actor::ActUntilFail() {
   while (IsReadReady() && IsWriteReady()) {
+    if (OF_PREDICT_FALSE(trace_state_ != nullptr)) { trace_state_->OnActBegin(); }
     Act();
 
     AsyncSendCustomizedProducedRegstMsgToConsumer();
@@ -432,7 +434,9 @@ void Actor::ActUntilFail() {
     AsyncRetInplaceConsumedRegstIfNoConsumer();
 
     AsyncSendQueuedMsg();
+    if (OF_PREDICT_FALSE(trace_state_ != nullptr)) { trace_state_->OnActEnd(); }
   }
+  if (OF_PREDICT_FALSE(trace_state_ != nullptr)) { trace_state_->OnBlocked(IsReadReady()); }
   // NOTE(liujuncheng): return inplace consumed
   AsyncSendQueuedMsg();
 }
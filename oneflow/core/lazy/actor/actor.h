@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/core/lazy/actor/actor_base.h"
 #include "oneflow/core/lazy/actor/actor_message_bus.h"
+#include "oneflow/core/lazy/actor/actor_tracer.h"
 #include "oneflow/core/job/task.pb.h"
 #include "oneflow/core/kernel/kernel.h"
 #include "oneflow/core/kernel/kernel_context.h"
@@ -35,7 +36,10 @@ class Actor : public ActorBase {
 
   // 1: success, and actor finish
   // 0: success, and actor not finish
-  int ProcessMsg(const ActorMsg& msg) override { return (this->*msg_handler_)(msg); }
+  int ProcessMsg(const ActorMsg& msg) override {
+    if (OF_PREDICT_FALSE(trace_state_ != nullptr)) { trace_state_->OnMsg(msg.src_actor_id()); }
+    return (this->*msg_handler_)(msg);
+  }
 
   int64_t machine_id() const { return MachineId4ActorId(actor_id_); }
   int64_t actor_id() const { return actor_id_; }
@@ -197,6 +201,7 @@ class Actor : public ActorBase {
   HashMap<int64_t, std::vector<std::unique_ptr<Regst>>> produced_regsts_;
   HashMap<Regst*, int64_t> produced_regst2reading_cnt_;
   int64_t total_reading_cnt_;
+  std::unique_ptr<ActorTraceState> trace_state_;
 
   RegstSlot naive_produced_rs_;
   RegstSlot naive_consumed_rs_;
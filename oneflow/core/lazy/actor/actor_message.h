@@ -60,6 +60,9 @@ class ActorMsg final {
   bool IsDataRegstMsgToConsumer() const;
   int64_t comm_net_sequence_number() const;
   void set_comm_net_sequence_number(int64_t sequence_number);
+  // Only stamped by the dst thread when actor tracing is enabled, 0 otherwise.
+  int64_t enqueue_time_ns() const { return enqueue_time_ns_; }
+  void set_enqueue_time_ns(int64_t enqueue_time_ns) { enqueue_time_ns_ = enqueue_time_ns; }
 
   // Serialize
   template<typename StreamT>
@@ -91,6 +94,7 @@ class ActorMsg final {
   };
   uint8_t user_data_size_;
   unsigned char user_data_[kActorMsgUserDataMaxSize];
+  int64_t enqueue_time_ns_;
 };
 
 template<typename StreamT>
@@ -21,24 +21,76 @@ limitations under the License.
 
 namespace oneflow {
 
+ActorMsgBus::ActorMsgBus()
+    : regst_desc_id2counter_chunk_(new std::atomic<CounterChunk*>[kMaxCounterChunkNum]) {
+  for (int64_t i = 0; i < kMaxCounterChunkNum; ++i) { regst_desc_id2counter_chunk_[i] = nullptr; }
+}
+
+void ActorMsgBus::AddPlan(const Plan& plan) {
+  std::unique_lock<std::mutex> lock(add_plan_mutex_);
+  const int64_t this_rank = GlobalProcessCtx::Rank();
+  for (const TaskProto& task : plan.task()) {
+    if (task.machine_id() != this_rank) { continue; }
+    for (const auto& pair : task.produced_regst_desc()) {
+      const RegstDescProto& regst_desc = pair.second;
+      std::vector<int64_t> dst_actor_ids;
+      for (int64_t consumer : regst_desc.consumer_task_id()) {
+        if (MachineId4ActorId(consumer) != this_rank) { dst_actor_ids.emplace_back(consumer); }
+      }
+      if (dst_actor_ids.empty()) { continue; }
+      const int64_t chunk_id = regst_desc.regst_desc_id() / kCounterChunkSize;
+      if (chunk_id >= kMaxCounterChunkNum) { continue; }
+      CounterChunk* chunk = regst_desc_id2counter_chunk_[chunk_id].load(std::memory_order_acquire);
+      if (chunk == nullptr) {
+        counter_chunks_.emplace_back(new CounterChunk());
+        chunk = counter_chunks_.back().get();
+        regst_desc_id2counter_chunk_[chunk_id].store(chunk, std::memory_order_release);
+      }
+      auto& counters = chunk->at(regst_desc.regst_desc_id() % kCounterChunkSize);
+      if (counters) { continue; }
+      counters.reset(new RemoteConsumerSequenceCounters());
+      counters->sequence_numbers.reset(new std::atomic<int64_t>[dst_actor_ids.size()]);
+      for (size_t i = 0; i < dst_actor_ids.size(); ++i) { counters->sequence_numbers[i] = 0; }
+      counters->dst_actor_ids = std::move(dst_actor_ids);
+    }
+  }
+}
+
+int64_t ActorMsgBus::NextCommNetSequenceNumber(int64_t regst_desc_id, int64_t dst_actor_id) {
+  const int64_t chunk_id = regst_desc_id / kCounterChunkSize;
+  if (chunk_id < kMaxCounterChunkNum) {
+    const CounterChunk* chunk =
+        regst_desc_id2counter_chunk_[chunk_id].load(std::memory_order_acquire);
+    if (chunk != nullptr) {
+      const auto& counters = (*chunk)[regst_desc_id % kCounterChunkSize];
+      if (counters) {
+        const std::vector<int64_t>& dst_actor_ids = counters->dst_actor_ids;
+        for (size_t i = 0; i < dst_actor_ids.size(); ++i) {
+          if (dst_actor_ids[i] == dst_actor_id) {
+            return counters->sequence_numbers[i].fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+      }
+    }
+  }
+  std::unique_lock<std::mutex> lock(regst_desc_id_dst_actor_id2comm_net_sequence_number_mutex_);
+  int64_t& comm_net_sequence_ref =
+      regst_desc_id_dst_actor_id2comm_net_sequence_number_[std::make_pair(regst_desc_id,
+                                                                          dst_actor_id)];
+  const int64_t comm_net_sequence = comm_net_sequence_ref;
+  comm_net_sequence_ref += 1;
+  return comm_net_sequence;
+}
+
 void ActorMsgBus::SendMsg(const ActorMsg& msg) {
   int64_t dst_machine_id = MachineId4ActorId(msg.dst_actor_id());
   if (dst_machine_id == GlobalProcessCtx::Rank()) {
     SendMsgWithoutCommNet(msg);
   } else {
     if (msg.IsDataRegstMsgToConsumer()) {
-      int64_t comm_net_sequence;
-      {
-        std::unique_lock<std::mutex> lock(
-            regst_desc_id_dst_actor_id2comm_net_sequence_number_mutex_);
-        int64_t& comm_net_sequence_ref =
-            regst_desc_id_dst_actor_id2comm_net_sequence_number_[std::make_pair(
-                msg.regst_desc_id(), msg.dst_actor_id())];
-        comm_net_sequence = comm_net_sequence_ref;
-        comm_net_sequence_ref += 1;
-      }
       ActorMsg new_msg = msg;
-      new_msg.set_comm_net_sequence_number(comm_net_sequence);
+      new_msg.set_comm_net_sequence_number(
+          NextCommNetSequenceNumber(msg.regst_desc_id(), msg.dst_actor_id()));
       Singleton<CommNet>::Get()->SendActorMsg(dst_machine_id, new_msg);
     } else {
       Singleton<CommNet>::Get()->SendActorMsg(dst_machine_id, msg);
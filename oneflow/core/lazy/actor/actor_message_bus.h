@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/core/lazy/actor/actor_message.h"
 #include "oneflow/core/common/util.h"
+#include "oneflow/core/job/plan.pb.h"
 
 namespace oneflow {
 
@@ -26,12 +27,33 @@ class ActorMsgBus final {
   OF_DISALLOW_COPY_AND_MOVE(ActorMsgBus);
   ~ActorMsgBus() = default;
 
+  // Preallocates comm net sequence counters for every (regst_desc_id, remote consumer) pair
+  // produced on this machine, so that SendMsg never takes a lock for them.
+  void AddPlan(const Plan& plan);
   void SendMsg(const ActorMsg& msg);
   void SendMsgWithoutCommNet(const ActorMsg& msg);
 
  private:
   friend class Singleton<ActorMsgBus>;
-  ActorMsgBus() = default;
+  ActorMsgBus();
+
+  struct RemoteConsumerSequenceCounters {
+    std::vector<int64_t> dst_actor_ids;
+    std::unique_ptr<std::atomic<int64_t>[]> sequence_numbers;
+  };
+  static constexpr int64_t kCounterChunkSize = int64_t{1} << 12;
+  static constexpr int64_t kMaxCounterChunkNum = int64_t{1} << 12;
+  using CounterChunk =
+      std::array<std::unique_ptr<RemoteConsumerSequenceCounters>, kCounterChunkSize>;
+
+  int64_t NextCommNetSequenceNumber(int64_t regst_desc_id, int64_t dst_actor_id);
+
+  // NOTE: indexed by regst_desc_id / kCounterChunkSize. Regst desc ids are allocated densely, and
+  // chunks are only created in AddPlan, before any actor of the plan can send a message.
+  std::unique_ptr<std::atomic<CounterChunk*>[]> regst_desc_id2counter_chunk_;
+  std::vector<std::unique_ptr<CounterChunk>> counter_chunks_;
+  std::mutex add_plan_mutex_;
+  // Slow path for pairs not known from any plan.
   HashMap<std::pair<int64_t, int64_t>, int64_t>
       regst_desc_id_dst_actor_id2comm_net_sequence_number_;
   std::mutex regst_desc_id_dst_actor_id2comm_net_sequence_number_mutex_;
@@ -0,0 +1,289 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/lazy/actor/actor_tracer.h"
+#include "nlohmann/json.hpp"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/persistence/tee_persistent_log_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+using json = nlohmann::json;
+
+class ActorTraceBuffer final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ActorTraceBuffer);
+  ActorTraceBuffer(int64_t tid, size_t capacity) : tid_(tid), cursor_(0) {
+    events_.resize(std::max<size_t>(capacity, 1));
+  }
+  ~ActorTraceBuffer() = default;
+
+  int64_t tid() const { return tid_; }
+  const std::string& name() const { return name_; }
+  void set_name(const std::string& name) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    name_ = name;
+  }
+
+  void Record(const ActorTraceEvent& event) {
+    // NOTE: only the owner thread writes, the mutex is uncontended unless events are collected.
+    std::unique_lock<std::mutex> lock(mutex_);
+    events_[cursor_ % events_.size()] = event;
+    cursor_ += 1;
+  }
+
+  void Clear() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cursor_ = 0;
+  }
+
+  void CopyTo(std::vector<std::pair<int64_t, ActorTraceEvent>>* events) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const size_t size = std::min(cursor_, events_.size());
+    for (size_t i = cursor_ - size; i < cursor_; ++i) {
+      events->emplace_back(tid_, events_[i % events_.size()]);
+    }
+  }
+
+ private:
+  int64_t tid_;
+  std::string name_;
+  std::vector<ActorTraceEvent> events_;
+  size_t cursor_;
+  std::mutex mutex_;
+};
+
+class ActorTraceRegistry final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ActorTraceRegistry);
+  ActorTraceRegistry() : next_tid_(0) {}
+  ~ActorTraceRegistry() = default;
+
+  static ActorTraceRegistry* Get() {
+    static ActorTraceRegistry registry;
+    return &registry;
+  }
+
+  std::shared_ptr<ActorTraceBuffer> NewBuffer() {
+    static const int64_t capacity = EnvInteger<ONEFLOW_ACTOR_TRACE_BUFFER_SIZE>();
+    std::unique_lock<std::mutex> lock(mutex_);
+    buffers_.emplace_back(std::make_shared<ActorTraceBuffer>(next_tid_++, capacity));
+    return buffers_.back();
+  }
+
+  void SetActorName(int64_t actor_id, const std::string& name) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    actor_id2name_[actor_id] = name;
+  }
+
+  std::string ActorName(int64_t actor_id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto it = actor_id2name_.find(actor_id);
+    if (it == actor_id2name_.end()) { return std::to_string(actor_id); }
+    return it->second;
+  }
+
+  void ForEachBuffer(const std::function<void(ActorTraceBuffer*)>& Handler) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (const auto& buffer : buffers_) { Handler(buffer.get()); }
+  }
+
+  // Drops the buffers of exited threads and the events and actor names of the others.
+  void Reset() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                  [](const std::shared_ptr<ActorTraceBuffer>& buffer) {
+                                    return buffer.use_count() == 1;
+                                  }),
+                   buffers_.end());
+    for (const auto& buffer : buffers_) { buffer->Clear(); }
+    actor_id2name_.clear();
+  }
+
+ private:
+  // A buffer is shared with the thread_local of its thread, so that the events of a thread are
+  // kept after the thread exits.
+  std::vector<std::shared_ptr<ActorTraceBuffer>> buffers_;
+  int64_t next_tid_;
+  HashMap<int64_t, std::string> actor_id2name_;
+  std::mutex mutex_;
+};
+
+ActorTraceBuffer* ThisThreadBuffer() {
+  thread_local std::shared_ptr<ActorTraceBuffer> buffer = ActorTraceRegistry::Get()->NewBuffer();
+  return buffer.get();
+}
+
+const char* EventTypeName(ActorTraceEventType type) {
+  switch (type) {
+    case ActorTraceEventType::kWaitReadable: return "wait_readable";
+    case ActorTraceEventType::kWaitWriteable: return "wait_writeable";
+    case ActorTraceEventType::kAct: return "act";
+    case ActorTraceEventType::kQueueDelay: return "queue_delay";
+    case ActorTraceEventType::kStreamSync: return "stream_sync";
+    default: UNIMPLEMENTED();
+  }
+  return "";
+}
+
+std::vector<std::pair<int64_t, ActorTraceEvent>> CollectEventsWithTid() {
+  std::vector<std::pair<int64_t, ActorTraceEvent>> events;
+  ActorTraceRegistry::Get()->ForEachBuffer(
+      [&](ActorTraceBuffer* buffer) { buffer->CopyTo(&events); });
+  return events;
+}
+
+std::string CriticalPathSummary(const std::vector<ActorCriticalPath>& paths) {
+  std::ostringstream ss;
+  HashMap<int64_t, std::pair<int64_t, int64_t>> actor_id2cnt_and_act_ns;
+  for (const auto& path : paths) {
+    ss << "iteration " << path.act_id << ": " << (path.end_ns - path.begin_ns) / 1000
+       << " us, " << path.nodes.size() << " actors on critical path\n";
+    for (const auto& node : path.nodes) {
+      ss << "  " << ActorTraceRegistry::Get()->ActorName(node.actor_id)
+         << " act: " << node.act_ns / 1000 << " us, wait: " << node.gap_ns / 1000 << " us\n";
+      auto& cnt_and_act_ns = actor_id2cnt_and_act_ns[node.actor_id];
+      cnt_and_act_ns.first += 1;
+      cnt_and_act_ns.second += node.act_ns;
+    }
+  }
+  std::vector<std::pair<int64_t, std::pair<int64_t, int64_t>>> sorted(
+      actor_id2cnt_and_act_ns.begin(), actor_id2cnt_and_act_ns.end());
+  std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.second.second > rhs.second.second;
+  });
+  ss << "actors by total act time on critical path:\n";
+  for (const auto& pair : sorted) {
+    ss << "  " << ActorTraceRegistry::Get()->ActorName(pair.first)
+       << " count: " << pair.second.first << ", act: " << pair.second.second / 1000 << " us\n";
+  }
+  return ss.str();
+}
+
+}  // namespace
+
+void ActorTracer::Record(const ActorTraceEvent& event) { ThisThreadBuffer()->Record(event); }
+
+void ActorTracer::SetThisThreadName(const std::string& name) { ThisThreadBuffer()->set_name(name); }
+
+void ActorTracer::SetActorName(int64_t actor_id, const std::string& name) {
+  ActorTraceRegistry::Get()->SetActorName(actor_id, name);
+}
+
+void ActorTracer::Reset() { ActorTraceRegistry::Get()->Reset(); }
+
+std::vector<ActorTraceEvent> ActorTracer::CollectEvents() {
+  std::vector<ActorTraceEvent> events;
+  for (const auto& pair : CollectEventsWithTid()) { events.emplace_back(pair.second); }
+  return events;
+}
+
+std::vector<ActorCriticalPath> ActorTracer::ComputeCriticalPaths(
+    const std::vector<ActorTraceEvent>& events) {
+  HashMap<int64_t, std::vector<const ActorTraceEvent*>> actor_id2acts;
+  std::map<int64_t, const ActorTraceEvent*> act_id2last_act;
+  for (const auto& event : events) {
+    if (event.type != ActorTraceEventType::kAct) { continue; }
+    actor_id2acts[event.actor_id].emplace_back(&event);
+    auto it = act_id2last_act.find(event.act_id);
+    if (it == act_id2last_act.end() || it->second->end_ns < event.end_ns) {
+      act_id2last_act[event.act_id] = &event;
+    }
+  }
+  for (auto& pair : actor_id2acts) {
+    std::sort(pair.second.begin(), pair.second.end(),
+              [](const ActorTraceEvent* lhs, const ActorTraceEvent* rhs) {
+                return lhs->end_ns < rhs->end_ns;
+              });
+  }
+  // Latest act of actor_id which finished no later than time_ns.
+  auto FindPrevAct = [&](int64_t actor_id, int64_t time_ns) -> const ActorTraceEvent* {
+    const auto it = actor_id2acts.find(actor_id);
+    if (it == actor_id2acts.end()) { return nullptr; }
+    const auto& acts = it->second;
+    auto act_it = std::upper_bound(
+        acts.begin(), acts.end(), time_ns,
+        [](int64_t t, const ActorTraceEvent* event) { return t < event->end_ns; });
+    if (act_it == acts.begin()) { return nullptr; }
+    return *(act_it - 1);
+  };
+  std::vector<ActorCriticalPath> paths;
+  for (const auto& pair : act_id2last_act) {
+    ActorCriticalPath path;
+    path.act_id = pair.first;
+    path.end_ns = pair.second->end_ns;
+    const ActorTraceEvent* cur = pair.second;
+    // NOTE: bounded by the number of actors, a path never visits an actor twice in one iteration.
+    HashSet<int64_t> visited;
+    while (cur != nullptr && visited.insert(cur->actor_id).second) {
+      const ActorTraceEvent* prev = nullptr;
+      if (cur->critical_src_actor_id != -1) {
+        prev = FindPrevAct(cur->critical_src_actor_id, cur->begin_ns);
+      }
+      const int64_t gap_ns = prev == nullptr ? 0 : cur->begin_ns - prev->end_ns;
+      path.nodes.emplace_back(
+          ActorCriticalPathNode{cur->actor_id, cur->end_ns - cur->begin_ns, gap_ns});
+      path.begin_ns = cur->begin_ns;
+      cur = prev;
+    }
+    std::reverse(path.nodes.begin(), path.nodes.end());
+    paths.emplace_back(std::move(path));
+  }
+  return paths;
+}
+
+void ActorTracer::Dump(const std::string& name) {
+  const auto events_with_tid = CollectEventsWithTid();
+  const int64_t rank = GlobalProcessCtx::Rank();
+  json trace_events = json::array();
+  ActorTraceRegistry::Get()->ForEachBuffer([&](ActorTraceBuffer* buffer) {
+    if (buffer->name().empty()) { return; }
+    trace_events.push_back({{"name", "thread_name"},
+                            {"ph", "M"},
+                            {"pid", rank},
+                            {"tid", buffer->tid()},
+                            {"args", {{"name", buffer->name()}}}});
+  });
+  std::vector<ActorTraceEvent> events;
+  events.reserve(events_with_tid.size());
+  for (const auto& pair : events_with_tid) {
+    const ActorTraceEvent& event = pair.second;
+    events.emplace_back(event);
+    const std::string actor_name = event.actor_id == -1
+                                       ? std::string()
+                                       : ActorTraceRegistry::Get()->ActorName(event.actor_id);
+    trace_events.push_back({{"name", EventTypeName(event.type)},
+                            {"cat", actor_name},
+                            {"ph", "X"},
+                            {"pid", rank},
+                            {"tid", pair.first},
+                            {"ts", event.begin_ns / 1000.0},
+                            {"dur", (event.end_ns - event.begin_ns) / 1000.0},
+                            {"args",
+                             {{"actor_id", event.actor_id},
+                              {"act_id", event.act_id},
+                              {"critical_src_actor_id", event.critical_src_actor_id}}}});
+  }
+  const json trace = {{"traceEvents", trace_events}, {"displayTimeUnit", "ns"}};
+  const std::string prefix = JoinPath("actor_trace", name + "_rank_" + std::to_string(rank));
+  TeePersistentLogStream::Create(prefix + ".json")->Write(trace.dump());
+  TeePersistentLogStream::Create(prefix + "_critical_path.txt")
+      ->Write(CriticalPathSummary(ComputeCriticalPaths(events)));
+}
+
+}  // namespace oneflow
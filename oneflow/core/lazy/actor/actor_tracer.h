@@ -0,0 +1,141 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_LAZY_ACTOR_ACTOR_TRACER_H_
+#define ONEFLOW_CORE_LAZY_ACTOR_ACTOR_TRACER_H_
+
+#include <chrono>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/env_var/env_var.h"
+
+namespace oneflow {
+
+DEFINE_ENV_BOOL(ONEFLOW_ACTOR_ENABLE_TRACE, false);
+// Max number of events kept per thread, older events are overwritten.
+DEFINE_ENV_INTEGER(ONEFLOW_ACTOR_TRACE_BUFFER_SIZE, 1 << 16);
+
+enum class ActorTraceEventType : int8_t {
+  kWaitReadable = 0,
+  kWaitWriteable,
+  kAct,
+  kQueueDelay,
+  kStreamSync,
+};
+
+struct ActorTraceEvent {
+  int64_t actor_id;
+  // Number of acts the actor has finished before this event, used as the iteration index.
+  int64_t act_id;
+  // For kAct: the src actor of the last message before the actor became ready, or -1.
+  int64_t critical_src_actor_id;
+  int64_t begin_ns;
+  int64_t end_ns;
+  ActorTraceEventType type;
+};
+
+struct ActorCriticalPathNode {
+  int64_t actor_id;
+  int64_t act_ns;
+  // Time between the end of the previous node on the path and the beginning of this act.
+  int64_t gap_ns;
+};
+
+struct ActorCriticalPath {
+  int64_t act_id;
+  int64_t begin_ns;
+  int64_t end_ns;
+  std::vector<ActorCriticalPathNode> nodes;
+};
+
+class ActorTracer final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ActorTracer);
+  ActorTracer() = delete;
+
+  static bool Enabled() {
+    static const bool enabled = EnvBool<ONEFLOW_ACTOR_ENABLE_TRACE>();
+    return enabled;
+  }
+  static int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // Appends to the ring buffer of the calling thread.
+  static void Record(const ActorTraceEvent& event);
+  static void SetThisThreadName(const std::string& name);
+  static void SetActorName(int64_t actor_id, const std::string& name);
+
+  static std::vector<ActorTraceEvent> CollectEvents();
+  // Walks back from the last finished act of every iteration, following the message that made
+  // each act ready.
+  static std::vector<ActorCriticalPath> ComputeCriticalPaths(
+      const std::vector<ActorTraceEvent>& events);
+  // Writes a Chrome/Perfetto trace and a critical path summary under the log dir.
+  static void Dump(const std::string& name);
+  // Forgets the events and actor names recorded so far, e.g. when a Runtime is destroyed.
+  static void Reset();
+};
+
+// Per-actor bookkeeping of wait intervals, only allocated when tracing is enabled.
+class ActorTraceState final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ActorTraceState);
+  explicit ActorTraceState(int64_t actor_id)
+      : actor_id_(actor_id),
+        act_cnt_(0),
+        last_src_actor_id_(-1),
+        wait_begin_ns_(-1),
+        act_begin_ns_(-1),
+        wait_type_(ActorTraceEventType::kWaitReadable) {}
+  ~ActorTraceState() = default;
+
+  void OnMsg(int64_t src_actor_id) {
+    last_src_actor_id_ = src_actor_id;
+    if (wait_begin_ns_ < 0) { wait_begin_ns_ = ActorTracer::NowNs(); }
+  }
+  void OnBlocked(bool is_read_ready) {
+    wait_type_ =
+        is_read_ready ? ActorTraceEventType::kWaitWriteable : ActorTraceEventType::kWaitReadable;
+  }
+  void OnActBegin() {
+    act_begin_ns_ = ActorTracer::NowNs();
+    if (wait_begin_ns_ >= 0 && wait_begin_ns_ < act_begin_ns_) {
+      ActorTracer::Record(
+          ActorTraceEvent{actor_id_, act_cnt_, -1, wait_begin_ns_, act_begin_ns_, wait_type_});
+    }
+  }
+  void OnActEnd() {
+    const int64_t now = ActorTracer::NowNs();
+    ActorTracer::Record(ActorTraceEvent{actor_id_, act_cnt_, last_src_actor_id_, act_begin_ns_,
+                                        now, ActorTraceEventType::kAct});
+    act_cnt_ += 1;
+    wait_begin_ns_ = now;
+    last_src_actor_id_ = -1;
+  }
+
+ private:
+  int64_t actor_id_;
+  int64_t act_cnt_;
+  int64_t last_src_actor_id_;
+  int64_t wait_begin_ns_;
+  int64_t act_begin_ns_;
+  ActorTraceEventType wait_type_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_LAZY_ACTOR_ACTOR_TRACER_H_
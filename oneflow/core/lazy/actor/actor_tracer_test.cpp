@@ -0,0 +1,92 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/lazy/actor/actor_tracer.h"
+
+namespace oneflow {
+namespace test {
+
+namespace {
+
+ActorTraceEvent Act(int64_t actor_id, int64_t act_id, int64_t src, int64_t begin, int64_t end) {
+  return ActorTraceEvent{actor_id, act_id, src, begin, end, ActorTraceEventType::kAct};
+}
+
+}  // namespace
+
+TEST(ActorTracer, critical_path_follows_last_arrival) {
+  // 0 -> {1, 2} -> 3, actor 2 is slower so it is on the critical path.
+  std::vector<ActorTraceEvent> events{
+      Act(0, 0, -1, 0, 10),  Act(1, 0, 0, 12, 20),  Act(2, 0, 0, 11, 50),
+      Act(3, 0, 2, 52, 60),  Act(0, 1, -1, 15, 25), Act(1, 1, 0, 26, 70),
+      Act(2, 1, 0, 51, 60),  Act(3, 1, 1, 71, 80),
+      ActorTraceEvent{3, 1, -1, 60, 71, ActorTraceEventType::kWaitReadable},
+  };
+  const auto paths = ActorTracer::ComputeCriticalPaths(events);
+  ASSERT_EQ(paths.size(), 2);
+
+  ASSERT_EQ(paths[0].act_id, 0);
+  ASSERT_EQ(paths[0].begin_ns, 0);
+  ASSERT_EQ(paths[0].end_ns, 60);
+  ASSERT_EQ(paths[0].nodes.size(), 3);
+  ASSERT_EQ(paths[0].nodes[0].actor_id, 0);
+  ASSERT_EQ(paths[0].nodes[1].actor_id, 2);
+  ASSERT_EQ(paths[0].nodes[1].gap_ns, 1);
+  ASSERT_EQ(paths[0].nodes[2].actor_id, 3);
+  ASSERT_EQ(paths[0].nodes[2].act_ns, 8);
+
+  ASSERT_EQ(paths[1].act_id, 1);
+  ASSERT_EQ(paths[1].nodes.size(), 3);
+  ASSERT_EQ(paths[1].nodes[0].actor_id, 0);
+  ASSERT_EQ(paths[1].nodes[1].actor_id, 1);
+  ASSERT_EQ(paths[1].nodes[2].actor_id, 3);
+  ASSERT_EQ(paths[1].begin_ns, 15);
+}
+
+TEST(ActorTracer, ring_buffer_keeps_latest_events) {
+  const int64_t capacity = EnvInteger<ONEFLOW_ACTOR_TRACE_BUFFER_SIZE>();
+  std::thread([&]() {
+    for (int64_t i = 0; i < capacity + 10; ++i) { ActorTracer::Record(Act(42, i, -1, i, i + 1)); }
+  }).join();
+  int64_t cnt = 0;
+  int64_t min_act_id = capacity + 10;
+  for (const auto& event : ActorTracer::CollectEvents()) {
+    if (event.actor_id != 42) { continue; }
+    cnt += 1;
+    min_act_id = std::min(min_act_id, event.act_id);
+  }
+  ASSERT_EQ(cnt, capacity);
+  ASSERT_EQ(min_act_id, 10);
+}
+
+TEST(ActorTracer, reset_forgets_events) {
+  std::thread([&]() { ActorTracer::Record(Act(43, 0, -1, 0, 1)); }).join();
+  ActorTracer::Record(Act(44, 0, -1, 0, 1));
+  ActorTracer::Reset();
+  for (const auto& event : ActorTracer::CollectEvents()) {
+    ASSERT_NE(event.actor_id, 43);
+    ASSERT_NE(event.actor_id, 44);
+  }
+  // The buffer of this thread is still usable.
+  ActorTracer::Record(Act(44, 1, -1, 1, 2));
+  const auto events = ActorTracer::CollectEvents();
+  ASSERT_EQ(std::count_if(events.begin(), events.end(),
+                          [](const ActorTraceEvent& event) { return event.actor_id == 44; }),
+            1);
+}
+
+}  // namespace test
+}  // namespace oneflow
@@ -22,6 +22,7 @@ limitations under the License.
 #include "oneflow/core/register/register_manager.h"
 #include "oneflow/core/lazy/actor/actor_message.h"
 #include "oneflow/core/lazy/actor/actor_message_bus.h"
+#include "oneflow/core/lazy/actor/actor_tracer.h"
 #include "oneflow/core/thread/thread.h"
 #include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/job/runtime_job_descs.h"
@@ -239,6 +240,7 @@ class LightActor : public ActorBase, public KernelContext, public ActorContextPr
     }
     const int64_t thrd_id = ThrdId4ActorId(task_proto.task_id());
     thread_ = Singleton<ThreadMgr>::Get()->GetThrd(thrd_id);
+    if (ActorTracer::Enabled()) { trace_state_.reset(new ActorTraceState(task_proto.task_id())); }
     total_reading_cnt_ = 0;
     max_total_reading_cnt_ = 0;
     remaining_eord_cnt_ = 0;
@@ -298,11 +300,24 @@ class LightActor : public ActorBase, public KernelContext, public ActorContextPr
 
   int ProcessMsg(const ActorMsg& msg) override {
     HandleActorMsg(msg);
-    if (total_reading_cnt_ != 0) { return 0; }
+    if (OF_PREDICT_FALSE(trace_state_ != nullptr)) { trace_state_->OnMsg(msg.src_actor_id()); }
+    if (total_reading_cnt_ != 0) {
+      if (OF_PREDICT_FALSE(trace_state_ != nullptr)) {
+        trace_state_->OnBlocked(ready_consumed_ == max_ready_consumed_);
+      }
+      return 0;
+    }
     if (ready_consumed_ == max_ready_consumed_) {
-      ActOnce();
+      if (OF_PREDICT_FALSE(trace_state_ != nullptr)) {
+        trace_state_->OnActBegin();
+        ActOnce();
+        trace_state_->OnActEnd();
+      } else {
+        ActOnce();
+      }
       return 0;
     }
+    if (OF_PREDICT_FALSE(trace_state_ != nullptr)) { trace_state_->OnBlocked(false); }
     if (OF_PREDICT_FALSE(ready_consumed_ == 0 && remaining_eord_cnt_ == 0)) {
       SendEORDMsg();
       return 1;
@@ -599,6 +614,7 @@ class LightActor : public ActorBase, public KernelContext, public ActorContextPr
   std::vector<ActorMsg> sync_post_act_msgs_;
   std::vector<ActorMsg> async_post_act_msgs_;
   KernelObserver* stream_kernel_observer_;
+  std::unique_ptr<ActorTraceState> trace_state_;
 };
 
 template<int kernel_exec, int inplace, typename IndexType, typename RegstIndex,
@@ -17,6 +17,7 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/ep/include/device_manager_registry.h"
 #include "oneflow/core/ep/include/active_device_guard.h"
+#include "oneflow/core/lazy/actor/actor_tracer.h"
 
 namespace oneflow {
 
@@ -30,9 +31,18 @@ GenericStreamContext::GenericStreamContext(const StreamId& stream_id) : stream_(
   CHECK(stream_ != nullptr);
   poller_thread_ = std::thread([this]() {
     CHECK_JUST(stream_->OnExecutionContextSetup());
+    const bool trace_enabled = ActorTracer::Enabled();
+    if (trace_enabled) { ActorTracer::SetThisThreadName("stream poller"); }
     std::pair<ep::Event*, std::function<void()>> cb_event;
     while (cb_event_chan_.Receive(&cb_event) == kChannelStatusSuccess) {
-      CHECK_JUST(cb_event.first->Sync());
+      if (trace_enabled) {
+        const int64_t sync_begin_ns = ActorTracer::NowNs();
+        CHECK_JUST(cb_event.first->Sync());
+        ActorTracer::Record(ActorTraceEvent{-1, -1, -1, sync_begin_ns, ActorTracer::NowNs(),
+                                            ActorTraceEventType::kStreamSync});
+      } else {
+        CHECK_JUST(cb_event.first->Sync());
+      }
       cb_event.second();
       device_->DestroyEvent(cb_event.first);
     }
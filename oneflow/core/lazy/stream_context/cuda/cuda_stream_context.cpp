@@ -24,6 +24,7 @@ limitations under the License.
 #include "oneflow/core/ep/cuda/cuda_device.h"
 #include "oneflow/core/ep/include/device_manager_registry.h"
 #include "oneflow/core/common/channel.h"
+#include "oneflow/core/lazy/actor/actor_tracer.h"
 
 #ifdef WITH_CUDA
 #include <cublas_v2.h>
@@ -75,9 +76,20 @@ CudaStreamContext::CudaStreamContext(int device_index)
     CHECK_JUST(stream_->OnExecutionContextSetup());
     OF_PROFILER_NAME_THIS_HOST_THREAD("_cuda" + std::to_string(device_index_) + " Poller : ("
                                       + std::to_string(device_index_) + ")");
+    const bool trace_enabled = ActorTracer::Enabled();
+    if (trace_enabled) {
+      ActorTracer::SetThisThreadName("cuda poller " + std::to_string(device_index_));
+    }
     std::pair<ep::Event*, std::function<void()>> cb_event;
     while (cb_event_chan_.Receive(&cb_event) == kChannelStatusSuccess) {
-      CHECK_JUST(cb_event.first->Sync());
+      if (trace_enabled) {
+        const int64_t sync_begin_ns = ActorTracer::NowNs();
+        CHECK_JUST(cb_event.first->Sync());
+        ActorTracer::Record(ActorTraceEvent{-1, -1, -1, sync_begin_ns, ActorTracer::NowNs(),
+                                            ActorTraceEventType::kStreamSync});
+      } else {
+        CHECK_JUST(cb_event.first->Sync());
+      }
       cb_event.second();
       device_->DestroyEvent(cb_event.first);
     }
@@ -19,9 +19,17 @@ limitations under the License.
 #include "oneflow/core/job/job_set.pb.h"
 #include <cstring>
 #include "oneflow/core/common/constant.h"
+#include "oneflow/core/common/env_var/env_var.h"
 
 namespace oneflow {
 
+// Number of chunks read ahead of the consumer, 0 reads synchronously through the StreamScanner.
+DEFINE_ENV_INTEGER(ONEFLOW_PERSISTENT_IN_STREAM_PREFETCH_DEPTH, 0);
+DEFINE_ENV_INTEGER(ONEFLOW_PERSISTENT_IN_STREAM_PREFETCH_CHUNK_SIZE_BYTES, 4 * 1024 * 1024);
+// Upper bound of the bytes read ahead, at least one chunk is always read ahead.
+DEFINE_ENV_INTEGER(ONEFLOW_PERSISTENT_IN_STREAM_PREFETCH_BUDGET_BYTES, 64 * 1024 * 1024);
+DEFINE_ENV_INTEGER(ONEFLOW_PERSISTENT_IN_STREAM_PREFETCH_THREAD_NUM, 4);
+
 namespace {
 
 constexpr size_t kDefaultBufferSize = 32 * 1024;  // 32KB
@@ -52,6 +60,21 @@ PersistentInStream::PersistentInStream(int64_t session_id, fs::FileSystem* fs,
                                        const std::vector<std::string>& file_paths, uint64_t offset,
                                        bool cyclic, bool with_local_copy) {
   if (with_local_copy) { CHECK_EQ(offset, 0); }
+  const int64_t prefetch_depth = EnvInteger<ONEFLOW_PERSISTENT_IN_STREAM_PREFETCH_DEPTH>();
+  // NOTE: the local copy is written while the stream is read sequentially, so it is not prefetched
+  if (prefetch_depth > 0 && !with_local_copy) {
+    const int64_t chunk_size = EnvInteger<ONEFLOW_PERSISTENT_IN_STREAM_PREFETCH_CHUNK_SIZE_BYTES>();
+    CHECK_GT(chunk_size, 0);
+    prefetcher_.reset(new StreamPrefetcher(
+        fs, file_paths, offset, cyclic, chunk_size, prefetch_depth,
+        EnvInteger<ONEFLOW_PERSISTENT_IN_STREAM_PREFETCH_BUDGET_BYTES>(),
+        EnvInteger<ONEFLOW_PERSISTENT_IN_STREAM_PREFETCH_THREAD_NUM>()));
+    buffer_.resize(chunk_size + 1);
+    cur_buf_begin_ = buffer_.data();
+    cur_buf_end_ = buffer_.data();
+    *cur_buf_end_ = '\0';
+    return;
+  }
   std::vector<std::shared_ptr<BinaryInStream>> streams;
   for (auto& file_path : file_paths) {
     if (with_local_copy) {
@@ -126,13 +149,15 @@ int32_t PersistentInStream::ReadFully(char* s, size_t n) {
 
 void PersistentInStream::UpdateBuffer() {
   CHECK_EQ(cur_buf_begin_, cur_buf_end_);
-  uint64_t n = stream_scanner_->UpdateBuffer(&buffer_);
+  uint64_t n = prefetcher_ ? prefetcher_->UpdateBuffer(&buffer_)
+                          : stream_scanner_->UpdateBuffer(&buffer_);
   cur_buf_begin_ = buffer_.data();
   cur_buf_end_ = buffer_.data() + n;
   *cur_buf_end_ = '\0';
 }
 
 bool PersistentInStream::IsEof() const {
-  return cur_buf_begin_ == cur_buf_end_ && stream_scanner_->IsEof();
+  return cur_buf_begin_ == cur_buf_end_
+         && (prefetcher_ ? prefetcher_->IsEof() : stream_scanner_->IsEof());
 }
 }  // namespace oneflow
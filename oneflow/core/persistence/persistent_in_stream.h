@@ -17,6 +17,7 @@ limitations under the License.
 #define ONEFLOW_CORE_PERSISTENCE_PERSISTENT_IN_STREAM_H_
 
 #include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/stream_prefetcher.h"
 #include "oneflow/core/persistence/stream_scanner.h"
 
 namespace oneflow {
@@ -44,11 +45,15 @@ class PersistentInStream {
   int32_t ReadLine(std::string* l);
   int32_t ReadFully(char* s, size_t n);
 
+  // nullptr unless ONEFLOW_PERSISTENT_IN_STREAM_PREFETCH_DEPTH is set
+  const StreamPrefetcher* prefetcher() const { return prefetcher_.get(); }
+
  private:
   bool IsEof() const;
   void UpdateBuffer();
 
   std::unique_ptr<StreamScanner> stream_scanner_;
+  std::unique_ptr<StreamPrefetcher> prefetcher_;
 
   std::vector<char> buffer_;
   char* cur_buf_begin_;
@@ -0,0 +1,185 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/stream_prefetcher.h"
+#include "oneflow/core/common/env_var/env_var.h"
+
+namespace oneflow {
+
+DEFINE_ENV_BOOL(ONEFLOW_PERSISTENT_IN_STREAM_PRINT_STATS, false);
+
+namespace {
+
+int64_t NanosecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+                                                              - start)
+      .count();
+}
+
+}  // namespace
+
+double StreamPrefetchStats::BandwidthMBps() const {
+  if (elapsed_ns == 0) { return 0; }
+  return static_cast<double>(read_bytes) / (1024 * 1024) / (elapsed_ns * 1e-9);
+}
+
+StreamPrefetcher::StreamPrefetcher(fs::FileSystem* fs, const std::vector<std::string>& file_paths,
+                                   uint64_t offset, bool cyclic, size_t chunk_size, int64_t depth,
+                                   int64_t budget_bytes, int64_t thread_num)
+    : cyclic_(cyclic),
+      chunk_size_(chunk_size),
+      depth_(depth),
+      budget_bytes_(budget_bytes),
+      total_size_(0),
+      next_file_(0),
+      next_pos_(0),
+      buffered_bytes_(0),
+      pending_read_num_(0),
+      start_time_(std::chrono::steady_clock::now()) {
+  CHECK_GT(chunk_size_, 0);
+  CHECK_GT(depth_, 0);
+  CHECK_GT(thread_num, 0);
+  for (const auto& path : file_paths) {
+    File file;
+    file.path = path;
+    file.size = fs->GetFileSize(path);
+    fs->NewRandomAccessFile(path, &file.file);
+    total_size_ += file.size;
+    files_.emplace_back(std::move(file));
+  }
+  CHECK_LE(offset, total_size_);
+  if (cyclic_ && total_size_ > 0) { offset %= total_size_; }
+  while (next_file_ < static_cast<int64_t>(files_.size())
+         && offset >= files_.at(next_file_).size) {
+    offset -= files_.at(next_file_).size;
+    ++next_file_;
+  }
+  next_pos_ = offset;
+  thread_pool_.reset(new ThreadPool(thread_num));
+  std::unique_lock<std::mutex> lock(mutex_);
+  IssueReads();
+}
+
+StreamPrefetcher::~StreamPrefetcher() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return pending_read_num_ == 0; });
+  }
+  if (EnvBool<ONEFLOW_PERSISTENT_IN_STREAM_PRINT_STATS>()) {
+    const StreamPrefetchStats s = stats();
+    LOG(INFO) << "PersistentInStream prefetch stats of " << files_.size() << " file(s)"
+              << (files_.empty() ? "" : " from " + files_.front().path) << ": read "
+              << s.read_bytes << " bytes in " << s.read_cnt << " reads, "
+              << s.BandwidthMBps() << " MB/s, " << s.stall_cnt << " stalls for "
+              << s.stall_ns / 1000000 << " ms in " << s.elapsed_ns / 1000000 << " ms";
+  }
+}
+
+bool StreamPrefetcher::HasNextRead() const {
+  if (total_size_ == 0) { return false; }
+  return cyclic_ || next_file_ < static_cast<int64_t>(files_.size());
+}
+
+void StreamPrefetcher::AdvanceToNonEmptyFile() {
+  const int64_t file_num = files_.size();
+  while (true) {
+    if (next_file_ == file_num) {
+      if (!cyclic_) { return; }
+      next_file_ = 0;
+    }
+    if (next_pos_ < files_.at(next_file_).size) { return; }
+    next_pos_ = 0;
+    ++next_file_;
+  }
+}
+
+void StreamPrefetcher::IssueReads() {
+  // NOTE: called with mutex_ held
+  while (HasNextRead() && static_cast<int64_t>(chunks_.size()) < depth_
+         && (chunks_.empty()
+             || buffered_bytes_ + static_cast<int64_t>(chunk_size_) <= budget_bytes_)) {
+    AdvanceToNonEmptyFile();
+    if (!HasNextRead()) { break; }
+    const int64_t file_index = next_file_;
+    const uint64_t pos = next_pos_;
+    const uint64_t size = std::min<uint64_t>(chunk_size_, files_.at(file_index).size - pos);
+    next_pos_ += size;
+    if (next_pos_ == files_.at(file_index).size) {
+      next_pos_ = 0;
+      ++next_file_;
+      if (!cyclic_) { AdvanceToNonEmptyFile(); }
+    }
+    auto chunk = std::make_shared<Chunk>();
+    if (free_buffers_.empty()) {
+      chunk->data.resize(chunk_size_ + 1);
+    } else {
+      chunk->data = std::move(free_buffers_.back());
+      free_buffers_.pop_back();
+      chunk->data.resize(chunk_size_ + 1);
+    }
+    chunk->size = size;
+    chunk->ready = false;
+    chunks_.emplace_back(chunk);
+    buffered_bytes_ += size;
+    pending_read_num_ += 1;
+    thread_pool_->AddWork([this, chunk, file_index, pos]() {
+      const auto start = std::chrono::steady_clock::now();
+      files_.at(file_index).file->Read(pos, chunk->size, chunk->data.data());
+      const int64_t read_ns = NanosecondsSince(start);
+      std::unique_lock<std::mutex> lock(mutex_);
+      chunk->ready = true;
+      stats_.read_cnt += 1;
+      stats_.read_bytes += chunk->size;
+      stats_.read_ns += read_ns;
+      pending_read_num_ -= 1;
+      cond_.notify_all();
+    });
+  }
+}
+
+bool StreamPrefetcher::IsEof() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return chunks_.empty() && !HasNextRead();
+}
+
+uint64_t StreamPrefetcher::UpdateBuffer(std::vector<char>* buffer) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  IssueReads();
+  if (chunks_.empty()) { return 0; }
+  std::shared_ptr<Chunk> chunk = chunks_.front();
+  chunks_.pop_front();
+  if (!chunk->ready) {
+    const auto start = std::chrono::steady_clock::now();
+    cond_.wait(lock, [&chunk]() { return chunk->ready; });
+    stats_.stall_cnt += 1;
+    stats_.stall_ns += NanosecondsSince(start);
+  }
+  buffered_bytes_ -= chunk->size;
+  std::swap(*buffer, chunk->data);
+  if (static_cast<int64_t>(free_buffers_.size()) < depth_) {
+    free_buffers_.emplace_back(std::move(chunk->data));
+  }
+  IssueReads();
+  return chunk->size;
+}
+
+StreamPrefetchStats StreamPrefetcher::stats() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  StreamPrefetchStats stats = stats_;
+  stats.elapsed_ns = NanosecondsSince(start_time_);
+  return stats;
+}
+
+}  // namespace oneflow
@@ -0,0 +1,96 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_STREAM_PREFETCHER_H_
+#define ONEFLOW_CORE_PERSISTENCE_STREAM_PREFETCHER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+struct StreamPrefetchStats {
+  int64_t read_cnt = 0;
+  int64_t read_bytes = 0;
+  // summed over the reads, which overlap each other
+  int64_t read_ns = 0;
+  // times the consumer waited for a chunk which was not read yet, and how long it waited
+  int64_t stall_cnt = 0;
+  int64_t stall_ns = 0;
+  int64_t elapsed_ns = 0;
+
+  double BandwidthMBps() const;
+};
+
+// Reads the concatenation of `file_paths` from `offset` in chunks of `chunk_size` bytes, keeping
+// up to `depth` chunks (and `budget_bytes` bytes) outstanding. The reads are positional, so the
+// chunks ahead of the consumer are read concurrently by `thread_num` threads, across file
+// boundaries. Chunks are handed out in stream order and never cross a file boundary.
+class StreamPrefetcher final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(StreamPrefetcher);
+  StreamPrefetcher(fs::FileSystem* fs, const std::vector<std::string>& file_paths,
+                   uint64_t offset, bool cyclic, size_t chunk_size, int64_t depth,
+                   int64_t budget_bytes, int64_t thread_num);
+  ~StreamPrefetcher();
+
+  bool IsEof() const;
+  // Swaps the next chunk into `buffer` and returns its size, the previous content of `buffer` is
+  // reused for later reads. `buffer` keeps one byte after the chunk for a terminator.
+  uint64_t UpdateBuffer(std::vector<char>* buffer);
+  StreamPrefetchStats stats() const;
+
+ private:
+  struct File {
+    std::string path;
+    uint64_t size;
+    std::unique_ptr<fs::RandomAccessFile> file;
+  };
+  struct Chunk {
+    std::vector<char> data;
+    uint64_t size;
+    bool ready;
+  };
+
+  bool HasNextRead() const;
+  void AdvanceToNonEmptyFile();
+  void IssueReads();
+
+  std::vector<File> files_;
+  bool cyclic_;
+  size_t chunk_size_;
+  int64_t depth_;
+  int64_t budget_bytes_;
+  uint64_t total_size_;
+  int64_t next_file_;
+  uint64_t next_pos_;
+  std::deque<std::shared_ptr<Chunk>> chunks_;
+  std::vector<std::vector<char>> free_buffers_;
+  int64_t buffered_bytes_;
+  int64_t pending_read_num_;
+  StreamPrefetchStats stats_;
+  std::chrono::steady_clock::time_point start_time_;
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_STREAM_PREFETCHER_H_
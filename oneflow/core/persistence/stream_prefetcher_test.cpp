@@ -0,0 +1,87 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/posix/posix_file_system.h"
+#include "oneflow/core/persistence/stream_prefetcher.h"
+
+namespace oneflow {
+
+namespace {
+
+// Writes files of the given sizes, an empty file included, and returns their concatenation.
+std::string WriteTestFiles(fs::FileSystem* file_system, const std::vector<size_t>& sizes,
+                           std::vector<std::string>* paths) {
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  std::string content;
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    std::string file_content;
+    for (size_t j = 0; j < sizes.at(i); ++j) { file_content.push_back('a' + (i * 7 + j) % 26); }
+    const std::string path =
+        JoinPath(current_dir, "tmp_stream_prefetcher_test_" + std::to_string(i));
+    std::unique_ptr<fs::WritableFile> file;
+    file_system->NewWritableFile(path, &file);
+    file->Append(file_content.data(), file_content.size());
+    file->Close();
+    paths->emplace_back(path);
+    content += file_content;
+  }
+  return content;
+}
+
+std::string ReadAll(StreamPrefetcher* prefetcher, size_t max_size) {
+  std::string content;
+  std::vector<char> buffer(1);
+  while (!prefetcher->IsEof() && content.size() < max_size) {
+    const uint64_t n = prefetcher->UpdateBuffer(&buffer);
+    EXPECT_LT(n, buffer.size());
+    content.append(buffer.data(), n);
+  }
+  return content;
+}
+
+}  // namespace
+
+TEST(StreamPrefetcher, read) {
+#ifdef OF_PLATFORM_POSIX
+  fs::PosixFileSystem file_system;
+  std::vector<std::string> paths;
+  const std::string content = WriteTestFiles(&file_system, {1000, 0, 37, 4096, 1}, &paths);
+  for (size_t chunk_size : {1, 7, 512, 8192}) {
+    for (int64_t depth : {1, 4}) {
+      for (uint64_t offset : {0, 5, 1000, 1037, 5134}) {
+        StreamPrefetcher acyclic(&file_system, paths, offset, false, chunk_size, depth,
+                                 /*budget_bytes=*/2048, /*thread_num=*/3);
+        ASSERT_EQ(ReadAll(&acyclic, content.size()), content.substr(offset));
+        ASSERT_TRUE(acyclic.IsEof());
+        ASSERT_EQ(acyclic.stats().read_bytes, static_cast<int64_t>(content.size() - offset));
+
+        StreamPrefetcher cyclic(&file_system, paths, offset, true, chunk_size, depth,
+                                /*budget_bytes=*/2048, /*thread_num=*/3);
+        const std::string twice = content + content;
+        ASSERT_EQ(ReadAll(&cyclic, content.size()).substr(0, content.size()),
+                  twice.substr(offset % content.size(), content.size()));
+        ASSERT_FALSE(cyclic.IsEof());
+      }
+    }
+  }
+  for (const auto& path : paths) { file_system.DelFile(path); }
+#endif
+}
+
+}  // namespace oneflow
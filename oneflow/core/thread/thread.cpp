@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/lazy/actor/actor.h"
 #include "oneflow/core/lazy/actor/light_actor.h"
+#include "oneflow/core/lazy/actor/actor_tracer.h"
 #include "oneflow/core/profiler/profiler.h"
 #include "oneflow/core/lazy/stream_context/include/stream_context.h"
 #include "oneflow/core/framework/to_string.h"
@@ -25,9 +26,11 @@ limitations under the License.
 
 namespace oneflow {
 
-Thread::Thread(const StreamId& stream_id) : thrd_id_(EncodeStreamIdToInt64(stream_id)) {
+Thread::Thread(const StreamId& stream_id)
+    : actor_num_(0), thrd_id_(EncodeStreamIdToInt64(stream_id)) {
   local_msg_queue_enabled_ = ParseBooleanFromEnv("ONEFLOW_THREAD_ENABLE_LOCAL_MESSAGE_QUEUE", true);
   light_actor_enabled_ = ParseBooleanFromEnv("ONEFLOW_ACTOR_ENABLE_LIGHT_ACTOR", true);
+  trace_enabled_ = ActorTracer::Enabled();
   if (IsClassRegistered<int, StreamContext, const StreamId&>(stream_id.device_id().device_type(),
                                                              stream_id)) {
     stream_ctx_.reset(NewObj<int, StreamContext, const StreamId&>(
@@ -40,6 +43,9 @@ Thread::Thread(const StreamId& stream_id) : thrd_id_(EncodeStreamIdToInt64(strea
     OF_PROFILER_NAME_THIS_HOST_THREAD("_" + ToString(stream_id.device_id().device_type())
                                       + std::to_string(stream_id.device_id().device_index())
                                       + "_actor");
+    if (trace_enabled_) {
+      ActorTracer::SetThisThreadName("actor thread " + std::to_string(thrd_id_));
+    }
     CHECK_JUST(stream_ctx_->stream()->OnExecutionContextSetup());
     PollMsgChannel();
     CHECK_JUST(stream_ctx_->stream()->OnExecutionContextTeardown());
@@ -64,11 +70,16 @@ void Thread::PollMsgChannel() {
     }
     ActorMsg msg = std::move(local_msg_queue_.front());
     local_msg_queue_.pop();
+    if (OF_PREDICT_FALSE(trace_enabled_ && msg.enqueue_time_ns() > 0)) {
+      ActorTracer::Record(ActorTraceEvent{msg.dst_actor_id(), -1, msg.src_actor_id(),
+                                          msg.enqueue_time_ns(), ActorTracer::NowNs(),
+                                          ActorTraceEventType::kQueueDelay});
+    }
     if (msg.msg_type() == ActorMsgType::kCmdMsg) {
       if (msg.actor_cmd() == ActorCmd::kStopThread) {
-        CHECK(id2actor_ptr_.empty())
+        CHECK_EQ(actor_num_, 0)
             << " RuntimeError! Thread: " << thrd_id_
-            << " NOT empty when stop with actor num: " << id2actor_ptr_.size();
+            << " NOT empty when stop with actor num: " << actor_num_;
         break;
       } else if (msg.actor_cmd() == ActorCmd::kConstructActor) {
         ConstructActor(msg.dst_actor_id());
@@ -77,27 +88,51 @@ void Thread::PollMsgChannel() {
         // do nothing
       }
     }
-    int64_t actor_id = msg.dst_actor_id();
-    auto actor_it = id2actor_ptr_.find(actor_id);
-    CHECK(actor_it != id2actor_ptr_.end());
-    int process_msg_ret = actor_it->second.second->ProcessMsg(msg);
+    ActorSlot* slot = MutActorSlot4ActorId(msg.dst_actor_id());
+    int process_msg_ret = slot->actor->ProcessMsg(msg);
     if (process_msg_ret == 1) {
-      VLOG(3) << "thread " << thrd_id_ << " deconstruct actor " << actor_id;
-      auto job_id_it = id2job_id_.find(actor_id);
-      const int64_t job_id = job_id_it->second;
-      id2job_id_.erase(job_id_it);
-      id2actor_ptr_.erase(actor_it);
-      Singleton<RuntimeCtx>::Get()->DecreaseCounter(GetRunningActorCountKeyByJobId(job_id));
+      DestructActor(task_index2actor_index_[TaskIndex4ActorId(msg.dst_actor_id())]);
     } else {
       CHECK_EQ(process_msg_ret, 0);
     }
   }
 }
 
+void Thread::EnqueueActorMsgWithTrace(const ActorMsg& msg) {
+  ActorMsg stamped_msg = msg;
+  stamped_msg.set_enqueue_time_ns(ActorTracer::NowNs());
+  if (UseLocalMsgQueue()) {
+    local_msg_queue_.push(stamped_msg);
+  } else {
+    msg_channel_.Send(stamped_msg);
+  }
+}
+
+void Thread::DestructActor(int32_t actor_index) {
+  ActorSlot* slot = &actors_[actor_index];
+  VLOG(3) << "thread " << thrd_id_ << " deconstruct actor " << slot->actor_id;
+  const int64_t job_id = slot->job_id;
+  task_index2actor_index_[TaskIndex4ActorId(slot->actor_id)] = -1;
+  slot->actor.reset();
+  slot->actor_ctx.reset();
+  slot->actor_id = -1;
+  free_actor_indices_.emplace_back(actor_index);
+  actor_num_ -= 1;
+  Singleton<RuntimeCtx>::Get()->DecreaseCounter(GetRunningActorCountKeyByJobId(job_id));
+}
+
 void Thread::ConstructActor(int64_t actor_id) {
   std::unique_lock<std::mutex> lck(id2task_mtx_);
   auto task_it = id2task_.find(actor_id);
   const TaskProto& task = task_it->second;
+  if (trace_enabled_) {
+    std::string actor_name = TaskType_Name(task.task_type());
+    if (task.exec_sequence().exec_node_size() > 0) {
+      actor_name +=
+          " " + task.exec_sequence().exec_node(0).kernel_conf().op_attribute().op_conf().name();
+    }
+    ActorTracer::SetActorName(actor_id, actor_name);
+  }
   std::unique_ptr<ActorContext> actor_ctx = NewActorContext(task, stream_ctx_.get());
   CHECK(actor_ctx);
   std::unique_ptr<ActorBase> actor_ptr;
@@ -110,9 +145,27 @@ void Thread::ConstructActor(int64_t actor_id) {
     VLOG(3) << "Thread " << thrd_id_ << " construct LightActor " << TaskType_Name(task.task_type())
             << " " << actor_id;
   }
-  CHECK(id2actor_ptr_.emplace(actor_id, std::make_pair(std::move(actor_ctx), std::move(actor_ptr)))
-            .second);
-  CHECK(id2job_id_.emplace(actor_id, task.job_id()).second);
+  const TaskId::task_index_t task_index = TaskIndex4ActorId(actor_id);
+  if (task_index >= task_index2actor_index_.size()) {
+    task_index2actor_index_.resize(task_index + 1, -1);
+  }
+  CHECK_EQ(task_index2actor_index_[task_index], -1)
+      << " RuntimeError! Thread: " << thrd_id_ << " actor " << actor_id << " constructed twice";
+  int32_t actor_index = -1;
+  if (free_actor_indices_.empty()) {
+    actor_index = actors_.size();
+    actors_.emplace_back();
+  } else {
+    actor_index = free_actor_indices_.back();
+    free_actor_indices_.pop_back();
+  }
+  ActorSlot* slot = &actors_[actor_index];
+  slot->actor_ctx = std::move(actor_ctx);
+  slot->actor = std::move(actor_ptr);
+  slot->actor_id = actor_id;
+  slot->job_id = task.job_id();
+  task_index2actor_index_[task_index] = actor_index;
+  actor_num_ += 1;
   id2task_.erase(task_it);
   Singleton<RuntimeCtx>::Get()->DecreaseCounter("constructing_actor_cnt");
 }
@@ -17,9 +17,10 @@ limitations under the License.
 #define ONEFLOW_CORE_THREAD_THREAD_H_
 
 #include "oneflow/core/lazy/actor/actor_message_bus.h"
-#include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/lock_free_channel.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/job/task.pb.h"
+#include "oneflow/core/graph/task_id.h"
 #include "oneflow/core/lazy/actor/actor.h"
 #include "oneflow/core/lazy/actor/actor_context.h"
 
@@ -35,9 +36,10 @@ class Thread {
 
   void AddTask(const TaskProto&);
 
-  Channel<ActorMsg>* GetMsgChannelPtr() { return &msg_channel_; }
+  LockFreeChannel<ActorMsg>* GetMsgChannelPtr() { return &msg_channel_; }
 
   inline void EnqueueActorMsg(const ActorMsg& msg) {
+    if (OF_PREDICT_FALSE(trace_enabled_)) { return EnqueueActorMsgWithTrace(msg); }
     if (UseLocalMsgQueue()) {
       local_msg_queue_.push(msg);
     } else {
@@ -47,6 +49,10 @@ class Thread {
 
   template<typename InputIt>
   inline void EnqueueActorMsg(InputIt first, InputIt last) {
+    if (OF_PREDICT_FALSE(trace_enabled_)) {
+      for (auto it = first; it != last; ++it) { EnqueueActorMsgWithTrace(*it); }
+      return;
+    }
     if (UseLocalMsgQueue()) {
       for (auto it = first; it != last; ++it) { local_msg_queue_.push(*it); }
     } else {
@@ -58,7 +64,25 @@ class Thread {
   void PollMsgChannel();
 
  private:
+  struct ActorSlot {
+    std::unique_ptr<ActorContext> actor_ctx;
+    std::unique_ptr<ActorBase> actor;
+    int64_t actor_id;
+    int64_t job_id;
+  };
+
   void ConstructActor(int64_t actor_id);
+  void EnqueueActorMsgWithTrace(const ActorMsg& msg);
+  void DestructActor(int32_t actor_index);
+  inline ActorSlot* MutActorSlot4ActorId(int64_t actor_id) {
+    const TaskId::task_index_t task_index = TaskIndex4ActorId(actor_id);
+    CHECK_LT(task_index, task_index2actor_index_.size());
+    const int32_t actor_index = task_index2actor_index_[task_index];
+    CHECK_GE(actor_index, 0);
+    ActorSlot* slot = &actors_[actor_index];
+    CHECK_EQ(slot->actor_id, actor_id);
+    return slot;
+  }
 
   inline bool UseLocalMsgQueue() const {
     return local_msg_queue_enabled_ && std::this_thread::get_id() == actor_thread_.get_id();
@@ -68,14 +92,19 @@ class Thread {
   std::mutex id2task_mtx_;
 
   std::thread actor_thread_;
-  Channel<ActorMsg> msg_channel_;
-  HashMap<int64_t, std::pair<std::unique_ptr<ActorContext>, std::unique_ptr<ActorBase>>>
-      id2actor_ptr_;
-  HashMap<int64_t, int64_t> id2job_id_;
+  LockFreeChannel<ActorMsg> msg_channel_;
+  // NOTE: actors are only touched by actor_thread_. Task indices of a stream are allocated
+  // contiguously, so the actor id of every message is remapped to a dense per-thread slot by
+  // indexing task_index2actor_index_ with its task index.
+  std::vector<int32_t> task_index2actor_index_;
+  std::vector<ActorSlot> actors_;
+  std::vector<int32_t> free_actor_indices_;
+  size_t actor_num_;
   std::queue<ActorMsg> local_msg_queue_;
   bool local_msg_queue_enabled_;
   int64_t thrd_id_;
   bool light_actor_enabled_;
+  bool trace_enabled_;
   std::unique_ptr<StreamContext> stream_ctx_;
 };
 
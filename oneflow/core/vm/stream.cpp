@@ -35,6 +35,10 @@ void Stream::__Init__(
   schedule_local_dep_object_ = schedule_local_dep_object;
   transport_local_dep_object_ = transport_local_dep_object;
   on_scheduler_thread_ = stream_policy_->OnSchedulerThread(stream_role);
+  is_multi_threaded_ =
+      !on_scheduler_thread_ && thread_ctx != nullptr && thread_ctx->worker_thread_num() > 1;
+  // Creates the ep stream before the worker threads share it.
+  if (is_multi_threaded_) { CHECK_NOTNULL(stream_policy_->stream()); }
 }
 
 int64_t Stream::device_id() const { return device_->device_id(); }
@@ -63,6 +63,9 @@ class Stream final : public intrusive::Base {
   Symbol<Device> device() const { return device_; }
   StreamRole stream_role() const { return stream_role_; }
   bool on_scheduler_thread() const { return on_scheduler_thread_; }
+  // The instructions of a multi-threaded stream run concurrently on the worker threads of its
+  // ThreadCtx, and finish out of order.
+  bool is_multi_threaded() const { return is_multi_threaded_; }
 
   const intrusive::shared_ptr<Dependence>& schedule_local_dep_object() const {
     return schedule_local_dep_object_;
@@ -86,6 +89,7 @@ class Stream final : public intrusive::Base {
         stream_role_(StreamRole::kInvalid),
         stream_policy_(),
         on_scheduler_thread_(false),
+        is_multi_threaded_(false),
         running_instruction_list_(),
         active_stream_hook_(),
         thread_ctx_stream_hook_() {}
@@ -96,6 +100,7 @@ class Stream final : public intrusive::Base {
   StreamRole stream_role_;
   std::shared_ptr<StreamPolicy> stream_policy_;
   bool on_scheduler_thread_;
+  bool is_multi_threaded_;
   // lists
   DispatchedInstructionList running_instruction_list_;
 
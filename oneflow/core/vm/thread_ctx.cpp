@@ -31,5 +31,20 @@ size_t ThreadCtx::TryReceiveAndRun() {
   return size;
 }
 
+size_t ThreadCtx::TryReceiveOneAndRun() {
+  Instruction* instruction = nullptr;
+  {
+    // The instruction is kept alive by the running instruction list of its stream until it is
+    // done, as in TryReceiveAndRun.
+    intrusive::shared_ptr<Instruction> pending = mut_worker_pending_instruction_list()->PopFront();
+    if (!pending) { return 0; }
+    instruction = pending.Mutable();
+  }
+  if (!worker_pending_instruction_list_.empty()) { notifier_.Notify(); }
+  const StreamPolicy& stream_policy = instruction->stream().stream_policy();
+  stream_policy.Run(instruction);
+  return 1;
+}
+
 }  // namespace vm
 }  // namespace oneflow
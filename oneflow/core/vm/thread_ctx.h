@@ -35,6 +35,7 @@ class ThreadCtx final : public intrusive::Base {
 
   // Getters
   const StreamList& stream_list() const { return stream_list_; }
+  size_t worker_thread_num() const { return worker_thread_num_; }
 
   // Setters
   StreamList* mut_stream_list() { return &stream_list_; }
@@ -43,7 +44,12 @@ class ThreadCtx final : public intrusive::Base {
   }
 
   // methods
+  void __Init__(size_t worker_thread_num) { worker_thread_num_ = worker_thread_num; }
   size_t TryReceiveAndRun();
+  // Runs the first pending instruction, and wakes up another worker thread if there are more, so
+  // that the worker threads of a multi-threaded ThreadCtx run the pending instructions
+  // concurrently.
+  size_t TryReceiveOneAndRun();
 
   Notifier* mut_notifier() { return &notifier_; }
 
@@ -53,12 +59,15 @@ class ThreadCtx final : public intrusive::Base {
 
   ThreadCtx()
       : intrusive_ref_(),
+        worker_thread_num_(1),
         stream_list_(),
         worker_pending_instruction_mutex_(),
         worker_pending_instruction_list_(&worker_pending_instruction_mutex_),
         notifier_(),
         thread_ctx_hook_() {}
   intrusive::Ref intrusive_ref_;
+  // fields
+  size_t worker_thread_num_;
   // lists
   StreamList stream_list_;
   std::mutex worker_pending_instruction_mutex_;
@@ -36,6 +36,7 @@ limitations under the License.
 #include "oneflow/core/profiler/profiler.h"
 #include "oneflow/core/platform/include/pthread_fork.h"
 #include "oneflow/core/common/env_var/env_var.h"
+#include "oneflow/core/common/env_var/vm.h"
 #include "oneflow/core/common/container_util.h"
 #include "oneflow/core/framework/device.h"
 #include "oneflow/core/framework/stream.h"
@@ -69,11 +70,24 @@ void GetSchedulerThreadInitializer(std::function<void()>* Initializer) {
 
 void WorkerLoop(vm::ThreadCtx* thread_ctx, const std::function<void(vm::ThreadCtx*)>& Initializer) {
   Initializer(thread_ctx);
-  while (thread_ctx->mut_notifier()->WaitAndClearNotifiedCnt() == kNotifierStatusSuccess) {
-    while (thread_ctx->TryReceiveAndRun()) {}
+  if (thread_ctx->worker_thread_num() > 1) {
+    while (thread_ctx->mut_notifier()->WaitAndClearNotifiedCnt() == kNotifierStatusSuccess) {
+      while (thread_ctx->TryReceiveOneAndRun()) {}
+    }
+  } else {
+    while (thread_ctx->mut_notifier()->WaitAndClearNotifiedCnt() == kNotifierStatusSuccess) {
+      while (thread_ctx->TryReceiveAndRun()) {}
+    }
   }
 }
 
+// The cpu compute stream runs on ONEFLOW_VM_CPU_COMPUTE_STREAM_WIDTH worker threads of its own,
+// which run the instructions without dependences between them concurrently.
+size_t GetWorkerThreadNum(Symbol<Device> device, StreamRole stream_role) {
+  if (device->enum_type() != DeviceType::kCPU || stream_role != StreamRole::kCompute) { return 1; }
+  return std::max<int64_t>(EnvInteger<ONEFLOW_VM_CPU_COMPUTE_STREAM_WIDTH>(), 1);
+}
+
 }  // namespace
 
 VirtualMachine::VirtualMachine() : disable_vm_threads_(false), scheduler_stopped_(false) {
@@ -378,7 +392,8 @@ Maybe<vm::ThreadCtx*> VirtualMachine::FindOrCreateThreadCtx(Symbol<Device> devic
                                                             StreamRole stream_role) {
   std::unique_lock<std::recursive_mutex> lock(creating_stream_and_thread_ctx_mutex_);
   vm::ThreadCtx** thread_ctx_ptr = nullptr;
-  if (StreamOnIndependentThread::Visit(stream_role)) {
+  if (StreamOnIndependentThread::Visit(stream_role)
+      || GetWorkerThreadNum(device, stream_role) > 1) {
     auto key = std::make_pair(device->enum_type(), stream_role);
     thread_ctx_ptr = &devcie_type_stream_role_2independent_thread_ctx_[key];
   } else {
@@ -391,12 +406,13 @@ Maybe<vm::ThreadCtx*> VirtualMachine::FindOrCreateThreadCtx(Symbol<Device> devic
 Maybe<vm::ThreadCtx*> VirtualMachine::CreateThreadCtx(Symbol<Device> device,
                                                       StreamRole stream_role) {
   std::unique_lock<std::recursive_mutex> lock(creating_stream_and_thread_ctx_mutex_);
+  const size_t worker_thread_num = GetWorkerThreadNum(device, stream_role);
   // thread_ctx_ptr may be used after timout.
   auto thread_ctx_ptr = std::make_shared<vm::ThreadCtx*>(nullptr);
   {
     auto bc = std::make_shared<BlockingCounter>(1);
-    engine_->InsertProbe([thread_ctx_ptr, bc](vm::VirtualMachineEngine* engine) {
-      auto thread_ctx = intrusive::make_shared<vm::ThreadCtx>();
+    engine_->InsertProbe([thread_ctx_ptr, bc, worker_thread_num](vm::VirtualMachineEngine* engine) {
+      auto thread_ctx = intrusive::make_shared<vm::ThreadCtx>(worker_thread_num);
       engine->mut_thread_ctx_list()->PushBack(thread_ctx.Mutable());
       *thread_ctx_ptr = thread_ctx.Mutable();
       bc->Decrease();
@@ -406,8 +422,9 @@ Maybe<vm::ThreadCtx*> VirtualMachine::CreateThreadCtx(Symbol<Device> device,
     JUST(bc->WaitUntilCntEqualZero(VirtualMachine::GetPredicatorNoMoreInstructionsFinished()));
   }
   auto* thread_ctx = *thread_ctx_ptr;
-  {
-    const auto& WorkerInitializer = [device, stream_role](vm::ThreadCtx* thread_ctx) {
+  for (size_t i = 0; i < worker_thread_num; ++i) {
+    const auto& WorkerInitializer = [device, stream_role, worker_thread_num,
+                                     i](vm::ThreadCtx* thread_ctx) {
       int device_type_value = static_cast<int>(device->enum_type());
       CHECK_GT(device_type_value, 0);
       std::string device_tag = *CHECK_JUST(DeviceTag4DeviceType(device->enum_type()));
@@ -415,7 +432,9 @@ Maybe<vm::ThreadCtx*> VirtualMachine::CreateThreadCtx(Symbol<Device> device,
         CHECK_JUST(
             InitThisThreadGlobalId(device_type_value + kThreadGlobalIdScheduler, device_tag));
       }
-      OF_PROFILER_NAME_THIS_HOST_THREAD("_VM::Worker_" + device_tag);
+      std::string thread_name = "_VM::Worker_" + device_tag;
+      if (worker_thread_num > 1) { thread_name += "_" + std::to_string(i); }
+      OF_PROFILER_NAME_THIS_HOST_THREAD(thread_name);
     };
     auto thread = std::make_unique<std::thread>(&WorkerLoop, thread_ctx, WorkerInitializer);
     {
@@ -174,18 +174,30 @@ intrusive::shared_ptr<Instruction> VirtualMachineEngine::LivelyInstructionListEr
   return mut_lively_instruction_list()->Erase(instruction);
 }
 
+void VirtualMachineEngine::ReleaseFinishedInstruction(Stream* stream,
+                                                      Instruction* instruction_ptr) {
+  ReleaseInstruction(instruction_ptr);
+  // Prevent destructing instruction_ptr.
+  intrusive::shared_ptr<Instruction> instruction =
+      stream->mut_running_instruction_list()->Erase(instruction_ptr);
+  LivelyInstructionListErase(instruction_ptr);
+  instruction_ptr->DeleteStatusAndClearEdges();
+}
+
 // Collect ready instructions onto ready_instruction_list_
 void VirtualMachineEngine::ReleaseFinishedInstructions(const ScheduleCtx& schedule_ctx) {
   INTRUSIVE_FOR_EACH_PTR(stream, mut_active_stream_list()) {
-    while (true) {
-      auto* instruction_ptr = stream->mut_running_instruction_list()->Begin();
-      if (instruction_ptr == nullptr || !instruction_ptr->Done()) { break; }
-      ReleaseInstruction(instruction_ptr);
-      // Prevent destructing instruction_ptr.
-      intrusive::shared_ptr<Instruction> instruction =
-          stream->mut_running_instruction_list()->Erase(instruction_ptr);
-      LivelyInstructionListErase(instruction_ptr);
-      instruction_ptr->DeleteStatusAndClearEdges();
+    if (unlikely(stream->is_multi_threaded())) {
+      // Instructions of a multi-threaded stream finish out of order.
+      INTRUSIVE_FOR_EACH_PTR(instruction_ptr, stream->mut_running_instruction_list()) {
+        if (instruction_ptr->Done()) { ReleaseFinishedInstruction(stream, instruction_ptr); }
+      }
+    } else {
+      while (true) {
+        auto* instruction_ptr = stream->mut_running_instruction_list()->Begin();
+        if (instruction_ptr == nullptr || !instruction_ptr->Done()) { break; }
+        ReleaseFinishedInstruction(stream, instruction_ptr);
+      }
     }
     if (stream->running_instruction_list().empty()) { mut_active_stream_list()->Erase(stream); }
   }
@@ -255,6 +267,7 @@ void VirtualMachineEngine::ConsumeDependences(Instruction* instruction) {
 
 bool VirtualMachineEngine::EdgeDispatchable(const Instruction* src, const Instruction* dst) const {
   return (&src->stream() == &dst->stream()) /* same stream*/
+         && !src->stream().is_multi_threaded() /* run in order */
          && !src->dispatched_instruction_hook().empty() /* dispatched */;
 }
 
@@ -96,6 +96,7 @@ class VirtualMachineEngine final : public intrusive::Base {
   ReadyInstructionList* mut_ready_instruction_list() { return &ready_instruction_list_; }
 
   void ReleaseFinishedInstructions(const ScheduleCtx& schedule_ctx);
+  void ReleaseFinishedInstruction(Stream* stream, Instruction* instruction);
   void HandleLocalPending();
   void FetchAndTryFusePendingInstructions(InstructionList* /*out*/ pending_instructions);
   void MakeAndAppendFusedInstruction(InstructionList&& fused_instruction_list,
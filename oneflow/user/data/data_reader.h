@@ -18,13 +18,14 @@ limitations under the License.
 
 #include "oneflow/user/data/dataset.h"
 #include "oneflow/user/data/parser.h"
+#include "oneflow/user/data/staged_pipeline.h"
 #include "oneflow/core/common/buffer.h"
 
 namespace oneflow {
 
-namespace data {
+DEFINE_ENV_INTEGER(ONEFLOW_DATA_READER_BATCH_BUFFER_SIZE, 4);
 
-static const int32_t kDataReaderBatchBufferSize = 4;
+namespace data {
 
 template<typename LoadTarget>
 class DataReader {
@@ -33,11 +34,18 @@ class DataReader {
   using BatchType = std::vector<SampleType>;
 
   DataReader(user_op::KernelInitContext* ctx)
-      : is_closed_(false), batch_buffer_(kDataReaderBatchBufferSize) {}
+      : is_closed_(false),
+        batch_buffer_(EnvInteger<ONEFLOW_DATA_READER_BATCH_BUFFER_SIZE>()),
+        fetch_cnt_(0),
+        fetch_wait_ns_(0) {}
 
   virtual ~DataReader() {
     Close();
     if (load_thrd_.joinable()) { load_thrd_.join(); }
+    if (EnvBool<ONEFLOW_DATA_PIPELINE_PRINT_STATS>() && fetch_cnt_ > 0) {
+      LOG(INFO) << "data reader waited " << fetch_wait_ns_ / 1000000 << " ms for " << fetch_cnt_
+                << " batches, " << fetch_wait_ns_ / 1000 / fetch_cnt_ << " us/batch";
+    }
   }
 
   void Read(user_op::KernelComputeContext* ctx) {
@@ -67,7 +75,12 @@ class DataReader {
  private:
   BatchType FetchBatchData() {
     BatchType batch;
+    const auto start = std::chrono::steady_clock::now();
     CHECK_EQ(batch_buffer_.Pull(&batch), BufferStatus::kBufferStatusSuccess);
+    fetch_cnt_ += 1;
+    fetch_wait_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
     return batch;
   }
 
@@ -79,6 +92,9 @@ class DataReader {
   std::atomic<bool> is_closed_;
   Buffer<BatchType> batch_buffer_;
   std::thread load_thrd_;
+  // time the kernel waited for loaded batches
+  int64_t fetch_cnt_;
+  int64_t fetch_wait_ns_;
 };
 
 }  // namespace data
@@ -14,17 +14,26 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/data/gpt_dataset.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/env_var/env_var.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 #ifdef __linux__
 #include <fcntl.h>
 #include <stdio.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #endif
 
 namespace oneflow {
 
+// Whether MegatronGPTMMapDataset caches its indices in a file, see gpt_dataset.h
+DEFINE_ENV_BOOL(ONEFLOW_GPT_INDEX_CACHE, true);
+
 namespace data {
 
 namespace {
@@ -74,9 +83,35 @@ size_t GetNumCompleteEpochs(size_t num_samples, size_t seq_length, size_t tokens
   return separate_last_epoch ? (num_epochs - 1) : num_epochs;
 }
 
+// Calls DoRange(begin, end) on the chunks of [0, n) in the thread pool.
+template<typename DoRangeT>
+void ParallelForRange(size_t n, const DoRangeT& DoRange) {
+  constexpr size_t kChunkSize = 1 << 16;
+  const size_t num_chunks = std::max<size_t>(1, (n + kChunkSize - 1) / kChunkSize);
+  BalancedSplitter bs(n, num_chunks);
+  MultiThreadLoop(num_chunks, [&](size_t i) { DoRange(bs.At(i).begin(), bs.At(i).end()); });
+}
+
+std::string IndexCachePath(const std::string& data_file_prefix, size_t seq_len,
+                           size_t num_samples, const std::vector<int64_t>& split_sizes,
+                           size_t split_index, bool shuffle, uint32_t seed) {
+  std::string split;
+  for (int64_t split_size : split_sizes) {
+    split += (split.empty() ? "" : "-") + std::to_string(split_size);
+  }
+  const std::string file_name = Basename(data_file_prefix) + "_indexmap_"
+                                + std::to_string(num_samples) + "ns_" + std::to_string(seq_len)
+                                + "sl_" + std::to_string(seed) + "s_" + split + "split"
+                                + std::to_string(split_index) + (shuffle ? "" : "_noshuffle")
+                                + ".gptidx";
+  const std::string dir = GetStringFromEnv("ONEFLOW_GPT_INDEX_CACHE_DIR", "");
+  return JoinPath(dir.empty() ? Dirname(data_file_prefix) : dir, file_name);
+}
+
 }  // namespace
 
 constexpr char MegatronGPTIndex::kMagicCode[];
+constexpr char MegatronGPTMMapDataset::kIndexCacheMagic[];
 
 MegatronGPTIndex::MegatronGPTIndex(const std::string& index_file_path) {
   auto start = std::chrono::system_clock::now();
@@ -161,20 +196,27 @@ MegatronGPTMMapDataset::MegatronGPTMMapDataset(const std::string& data_file_pref
   tokens_per_epoch_ = GetEpochNumTokens(epoch_doc_indices);
   num_epochs_ = GetNumEpochs(num_samples_, seq_len_, tokens_per_epoch_);
   num_complete_epochs_ = GetNumCompleteEpochs(num_samples_, seq_len_, tokens_per_epoch_);
-  InitDocIndices(epoch_doc_indices, num_epochs_, num_complete_epochs_);
-  size_t total_num_samples = static_cast<size_t>(
+  num_doc_indices_ = epoch_doc_indices.size() * num_epochs_;
+  total_num_samples_ = static_cast<size_t>(
       std::floor(static_cast<double>(num_epochs_ * tokens_per_epoch_ - 1) / seq_len_));
-  InitSampleIndices(total_num_samples);
-  InitShuffleIndices(sample_indices_.size());
+  CHECK_GE(total_num_samples_, num_samples_);
+  if (EnvBool<ONEFLOW_GPT_INDEX_CACHE>()) {
+    LoadOrBuildIndices(IndexCachePath(data_file_prefix, seq_len_, num_samples_, split_sizes,
+                                      split_index, shuffle_, seed_),
+                       epoch_doc_indices);
+  } else {
+    BuildIndices(epoch_doc_indices);
+  }
   std::chrono::duration<double, std::milli> elapse = std::chrono::system_clock::now() - start;
   VLOG(2) << "Create GPT Dataset successed, sequence length: " << seq_len_
           << ", number of samples: " << num_samples_
-          << ", total number of samples: " << shuffle_indices_.size()
-          << ", total number of documents: " << doc_indices_.size()
+          << ", total number of samples: " << total_num_samples_
+          << ", total number of documents: " << num_doc_indices_
           << ", number of epochs: " << num_epochs_
           << ", number of complete epochs: " << num_complete_epochs_
           << ", shuffle: " << std::boolalpha << shuffle_ << ", random_seed: " << seed_
-          << ", elapsed time: " << elapse.count() << " ms";
+          << ", index cache: " << index_cache_path_ << ", elapsed time: " << elapse.count()
+          << " ms";
 }
 
 size_t MegatronGPTMMapDataset::GetEpochNumTokens(const std::vector<size_t>& doc_indices) const {
@@ -183,67 +225,199 @@ size_t MegatronGPTMMapDataset::GetEpochNumTokens(const std::vector<size_t>& doc_
   return num_tokens;
 }
 
-void MegatronGPTMMapDataset::InitDocIndices(const std::vector<size_t>& epoch_doc_indices,
-                                            size_t num_epochs, size_t num_complete_epochs) {
-  doc_indices_.reserve(epoch_doc_indices.size() * num_epochs);
-  InitDocIndices(epoch_doc_indices, num_complete_epochs);
-  if (num_epochs != num_complete_epochs) {
-    CHECK_EQ(num_complete_epochs + 1, num_epochs);
-    InitDocIndices(epoch_doc_indices, 1);
-  }
+// Everything the indices depend on, a cache whose header differs is stale.
+std::vector<int64_t> MegatronGPTMMapDataset::IndexCacheHeader() const {
+  int64_t magic = 0;
+  std::memcpy(&magic, kIndexCacheMagic, sizeof(magic));
+  std::vector<int64_t> header{magic,
+                              static_cast<int64_t>(index_->num_docs()),
+                              static_cast<int64_t>(tokens_per_epoch_),
+                              static_cast<int64_t>(seq_len_),
+                              static_cast<int64_t>(num_samples_),
+                              static_cast<int64_t>(seed_),
+                              static_cast<int64_t>(shuffle_),
+                              static_cast<int64_t>(num_epochs_),
+                              static_cast<int64_t>(num_complete_epochs_),
+                              static_cast<int64_t>(num_doc_indices_),
+                              static_cast<int64_t>(total_num_samples_)};
+  CHECK_EQ(header.size(), kIndexCacheHeaderLen);
+  return header;
+}
+
+size_t MegatronGPTMMapDataset::IndicesLen() const {
+  return kIndexCacheHeaderLen + num_doc_indices_ + 3 * total_num_samples_;
+}
+
+void MegatronGPTMMapDataset::BuildIndices(const std::vector<size_t>& epoch_doc_indices) {
+  auto start = std::chrono::system_clock::now();
+  indices_buffer_.resize(IndicesLen());
+  const std::vector<int64_t> header = IndexCacheHeader();
+  std::copy(header.cbegin(), header.cend(), indices_buffer_.begin());
+  int64_t* doc_indices = indices_buffer_.data() + kIndexCacheHeaderLen;
+  int64_t* sample_indices = doc_indices + num_doc_indices_;
+  int64_t* shuffle_indices = sample_indices + 2 * total_num_samples_;
+  InitDocIndices(epoch_doc_indices, doc_indices);
+  InitSampleIndices(doc_indices, sample_indices);
+  InitShuffleIndices(shuffle_indices);
+  SetIndices(indices_buffer_.data());
+  std::chrono::duration<double, std::milli> elapse = std::chrono::system_clock::now() - start;
+  VLOG(2) << "Build GPT Dataset indices successed, elapsed time: " << elapse.count() << " ms";
 }
 
 void MegatronGPTMMapDataset::InitDocIndices(const std::vector<size_t>& epoch_doc_indices,
-                                            size_t num_epochs) {
-  auto start = std::distance(doc_indices_.cbegin(), doc_indices_.cend());
-  FOR_RANGE(size_t, i, 0, num_epochs) {
-    doc_indices_.insert(doc_indices_.end(), epoch_doc_indices.cbegin(), epoch_doc_indices.cend());
+                                            int64_t* doc_indices) {
+  const size_t epoch_num_docs = epoch_doc_indices.size();
+  ParallelForRange(num_doc_indices_, [&](size_t begin, size_t end) {
+    FOR_RANGE(size_t, i, begin, end) { doc_indices[i] = epoch_doc_indices[i % epoch_num_docs]; }
+  });
+  if (shuffle_) {
+    // the complete epochs are shuffled together and the last one alone, with the same generator
+    // as the samples so that the order only depends on the seed
+    const size_t num_shuffled = epoch_num_docs * num_complete_epochs_;
+    std::shuffle(doc_indices, doc_indices + num_shuffled, gen_);
+    if (num_epochs_ != num_complete_epochs_) {
+      CHECK_EQ(num_complete_epochs_ + 1, num_epochs_);
+      std::shuffle(doc_indices + num_shuffled, doc_indices + num_doc_indices_, gen_);
+    }
   }
-  if (shuffle_) { std::shuffle(doc_indices_.begin() + start, doc_indices_.end(), gen_); }
 }
 
-void MegatronGPTMMapDataset::InitSampleIndices(size_t total_num_samples) {
-  sample_indices_.reserve(total_num_samples);
-  size_t doc_indices_idx = 0;
-  size_t doc_offset = 0;
-  FOR_RANGE(size_t, i, 0, total_num_samples) {
-    if (doc_indices_idx >= doc_indices_.size()) { break; }
-    sample_indices_.emplace_back(doc_indices_idx, doc_offset);
-    int remaining_tokens = seq_len_;
-    while (remaining_tokens > 0) {
-      CHECK_LT(doc_indices_idx, doc_indices_.size());
-      size_t doc_len = index_->doc_length(doc_indices_[doc_indices_idx]);
-      CHECK_LT(doc_offset, doc_len);
-      doc_len -= doc_offset;
-      if (remaining_tokens < doc_len) {
-        // move offset inside doc
-        doc_offset += remaining_tokens;
-      } else {
-        // move to next doc
-        doc_indices_idx += 1;
-        doc_offset = 0;
-      }
-      remaining_tokens -= doc_len;
+void MegatronGPTMMapDataset::InitSampleIndices(const int64_t* doc_indices,
+                                               int64_t* sample_indices) {
+  // Sample i starts at token i * seq_len of the docs in doc indices order, the last token of a
+  // sample is the first one of the next. The token offsets of the docs are a prefix sum, scanned
+  // by chunks in parallel, then every sample is located by a binary search.
+  std::vector<int64_t> doc_token_offsets(num_doc_indices_ + 1);
+  constexpr size_t kChunkSize = 1 << 16;
+  const size_t num_chunks = std::max<size_t>(1, (num_doc_indices_ + kChunkSize - 1) / kChunkSize);
+  BalancedSplitter bs(num_doc_indices_, num_chunks);
+  std::vector<int64_t> chunk_offsets(num_chunks + 1, 0);
+  MultiThreadLoop(num_chunks, [&](size_t chunk) {
+    int64_t num_tokens = 0;
+    FOR_RANGE(int64_t, i, bs.At(chunk).begin(), bs.At(chunk).end()) {
+      num_tokens += index_->doc_length(doc_indices[i]);
     }
-  }
-  CHECK_EQ(sample_indices_.size(), total_num_samples);
-  CHECK_GE(sample_indices_.size(), num_samples_);
+    chunk_offsets[chunk + 1] = num_tokens;
+  });
+  std::partial_sum(chunk_offsets.begin(), chunk_offsets.end(), chunk_offsets.begin());
+  MultiThreadLoop(num_chunks, [&](size_t chunk) {
+    int64_t offset = chunk_offsets[chunk];
+    FOR_RANGE(int64_t, i, bs.At(chunk).begin(), bs.At(chunk).end()) {
+      doc_token_offsets[i] = offset;
+      offset += index_->doc_length(doc_indices[i]);
+    }
+  });
+  doc_token_offsets[num_doc_indices_] = chunk_offsets[num_chunks];
+  CHECK_EQ(doc_token_offsets[num_doc_indices_], num_epochs_ * tokens_per_epoch_);
+  ParallelForRange(total_num_samples_, [&](size_t begin, size_t end) {
+    FOR_RANGE(size_t, i, begin, end) {
+      const int64_t token_offset = i * seq_len_;
+      // the last doc starting at or before the token, empty docs are skipped
+      const size_t doc_indices_idx =
+          std::upper_bound(doc_token_offsets.cbegin(), doc_token_offsets.cend(), token_offset)
+          - doc_token_offsets.cbegin() - 1;
+      CHECK_LT(doc_indices_idx, num_doc_indices_);
+      sample_indices[2 * i] = doc_indices_idx;
+      sample_indices[2 * i + 1] = token_offset - doc_token_offsets[doc_indices_idx];
+    }
+  });
 }
 
-void MegatronGPTMMapDataset::InitShuffleIndices(size_t total_num_samples) {
-  shuffle_indices_.resize(total_num_samples);
-  std::iota(shuffle_indices_.begin(), shuffle_indices_.end(), 0);
+void MegatronGPTMMapDataset::InitShuffleIndices(int64_t* shuffle_indices) {
+  ParallelForRange(total_num_samples_, [&](size_t begin, size_t end) {
+    std::iota(shuffle_indices + begin, shuffle_indices + end, static_cast<int64_t>(begin));
+  });
   if (shuffle_) {
     size_t num_samples = static_cast<size_t>(
         std::floor(static_cast<double>(num_complete_epochs_ * tokens_per_epoch_ - 1) / seq_len_));
-    CHECK_LE(num_samples, shuffle_indices_.size());
-    std::shuffle(shuffle_indices_.begin(), shuffle_indices_.begin() + num_samples, gen_);
+    CHECK_LE(num_samples, total_num_samples_);
+    std::shuffle(shuffle_indices, shuffle_indices + num_samples, gen_);
     if (num_complete_epochs_ != num_epochs_) {
-      std::shuffle(shuffle_indices_.begin() + num_samples, shuffle_indices_.end(), gen_);
+      std::shuffle(shuffle_indices + num_samples, shuffle_indices + total_num_samples_, gen_);
     }
   }
 }
 
+void MegatronGPTMMapDataset::LoadOrBuildIndices(const std::string& cache_path,
+                                                const std::vector<size_t>& epoch_doc_indices) {
+#ifdef __linux__
+  if (TryLoadIndexCache(cache_path)) { return; }
+  // the first process to take the lock builds the cache, the others wait and load it
+  const std::string lock_path = cache_path + ".lock";
+  int lock_fd = open(lock_path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (lock_fd == -1) {
+    LOG(WARNING) << "Can't create GPT Dataset index cache " << cache_path << ": "
+                 << strerror(errno) << ", the indices are built in memory";
+    BuildIndices(epoch_doc_indices);
+    return;
+  }
+  PCHECK(flock(lock_fd, LOCK_EX) == 0) << "flock " << lock_path << " failed";
+  if (!TryLoadIndexCache(cache_path)) {
+    BuildIndices(epoch_doc_indices);
+    // keep the built indices if they can't be stored, otherwise share the pages of the cache
+    if (StoreIndexCache(cache_path) && TryLoadIndexCache(cache_path)) {
+      std::vector<int64_t>().swap(indices_buffer_);
+    }
+  }
+  PCHECK(flock(lock_fd, LOCK_UN) == 0) << "flock " << lock_path << " failed";
+  close(lock_fd);
+#else
+  BuildIndices(epoch_doc_indices);
+#endif
+}
+
+bool MegatronGPTMMapDataset::TryLoadIndexCache(const std::string& cache_path) {
+#ifdef __linux__
+  struct stat s;
+  if (stat(cache_path.c_str(), &s) != 0) { return false; }
+  const std::vector<int64_t> header = IndexCacheHeader();
+  if (static_cast<size_t>(s.st_size) != IndicesLen() * sizeof(int64_t)) {
+    LOG(WARNING) << "GPT Dataset index cache " << cache_path << " is stale, rebuilding it";
+    return false;
+  }
+  auto index_cache = std::make_unique<const MappedBuffer>(cache_path);
+  if (std::memcmp(index_cache->ptr(), header.data(), header.size() * sizeof(int64_t)) != 0) {
+    LOG(WARNING) << "GPT Dataset index cache " << cache_path << " is stale, rebuilding it";
+    return false;
+  }
+  index_cache_ = std::move(index_cache);
+  index_cache_path_ = cache_path;
+  SetIndices(static_cast<const int64_t*>(index_cache_->ptr()));
+  VLOG(2) << "Load GPT Dataset index cache successed, file_path: " << cache_path;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool MegatronGPTMMapDataset::StoreIndexCache(const std::string& cache_path) const {
+  // NOTE: write to a temp file and rename, so concurrent readers never see a partial cache.
+  const std::string tmp_path = cache_path + ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream out_stream(tmp_path, std::ofstream::out | std::ofstream::binary);
+    out_stream.write(reinterpret_cast<const char*>(indices_buffer_.data()),
+                     indices_buffer_.size() * sizeof(int64_t));
+    if (!out_stream.good()) {
+      LOG(WARNING) << "Failed to write GPT Dataset index cache " << tmp_path;
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+    LOG(WARNING) << "Failed to rename " << tmp_path << " to " << cache_path << ": "
+                 << strerror(errno);
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void MegatronGPTMMapDataset::SetIndices(const int64_t* indices) {
+  doc_indices_ = indices + kIndexCacheHeaderLen;
+  sample_indices_ = doc_indices_ + num_doc_indices_;
+  shuffle_indices_ = sample_indices_ + 2 * total_num_samples_;
+}
+
 const HashMap<char, size_t> MegatronGPTMMapDataset::kDTypeCode2Size = {
     {1, 1},  // DataType::kUInt8
     {2, 1},  // DataType::kInt8
@@ -58,6 +58,14 @@ class MappedBuffer final {
   size_t size_;
 };
 
+// The doc, sample and shuffle indices of a dataset are built once and cached in a file next to
+// the data file (or in ONEFLOW_GPT_INDEX_CACHE_DIR) named after what they depend on, the ranks and
+// the later runs of the same config map the file instead of building them again. The file is
+// the little endian int64 array
+//   header, kIndexCacheHeaderLen of them, see IndexCacheHeader
+//   doc indices, the docs of the split repeated for each epoch and shuffled per epoch
+//   sample indices, (doc indices idx, token offset in the doc) at which each sample starts
+//   shuffle indices
 class MegatronGPTMMapDataset final {
  public:
   MegatronGPTMMapDataset(const std::string& data_file_prefix, size_t seq_len, size_t label_len,
@@ -66,18 +74,31 @@ class MegatronGPTMMapDataset final {
   OF_DISALLOW_COPY_AND_MOVE(MegatronGPTMMapDataset);
   ~MegatronGPTMMapDataset() = default;
 
+  static constexpr char kIndexCacheMagic[] = "OFGPTIX1";
+  static constexpr size_t kIndexCacheHeaderLen = 11;
+
   template<typename T>
   void GetSample(size_t index, T* data) const;
 
+  size_t total_num_samples() const { return total_num_samples_; }
+  // Empty if the indices aren't cached.
+  const std::string& index_cache_path() const { return index_cache_path_; }
+
  private:
   static const HashMap<char, size_t> kDTypeCode2Size;
 
   size_t GetEpochNumTokens(const std::vector<size_t>& doc_indices) const;
-  void InitDocIndices(const std::vector<size_t>& epoch_doc_indices, size_t num_epochs,
-                      size_t num_complete_epochs);
-  void InitDocIndices(const std::vector<size_t>& doc_indices, size_t num_epochs);
-  void InitSampleIndices(size_t total_num_samples);
-  void InitShuffleIndices(size_t total_num_samples);
+  std::vector<int64_t> IndexCacheHeader() const;
+  size_t IndicesLen() const;
+  void BuildIndices(const std::vector<size_t>& epoch_doc_indices);
+  void InitDocIndices(const std::vector<size_t>& epoch_doc_indices, int64_t* doc_indices);
+  void InitSampleIndices(const int64_t* doc_indices, int64_t* sample_indices);
+  void InitShuffleIndices(int64_t* shuffle_indices);
+  void LoadOrBuildIndices(const std::string& cache_path,
+                          const std::vector<size_t>& epoch_doc_indices);
+  bool TryLoadIndexCache(const std::string& cache_path);
+  bool StoreIndexCache(const std::string& cache_path) const;
+  void SetIndices(const int64_t* indices);
   template<typename T>
   void ReadTokens(const void* src, size_t offset, T* dst, size_t size) const;
 
@@ -96,21 +117,27 @@ class MegatronGPTMMapDataset final {
   size_t tokens_per_epoch_;
   size_t num_epochs_;
   size_t num_complete_epochs_;
-  std::vector<size_t> doc_indices_;
-  std::vector<std::pair<size_t, size_t>> sample_indices_;
-  std::vector<size_t> shuffle_indices_;
+  size_t num_doc_indices_;
+  size_t total_num_samples_;
+  // header and indices, built in memory or mapped from the cache
+  std::vector<int64_t> indices_buffer_;
+  std::unique_ptr<const MappedBuffer> index_cache_;
+  std::string index_cache_path_;
+  const int64_t* doc_indices_;
+  const int64_t* sample_indices_;
+  const int64_t* shuffle_indices_;
 };
 
 template<typename T>
 void MegatronGPTMMapDataset::GetSample(size_t index, T* data) const {
-  CHECK_LT(index, shuffle_indices_.size());
+  CHECK_LT(index, total_num_samples_);
   const size_t sample_index = shuffle_indices_[index];
-  CHECK_LT(sample_index, sample_indices_.size());
-  size_t doc_indices_idx = sample_indices_[sample_index].first;
-  size_t doc_offset = sample_indices_[sample_index].second;
+  CHECK_LT(sample_index, total_num_samples_);
+  size_t doc_indices_idx = sample_indices_[2 * sample_index];
+  size_t doc_offset = sample_indices_[2 * sample_index + 1];
   int remaining_tokens = sample_len_;
   while (remaining_tokens > 0) {
-    CHECK_LT(doc_indices_idx, doc_indices_.size());
+    CHECK_LT(doc_indices_idx, num_doc_indices_);
     const size_t doc_index = doc_indices_[doc_indices_idx];
     size_t offset = index_->address(doc_index) + doc_offset * dtype_size_;
     size_t num_tokens = index_->doc_length(doc_index);
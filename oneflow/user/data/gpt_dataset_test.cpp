@@ -0,0 +1,148 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/user/data/gpt_dataset.h"
+#include "oneflow/core/common/str_util.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+constexpr size_t kNumDocs = 200;
+// docs in the split 0 of kSplitSizes
+constexpr size_t kNumSplitDocs = 190;
+constexpr size_t kSeqLen = 32;
+constexpr size_t kNumSamples = 1000;
+const std::vector<int64_t> kSplitSizes{949, 50, 1};
+
+std::string CreateTempDirectory() {
+  const char* tmp_env = getenv("TMPDIR");
+  const char* tmp_dir = tmp_env == nullptr ? "/tmp" : tmp_env;
+  std::string tpl = std::string(tmp_dir) + "/test_gpt_XXXXXX";
+  char* path = mkdtemp(const_cast<char*>(tpl.c_str()));
+  PCHECK(path != nullptr);
+  return std::string(path);
+}
+
+// Writes a dataset of uint16 tokens, returns the tokens of each doc.
+std::vector<std::vector<uint16_t>> WriteDataset(const std::string& prefix) {
+  std::mt19937 gen(0);
+  std::vector<std::vector<uint16_t>> docs(kNumDocs);
+  std::vector<int32_t> sizes;
+  std::vector<int64_t> addresses;
+  std::vector<int64_t> doc_offsets{0};
+  std::ofstream bin(prefix + ".bin", std::ios::binary);
+  int64_t address = 0;
+  for (size_t i = 0; i < kNumDocs; ++i) {
+    docs[i].resize(1 + gen() % 50);
+    for (auto& token : docs[i]) { token = static_cast<uint16_t>(gen()); }
+    bin.write(reinterpret_cast<const char*>(docs[i].data()), docs[i].size() * sizeof(uint16_t));
+    sizes.emplace_back(docs[i].size());
+    addresses.emplace_back(address);
+    doc_offsets.emplace_back(i + 1);
+    address += docs[i].size() * sizeof(uint16_t);
+  }
+  std::ofstream idx(prefix + ".idx", std::ios::binary);
+  idx.write(MegatronGPTIndex::kMagicCode, MegatronGPTIndex::kMagicCodeLen);
+  const uint64_t version = 1;
+  idx.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  const char dtype_code = 8;
+  idx.write(&dtype_code, sizeof(dtype_code));
+  const uint64_t sizes_size = sizes.size();
+  const uint64_t doc_offsets_size = doc_offsets.size();
+  idx.write(reinterpret_cast<const char*>(&sizes_size), sizeof(sizes_size));
+  idx.write(reinterpret_cast<const char*>(&doc_offsets_size), sizeof(doc_offsets_size));
+  idx.write(reinterpret_cast<const char*>(sizes.data()), sizes.size() * sizeof(int32_t));
+  idx.write(reinterpret_cast<const char*>(addresses.data()), addresses.size() * sizeof(int64_t));
+  idx.write(reinterpret_cast<const char*>(doc_offsets.data()),
+            doc_offsets.size() * sizeof(int64_t));
+  return docs;
+}
+
+std::unique_ptr<MegatronGPTMMapDataset> NewDataset(const std::string& prefix, bool shuffle) {
+  return std::make_unique<MegatronGPTMMapDataset>(prefix, kSeqLen, 1, kNumSamples, kSplitSizes, 0,
+                                                  shuffle, 1234);
+}
+
+std::vector<int64_t> GetSamples(const MegatronGPTMMapDataset& dataset) {
+  std::vector<int64_t> samples(dataset.total_num_samples() * (kSeqLen + 1));
+  for (size_t i = 0; i < dataset.total_num_samples(); ++i) {
+    dataset.GetSample(i, samples.data() + i * (kSeqLen + 1));
+  }
+  return samples;
+}
+
+}  // namespace
+
+TEST(MegatronGPTMMapDataset, samples) {
+  const std::string dir = CreateTempDirectory();
+  const std::string prefix = JoinPath(dir, "dataset");
+  const auto docs = WriteDataset(prefix);
+  setenv("ONEFLOW_GPT_INDEX_CACHE", "1", 1);
+  setenv("ONEFLOW_GPT_INDEX_CACHE_DIR", dir.c_str(), 1);
+  const auto dataset = NewDataset(prefix, /*shuffle=*/false);
+  // the docs of the split repeated in order, sample i starts at token i * seq_len
+  std::vector<int64_t> tokens;
+  while (tokens.size() < (kNumSamples + 1) * kSeqLen) {
+    for (size_t i = 0; i < kNumSplitDocs; ++i) {
+      tokens.insert(tokens.end(), docs[i].begin(), docs[i].end());
+    }
+  }
+  ASSERT_GE(dataset->total_num_samples(), kNumSamples);
+  const std::vector<int64_t> samples = GetSamples(*dataset);
+  for (size_t i = 0; i < kNumSamples; ++i) {
+    ASSERT_TRUE(std::equal(tokens.begin() + i * kSeqLen, tokens.begin() + (i + 1) * kSeqLen + 1,
+                           samples.begin() + i * (kSeqLen + 1)));
+  }
+  ASSERT_FALSE(dataset->index_cache_path().empty());
+}
+
+TEST(MegatronGPTMMapDataset, index_cache) {
+  const std::string dir = CreateTempDirectory();
+  const std::string prefix = JoinPath(dir, "dataset");
+  WriteDataset(prefix);
+  setenv("ONEFLOW_GPT_INDEX_CACHE_DIR", dir.c_str(), 1);
+  setenv("ONEFLOW_GPT_INDEX_CACHE", "0", 1);
+  const auto in_memory = NewDataset(prefix, /*shuffle=*/true);
+  ASSERT_TRUE(in_memory->index_cache_path().empty());
+  const std::vector<int64_t> expected = GetSamples(*in_memory);
+
+  setenv("ONEFLOW_GPT_INDEX_CACHE", "1", 1);
+  // built and stored, then mapped
+  const auto built = NewDataset(prefix, /*shuffle=*/true);
+  const std::string cache_path = built->index_cache_path();
+  ASSERT_FALSE(cache_path.empty());
+  ASSERT_EQ(GetSamples(*built), expected);
+  const auto loaded = NewDataset(prefix, /*shuffle=*/true);
+  ASSERT_EQ(loaded->index_cache_path(), cache_path);
+  ASSERT_EQ(GetSamples(*loaded), expected);
+
+  // a stale cache is rebuilt
+  {
+    std::fstream cache(cache_path, std::ios::binary | std::ios::in | std::ios::out);
+    const int64_t num_docs = kNumDocs + 1;
+    cache.seekp(sizeof(int64_t));
+    cache.write(reinterpret_cast<const char*>(&num_docs), sizeof(num_docs));
+  }
+  const auto rebuilt = NewDataset(prefix, /*shuffle=*/true);
+  ASSERT_EQ(GetSamples(*rebuilt), expected);
+  unsetenv("ONEFLOW_GPT_INDEX_CACHE");
+  unsetenv("ONEFLOW_GPT_INDEX_CACHE_DIR");
+}
+
+}  // namespace data
+}  // namespace oneflow
@@ -0,0 +1,110 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_INDEXED_RECORD_DATASET_H_
+#define ONEFLOW_USER_DATA_INDEXED_RECORD_DATASET_H_
+
+#include "oneflow/user/data/dataset.h"
+#include "oneflow/user/data/record_index.h"
+
+namespace oneflow {
+namespace data {
+
+// Reads records by position through the record index of every data part.
+//
+// The records of all parts form one global sequence which is split by record, not by file, so
+// every rank reads ceil(N / parallel_num) samples per epoch; the tail of the last shard wraps
+// around to the head of the sequence. With `shuffle`, epoch e reads the sequence through a
+// permutation keyed by (seed, e), which is the same on every rank, so the epoch is an exact
+// permutation of the whole dataset instead of a shuffle within a buffer. `start_cursor` is the
+// number of samples this rank has consumed before, reading resumes right after them.
+class IndexedRecordDataset final : public Dataset<TensorBuffer> {
+ public:
+  using Base = Dataset<TensorBuffer>;
+  using SampleType = typename Base::SampleType;
+  using BatchType = typename Base::BatchType;
+
+  OF_DISALLOW_COPY_AND_MOVE(IndexedRecordDataset);
+
+  IndexedRecordDataset(const std::vector<std::string>& data_file_paths, RecordFormat format,
+                       int64_t parallel_id, int64_t parallel_num, bool shuffle, int64_t seed,
+                       int64_t start_cursor)
+      : data_file_paths_(data_file_paths),
+        parallel_id_(parallel_id),
+        shuffle_(shuffle),
+        seed_(seed == -1 ? kOneflowDatasetSeed : seed),
+        cursor_(start_cursor),
+        epoch_(-1) {
+    CHECK_GE(start_cursor, 0);
+    CHECK_GE(parallel_id, 0);
+    CHECK_LT(parallel_id, parallel_num);
+    record_num_prefix_sum_.emplace_back(0);
+    for (const auto& path : data_file_paths_) {
+      indexes_.emplace_back(RecordIndex::LoadOrBuild(DataFS(), path, format));
+      record_num_prefix_sum_.emplace_back(record_num_prefix_sum_.back()
+                                          + indexes_.back().record_num());
+    }
+    files_.resize(data_file_paths_.size());
+    const int64_t record_num = record_num_prefix_sum_.back();
+    CHECK_GT(record_num, 0) << "no record found in the data parts";
+    shard_size_ = RoundUp(record_num, parallel_num) / parallel_num;
+  }
+  ~IndexedRecordDataset() = default;
+
+  BatchType Next() override {
+    const int64_t epoch = cursor_ / shard_size_;
+    if (epoch != epoch_) { ResetEpoch(epoch); }
+    const int64_t record_num = record_num_prefix_sum_.back();
+    int64_t global_index = (parallel_id_ * shard_size_ + cursor_ % shard_size_) % record_num;
+    if (permutation_) { global_index = permutation_->At(global_index); }
+    const int64_t part = std::upper_bound(record_num_prefix_sum_.begin(),
+                                          record_num_prefix_sum_.end(), global_index)
+                         - record_num_prefix_sum_.begin() - 1;
+    auto& file = files_.at(part);
+    if (!file) { DataFS()->NewRandomAccessFile(data_file_paths_.at(part), &file); }
+    BatchType batch;
+    batch.push_back(TensorBuffer());
+    ReadRecord(*file, indexes_.at(part), global_index - record_num_prefix_sum_.at(part),
+               &batch.back());
+    cursor_ += 1;
+    return batch;
+  }
+
+ private:
+  void ResetEpoch(int64_t epoch) {
+    epoch_ = epoch;
+    if (shuffle_) {
+      const uint64_t key = static_cast<uint64_t>(seed_) * 0x9E3779B97F4A7C15ull + epoch;
+      permutation_.reset(new IndexPermutation(record_num_prefix_sum_.back(), key));
+    }
+  }
+
+  std::vector<std::string> data_file_paths_;
+  std::vector<RecordIndex> indexes_;
+  std::vector<int64_t> record_num_prefix_sum_;
+  std::vector<std::unique_ptr<fs::RandomAccessFile>> files_;
+  int64_t parallel_id_;
+  int64_t shard_size_;
+  bool shuffle_;
+  int64_t seed_;
+  int64_t cursor_;
+  int64_t epoch_;
+  std::unique_ptr<IndexPermutation> permutation_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_INDEXED_RECORD_DATASET_H_
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/user/data/data_reader.h"
 #include "oneflow/user/data/ofrecord_dataset.h"
+#include "oneflow/user/data/indexed_record_dataset.h"
 #include "oneflow/user/data/ofrecord_parser.h"
 #include "oneflow/user/data/random_shuffle_dataset.h"
 #include "oneflow/user/data/batch_dataset.h"
@@ -30,8 +31,18 @@ class OFRecordDataReader final : public DataReader<TensorBuffer> {
   OFRecordDataReader(user_op::KernelInitContext* ctx) : DataReader<TensorBuffer>(ctx) {
     batch_size_ = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape().elem_cnt();
     if (auto* pool = TensorBufferPool::TryGet()) { pool->IncreasePoolSizeByBase(batch_size_); }
-    loader_.reset(new OFRecordDataset(ctx));
-    if (ctx->Attr<bool>("random_shuffle")) {
+    if (ctx->Attr<bool>("use_record_index")) {
+      int32_t parallel_id = 0;
+      int32_t parallel_num = 1;
+      OFRecordDataset::InitParallelInfo(ctx, &parallel_id, &parallel_num);
+      loader_.reset(new IndexedRecordDataset(
+          OFRecordDataset::DataFilePaths(ctx), RecordFormat::kOFRecord, parallel_id, parallel_num,
+          ctx->Attr<bool>("random_shuffle"), ctx->Attr<int64_t>("seed"),
+          ctx->Attr<int64_t>("start_cursor")));
+    } else {
+      loader_.reset(new OFRecordDataset(ctx));
+    }
+    if (ctx->Attr<bool>("random_shuffle") && !ctx->Attr<bool>("use_record_index")) {
       loader_.reset(new RandomShuffleDataset<TensorBuffer>(ctx, std::move(loader_)));
     }
     loader_.reset(new BatchDataset<TensorBuffer>(batch_size_, std::move(loader_)));
@@ -40,20 +40,36 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
     current_epoch_ = 0;
     shuffle_after_epoch_ = ctx->Attr<bool>("shuffle_after_epoch");
 
-    // in stream
     data_part_num_ = ctx->Attr<int32_t>("data_part_num");
-    std::string data_dir = ctx->Attr<std::string>("data_dir");
-    std::string part_name_prefix = ctx->Attr<std::string>("part_name_prefix");
-    int32_t part_name_suffix_length = ctx->Attr<int32_t>("part_name_suffix_length");
+    data_file_paths_ = DataFilePaths(ctx);
+    InitParallelInfo(ctx, &parallel_id_, &parallel_num_);
+    CHECK_LE(parallel_num_, data_part_num_);
+    BalancedSplitter bs(data_part_num_, parallel_num_);
+    range_ = bs.At(parallel_id_);
+    std::vector<std::string> local_file_paths = GetLocalFilePaths();
+    in_stream_.reset(
+        new PersistentInStream(DataFS(), local_file_paths, !shuffle_after_epoch_, false));
+  }
+  ~OFRecordDataset() = default;
 
-    for (int i = 0; i < data_part_num_; ++i) {
+  static std::vector<std::string> DataFilePaths(user_op::KernelInitContext* ctx) {
+    const int32_t data_part_num = ctx->Attr<int32_t>("data_part_num");
+    const std::string data_dir = ctx->Attr<std::string>("data_dir");
+    const std::string part_name_prefix = ctx->Attr<std::string>("part_name_prefix");
+    const int32_t part_name_suffix_length = ctx->Attr<int32_t>("part_name_suffix_length");
+    std::vector<std::string> data_file_paths;
+    for (int i = 0; i < data_part_num; ++i) {
       std::string num = std::to_string(i);
       int32_t zero_count =
           std::max(part_name_suffix_length - static_cast<int32_t>(num.length()), 0);
-      data_file_paths_.emplace_back(
+      data_file_paths.emplace_back(
           JoinPath(data_dir, part_name_prefix + std::string(zero_count, '0') + num));
     }
+    return data_file_paths;
+  }
 
+  static void InitParallelInfo(user_op::KernelInitContext* ctx, int32_t* parallel_id,
+                               int32_t* parallel_num) {
     bool is_local = false;
     // NOTE(zwx): OFRecordDataset is used by OFRecordDataReader and
     // OFRecordImageClassificationDataReader both, the latter has no attr nd_sbp,
@@ -67,20 +83,13 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
       if (nd_sbp_str_vec.empty()) { is_local = true; }
     }
     if (is_local) {
-      parallel_id_ = GlobalProcessCtx::Rank();
-      parallel_num_ = GlobalProcessCtx::WorldSize();
+      *parallel_id = GlobalProcessCtx::Rank();
+      *parallel_num = GlobalProcessCtx::WorldSize();
     } else {
-      parallel_id_ = ctx->parallel_ctx().parallel_id();
-      parallel_num_ = ctx->parallel_ctx().parallel_num();
+      *parallel_id = ctx->parallel_ctx().parallel_id();
+      *parallel_num = ctx->parallel_ctx().parallel_num();
     }
-    CHECK_LE(parallel_num_, data_part_num_);
-    BalancedSplitter bs(data_part_num_, parallel_num_);
-    range_ = bs.At(parallel_id_);
-    std::vector<std::string> local_file_paths = GetLocalFilePaths();
-    in_stream_.reset(
-        new PersistentInStream(DataFS(), local_file_paths, !shuffle_after_epoch_, false));
   }
-  ~OFRecordDataset() = default;
 
   BatchType Next() override {
     BatchType batch;
@@ -18,26 +18,35 @@ limitations under the License.
 #include "oneflow/user/image/image_util.h"
 #include "oneflow/core/job/resource_desc.h"
 #include "oneflow/core/job/global_for.h"
+#include "oneflow/user/data/ofrecord_view.h"
+#include "oneflow/core/common/env_var/env_var.h"
 
 #include <opencv2/opencv.hpp>
 
 namespace oneflow {
 
+// 0 keeps the initial split of the threads between the stages
+DEFINE_ENV_INTEGER(ONEFLOW_DATA_PIPELINE_AUTOTUNE_INTERVAL_MS, 100);
+
 namespace data {
 
 namespace {
 
 using DS = OFRecordImageClassificationDataset;
 
-void DecodeImageFromOFRecord(const OFRecord& record, const std::string& feature_name,
+// The serialized record and the features the decode stage needs, scanned by the parse stage.
+struct ParsedOFRecord {
+  TensorBuffer serialized;
+  OFRecordView view;
+};
+
+void DecodeImageFromOFRecord(const OFRecordView& record, const std::string& feature_name,
                              const std::string& color_space, TensorBuffer* out) {
-  auto image_feature_it = record.feature().find(feature_name);
-  CHECK(image_feature_it != record.feature().end());
-  const Feature& image_feature = image_feature_it->second;
+  const OFRecordFeatureView& image_feature = record.Get(feature_name);
   CHECK(image_feature.has_bytes_list());
-  CHECK(image_feature.bytes_list().value_size() == 1);
-  const std::string& src_data = image_feature.bytes_list().value(0);
-  cv::Mat image = cv::imdecode(cv::Mat(1, src_data.size(), CV_8UC1, (void*)(src_data.data())),
+  CHECK(image_feature.value_size() == 1);
+  cv::Mat image = cv::imdecode(cv::Mat(1, image_feature.bytes_size(0), CV_8UC1,
+                                       const_cast<char*>(image_feature.bytes_data(0))),
                                cv::IMREAD_COLOR);
   int W = image.cols;
   int H = image.rows;
@@ -57,62 +66,18 @@ void DecodeImageFromOFRecord(const OFRecord& record, const std::string& feature_
   memcpy(out->mut_data<uint8_t>(), image.ptr(), image_shape.elem_cnt());
 }
 
-void DecodeLabelFromFromOFRecord(const OFRecord& record, const std::string& feature_name,
+void DecodeLabelFromFromOFRecord(const OFRecordView& record, const std::string& feature_name,
                                  TensorBuffer* out) {
-  auto label_feature_it = record.feature().find(feature_name);
-  CHECK(label_feature_it != record.feature().end());
-  const Feature& label_feature = label_feature_it->second;
+  const OFRecordFeatureView& label_feature = record.Get(feature_name);
   out->Resize(Shape({1}), DataType::kInt32);
-  if (label_feature.has_int32_list()) {
-    CHECK_EQ(label_feature.int32_list().value_size(), 1);
-    *out->mut_data<int32_t>() = label_feature.int32_list().value(0);
-  } else if (label_feature.has_int64_list()) {
-    CHECK_EQ(label_feature.int64_list().value_size(), 1);
-    *out->mut_data<int32_t>() = label_feature.int64_list().value(0);
+  if (label_feature.has_int32_list() || label_feature.has_int64_list()) {
+    CHECK_EQ(label_feature.value_size(), 1);
+    label_feature.CopyValues(1, out->mut_data<int32_t>());
   } else {
     UNIMPLEMENTED();
   }
 }
 
-void LoadWorker(Dataset<TensorBuffer>* record_dataset,
-                std::vector<std::unique_ptr<Buffer<TensorBuffer>>>* decode_in_buffers) {
-  int64_t thread_idx = 0;
-  bool shutdown = false;
-  while (!shutdown) {
-    auto records = record_dataset->Next();
-    for (auto& record : records) {
-      auto& current_in_buffer = decode_in_buffers->at(thread_idx++);
-      if (thread_idx >= decode_in_buffers->size()) { thread_idx = 0; }
-      auto status = current_in_buffer->Push(std::move(record));
-      if (status == kBufferStatusErrorClosed) {
-        shutdown = true;
-        break;
-      }
-      CHECK(status == kBufferStatusSuccess);
-    }
-  }
-}
-
-void DecodeWorker(const std::string& image_feature_name, const std::string& label_feature_name,
-                  const std::string& color_space, Buffer<TensorBuffer>* in_buffer,
-                  Buffer<ImageClassificationDataInstance>* out_buffer) {
-  while (true) {
-    TensorBuffer serialized_record;
-    auto receive_status = in_buffer->Pull(&serialized_record);
-    if (receive_status == kBufferStatusErrorClosed) { break; }
-    CHECK(receive_status == kBufferStatusSuccess);
-    OFRecord record;
-    CHECK(record.ParseFromArray(serialized_record.data<char>(),
-                                serialized_record.shape_view().elem_cnt()));
-    ImageClassificationDataInstance instance;
-    DecodeImageFromOFRecord(record, image_feature_name, color_space, &instance.image);
-    DecodeLabelFromFromOFRecord(record, label_feature_name, &instance.label);
-    auto send_status = out_buffer->Push(std::move(instance));
-    if (send_status == kBufferStatusErrorClosed) { break; }
-    CHECK(send_status == kBufferStatusSuccess);
-  }
-}
-
 int32_t GetNumLocalDecodeThreads(int32_t num_decode_threads_per_machine,
                                  const ParallelDesc& parallel_desc,
                                  const ParallelContext& parallel_ctx) {
@@ -128,8 +93,7 @@ int32_t GetNumLocalDecodeThreads(int32_t num_decode_threads_per_machine,
 }  // namespace
 
 OFRecordImageClassificationDataset::OFRecordImageClassificationDataset(
-    user_op::KernelInitContext* ctx, std::unique_ptr<NestedDS>&& dataset)
-    : nested_ds_(std::move(dataset)), out_thread_idx_(0) {
+    user_op::KernelInitContext* ctx, std::unique_ptr<NestedDS>&& dataset) {
   const std::string& color_space = ctx->Attr<std::string>("color_space");
   const std::string& image_feature_name = ctx->Attr<std::string>("image_feature_name");
   const std::string& label_feature_name = ctx->Attr<std::string>("label_feature_name");
@@ -137,24 +101,42 @@ OFRecordImageClassificationDataset::OFRecordImageClassificationDataset(
   auto decode_buffer_size_per_thread = ctx->Attr<int32_t>("decode_buffer_size_per_thread");
   auto num_local_decode_threads = GetNumLocalDecodeThreads(
       num_decode_threads_per_machine, ctx->parallel_desc(), ctx->parallel_ctx());
-  decode_in_buffers_.reserve(num_local_decode_threads);
-  decode_out_buffers_.reserve(num_local_decode_threads);
-  for (int64_t i = 0; i < num_local_decode_threads; ++i) {
-    decode_in_buffers_.emplace_back(
-        std::make_unique<Buffer<NestedSampleType>>(decode_buffer_size_per_thread));
-    decode_out_buffers_.emplace_back(
-        std::make_unique<Buffer<SampleType>>(decode_buffer_size_per_thread));
-    decode_threads_.emplace_back(DecodeWorker, image_feature_name, label_feature_name, color_space,
-                                 decode_in_buffers_.back().get(), decode_out_buffers_.back().get());
-  }
-  load_thread_ = std::thread(LoadWorker, nested_ds_.get(), &decode_in_buffers_);
+  const int64_t capacity = decode_buffer_size_per_thread * num_local_decode_threads;
+  // Parsing is cheap next to decoding, both stages start from that split and may grow to all the
+  // threads, the controller keeps the sum within the thread budget.
+  const int64_t thread_budget = std::max<int64_t>(num_local_decode_threads, 2);
+  const int64_t parse_worker_num = std::max<int64_t>(thread_budget / 8, 1);
+  const std::vector<std::string> feature_names{image_feature_name, label_feature_name};
+  auto* parse_ds = new ParallelMapDataset<TensorBuffer, ParsedOFRecord>(
+      "parse", std::move(dataset),
+      [feature_names](TensorBuffer&& serialized_record) {
+        ParsedOFRecord record;
+        record.serialized = std::move(serialized_record);
+        // the view points into the buffer of `serialized`, which moves along with the record
+        record.view.Reset(record.serialized.data<char>(),
+                          record.serialized.shape_view().elem_cnt(), feature_names);
+        return record;
+      },
+      parse_worker_num, thread_budget - 1, capacity);
+  auto* decode_ds = new ParallelMapDataset<ParsedOFRecord, SampleType>(
+      "decode", std::unique_ptr<Dataset<ParsedOFRecord>>(parse_ds),
+      [image_feature_name, label_feature_name, color_space](ParsedOFRecord&& record) {
+        ImageClassificationDataInstance instance;
+        DecodeImageFromOFRecord(record.view, image_feature_name, color_space, &instance.image);
+        DecodeLabelFromFromOFRecord(record.view, label_feature_name, &instance.label);
+        return instance;
+      },
+      thread_budget - parse_worker_num, thread_budget - 1, capacity);
+  decode_ds_.reset(decode_ds);
+  const int64_t autotune_interval_ms = EnvInteger<ONEFLOW_DATA_PIPELINE_AUTOTUNE_INTERVAL_MS>();
+  controller_.reset(
+      new PipelineController({parse_ds, decode_ds}, thread_budget, autotune_interval_ms));
 }
 
 OFRecordImageClassificationDataset::~OFRecordImageClassificationDataset() {
-  for (auto& out_buffer : decode_out_buffers_) { out_buffer->Close(); }
-  for (auto& in_buffer : decode_in_buffers_) { in_buffer->Close(); }
-  load_thread_.join();
-  for (auto& decode_thread : decode_threads_) { decode_thread.join(); }
+  // the controller holds raw pointers to the stages
+  controller_.reset();
+  decode_ds_.reset();
 }
 
 }  // namespace data
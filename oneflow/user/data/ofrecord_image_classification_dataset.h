@@ -17,7 +17,7 @@ limitations under the License.
 #define ONEFLOW_USER_DATA_OFRECORD_IMAGE_CLASSIFICATION_DATASET_H_
 
 #include "oneflow/user/data/dataset.h"
-#include "oneflow/core/common/buffer.h"
+#include "oneflow/user/data/staged_pipeline.h"
 #include "oneflow/core/framework/op_kernel.h"
 
 namespace oneflow {
@@ -43,26 +43,12 @@ class OFRecordImageClassificationDataset final : public Dataset<ImageClassificat
                                      std::unique_ptr<NestedDS>&& dataset);
   ~OFRecordImageClassificationDataset() override;
 
-  BatchType Next() override {
-    size_t thread_idx =
-        out_thread_idx_.fetch_add(1, std::memory_order_relaxed) % decode_out_buffers_.size();
-    CHECK_LT(thread_idx, decode_out_buffers_.size());
-
-    BatchType batch;
-    SampleType sample;
-    auto status = decode_out_buffers_[thread_idx]->Pull(&sample);
-    CHECK_EQ(status, kBufferStatusSuccess);
-    batch.push_back(std::move(sample));
-    return batch;
-  }
+  BatchType Next() override { return decode_ds_->Next(); }
 
  private:
-  std::unique_ptr<NestedDS> nested_ds_;
-  std::thread load_thread_;
-  std::vector<std::thread> decode_threads_;
-  std::vector<std::unique_ptr<Buffer<NestedSampleType>>> decode_in_buffers_;
-  std::vector<std::unique_ptr<Buffer<SampleType>>> decode_out_buffers_;
-  std::atomic<size_t> out_thread_idx_;
+  // read -> parse -> decode, the controller moves the decode threads between parse and decode
+  std::unique_ptr<Dataset<SampleType>> decode_ds_;
+  std::unique_ptr<PipelineController> controller_;
 };
 
 }  // namespace data
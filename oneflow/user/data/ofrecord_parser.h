@@ -17,6 +17,7 @@ limitations under the License.
 #define ONEFLOW_USER_DATA_OFRECORD_PARSER_H_
 
 #include "oneflow/user/data/parser.h"
+#include "oneflow/user/data/ofrecord_view.h"
 #include "oneflow/core/common/tensor_buffer.h"
 #include "oneflow/core/record/record.pb.h"
 #include "oneflow/core/thread/thread_manager.h"
@@ -36,9 +37,15 @@ class OFRecordParser final : public Parser<TensorBuffer> {
   void Parse(BatchType& batch_data, user_op::KernelComputeContext* ctx) override {
     user_op::Tensor* out_tensor = ctx->Tensor4ArgNameAndIndex("out", 0);
     OFRecord* dptr = out_tensor->mut_dptr<OFRecord>();
+    // the decoders scan the serialized records for the few features they need
+    const bool lazy_parse = EnvBool<ONEFLOW_OFRECORD_LAZY_PARSE>();
     MultiThreadLoop(batch_data.size(), [&](size_t i) {
       auto& sample = batch_data[i];
-      CHECK(dptr[i].ParseFromArray(sample.data(), sample.nbytes()));
+      if (lazy_parse) {
+        SetSerializedOFRecord(sample.data<char>(), sample.nbytes(), &dptr[i]);
+      } else {
+        CHECK(dptr[i].ParseFromArray(sample.data(), sample.nbytes()));
+      }
     });
     if (batch_data.size() != out_tensor->shape_view().elem_cnt()) {
       CHECK_EQ(out_tensor->mut_shape_view().NumAxes(), 1);
@@ -0,0 +1,313 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/ofrecord_view.h"
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/unknown_field_set.h>
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+// the serialized record is kept as an unknown field of the OFRecord, out of the range of its
+// schema
+constexpr int kSerializedOFRecordFieldNumber = (1 << 29) - 1;
+
+constexpr uint32_t kWireTypeVarint = 0;
+constexpr uint32_t kWireTypeFixed64 = 1;
+constexpr uint32_t kWireTypeLengthDelimited = 2;
+constexpr uint32_t kWireTypeFixed32 = 5;
+
+// field numbers of OFRecord, its map entries and the lists of Feature
+constexpr uint32_t kOFRecordFeatureField = 1;
+constexpr uint32_t kMapEntryKeyField = 1;
+constexpr uint32_t kMapEntryValueField = 2;
+constexpr uint32_t kListValueField = 1;
+
+using Span = std::pair<const char*, size_t>;
+
+class WireReader final {
+ public:
+  WireReader(const char* data, size_t size) : ptr_(data), end_(data + size) {}
+
+  bool Done() const { return ptr_ == end_; }
+
+  void ReadTag(uint32_t* field, uint32_t* wire_type) {
+    const uint64_t tag = ReadVarint();
+    *field = static_cast<uint32_t>(tag >> 3);
+    *wire_type = static_cast<uint32_t>(tag & 7);
+  }
+
+  uint64_t ReadVarint() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      CHECK(ptr_ < end_) << "Malformed OFRecord: truncated varint";
+      const uint8_t byte = static_cast<uint8_t>(*ptr_++);
+      v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) { return v; }
+    }
+    LOG(FATAL) << "Malformed OFRecord: varint too long";
+    return 0;
+  }
+
+  Span ReadLengthDelimited() {
+    const uint64_t size = ReadVarint();
+    CHECK_LE(size, static_cast<uint64_t>(end_ - ptr_)) << "Malformed OFRecord: truncated field";
+    Span span(ptr_, size);
+    ptr_ += size;
+    return span;
+  }
+
+  void Skip(uint32_t wire_type) {
+    if (wire_type == kWireTypeVarint) {
+      ReadVarint();
+    } else if (wire_type == kWireTypeLengthDelimited) {
+      ReadLengthDelimited();
+    } else if (wire_type == kWireTypeFixed64 || wire_type == kWireTypeFixed32) {
+      const size_t size = wire_type == kWireTypeFixed64 ? 8 : 4;
+      CHECK_LE(size, static_cast<size_t>(end_ - ptr_)) << "Malformed OFRecord: truncated field";
+      ptr_ += size;
+    } else {
+      LOG(FATAL) << "Malformed OFRecord: unsupported wire type " << wire_type;
+    }
+  }
+
+ private:
+  const char* ptr_;
+  const char* end_;
+};
+
+bool IsNumericList(Feature::KindCase kind) {
+  return kind == Feature::kFloatList || kind == Feature::kDoubleList
+         || kind == Feature::kInt32List || kind == Feature::kInt64List;
+}
+
+}  // namespace
+
+void SetSerializedOFRecord(const char* data, size_t size, OFRecord* record) {
+  if (!record->feature().empty()) { record->clear_feature(); }
+  google::protobuf::UnknownFieldSet* unknown_fields = record->mutable_unknown_fields();
+  if (unknown_fields->field_count() == 1
+      && unknown_fields->field(0).number() == kSerializedOFRecordFieldNumber
+      && unknown_fields->field(0).type() == google::protobuf::UnknownField::TYPE_LENGTH_DELIMITED) {
+    unknown_fields->mutable_field(0)->mutable_length_delimited()->assign(data, size);
+  } else {
+    unknown_fields->Clear();
+    unknown_fields->AddLengthDelimited(kSerializedOFRecordFieldNumber)->assign(data, size);
+  }
+}
+
+bool GetSerializedOFRecord(const OFRecord& record, const char** data, size_t* size) {
+  const google::protobuf::UnknownFieldSet& unknown_fields = record.unknown_fields();
+  if (unknown_fields.field_count() != 1) { return false; }
+  const google::protobuf::UnknownField& field = unknown_fields.field(0);
+  if (field.number() != kSerializedOFRecordFieldNumber
+      || field.type() != google::protobuf::UnknownField::TYPE_LENGTH_DELIMITED) {
+    return false;
+  }
+  *data = field.length_delimited().data();
+  *size = field.length_delimited().size();
+  return true;
+}
+
+int64_t OFRecordFeatureView::value_size() const {
+  if (feature_ == nullptr) { return value_size_; }
+  switch (feature_->kind_case()) {
+    case Feature::kBytesList: return feature_->bytes_list().value_size();
+    case Feature::kFloatList: return feature_->float_list().value_size();
+    case Feature::kDoubleList: return feature_->double_list().value_size();
+    case Feature::kInt32List: return feature_->int32_list().value_size();
+    case Feature::kInt64List: return feature_->int64_list().value_size();
+    default: return 0;
+  }
+}
+
+const char* OFRecordFeatureView::bytes_data(int64_t i) const {
+  CHECK(has_bytes_list());
+  if (feature_ != nullptr) { return feature_->bytes_list().value(i).data(); }
+  return spans_.at(i).first;
+}
+
+size_t OFRecordFeatureView::bytes_size(int64_t i) const {
+  CHECK(has_bytes_list());
+  if (feature_ != nullptr) { return feature_->bytes_list().value(i).size(); }
+  return spans_.at(i).second;
+}
+
+void OFRecordView::Reset(const OFRecord& record, const std::vector<std::string>& names) {
+  const char* data = nullptr;
+  size_t size = 0;
+  if (GetSerializedOFRecord(record, &data, &size)) {
+    Reset(data, size, names);
+    return;
+  }
+  names_ = names;
+  features_.assign(names_.size(), OFRecordFeatureView());
+  found_.assign(names_.size(), false);
+  for (size_t i = 0; i < names_.size(); ++i) {
+    auto it = record.feature().find(names_.at(i));
+    if (it == record.feature().end()) { continue; }
+    features_.at(i).feature_ = &it->second;
+    found_.at(i) = true;
+  }
+}
+
+void OFRecordView::Reset(const char* data, size_t size, const std::vector<std::string>& names) {
+  names_ = names;
+  features_.assign(names_.size(), OFRecordFeatureView());
+  found_.assign(names_.size(), false);
+  if (arena_) { arena_->Reset(); }
+  ScanRecord(data, size);
+}
+
+const OFRecordFeatureView* OFRecordView::Find(const std::string& name) const {
+  auto it = std::find(names_.cbegin(), names_.cend(), name);
+  CHECK(it != names_.cend()) << "Field " << name << " is not indexed by the view";
+  const size_t i = it - names_.cbegin();
+  return found_.at(i) ? &features_.at(i) : nullptr;
+}
+
+const OFRecordFeatureView& OFRecordView::Get(const std::string& name) const {
+  const OFRecordFeatureView* feature = Find(name);
+  CHECK(feature != nullptr) << "Field " << name << " not found";
+  return *feature;
+}
+
+void OFRecordView::ScanRecord(const char* data, size_t size) {
+  WireReader record_reader(data, size);
+  std::vector<Span> value_chunks;
+  while (!record_reader.Done()) {
+    uint32_t field = 0;
+    uint32_t wire_type = 0;
+    record_reader.ReadTag(&field, &wire_type);
+    if (field != kOFRecordFeatureField || wire_type != kWireTypeLengthDelimited) {
+      record_reader.Skip(wire_type);
+      continue;
+    }
+    const Span entry = record_reader.ReadLengthDelimited();
+    WireReader entry_reader(entry.first, entry.second);
+    Span key(nullptr, 0);
+    value_chunks.clear();
+    while (!entry_reader.Done()) {
+      entry_reader.ReadTag(&field, &wire_type);
+      if (field == kMapEntryKeyField && wire_type == kWireTypeLengthDelimited) {
+        key = entry_reader.ReadLengthDelimited();
+      } else if (field == kMapEntryValueField && wire_type == kWireTypeLengthDelimited) {
+        value_chunks.emplace_back(entry_reader.ReadLengthDelimited());
+      } else {
+        entry_reader.Skip(wire_type);
+      }
+    }
+    for (size_t i = 0; i < names_.size(); ++i) {
+      const std::string& name = names_.at(i);
+      if (name.size() != key.second || std::memcmp(name.data(), key.first, key.second) != 0) {
+        continue;
+      }
+      // a later entry of the same key replaces the earlier one, as in the parsed map
+      OFRecordFeatureView* feature = &features_.at(i);
+      *feature = OFRecordFeatureView();
+      if (value_chunks.size() == 1) {
+        ScanFeature(value_chunks.front().first, value_chunks.front().second, feature);
+      } else if (value_chunks.size() > 1) {
+        MaterializeFeature(value_chunks, feature);
+      }
+      found_.at(i) = true;
+    }
+  }
+}
+
+void OFRecordView::ScanFeature(const char* data, size_t size, OFRecordFeatureView* feature) {
+  WireReader feature_reader(data, size);
+  Feature::KindCase kind = Feature::KIND_NOT_SET;
+  Span list(nullptr, 0);
+  int64_t list_num = 0;
+  while (!feature_reader.Done()) {
+    uint32_t field = 0;
+    uint32_t wire_type = 0;
+    feature_reader.ReadTag(&field, &wire_type);
+    if (field >= Feature::kBytesList && field <= Feature::kInt64List
+        && wire_type == kWireTypeLengthDelimited) {
+      kind = static_cast<Feature::KindCase>(field);
+      list = feature_reader.ReadLengthDelimited();
+      list_num += 1;
+    } else {
+      feature_reader.Skip(wire_type);
+    }
+  }
+  // several lists are merged or replace each other, left to protobuf
+  if (list_num > 1) {
+    MaterializeFeature({Span(data, size)}, feature);
+    return;
+  }
+  feature->kind_case_ = kind;
+  if (list_num == 0) { return; }
+
+  WireReader list_reader(list.first, list.second);
+  int64_t packed_num = 0;
+  while (!list_reader.Done()) {
+    uint32_t field = 0;
+    uint32_t wire_type = 0;
+    list_reader.ReadTag(&field, &wire_type);
+    if (field != kListValueField) {
+      list_reader.Skip(wire_type);
+    } else if (kind == Feature::kBytesList && wire_type == kWireTypeLengthDelimited) {
+      feature->spans_.emplace_back(list_reader.ReadLengthDelimited());
+    } else if (IsNumericList(kind) && wire_type == kWireTypeLengthDelimited) {
+      feature->spans_.emplace_back(list_reader.ReadLengthDelimited());
+      packed_num += 1;
+    } else {
+      // unpacked numeric values
+      packed_num = -1;
+      break;
+    }
+  }
+  if (kind == Feature::kBytesList) {
+    feature->value_size_ = feature->spans_.size();
+    return;
+  }
+  if (packed_num != 1) {
+    feature->spans_.clear();
+    if (packed_num != 0) { MaterializeFeature({Span(data, size)}, feature); }
+    return;
+  }
+  const Span& payload = feature->spans_.front();
+  if (kind == Feature::kFloatList || kind == Feature::kDoubleList) {
+    const size_t elem_size = kind == Feature::kFloatList ? sizeof(float) : sizeof(double);
+    CHECK_EQ(payload.second % elem_size, 0) << "Malformed OFRecord: truncated packed list";
+    feature->value_size_ = payload.second / elem_size;
+  } else {
+    CHECK(payload.second == 0 || (payload.first[payload.second - 1] & 0x80) == 0)
+        << "Malformed OFRecord: truncated varint";
+    feature->value_size_ = std::count_if(payload.first, payload.first + payload.second,
+                                         [](char c) { return (c & 0x80) == 0; });
+  }
+}
+
+void OFRecordView::MaterializeFeature(const std::vector<Span>& chunks,
+                                      OFRecordFeatureView* feature) {
+  if (!arena_) { arena_.reset(new google::protobuf::Arena()); }
+  Feature* parsed = google::protobuf::Arena::CreateMessage<Feature>(arena_.get());
+  for (const Span& chunk : chunks) {
+    google::protobuf::io::CodedInputStream input(reinterpret_cast<const uint8_t*>(chunk.first),
+                                                 static_cast<int>(chunk.second));
+    CHECK(parsed->MergeFromCodedStream(&input)) << "Malformed OFRecord feature";
+  }
+  *feature = OFRecordFeatureView();
+  feature->feature_ = parsed;
+}
+
+}  // namespace data
+}  // namespace oneflow
@@ -0,0 +1,169 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
+#define ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
+
+#include <google/protobuf/arena.h>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/env_var/env_var.h"
+#include "oneflow/core/record/record.pb.h"
+
+namespace oneflow {
+
+// Whether OFRecordParser keeps the serialized records for OFRecordView instead of parsing them.
+DEFINE_ENV_BOOL(ONEFLOW_OFRECORD_LAZY_PARSE, true);
+
+namespace data {
+
+// Stores the serialized `data` in `record` in place of its features, the buffer of a record
+// stored before is reused. The features are scanned later by OFRecordView.
+void SetSerializedOFRecord(const char* data, size_t size, OFRecord* record);
+// Returns false if `record` was parsed rather than stored by SetSerializedOFRecord.
+bool GetSerializedOFRecord(const OFRecord& record, const char** data, size_t* size);
+
+// One feature of an OFRecordView. The values of a bytes_list and the packed payload of a numeric
+// list point into the serialized record, int32/int64 values are varints and decoded on access.
+class OFRecordFeatureView final {
+ public:
+  OFRecordFeatureView() = default;
+  ~OFRecordFeatureView() = default;
+
+  Feature::KindCase kind_case() const { return feature_ ? feature_->kind_case() : kind_case_; }
+  bool has_bytes_list() const { return kind_case() == Feature::kBytesList; }
+  bool has_float_list() const { return kind_case() == Feature::kFloatList; }
+  bool has_double_list() const { return kind_case() == Feature::kDoubleList; }
+  bool has_int32_list() const { return kind_case() == Feature::kInt32List; }
+  bool has_int64_list() const { return kind_case() == Feature::kInt64List; }
+
+  // Number of values in the list of the feature.
+  int64_t value_size() const;
+  // Value `i` of a bytes_list.
+  const char* bytes_data(int64_t i) const;
+  size_t bytes_size(int64_t i) const;
+  // Converts the first `n` values of a float/double/int32/int64 list to T.
+  template<typename T>
+  void CopyValues(int64_t n, T* dst) const;
+
+ private:
+  friend class OFRecordView;
+
+  template<typename List, typename U>
+  static void CopyParsed(const List& list, int64_t n, U* dst) {
+    for (int64_t i = 0; i < n; ++i) { dst[i] = static_cast<U>(list.value(i)); }
+  }
+  template<typename T, typename U>
+  static void CopyFixed(const char* data, int64_t n, U* dst) {
+    for (int64_t i = 0; i < n; ++i) {
+      T v;
+      std::memcpy(&v, data + i * sizeof(T), sizeof(T));
+      dst[i] = static_cast<U>(v);
+    }
+  }
+  template<typename T, typename U>
+  static void CopyVarint(const char* data, int64_t n, U* dst) {
+    for (int64_t i = 0; i < n; ++i) {
+      uint64_t v = 0;
+      int shift = 0;
+      while (true) {
+        const uint8_t byte = static_cast<uint8_t>(*data++);
+        v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) { break; }
+        shift += 7;
+      }
+      dst[i] = static_cast<U>(static_cast<T>(v));
+    }
+  }
+
+  Feature::KindCase kind_case_ = Feature::KIND_NOT_SET;
+  // values of a bytes_list, or the single packed payload of a numeric list
+  std::vector<std::pair<const char*, size_t>> spans_;
+  int64_t value_size_ = 0;
+  // set if the feature is parsed, the spans are unused then
+  const Feature* feature_ = nullptr;
+};
+
+template<typename T>
+void OFRecordFeatureView::CopyValues(int64_t n, T* dst) const {
+  CHECK_LE(n, value_size());
+  const Feature::KindCase kind = kind_case();
+  if (feature_ != nullptr) {
+    if (kind == Feature::kFloatList) {
+      CopyParsed(feature_->float_list(), n, dst);
+    } else if (kind == Feature::kDoubleList) {
+      CopyParsed(feature_->double_list(), n, dst);
+    } else if (kind == Feature::kInt32List) {
+      CopyParsed(feature_->int32_list(), n, dst);
+    } else if (kind == Feature::kInt64List) {
+      CopyParsed(feature_->int64_list(), n, dst);
+    } else {
+      UNIMPLEMENTED();
+    }
+    return;
+  }
+  if (n == 0) { return; }
+  const char* data = spans_.front().first;
+  if (kind == Feature::kFloatList) {
+    CopyFixed<float>(data, n, dst);
+  } else if (kind == Feature::kDoubleList) {
+    CopyFixed<double>(data, n, dst);
+  } else if (kind == Feature::kInt32List) {
+    CopyVarint<int32_t>(data, n, dst);
+  } else if (kind == Feature::kInt64List) {
+    CopyVarint<int64_t>(data, n, dst);
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+// A read-only view of some features of an OFRecord.
+//
+// For a record stored by SetSerializedOFRecord, the wire format is scanned once, only the
+// features named in `names` are indexed and their values are handed out as spans into the
+// serialized record, nothing is copied. A feature the scan can't describe by spans (a list split
+// over several fields, unpacked numeric values) is parsed into a protobuf arena owned by the view.
+// A parsed record is viewed through its features.
+class OFRecordView final {
+ public:
+  OF_DISALLOW_COPY(OFRecordView);
+  OFRecordView() = default;
+  OFRecordView(OFRecordView&&) = default;
+  OFRecordView& operator=(OFRecordView&&) = default;
+  ~OFRecordView() = default;
+
+  // The serialized record must outlive the view.
+  void Reset(const OFRecord& record, const std::vector<std::string>& names);
+  void Reset(const char* data, size_t size, const std::vector<std::string>& names);
+
+  // Returns nullptr if the record has no feature `name`, `name` must be one of `names`.
+  const OFRecordFeatureView* Find(const std::string& name) const;
+  const OFRecordFeatureView& Get(const std::string& name) const;
+
+ private:
+  void ScanRecord(const char* data, size_t size);
+  void ScanFeature(const char* data, size_t size, OFRecordFeatureView* feature);
+  void MaterializeFeature(const std::vector<std::pair<const char*, size_t>>& chunks,
+                          OFRecordFeatureView* feature);
+
+  std::vector<std::string> names_;
+  std::vector<OFRecordFeatureView> features_;
+  std::vector<bool> found_;
+  std::unique_ptr<google::protobuf::Arena> arena_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
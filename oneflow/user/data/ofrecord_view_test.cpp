@@ -0,0 +1,198 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/user/data/ofrecord_view.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+OFRecord MakeRecord() {
+  OFRecord record;
+  const std::string image("\xff\xd8\x00j", 4);
+  (*record.mutable_feature())["image"].mutable_bytes_list()->add_value(image);
+  auto* bytes = (*record.mutable_feature())["bytes"].mutable_bytes_list();
+  bytes->add_value("a");
+  bytes->add_value("");
+  bytes->add_value("ccc");
+  for (float v : {1.5f, -2.25f, 3.f}) {
+    (*record.mutable_feature())["float"].mutable_float_list()->add_value(v);
+  }
+  for (double v : {1e300, -0.5}) {
+    (*record.mutable_feature())["double"].mutable_double_list()->add_value(v);
+  }
+  for (int32_t v : {7, -1, 300, std::numeric_limits<int32_t>::min()}) {
+    (*record.mutable_feature())["int32"].mutable_int32_list()->add_value(v);
+  }
+  for (int64_t v : {int64_t(1) << 40, int64_t(-5)}) {
+    (*record.mutable_feature())["int64"].mutable_int64_list()->add_value(v);
+  }
+  (*record.mutable_feature())["empty"].mutable_int32_list();
+  (*record.mutable_feature())["unset"];
+  for (int i = 0; i < 16; ++i) {
+    (*record.mutable_feature())["unused_" + std::to_string(i)].mutable_float_list()->add_value(i);
+  }
+  return record;
+}
+
+const std::vector<std::string>& FeatureNames() {
+  static const std::vector<std::string> names{"image", "bytes",  "float", "double", "int32",
+                                              "int64", "empty", "unset", "missing"};
+  return names;
+}
+
+template<typename T>
+std::vector<T> Values(const OFRecordFeatureView& feature) {
+  std::vector<T> values(feature.value_size());
+  feature.CopyValues(values.size(), values.data());
+  return values;
+}
+
+void CheckView(const OFRecordView& view) {
+  const OFRecordFeatureView& image = view.Get("image");
+  ASSERT_TRUE(image.has_bytes_list());
+  ASSERT_EQ(image.value_size(), 1);
+  ASSERT_EQ(std::string(image.bytes_data(0), image.bytes_size(0)),
+            std::string("\xff\xd8\x00j", 4));
+  const OFRecordFeatureView& bytes = view.Get("bytes");
+  ASSERT_EQ(bytes.value_size(), 3);
+  ASSERT_EQ(std::string(bytes.bytes_data(0), bytes.bytes_size(0)), "a");
+  ASSERT_EQ(bytes.bytes_size(1), 0);
+  ASSERT_EQ(std::string(bytes.bytes_data(2), bytes.bytes_size(2)), "ccc");
+  ASSERT_TRUE(view.Get("float").has_float_list());
+  ASSERT_EQ(Values<float>(view.Get("float")), (std::vector<float>{1.5f, -2.25f, 3.f}));
+  ASSERT_EQ(Values<int32_t>(view.Get("float")), (std::vector<int32_t>{1, -2, 3}));
+  ASSERT_EQ(Values<double>(view.Get("double")), (std::vector<double>{1e300, -0.5}));
+  ASSERT_EQ(Values<int32_t>(view.Get("int32")),
+            (std::vector<int32_t>{7, -1, 300, std::numeric_limits<int32_t>::min()}));
+  ASSERT_EQ(Values<int64_t>(view.Get("int64")), (std::vector<int64_t>{int64_t(1) << 40, -5}));
+  ASSERT_TRUE(view.Get("empty").has_int32_list());
+  ASSERT_EQ(view.Get("empty").value_size(), 0);
+  ASSERT_EQ(view.Get("unset").kind_case(), Feature::KIND_NOT_SET);
+  ASSERT_EQ(view.Find("missing"), nullptr);
+}
+
+// appends the tag of a field with `wire_type` and, for length delimited fields, the length
+void AppendTag(int field, int wire_type, size_t length, std::string* out) {
+  uint64_t v = (field << 3) | wire_type;
+  const int n = wire_type == 2 ? 2 : 1;
+  for (int i = 0; i < n; ++i) {
+    while (v >= 0x80) {
+      out->push_back(static_cast<char>(v | 0x80));
+      v >>= 7;
+    }
+    out->push_back(static_cast<char>(v));
+    v = length;
+  }
+}
+
+std::string FeatureEntry(const std::string& key, const std::vector<std::string>& values) {
+  std::string entry;
+  AppendTag(1, 2, key.size(), &entry);
+  entry += key;
+  for (const auto& value : values) {
+    AppendTag(2, 2, value.size(), &entry);
+    entry += value;
+  }
+  std::string out;
+  AppendTag(1, 2, entry.size(), &out);
+  return out + entry;
+}
+
+}  // namespace
+
+TEST(OFRecordView, serialized) {
+  const std::string serialized = MakeRecord().SerializeAsString();
+  OFRecordView view;
+  view.Reset(serialized.data(), serialized.size(), FeatureNames());
+  CheckView(view);
+  // the bytes point into the serialized record
+  const char* image = view.Get("image").bytes_data(0);
+  ASSERT_TRUE(image >= serialized.data() && image < serialized.data() + serialized.size());
+}
+
+TEST(OFRecordView, parsed) {
+  const OFRecord record = MakeRecord();
+  OFRecordView view;
+  view.Reset(record, FeatureNames());
+  CheckView(view);
+}
+
+TEST(OFRecordView, stored_in_record) {
+  const std::string serialized = MakeRecord().SerializeAsString();
+  OFRecord record = MakeRecord();
+  const char* data = nullptr;
+  size_t size = 0;
+  ASSERT_FALSE(GetSerializedOFRecord(record, &data, &size));
+  SetSerializedOFRecord(serialized.data(), serialized.size(), &record);
+  ASSERT_TRUE(record.feature().empty());
+  ASSERT_TRUE(GetSerializedOFRecord(record, &data, &size));
+  ASSERT_EQ(std::string(data, size), serialized);
+  OFRecordView view;
+  view.Reset(record, FeatureNames());
+  CheckView(view);
+  // a record stored again reuses its buffer
+  SetSerializedOFRecord(serialized.data(), 8, &record);
+  ASSERT_TRUE(GetSerializedOFRecord(record, &data, &size));
+  ASSERT_EQ(size, 8);
+}
+
+TEST(OFRecordView, materialized) {
+  // unpacked float values, a bytes list split over two values of the map entry, and a key which
+  // appears twice
+  std::string unpacked_list;
+  for (float v : {0.5f, 4.f}) {
+    AppendTag(1, 5, 0, &unpacked_list);
+    unpacked_list.append(reinterpret_cast<const char*>(&v), sizeof(v));
+  }
+  std::string unpacked_feature;
+  AppendTag(2, 2, unpacked_list.size(), &unpacked_feature);
+  unpacked_feature += unpacked_list;
+
+  Feature first;
+  first.mutable_bytes_list()->add_value("x");
+  Feature second;
+  second.mutable_bytes_list()->add_value("yz");
+  Feature replaced;
+  replaced.mutable_int64_list()->add_value(1);
+  Feature replacing;
+  replacing.mutable_int64_list()->add_value(2);
+
+  const std::string serialized =
+      FeatureEntry("unpacked", {unpacked_feature})
+      + FeatureEntry("split", {first.SerializeAsString(), second.SerializeAsString()})
+      + FeatureEntry("twice", {replaced.SerializeAsString()})
+      + FeatureEntry("twice", {replacing.SerializeAsString()});
+  OFRecord parsed;
+  ASSERT_TRUE(parsed.ParseFromString(serialized));
+
+  OFRecordView view;
+  for (int i = 0; i < 2; ++i) {
+    view.Reset(serialized.data(), serialized.size(), {"unpacked", "split", "twice"});
+    ASSERT_EQ(Values<float>(view.Get("unpacked")), (std::vector<float>{0.5f, 4.f}));
+    const OFRecordFeatureView& split = view.Get("split");
+    ASSERT_EQ(split.value_size(), parsed.feature().at("split").bytes_list().value_size());
+    for (int64_t j = 0; j < split.value_size(); ++j) {
+      ASSERT_EQ(std::string(split.bytes_data(j), split.bytes_size(j)),
+                parsed.feature().at("split").bytes_list().value(j));
+    }
+    ASSERT_EQ(Values<int64_t>(view.Get("twice")), (std::vector<int64_t>{2}));
+  }
+}
+
+}  // namespace data
+}  // namespace oneflow
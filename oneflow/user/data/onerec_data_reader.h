@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/user/data/data_reader.h"
 #include "oneflow/user/data/onerec_dataset.h"
+#include "oneflow/user/data/indexed_record_dataset.h"
 #include "oneflow/user/data/onerec_parser.h"
 #include "oneflow/user/data/random_shuffle_dataset.h"
 #include "oneflow/user/data/batch_random_shuffle_dataset.h"
@@ -33,7 +34,15 @@ class OneRecDataReader final : public DataReader<TensorBuffer> {
     if (auto* pool = TensorBufferPool::TryGet()) { pool->IncreasePoolSizeByBase(batch_size_); }
     const auto random_shuffle = ctx->Attr<bool>("random_shuffle");
     parser_.reset(new OneRecParser());
-    if (random_shuffle) {
+    if (ctx->Attr<bool>("use_record_index")) {
+      size_t world_size = 1;
+      int64_t rank = 0;
+      CHECK_JUST(InitDataSourceDistributedInfo(ctx, world_size, rank));
+      loader_.reset(new IndexedRecordDataset(
+          ctx->Attr<std::vector<std::string>>("files"), RecordFormat::kOneRec, rank, world_size,
+          random_shuffle, ctx->Attr<int64_t>("seed"), ctx->Attr<int64_t>("start_cursor")));
+      loader_.reset(new BatchDataset<TensorBuffer>(batch_size_, std::move(loader_)));
+    } else if (random_shuffle) {
       const auto mode = ctx->Attr<std::string>("shuffle_mode");
       if (mode == "batch") {
         loader_.reset(new OneRecDataset(ctx, batch_size_));
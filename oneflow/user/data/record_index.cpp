@@ -0,0 +1,196 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/record_index.h"
+#include "oneflow/user/data/onerec_dataset.h"
+
+namespace oneflow {
+
+namespace data {
+
+namespace {
+
+constexpr int64_t kOFRecordHeaderSize = sizeof(int64_t);
+
+std::unique_ptr<fs::RandomAccessFile> NewRandomAccessFile(fs::FileSystem* fs,
+                                                          const std::string& path) {
+  std::unique_ptr<fs::RandomAccessFile> file;
+  fs->NewRandomAccessFile(path, &file);
+  return file;
+}
+
+template<typename T>
+T ReadPod(const fs::RandomAccessFile& file, int64_t offset) {
+  T value;
+  file.Read(offset, sizeof(T), reinterpret_cast<char*>(&value));
+  return value;
+}
+
+int64_t OneRecRecordSize(int64_t payload_size) {
+  return kHeaderSize + RoundUp(payload_size, kPayloadAlignmentSize) + kDigestFieldSize;
+}
+
+// Checks the frame header of the OneRec record at `offset` and returns the size of its payload.
+int64_t CheckOneRecHeader(const OneRecFrameHeaderView& header_view, int64_t offset) {
+  CHECK_EQ(header_view.header.magic, kMagicNumber) << "bad OneRec record at offset " << offset;
+  CHECK_EQ(header_view.header.reserved, kReservedNumber);
+  const int32_t payload_size = header_view.header.payload_size;
+  CHECK_GE(payload_size, 0);
+  CHECK_LE(payload_size, kMaxPayloadSize);
+  CHECK_EQ(ByteSwap(header_view.header.digest),
+           XXH64(header_view.raw, kHeaderSizeWithoutDigest, /*seed=*/0));
+  return payload_size;
+}
+
+}  // namespace
+
+constexpr char RecordIndex::kSidecarMagic[];
+
+/* static */ RecordIndex RecordIndex::LoadOrBuild(fs::FileSystem* fs, const std::string& data_file,
+                                                  RecordFormat format) {
+  const std::string sidecar = SidecarPath(data_file);
+  if (!fs->FileExists(sidecar)) {
+    LOG(WARNING) << "no record index found for " << data_file
+                 << ", scanning it instead. Write one with `python3 -m "
+                    "oneflow.utils.data.record_index` to skip the scan.";
+    return Build(fs, data_file, format);
+  }
+  const auto file = NewRandomAccessFile(fs, sidecar);
+  const int64_t sidecar_size = fs->GetFileSize(sidecar);
+  const int64_t header_size = kSidecarHeaderSize;
+  CHECK_GE(sidecar_size, header_size) << "truncated record index " << sidecar;
+  char magic[kSidecarMagicLen];
+  file->Read(0, kSidecarMagicLen, magic);
+  CHECK(std::equal(magic, magic + kSidecarMagicLen, kSidecarMagic))
+      << "bad record index " << sidecar;
+  int64_t offset = kSidecarMagicLen;
+  const auto stored_format = static_cast<RecordFormat>(ReadPod<int32_t>(*file, offset));
+  CHECK(stored_format == format) << "record index " << sidecar << " is written for another format";
+  offset += 2 * sizeof(int32_t);
+  const int64_t record_num = ReadPod<int64_t>(*file, offset);
+  offset += sizeof(int64_t);
+  RecordIndex index;
+  index.format_ = format;
+  index.data_size_ = ReadPod<int64_t>(*file, offset);
+  offset += sizeof(int64_t);
+  CHECK_EQ(index.data_size_, static_cast<int64_t>(fs->GetFileSize(data_file)))
+      << "record index " << sidecar << " is stale, rebuild it";
+  CHECK_GE(record_num, 0);
+  CHECK_EQ(sidecar_size, header_size + record_num * static_cast<int64_t>(sizeof(int64_t)))
+      << "truncated record index " << sidecar;
+  index.offsets_.resize(record_num);
+  if (record_num > 0) {
+    file->Read(offset, record_num * sizeof(int64_t),
+               reinterpret_cast<char*>(index.offsets_.data()));
+    CHECK_EQ(index.offsets_.front(), 0);
+    CHECK_LT(index.offsets_.back(), index.data_size_);
+  }
+  return index;
+}
+
+/* static */ RecordIndex RecordIndex::Build(fs::FileSystem* fs, const std::string& data_file,
+                                            RecordFormat format) {
+  const auto file = NewRandomAccessFile(fs, data_file);
+  RecordIndex index;
+  index.format_ = format;
+  index.data_size_ = fs->GetFileSize(data_file);
+  int64_t offset = 0;
+  while (offset < index.data_size_) {
+    index.offsets_.emplace_back(offset);
+    int64_t record_size = 0;
+    if (format == RecordFormat::kOFRecord) {
+      CHECK_LE(offset + kOFRecordHeaderSize, index.data_size_) << "truncated " << data_file;
+      const int64_t payload_size = ReadPod<int64_t>(*file, offset);
+      CHECK_GT(payload_size, 0) << "bad OFRecord at offset " << offset << " of " << data_file;
+      record_size = kOFRecordHeaderSize + payload_size;
+    } else if (format == RecordFormat::kOneRec) {
+      CHECK_LE(offset + kHeaderSize, index.data_size_) << "truncated " << data_file;
+      OneRecFrameHeaderView header_view{};
+      file->Read(offset, kHeaderSize, header_view.raw);
+      record_size = OneRecRecordSize(CheckOneRecHeader(header_view, offset));
+    } else {
+      UNIMPLEMENTED();
+    }
+    offset += record_size;
+  }
+  CHECK_EQ(offset, index.data_size_) << "truncated " << data_file;
+  return index;
+}
+
+void ReadRecord(const fs::RandomAccessFile& file, const RecordIndex& index, int64_t i,
+                TensorBuffer* buffer) {
+  const int64_t offset = index.record_offset(i);
+  const int64_t record_size = index.record_size(i);
+  if (index.format() == RecordFormat::kOFRecord) {
+    const int64_t payload_size = ReadPod<int64_t>(file, offset);
+    CHECK_GT(payload_size, 0);
+    CHECK_EQ(kOFRecordHeaderSize + payload_size, record_size) << "record index is stale";
+    buffer->Resize(Shape({payload_size}), DataType::kChar);
+    file.Read(offset + kOFRecordHeaderSize, payload_size, buffer->mut_data<char>());
+  } else if (index.format() == RecordFormat::kOneRec) {
+    OneRecFrameHeaderView header_view{};
+    file.Read(offset, kHeaderSize, header_view.raw);
+    const int64_t payload_size = CheckOneRecHeader(header_view, offset);
+    CHECK_EQ(OneRecRecordSize(payload_size), record_size) << "record index is stale";
+    buffer->Resize(Shape({payload_size}), DataType::kChar);
+    char* body = buffer->mut_data<char>();
+    file.Read(offset + kHeaderSize, payload_size, body);
+    OneRecFrameFooterView footer_view{};
+    file.Read(offset + record_size - kDigestFieldSize, kDigestFieldSize, footer_view.raw);
+    CHECK_EQ(ByteSwap(footer_view.digest), XXH64(body, payload_size, /*seed=*/0));
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+IndexPermutation::IndexPermutation(int64_t size, uint64_t key) : size_(size), key_(key) {
+  CHECK_GE(size, 0);
+  int32_t bits = 1;
+  while (bits < 62 && (int64_t{1} << bits) < size) { ++bits; }
+  half_bits_ = (bits + 1) / 2;
+  half_mask_ = (uint64_t{1} << half_bits_) - 1;
+}
+
+uint64_t IndexPermutation::Round(uint64_t half, int64_t round) const {
+  // splitmix64 finalizer
+  uint64_t x = half + key_ + static_cast<uint64_t>(round) * 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return (x ^ (x >> 31)) & half_mask_;
+}
+
+int64_t IndexPermutation::At(int64_t i) const {
+  CHECK_GE(i, 0);
+  CHECK_LT(i, size_);
+  constexpr int64_t kRoundNum = 4;
+  // The Feistel network permutes [0, 4^half_bits), which is less than 4 * size_, so walking the
+  // cycle until the value falls back into [0, size_) takes a few steps in expectation.
+  uint64_t x = i;
+  do {
+    uint64_t left = x >> half_bits_;
+    uint64_t right = x & half_mask_;
+    for (int64_t r = 0; r < kRoundNum; ++r) {
+      const uint64_t next_right = left ^ Round(right, r);
+      left = right;
+      right = next_right;
+    }
+    x = (left << half_bits_) | right;
+  } while (x >= static_cast<uint64_t>(size_));
+  return x;
+}
+
+}  // namespace data
+
+}  // namespace oneflow
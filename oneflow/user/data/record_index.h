@@ -0,0 +1,98 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_RECORD_INDEX_H_
+#define ONEFLOW_USER_DATA_RECORD_INDEX_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/tensor_buffer.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+namespace data {
+
+enum class RecordFormat : int32_t {
+  kOFRecord = 0,
+  kOneRec = 1,
+};
+
+// Offsets of the records in one data part, stored in a sidecar file `<part>.idx`:
+//   char[8] magic "OFRIDX01"
+//   int32   format
+//   int32   reserved, 0
+//   int64   record num
+//   int64   size of the data part in bytes
+//   int64   offsets of the records, `record num` of them
+// All fields are little endian. The sidecar is written by `oneflow.utils.data.record_index`.
+class RecordIndex final {
+ public:
+  RecordIndex() = default;
+  ~RecordIndex() = default;
+
+  static constexpr char kSidecarMagic[] = "OFRIDX01";
+  static constexpr size_t kSidecarMagicLen = sizeof(kSidecarMagic) - 1;
+  static constexpr size_t kSidecarHeaderSize = kSidecarMagicLen + 4 + 4 + 8 + 8;
+
+  static std::string SidecarPath(const std::string& data_file) { return data_file + ".idx"; }
+  // Loads the sidecar of `data_file`, or scans the data part if there is none.
+  static RecordIndex LoadOrBuild(fs::FileSystem* fs, const std::string& data_file,
+                                 RecordFormat format);
+  static RecordIndex Build(fs::FileSystem* fs, const std::string& data_file, RecordFormat format);
+
+  RecordFormat format() const { return format_; }
+  int64_t data_size() const { return data_size_; }
+  int64_t record_num() const { return offsets_.size(); }
+  int64_t record_offset(int64_t i) const { return offsets_.at(i); }
+  int64_t record_size(int64_t i) const {
+    return (i + 1 == record_num() ? data_size_ : offsets_.at(i + 1)) - offsets_.at(i);
+  }
+
+ private:
+  RecordFormat format_;
+  int64_t data_size_;
+  std::vector<int64_t> offsets_;
+};
+
+// Reads the payload of record i of `index` from `file` with positional reads, the framing and
+// the digests of a OneRec record are checked as the sequential reader does.
+void ReadRecord(const fs::RandomAccessFile& file, const RecordIndex& index, int64_t i,
+                TensorBuffer* buffer);
+
+// A pseudo-random permutation of [0, size) keyed by `key`, computed per element in O(1) memory
+// with a Feistel network and cycle walking, so arbitrarily large datasets can be shuffled
+// globally and any position of the permutation can be resumed from.
+class IndexPermutation final {
+ public:
+  IndexPermutation(int64_t size, uint64_t key);
+  ~IndexPermutation() = default;
+
+  int64_t size() const { return size_; }
+  int64_t At(int64_t i) const;
+
+ private:
+  uint64_t Round(uint64_t half, int64_t round) const;
+
+  int64_t size_;
+  uint64_t key_;
+  int32_t half_bits_;
+  uint64_t half_mask_;
+};
+
+}  // namespace data
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_RECORD_INDEX_H_
@@ -0,0 +1,111 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/staged_pipeline.h"
+
+namespace oneflow {
+
+DEFINE_ENV_INTEGER(ONEFLOW_DATA_PIPELINE_PRINT_STATS_INTERVAL_TICKS, 100);
+
+namespace data {
+
+namespace {
+
+// smoothing of the pressure samples, and the gap of pressure which moves a worker
+constexpr double kPressureDecay = 0.5;
+constexpr double kRebalanceMargin = 0.25;
+
+}  // namespace
+
+PipelineController::PipelineController(const std::vector<PipelineStage*>& stages,
+                                       int64_t thread_budget, int64_t interval_ms)
+    : stages_(stages),
+      pressures_(stages.size(), 0),
+      thread_budget_(thread_budget),
+      interval_ms_(interval_ms),
+      tick_(0),
+      stopped_(false) {
+  CHECK_GE(thread_budget_, static_cast<int64_t>(stages_.size()));
+  if (interval_ms_ <= 0) { return; }
+  thread_ = std::thread([this]() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!cond_.wait_for(lock, std::chrono::milliseconds(interval_ms_),
+                           [this]() { return stopped_; })) {
+      Rebalance();
+      tick_ += 1;
+      if (EnvBool<ONEFLOW_DATA_PIPELINE_PRINT_STATS>()
+          && tick_ % EnvInteger<ONEFLOW_DATA_PIPELINE_PRINT_STATS_INTERVAL_TICKS>() == 0) {
+        LogStats();
+      }
+    }
+  });
+}
+
+PipelineController::~PipelineController() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  cond_.notify_all();
+  if (thread_.joinable()) { thread_.join(); }
+  if (EnvBool<ONEFLOW_DATA_PIPELINE_PRINT_STATS>()) { LogStats(); }
+}
+
+void PipelineController::Rebalance() {
+  const int64_t stage_num = stages_.size();
+  int64_t total_worker_num = 0;
+  int64_t bottleneck = -1;
+  int64_t donor = -1;
+  for (int64_t i = 0; i < stage_num; ++i) {
+    PipelineStage* stage = stages_.at(i);
+    const double pressure = stage->InputOccupancy() - stage->OutputOccupancy();
+    pressures_.at(i) = kPressureDecay * pressures_.at(i) + (1 - kPressureDecay) * pressure;
+    const int64_t worker_num = stage->worker_num();
+    total_worker_num += worker_num;
+    if (worker_num < stage->max_worker_num()
+        && (bottleneck == -1 || pressures_.at(i) > pressures_.at(bottleneck))) {
+      bottleneck = i;
+    }
+    if (worker_num > 1 && (donor == -1 || pressures_.at(i) < pressures_.at(donor))) { donor = i; }
+  }
+  if (bottleneck == -1 || pressures_.at(bottleneck) <= 0) { return; }
+  PipelineStage* to = stages_.at(bottleneck);
+  if (total_worker_num < thread_budget_) {
+    to->SetWorkerNum(to->worker_num() + 1);
+  } else if (donor != -1 && donor != bottleneck
+             && pressures_.at(bottleneck) - pressures_.at(donor) > kRebalanceMargin) {
+    PipelineStage* from = stages_.at(donor);
+    from->SetWorkerNum(from->worker_num() - 1);
+    to->SetWorkerNum(to->worker_num() + 1);
+  }
+}
+
+void PipelineController::LogStats() const {
+  std::ostringstream ss;
+  ss << "data pipeline stats:";
+  for (int64_t i = 0; i < static_cast<int64_t>(stages_.size()); ++i) {
+    const PipelineStage* stage = stages_.at(i);
+    const PipelineStageStats stats = stage->stats();
+    ss << "\n  " << stage->name() << ": " << stage->worker_num() << " worker(s), "
+       << stats.sample_cnt << " samples, " << stats.AvgLatencyUs() << " us/sample, starved "
+       << stats.starve_ns / 1000000 << " ms, blocked " << stats.block_ns / 1000000
+       << " ms, pressure " << pressures_.at(i);
+  }
+  LOG(INFO) << ss.str();
+}
+
+}  // namespace data
+
+}  // namespace oneflow
@@ -0,0 +1,272 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_STAGED_PIPELINE_H_
+#define ONEFLOW_USER_DATA_STAGED_PIPELINE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "oneflow/user/data/dataset.h"
+#include "oneflow/core/common/env_var/env_var.h"
+
+namespace oneflow {
+
+DEFINE_ENV_BOOL(ONEFLOW_DATA_PIPELINE_PRINT_STATS, false);
+
+namespace data {
+
+struct PipelineStageStats {
+  int64_t sample_cnt = 0;
+  // time spent in the map function, summed over the workers
+  int64_t busy_ns = 0;
+  // time the consumer of the stage waited for the next sample
+  int64_t starve_ns = 0;
+  // time the feeder waited for room in the input queue
+  int64_t block_ns = 0;
+
+  double AvgLatencyUs() const { return sample_cnt == 0 ? 0 : busy_ns / 1e3 / sample_cnt; }
+};
+
+// One stage of a staged data pipeline, seen by the PipelineController.
+class PipelineStage {
+ public:
+  PipelineStage() = default;
+  virtual ~PipelineStage() = default;
+
+  virtual const std::string& name() const = 0;
+  virtual int64_t worker_num() const = 0;
+  virtual int64_t max_worker_num() const = 0;
+  virtual void SetWorkerNum(int64_t worker_num) = 0;
+  // Fractions of the input queue and of the reorder window in use.
+  virtual double InputOccupancy() const = 0;
+  virtual double OutputOccupancy() const = 0;
+  virtual PipelineStageStats stats() const = 0;
+  // Wakes up every blocked thread, Next() returns an empty batch afterwards.
+  virtual void Close() = 0;
+};
+
+// Applies `map_fn` to the samples of `dataset` on an elastic number of workers.
+//
+// A feeder thread moves the samples of `dataset` into a bounded input queue, `max_worker_num`
+// workers are started and the first `worker_num` of them take samples from the queue, the rest are
+// parked until SetWorkerNum raises the count. Samples come out in input order: a worker holding a
+// sample more than `capacity` ahead of the consumer waits, so the output is bounded as well. Once
+// `dataset` returns an empty batch and every sample before it is consumed, Next() returns empty
+// batches.
+template<typename In, typename Out>
+class ParallelMapDataset final : public Dataset<Out>, public PipelineStage {
+ public:
+  using Base = Dataset<Out>;
+  using SampleType = typename Base::SampleType;
+  using BatchType = typename Base::BatchType;
+  using MapFn = std::function<Out(In&&)>;
+
+  OF_DISALLOW_COPY_AND_MOVE(ParallelMapDataset);
+
+  ParallelMapDataset(const std::string& name, std::unique_ptr<Dataset<In>>&& dataset, MapFn map_fn,
+                     int64_t worker_num, int64_t max_worker_num, int64_t capacity)
+      : name_(name),
+        nested_ds_(std::move(dataset)),
+        map_fn_(std::move(map_fn)),
+        max_worker_num_(max_worker_num),
+        capacity_(capacity),
+        worker_num_(std::min(worker_num, max_worker_num)),
+        in_seq_(0),
+        out_seq_(0),
+        input_done_(false),
+        closed_(false) {
+    CHECK_GT(worker_num, 0);
+    CHECK_GT(capacity, 0);
+    for (int64_t i = 0; i < max_worker_num_; ++i) {
+      workers_.emplace_back([this, i]() { WorkerLoop(i); });
+    }
+    feeder_ = std::thread([this]() { FeederLoop(); });
+  }
+
+  ~ParallelMapDataset() override {
+    Close();
+    // the feeder may be blocked in a nested stage
+    if (auto* nested_stage = dynamic_cast<PipelineStage*>(nested_ds_.get())) {
+      nested_stage->Close();
+    }
+    feeder_.join();
+    for (auto& worker : workers_) { worker.join(); }
+  }
+
+  BatchType Next() override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto start = std::chrono::steady_clock::now();
+    out_cond_.wait(lock, [this]() {
+      return closed_ || out_.count(out_seq_) > 0 || (input_done_ && out_seq_ == in_seq_);
+    });
+    stats_.starve_ns += ElapsedNs(start);
+    auto it = out_.find(out_seq_);
+    if (closed_ || it == out_.end()) { return BatchType(); }
+    BatchType batch;
+    batch.push_back(std::move(it->second));
+    out_.erase(it);
+    out_seq_ += 1;
+    window_cond_.notify_all();
+    return batch;
+  }
+
+  const std::string& name() const override { return name_; }
+  int64_t max_worker_num() const override { return max_worker_num_; }
+  int64_t worker_num() const override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return worker_num_;
+  }
+  void SetWorkerNum(int64_t worker_num) override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    worker_num_ = std::max<int64_t>(std::min(worker_num, max_worker_num_), 1);
+    in_cond_.notify_all();
+  }
+  double InputOccupancy() const override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return static_cast<double>(in_queue_.size()) / capacity_;
+  }
+  double OutputOccupancy() const override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return static_cast<double>(out_.size()) / capacity_;
+  }
+  PipelineStageStats stats() const override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return stats_;
+  }
+  void Close() override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    closed_ = true;
+    in_cond_.notify_all();
+    out_cond_.notify_all();
+    window_cond_.notify_all();
+    feed_cond_.notify_all();
+  }
+
+ private:
+  static int64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+                                                                - start)
+        .count();
+  }
+
+  void FeederLoop() {
+    while (true) {
+      auto batch = nested_ds_->Next();
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (closed_) { return; }
+      if (batch.empty()) {
+        // end of the nested dataset, Next() returns an empty batch after the samples in flight
+        input_done_ = true;
+        out_cond_.notify_all();
+        return;
+      }
+      for (auto& sample : batch) {
+        const auto start = std::chrono::steady_clock::now();
+        feed_cond_.wait(lock, [this]() {
+          return closed_ || static_cast<int64_t>(in_queue_.size()) < capacity_;
+        });
+        stats_.block_ns += ElapsedNs(start);
+        if (closed_) { return; }
+        in_queue_.emplace_back(in_seq_++, std::move(sample));
+        in_cond_.notify_one();
+      }
+    }
+  }
+
+  void WorkerLoop(int64_t worker_index) {
+    while (true) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      in_cond_.wait(lock, [this, worker_index]() {
+        return closed_ || (worker_index < worker_num_ && !in_queue_.empty());
+      });
+      if (closed_) { return; }
+      const int64_t seq = in_queue_.front().first;
+      In sample = std::move(in_queue_.front().second);
+      in_queue_.pop_front();
+      feed_cond_.notify_one();
+      lock.unlock();
+      const auto start = std::chrono::steady_clock::now();
+      Out result = map_fn_(std::move(sample));
+      const int64_t busy_ns = ElapsedNs(start);
+      lock.lock();
+      window_cond_.wait(lock, [this, seq]() { return closed_ || seq < out_seq_ + capacity_; });
+      if (closed_) { return; }
+      out_.emplace(seq, std::move(result));
+      stats_.sample_cnt += 1;
+      stats_.busy_ns += busy_ns;
+      if (seq == out_seq_) { out_cond_.notify_one(); }
+    }
+  }
+
+  const std::string name_;
+  std::unique_ptr<Dataset<In>> nested_ds_;
+  MapFn map_fn_;
+  const int64_t max_worker_num_;
+  const int64_t capacity_;
+  int64_t worker_num_;
+  int64_t in_seq_;
+  int64_t out_seq_;
+  bool input_done_;
+  bool closed_;
+  std::deque<std::pair<int64_t, In>> in_queue_;
+  std::map<int64_t, Out> out_;
+  PipelineStageStats stats_;
+  mutable std::mutex mutex_;
+  std::condition_variable in_cond_;
+  std::condition_variable out_cond_;
+  std::condition_variable window_cond_;
+  std::condition_variable feed_cond_;
+  std::thread feeder_;
+  std::vector<std::thread> workers_;
+};
+
+// Moves workers to the bottleneck stage of a pipeline.
+//
+// Every tick the pressure of a stage is estimated as the occupancy of its input queue minus the
+// occupancy of its output: a stage with a full input and an empty output is slower than its
+// neighbours. When the pressure of the most loaded stage exceeds that of the least loaded one by
+// a margin, one worker moves between them, the total number of workers stays within
+// `thread_budget`.
+class PipelineController final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(PipelineController);
+  PipelineController(const std::vector<PipelineStage*>& stages, int64_t thread_budget,
+                     int64_t interval_ms);
+  ~PipelineController();
+
+  // One step of the controller, called by its thread every `interval_ms`.
+  void Rebalance();
+  void LogStats() const;
+
+ private:
+  std::vector<PipelineStage*> stages_;
+  std::vector<double> pressures_;
+  int64_t thread_budget_;
+  int64_t interval_ms_;
+  int64_t tick_;
+  bool stopped_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::thread thread_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_STAGED_PIPELINE_H_
@@ -0,0 +1,119 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/user/data/staged_pipeline.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+// Returns the samples 0, 1, ..., sample_num - 1 in batches of 2, then empty batches.
+class CountingDataset final : public Dataset<int64_t> {
+ public:
+  explicit CountingDataset(int64_t sample_num) : sample_num_(sample_num), next_(0) {}
+  BatchType Next() override {
+    BatchType batch;
+    for (int64_t i = 0; i < 2 && next_ < sample_num_; ++i) { batch.push_back(next_++); }
+    return batch;
+  }
+
+ private:
+  int64_t sample_num_;
+  int64_t next_;
+};
+
+using Stage = ParallelMapDataset<int64_t, int64_t>;
+
+std::unique_ptr<Stage> NewStage(const std::string& name, std::unique_ptr<Dataset<int64_t>>&& ds,
+                                int64_t worker_num, int64_t max_worker_num) {
+  return std::make_unique<Stage>(
+      name, std::move(ds), [](int64_t&& x) { return x * 2; }, worker_num, max_worker_num,
+      /*capacity=*/8);
+}
+
+class FakeStage final : public PipelineStage {
+ public:
+  FakeStage(int64_t worker_num, double input_occupancy, double output_occupancy)
+      : name_("fake"),
+        worker_num_(worker_num),
+        input_occupancy_(input_occupancy),
+        output_occupancy_(output_occupancy) {}
+
+  const std::string& name() const override { return name_; }
+  int64_t worker_num() const override { return worker_num_; }
+  int64_t max_worker_num() const override { return 4; }
+  void SetWorkerNum(int64_t worker_num) override { worker_num_ = worker_num; }
+  double InputOccupancy() const override { return input_occupancy_; }
+  double OutputOccupancy() const override { return output_occupancy_; }
+  PipelineStageStats stats() const override { return PipelineStageStats(); }
+  void Close() override {}
+
+ private:
+  std::string name_;
+  int64_t worker_num_;
+  double input_occupancy_;
+  double output_occupancy_;
+};
+
+}  // namespace
+
+TEST(ParallelMapDataset, keep_order_until_end_of_data) {
+  const int64_t sample_num = 201;
+  std::unique_ptr<Dataset<int64_t>> ds(new CountingDataset(sample_num));
+  ds = NewStage("a", std::move(ds), 4, 4);
+  ds = NewStage("b", std::move(ds), 3, 4);
+  for (int64_t i = 0; i < sample_num; ++i) {
+    auto batch = ds->Next();
+    ASSERT_EQ(batch.size(), 1);
+    ASSERT_EQ(batch.at(0), i * 4);
+  }
+  ASSERT_TRUE(ds->Next().empty());
+  ASSERT_TRUE(ds->Next().empty());
+  ds.reset();
+}
+
+TEST(ParallelMapDataset, empty_dataset) {
+  std::unique_ptr<Dataset<int64_t>> ds(new CountingDataset(0));
+  ds = NewStage("a", std::move(ds), 2, 2);
+  ASSERT_TRUE(ds->Next().empty());
+}
+
+TEST(PipelineController, move_workers_to_bottleneck) {
+  // a full input and an empty output make the stage the bottleneck
+  FakeStage fast(3, 0, 1);
+  FakeStage slow(1, 1, 0);
+  PipelineController controller({&fast, &slow}, /*thread_budget=*/4, /*interval_ms=*/0);
+  controller.Rebalance();
+  ASSERT_EQ(fast.worker_num(), 2);
+  ASSERT_EQ(slow.worker_num(), 2);
+  for (int64_t i = 0; i < 4; ++i) { controller.Rebalance(); }
+  // every stage keeps at least one worker
+  ASSERT_EQ(fast.worker_num(), 1);
+  ASSERT_EQ(slow.worker_num(), 3);
+}
+
+TEST(PipelineController, grow_within_budget) {
+  FakeStage first(1, 0, 0);
+  FakeStage second(1, 1, 0);
+  PipelineController controller({&first, &second}, /*thread_budget=*/3, /*interval_ms=*/0);
+  for (int64_t i = 0; i < 4; ++i) { controller.Rebalance(); }
+  ASSERT_EQ(first.worker_num(), 1);
+  ASSERT_EQ(second.worker_num(), 2);
+}
+
+}  // namespace data
+}  // namespace oneflow
@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <csetjmp>
 #include <cstddef>
 #include <iostream>
 
@@ -35,48 +36,89 @@ class LibjpegCtx {
   struct jpeg_decompress_struct* compress_info_;
 };
 
+namespace {
+
+struct JpegErrorManager {
+  struct jpeg_error_mgr pub;
+  jmp_buf jump_buffer;
+};
+
+void JpegErrorExit(j_common_ptr cinfo) {
+  longjmp(reinterpret_cast<JpegErrorManager*>(cinfo->err)->jump_buffer, 1);
+}
+
+}  // namespace
+
+int JpegDctScaleDenom(int crop_width, int crop_height, int target_width, int target_height) {
+  if (target_width <= 0 || target_height <= 0) { return 1; }
+  for (int denom : {8, 4, 2}) {
+    if (crop_width >= target_width * denom && crop_height >= target_height * denom) {
+      return denom;
+    }
+  }
+  return 1;
+}
+
 bool JpegPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
                                       RandomCropGenerator* random_crop_gen,
                                       unsigned char* workspace, size_t workspace_size,
-                                      cv::Mat* out_mat) {
+                                      cv::Mat* out_mat, int target_width, int target_height) {
   struct jpeg_decompress_struct compress_info {};
-  struct jpeg_error_mgr jpeg_err {};
-  compress_info.err = jpeg_std_error(&jpeg_err);
-  jpeg_create_decompress(&compress_info);
-  if (compress_info.err->msg_code != 0) { return false; }
-
+  JpegErrorManager jpeg_err{};
+  compress_info.err = jpeg_std_error(&jpeg_err.pub);
+  jpeg_err.pub.error_exit = JpegErrorExit;
   LibjpegCtx ctx_guard(&compress_info);
+  CropWindow crop;
+  std::vector<unsigned char> decode_output_buf;
+  // NOTE: the default error_exit of libjpeg exits the process, a corrupted or unsupported image
+  // jumps back here instead and is left to the caller (e.g. to decode with OpenCV). Everything
+  // with a destructor must be declared above.
+  if (setjmp(jpeg_err.jump_buffer)) { return false; }
 
+  jpeg_create_decompress(ctx_guard.compress_info());
   jpeg_mem_src(ctx_guard.compress_info(), data, length);
-  if (ctx_guard.compress_info()->err->msg_code != 0) { return false; }
-
   int rc = jpeg_read_header(ctx_guard.compress_info(), TRUE);
   if (rc != JPEG_HEADER_OK) { return false; }
 
-  jpeg_start_decompress(ctx_guard.compress_info());
-  int width = ctx_guard.compress_info()->output_width;
-  int height = ctx_guard.compress_info()->output_height;
-  int pixel_size = ctx_guard.compress_info()->output_components;
-
-  unsigned int u_crop_x = 0, u_crop_y = 0, u_crop_w = width, u_crop_h = height;
+  const int width = ctx_guard.compress_info()->image_width;
+  const int height = ctx_guard.compress_info()->image_height;
+  int crop_x = 0, crop_y = 0, crop_w = width, crop_h = height;
   if (random_crop_gen) {
-    CropWindow crop;
     random_crop_gen->GenerateCropWindow({height, width}, &crop);
-    u_crop_y = crop.anchor.At(0);
-    u_crop_x = crop.anchor.At(1);
-    u_crop_h = crop.shape.At(0);
-    u_crop_w = crop.shape.At(1);
+    crop_y = crop.anchor.At(0);
+    crop_x = crop.anchor.At(1);
+    crop_h = crop.shape.At(0);
+    crop_w = crop.shape.At(1);
   }
 
+  // decode at 1/denom of the resolution in the DCT domain, grayscale images are expanded to RGB
+  const int denom = JpegDctScaleDenom(crop_w, crop_h, target_width, target_height);
+  ctx_guard.compress_info()->scale_num = 1;
+  ctx_guard.compress_info()->scale_denom = denom;
+  ctx_guard.compress_info()->out_color_space = JCS_RGB;
+  jpeg_start_decompress(ctx_guard.compress_info());
+  const unsigned int scaled_width = ctx_guard.compress_info()->output_width;
+  const unsigned int scaled_height = ctx_guard.compress_info()->output_height;
+  const int pixel_size = ctx_guard.compress_info()->output_components;
+  CHECK_EQ(pixel_size, 3);
+
+  // the crop window in the scaled image, rounded outwards to whole scaled pixels
+  unsigned int u_crop_x = crop_x / denom;
+  const unsigned int u_crop_y = crop_y / denom;
+  const unsigned int u_crop_w =
+      std::min<unsigned int>(RoundUp(crop_x + crop_w, denom) / denom, scaled_width) - u_crop_x;
+  const unsigned int u_crop_h =
+      std::min<unsigned int>(RoundUp(crop_y + crop_h, denom) / denom, scaled_height) - u_crop_y;
+
+  // only the iMCU columns covering the window are decoded, the scanlines above it are skipped
   unsigned int tmp_w = u_crop_w;
   jpeg_crop_scanline(ctx_guard.compress_info(), &u_crop_x, &tmp_w);
   if (jpeg_skip_scanlines(ctx_guard.compress_info(), u_crop_y) != u_crop_y) { return false; }
 
   int row_offset = (tmp_w - u_crop_w) * pixel_size;
   int out_row_stride = u_crop_w * pixel_size;
-  std::vector<unsigned char> decode_output_buf;
   unsigned char* decode_output_pointer = nullptr;
-  size_t image_space_size = width * pixel_size;
+  size_t image_space_size = tmp_w * pixel_size;
 
   if (image_space_size > workspace_size) {
     decode_output_buf.resize(image_space_size);
@@ -95,8 +137,8 @@ bool JpegPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
            decode_output_pointer + row_offset, out_row_stride);
   }
 
-  jpeg_skip_scanlines(ctx_guard.compress_info(), height - u_crop_y - u_crop_h);
-  jpeg_finish_decompress(ctx_guard.compress_info());
+  // the scanlines below the window are never decoded
+  jpeg_abort_decompress(ctx_guard.compress_info());
 
   return true;
 }
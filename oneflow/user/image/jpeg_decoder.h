@@ -22,10 +22,19 @@ limitations under the License.
 
 namespace oneflow {
 
+// Returns d in {1, 2, 4, 8} such that a `crop_width` x `crop_height` window decoded at 1/d of the
+// resolution still covers `target_width` x `target_height`, d is 1 when no target is given.
+int JpegDctScaleDenom(int crop_width, int crop_height, int target_width, int target_height);
+
+// Decodes the random crop window of a JPEG image into an RGB `out_mat`, only the part of the
+// image covering the window is decoded. With a target size the window is decoded in the DCT
+// domain at 1/JpegDctScaleDenom of the resolution, so `out_mat` is the window downscaled by that
+// factor and is left for the caller to resize. Returns false if libjpeg can't decode the image.
 bool JpegPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
                                       RandomCropGenerator* random_crop_gen,
                                       unsigned char* workspace, size_t workspace_size,
-                                      cv::Mat* out_mat);
+                                      cv::Mat* out_mat, int target_width = 0,
+                                      int target_height = 0);
 
 void OpenCvPartialDecodeRandomCropImage(const unsigned char* data, size_t length,
                                         RandomCropGenerator* random_crop_gen,
@@ -15,12 +15,14 @@ limitations under the License.
 */
 
 #include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
-#include <iostream>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <opencv2/opencv.hpp>
+#include "oneflow/core/common/util.h"
 #include "oneflow/user/image/jpeg_decoder.h"
 #include "oneflow/user/image/image_util.h"
 
@@ -93,4 +95,111 @@ TEST(JPEG, decoder) {
   }
 }
 
+// generate a photo-like image, smooth gradients with some noise, so the entropy decoding and the
+// IDCT cost about what they cost on natural images
+void GenerateTexturedImage(std::vector<uint8_t>& jpg, int w, int h, int seed) {
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> noise(-12, 12);
+  cv::Mat raw(h, w, CV_8UC3);
+  for (int y = 0; y < h; y++) {
+    uint8_t* row = raw.ptr<uint8_t>(y);
+    for (int x = 0; x < w; x++) {
+      for (int c = 0; c < 3; c++) {
+        const double v = 128 + 90 * std::sin(x * 0.02 * (c + 1) + seed) * std::cos(y * 0.015);
+        row[3 * x + c] = cv::saturate_cast<uint8_t>(v + noise(gen));
+      }
+    }
+  }
+  cv::imencode(".jpg", raw, jpg, {cv::IMWRITE_JPEG_QUALITY, 90});
+}
+
+TEST(JPEG, dct_scale_denom) {
+  ASSERT_EQ(JpegDctScaleDenom(500, 375, 0, 0), 1);
+  ASSERT_EQ(JpegDctScaleDenom(500, 375, 224, 224), 1);
+  ASSERT_EQ(JpegDctScaleDenom(500, 460, 224, 224), 2);
+  ASSERT_EQ(JpegDctScaleDenom(1000, 900, 224, 224), 4);
+  ASSERT_EQ(JpegDctScaleDenom(2000, 1800, 224, 224), 8);
+  ASSERT_EQ(JpegDctScaleDenom(4000, 1800, 224, 224), 8);
+}
+
+TEST(JPEG, scaled_decoder) {
+  std::vector<unsigned char> jpg;
+  GenerateTexturedImage(jpg, 640, 480, 0);
+  cv::Mat full_mat;
+  ASSERT_TRUE(JpegPartialDecodeRandomCropImage(jpg.data(), jpg.size(), nullptr, nullptr, 0,
+                                               &full_mat));
+  for (int target : {200, 100, 40}) {
+    const int denom = JpegDctScaleDenom(640, 480, target, target);
+    cv::Mat scaled_mat;
+    ASSERT_TRUE(JpegPartialDecodeRandomCropImage(jpg.data(), jpg.size(), nullptr, nullptr, 0,
+                                                 &scaled_mat, target, target));
+    ASSERT_EQ(scaled_mat.cols, 640 / denom);
+    ASSERT_EQ(scaled_mat.rows, 480 / denom);
+    ASSERT_GE(scaled_mat.cols, target);
+    ASSERT_GE(scaled_mat.rows, target);
+    // decoding at 1/denom is close to averaging denom x denom blocks of the full image
+    cv::Mat box_mat;
+    cv::resize(full_mat, box_mat, scaled_mat.size(), 0, 0, cv::INTER_AREA);
+    cv::Mat diff;
+    cv::absdiff(box_mat, scaled_mat, diff);
+    const auto mean = cv::mean(diff);
+    for (int c = 0; c < 3; c++) { ASSERT_LT(mean[c], 3); }
+  }
+  std::vector<unsigned char> junk(128, 7);
+  cv::Mat junk_mat;
+  ASSERT_FALSE(JpegPartialDecodeRandomCropImage(junk.data(), junk.size(), nullptr, nullptr, 0,
+                                                &junk_mat, 224, 224));
+}
+
+// Images per second of one core decoding random 224x224 crops of a synthetic corpus, decoding the
+// whole image with OpenCV, decoding the crop window only, and decoding the crop window at a
+// reduced DCT scale.
+TEST(JPEG, decode_random_crop_resize_benchmark) {
+  if (!ParseBooleanFromEnv("ONEFLOW_TEST_BENCHMARK", false)) {
+    GTEST_SKIP() << "set ONEFLOW_TEST_BENCHMARK=1 to run";
+  }
+  constexpr int kTargetSize = 224;
+  constexpr int kIterNum = 3;
+  std::vector<std::vector<unsigned char>> corpus;
+  for (const auto& size : std::vector<std::pair<int, int>>{{500, 375}, {1024, 768}, {2048, 1536}}) {
+    for (int i = 0; i < 8; i++) {
+      corpus.emplace_back();
+      GenerateTexturedImage(corpus.back(), size.first, size.second, i);
+    }
+  }
+  std::vector<unsigned char> workspace(2048 * 3);
+  cv::Mat dst_mat(kTargetSize, kTargetSize, CV_8UC3);
+
+  using DecodeFn = std::function<void(const std::vector<unsigned char>&, RandomCropGenerator*)>;
+  auto run = [&](const std::string& name, const DecodeFn& decode) {
+    RandomCropGenerator random_crop_gen({3.0 / 4, 4.0 / 3}, {0.08, 1.0}, 0, 10);
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterNum; i++) {
+      for (const auto& jpg : corpus) { decode(jpg, &random_crop_gen); }
+    }
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    RecordProperty(name + "_images_per_sec", std::to_string(kIterNum * corpus.size() / seconds));
+  };
+  run("opencv_full_decode", [&](const std::vector<unsigned char>& jpg, RandomCropGenerator* gen) {
+    cv::Mat crop_mat;
+    OpenCvPartialDecodeRandomCropImage(jpg.data(), jpg.size(), gen, "BGR", crop_mat);
+    cv::resize(crop_mat, dst_mat, dst_mat.size(), 0, 0, cv::INTER_LINEAR);
+  });
+  run("libjpeg_roi_decode", [&](const std::vector<unsigned char>& jpg, RandomCropGenerator* gen) {
+    cv::Mat crop_mat;
+    ASSERT_TRUE(JpegPartialDecodeRandomCropImage(jpg.data(), jpg.size(), gen, workspace.data(),
+                                                 workspace.size(), &crop_mat));
+    cv::resize(crop_mat, dst_mat, dst_mat.size(), 0, 0, cv::INTER_LINEAR);
+  });
+  run("libjpeg_roi_decode_with_dct_scaling",
+      [&](const std::vector<unsigned char>& jpg, RandomCropGenerator* gen) {
+        cv::Mat crop_mat;
+        ASSERT_TRUE(JpegPartialDecodeRandomCropImage(jpg.data(), jpg.size(), gen, workspace.data(),
+                                                     workspace.size(), &crop_mat, kTargetSize,
+                                                     kTargetSize));
+        cv::resize(crop_mat, dst_mat, dst_mat.size(), 0, 0, cv::INTER_LINEAR);
+      });
+}
+
 }  // namespace oneflow
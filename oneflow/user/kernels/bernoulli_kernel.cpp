@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/kernels/distributions/common.h"
+#include "oneflow/user/kernels/distributions/philox_sampling.h"
 #include "oneflow/user/kernels/op_kernel_wrapper.h"
 #include "oneflow/user/kernels/random_seed_util.h"
 #include "oneflow/user/kernels/random_mask_generator.h"
@@ -51,12 +52,13 @@ class BernoulliKerenl final : public user_op::OpKernel {
     CHECK_NOTNULL(generator);
     const auto& cpu_generator = CHECK_JUST(generator->Get<one::CPUGeneratorImpl>());
 
-    for (int32_t i = 0; i < out_blob->shape_view().elem_cnt(); ++i) {
-      double prob = static_cast<double>(*(in_dptr + i));
-      CHECK(prob >= 0.0 && prob <= 1.0);
-      std::bernoulli_distribution dis(prob);
-      *(out_dptr + i) = dis(cpu_generator->engine()) ? GetOneVal<K>() : GetZeroVal<K>();
-    }
+    PhiloxParallelSample<PhiloxUniform<double>>(
+        ctx->stream(), cpu_generator.get(), out_blob->shape_view().elem_cnt(),
+        [=](int64_t i, double sample) {
+          const double prob = static_cast<double>(in_dptr[i]);
+          CHECK(prob >= 0.0 && prob <= 1.0);
+          out_dptr[i] = sample < prob ? GetOneVal<K>() : GetZeroVal<K>();
+        });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
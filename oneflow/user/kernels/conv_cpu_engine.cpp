@@ -0,0 +1,708 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/conv_cpu_engine.h"
+#include "oneflow/core/common/blas.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#ifdef WITH_ONEDNN
+#include "oneflow/core/ep/common/onednn.h"
+#endif
+
+namespace oneflow {
+
+namespace {
+
+// The column buffer and the output tile of a task stay in L2 while the gemm and the bias epilogue
+// read them, unless a tile of the minimum number of output positions doesn't fit.
+constexpr int64_t kColTileBytes = 256 * 1024;
+constexpr int64_t kMinTileSize = 64;
+
+struct ConvSizes {
+  ConvSizes(const ConvCpuProblem& problem, int64_t elem_size) {
+    in_channels_per_group = problem.in_channels / problem.groups;
+    out_channels_per_group = problem.out_channels / problem.groups;
+    kernel_size = problem.kernel_dims[0] * problem.kernel_dims[1] * problem.kernel_dims[2];
+    col_rows = in_channels_per_group * kernel_size;
+    in_spatial = problem.in_dims[0] * problem.in_dims[1] * problem.in_dims[2];
+    out_spatial = problem.out_dims[0] * problem.out_dims[1] * problem.out_dims[2];
+    tile_size = std::max(kMinTileSize, kColTileBytes / elem_size / std::max<int64_t>(col_rows, 1));
+    tile_size = std::max<int64_t>(std::min(tile_size, out_spatial), 1);
+    tile_num = (out_spatial + tile_size - 1) / tile_size;
+  }
+
+  int64_t in_channels_per_group;
+  int64_t out_channels_per_group;
+  int64_t kernel_size;
+  // the rows of the columns of a group, in_channels_per_group * kernel_size
+  int64_t col_rows;
+  int64_t in_spatial;
+  int64_t out_spatial;
+  // output positions per task
+  int64_t tile_size;
+  int64_t tile_num;
+};
+
+template<typename T>
+void Gemm(bool trans_a, bool trans_b, int64_t m, int64_t n, int64_t k, const T* a, int64_t lda,
+          const T* b, int64_t ldb, T beta, T* c, int64_t ldc) {
+  cblas_gemm<T>(CblasRowMajor, trans_a ? CblasTrans : CblasNoTrans,
+                trans_b ? CblasTrans : CblasNoTrans, static_cast<int>(m), static_cast<int>(n),
+                static_cast<int>(k), static_cast<T>(1), a, static_cast<int>(lda), b,
+                static_cast<int>(ldb), beta, c, static_cast<int>(ldc));
+}
+
+// The column buffer of the calling thread, kept between tasks.
+template<typename T>
+T* ThreadLocalColBuffer(int64_t elem_cnt) {
+  thread_local std::vector<T> buffer;
+  if (buffer.size() < static_cast<size_t>(elem_cnt)) { buffer.resize(elem_cnt); }
+  return buffer.data();
+}
+
+// The j in [0, n) of the positions (first + j) * stride + offset within [0, limit) are [*lo, *hi).
+void ValidRange(int64_t first, int64_t n, int64_t stride, int64_t offset, int64_t limit,
+                int64_t* lo, int64_t* hi) {
+  const int64_t begin = first * stride + offset;
+  *lo = begin >= 0 ? 0 : std::min(n, (-begin + stride - 1) / stride);
+  *hi = begin >= limit ? 0 : std::min(n, (limit - begin + stride - 1) / stride);
+  *hi = std::max(*hi, *lo);
+}
+
+// Visit(od, oh, ow, n, offset) for the runs of the output positions [first, first + num) within a
+// row, the run starts at the offset-th position of the range.
+template<typename F>
+void ForEachOutputRun(const ConvCpuProblem& problem, int64_t first, int64_t num, const F& Visit) {
+  const int64_t oh_num = problem.out_dims[1];
+  const int64_t ow_num = problem.out_dims[2];
+  int64_t ow = first % ow_num;
+  int64_t oh = (first / ow_num) % oh_num;
+  int64_t od = first / ow_num / oh_num;
+  for (int64_t offset = 0; offset < num;) {
+    const int64_t n = std::min(ow_num - ow, num - offset);
+    Visit(od, oh, ow, n, offset);
+    offset += n;
+    ow = 0;
+    if (++oh == oh_num) {
+      oh = 0;
+      ++od;
+    }
+  }
+}
+
+bool IsValidInput(const ConvCpuProblem& problem, int dim, int64_t index) {
+  return index >= 0 && index < problem.in_dims[dim];
+}
+
+int64_t InputIndex(const ConvCpuProblem& problem, int dim, int64_t out_index, int64_t k_index) {
+  return out_index * problem.strides[dim] + k_index * problem.dilation_rate[dim]
+         - problem.padding_before[dim];
+}
+
+// Channels first columns of a group are [col_rows, num] with the rows ordered as (c, kd, kh, kw).
+// Im2col writes the columns of the output positions [first, first + num), col2im adds them back.
+template<typename T, bool kCol2Im>
+void ChannelsFirstColTile(const ConvCpuProblem& problem, const ConvSizes& sizes, T* img,
+                          int64_t first, int64_t num, T* col) {
+  const int64_t ih_num = problem.in_dims[1];
+  const int64_t iw_num = problem.in_dims[2];
+  const int64_t stride = problem.strides[2];
+  int64_t row = 0;
+  for (int64_t c = 0; c < sizes.in_channels_per_group; ++c) {
+    T* img_channel = img + c * sizes.in_spatial;
+    for (int64_t kd = 0; kd < problem.kernel_dims[0]; ++kd) {
+      for (int64_t kh = 0; kh < problem.kernel_dims[1]; ++kh) {
+        for (int64_t kw = 0; kw < problem.kernel_dims[2]; ++kw) {
+          T* col_row = col + row * num;
+          const int64_t w_offset =
+              kw * problem.dilation_rate[2] - static_cast<int64_t>(problem.padding_before[2]);
+          auto Run = [&](int64_t od, int64_t oh, int64_t ow, int64_t n, int64_t offset) {
+            T* run = col_row + offset;
+            const int64_t id = InputIndex(problem, 0, od, kd);
+            const int64_t ih = InputIndex(problem, 1, oh, kh);
+            if (!IsValidInput(problem, 0, id) || !IsValidInput(problem, 1, ih)) {
+              if (!kCol2Im) { std::fill(run, run + n, T(0)); }
+              return;
+            }
+            int64_t lo = 0;
+            int64_t hi = 0;
+            ValidRange(ow, n, stride, w_offset, iw_num, &lo, &hi);
+            T* img_pos = img_channel + (id * ih_num + ih) * iw_num + ow * stride + w_offset;
+            if (kCol2Im) {
+              for (int64_t j = lo; j < hi; ++j) { img_pos[j * stride] += run[j]; }
+            } else {
+              std::fill(run, run + lo, T(0));
+              for (int64_t j = lo; j < hi; ++j) { run[j] = img_pos[j * stride]; }
+              std::fill(run + hi, run + n, T(0));
+            }
+          };
+          ForEachOutputRun(problem, first, num, Run);
+          row += 1;
+        }
+      }
+    }
+  }
+}
+
+// Channels last columns of a group are [num, col_rows] with the columns ordered as (kd, kh, kw, c),
+// img points to the first channel of the group.
+template<typename T, bool kCol2Im>
+void ChannelsLastColTile(const ConvCpuProblem& problem, const ConvSizes& sizes, T* img,
+                         int64_t first, int64_t num, T* col) {
+  const int64_t channels = problem.in_channels;
+  const int64_t group_channels = sizes.in_channels_per_group;
+  auto Run = [&](int64_t od, int64_t oh, int64_t ow, int64_t n, int64_t offset) {
+    for (int64_t j = 0; j < n; ++j) {
+      T* col_pos = col + (offset + j) * sizes.col_rows;
+      for (int64_t kd = 0; kd < problem.kernel_dims[0]; ++kd) {
+        const int64_t id = InputIndex(problem, 0, od, kd);
+        for (int64_t kh = 0; kh < problem.kernel_dims[1]; ++kh) {
+          const int64_t ih = InputIndex(problem, 1, oh, kh);
+          for (int64_t kw = 0; kw < problem.kernel_dims[2]; ++kw) {
+            const int64_t iw = InputIndex(problem, 2, ow + j, kw);
+            T* dst = col_pos;
+            col_pos += group_channels;
+            if (!IsValidInput(problem, 0, id) || !IsValidInput(problem, 1, ih)
+                || !IsValidInput(problem, 2, iw)) {
+              if (!kCol2Im) { std::fill(dst, dst + group_channels, T(0)); }
+              continue;
+            }
+            T* src = img + ((id * problem.in_dims[1] + ih) * problem.in_dims[2] + iw) * channels;
+            if (kCol2Im) {
+              for (int64_t c = 0; c < group_channels; ++c) { src[c] += dst[c]; }
+            } else {
+              std::copy(src, src + group_channels, dst);
+            }
+          }
+        }
+      }
+    }
+  };
+  ForEachOutputRun(problem, first, num, Run);
+}
+
+template<typename T>
+void Im2ColTile(const ConvCpuProblem& problem, const ConvSizes& sizes, const T* img, int64_t first,
+                int64_t num, T* col) {
+  if (problem.channels_last) {
+    ChannelsLastColTile<T, false>(problem, sizes, const_cast<T*>(img), first, num, col);
+  } else {
+    ChannelsFirstColTile<T, false>(problem, sizes, const_cast<T*>(img), first, num, col);
+  }
+}
+
+template<typename T>
+void Col2ImTile(const ConvCpuProblem& problem, const ConvSizes& sizes, const T* col,
+                int64_t first, int64_t num, T* img) {
+  if (problem.channels_last) {
+    ChannelsLastColTile<T, true>(problem, sizes, img, first, num, const_cast<T*>(col));
+  } else {
+    ChannelsFirstColTile<T, true>(problem, sizes, img, first, num, const_cast<T*>(col));
+  }
+}
+
+template<typename T>
+void AddBiasTile(const ConvCpuProblem& problem, const ConvSizes& sizes, const T* bias,
+                 int64_t first, int64_t num, T* out_img) {
+  const int64_t channels = problem.out_channels;
+  if (problem.channels_last) {
+    for (int64_t i = first; i < first + num; ++i) {
+      T* out_pos = out_img + i * channels;
+      for (int64_t c = 0; c < channels; ++c) { out_pos[c] += bias[c]; }
+    }
+  } else {
+    for (int64_t c = 0; c < channels; ++c) {
+      T* out_run = out_img + c * sizes.out_spatial + first;
+      const T value = bias[c];
+      for (int64_t i = 0; i < num; ++i) { out_run[i] += value; }
+    }
+  }
+}
+
+template<typename T>
+void Im2ColGemmForward(ep::Stream* stream, const ConvCpuProblem& problem, bool is_pointwise,
+                       const T* in, const T* weight, const T* bias, T* out) {
+  const ConvSizes sizes(problem, sizeof(T));
+  const int64_t in_img_size = problem.in_channels * sizes.in_spatial;
+  const int64_t out_img_size = problem.out_channels * sizes.out_spatial;
+  const int64_t group_weight_size = sizes.out_channels_per_group * sizes.col_rows;
+  auto Task = [&](int64_t task) {
+    const T* in_img = in + (task / sizes.tile_num) * in_img_size;
+    T* out_img = out + (task / sizes.tile_num) * out_img_size;
+    const int64_t first = (task % sizes.tile_num) * sizes.tile_size;
+    const int64_t num = std::min(sizes.tile_size, sizes.out_spatial - first);
+    T* col = is_pointwise ? nullptr : ThreadLocalColBuffer<T>(sizes.col_rows * num);
+    for (int64_t g = 0; g < problem.groups; ++g) {
+      const T* group_weight = weight + g * group_weight_size;
+      if (problem.channels_last) {
+        // out[first:first + num, group] = col * weight(T)
+        const T* group_in = in_img + g * sizes.in_channels_per_group;
+        const T* a = is_pointwise ? group_in + first * problem.in_channels : col;
+        const int64_t lda = is_pointwise ? problem.in_channels : sizes.col_rows;
+        if (!is_pointwise) { Im2ColTile(problem, sizes, group_in, first, num, col); }
+        Gemm<T>(false, true, num, sizes.out_channels_per_group, sizes.col_rows, a, lda,
+                group_weight, sizes.col_rows, T(0),
+                out_img + first * problem.out_channels + g * sizes.out_channels_per_group,
+                problem.out_channels);
+      } else {
+        // out[group, first:first + num] = weight * col
+        const T* group_in = in_img + g * sizes.in_channels_per_group * sizes.in_spatial;
+        const T* b = is_pointwise ? group_in + first : col;
+        const int64_t ldb = is_pointwise ? sizes.in_spatial : num;
+        if (!is_pointwise) { Im2ColTile(problem, sizes, group_in, first, num, col); }
+        Gemm<T>(false, false, sizes.out_channels_per_group, num, sizes.col_rows, group_weight,
+                sizes.col_rows, b, ldb, T(0),
+                out_img + g * sizes.out_channels_per_group * sizes.out_spatial + first,
+                sizes.out_spatial);
+      }
+    }
+    if (bias != nullptr) { AddBiasTile(problem, sizes, bias, first, num, out_img); }
+  };
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, problem.batch_size * sizes.tile_num,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t task = begin; task < end; ++task) { Task(task); }
+      },
+      1);
+}
+
+template<typename T>
+void DepthwiseForward(ep::Stream* stream, const ConvCpuProblem& problem, const T* in,
+                      const T* weight, const T* bias, T* out) {
+  const ConvSizes sizes(problem, sizeof(T));
+  const int64_t channels = problem.in_channels;
+  const int64_t od_num = problem.out_dims[0];
+  const int64_t oh_num = problem.out_dims[1];
+  const int64_t ow_num = problem.out_dims[2];
+  const int64_t ih_num = problem.in_dims[1];
+  const int64_t iw_num = problem.in_dims[2];
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  if (problem.channels_last) {
+    // the weight of a kernel position is contiguous over the channels
+    std::vector<T> kernel_major_weight(sizes.kernel_size * channels);
+    for (int64_t c = 0; c < channels; ++c) {
+      for (int64_t k = 0; k < sizes.kernel_size; ++k) {
+        kernel_major_weight[k * channels + c] = weight[c * sizes.kernel_size + k];
+      }
+    }
+    auto Task = [&](int64_t task) {
+      const T* in_img = in + (task / sizes.tile_num) * channels * sizes.in_spatial;
+      T* out_img = out + (task / sizes.tile_num) * channels * sizes.out_spatial;
+      const int64_t first = (task % sizes.tile_num) * sizes.tile_size;
+      const int64_t num = std::min(sizes.tile_size, sizes.out_spatial - first);
+      auto Run = [&](int64_t od, int64_t oh, int64_t ow, int64_t n, int64_t offset) {
+        for (int64_t j = 0; j < n; ++j) {
+          T* out_pos = out_img + (first + offset + j) * channels;
+          if (bias != nullptr) {
+            std::copy(bias, bias + channels, out_pos);
+          } else {
+            std::fill(out_pos, out_pos + channels, T(0));
+          }
+          const T* kernel_weight = kernel_major_weight.data();
+          for (int64_t kd = 0; kd < problem.kernel_dims[0]; ++kd) {
+            const int64_t id = InputIndex(problem, 0, od, kd);
+            for (int64_t kh = 0; kh < problem.kernel_dims[1]; ++kh) {
+              const int64_t ih = InputIndex(problem, 1, oh, kh);
+              for (int64_t kw = 0; kw < problem.kernel_dims[2]; ++kw) {
+                const int64_t iw = InputIndex(problem, 2, ow + j, kw);
+                const T* w = kernel_weight;
+                kernel_weight += channels;
+                if (!IsValidInput(problem, 0, id) || !IsValidInput(problem, 1, ih)
+                    || !IsValidInput(problem, 2, iw)) {
+                  continue;
+                }
+                const T* in_pos = in_img + ((id * ih_num + ih) * iw_num + iw) * channels;
+                for (int64_t c = 0; c < channels; ++c) { out_pos[c] += w[c] * in_pos[c]; }
+              }
+            }
+          }
+        }
+      };
+      ForEachOutputRun(problem, first, num, Run);
+    };
+    cpu_stream->ParallelFor(
+        0, problem.batch_size * sizes.tile_num,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t task = begin; task < end; ++task) { Task(task); }
+        },
+        1);
+  } else {
+    // a task per channel of an image, whose output plane stays in cache
+    auto Task = [&](int64_t task) {
+      const int64_t c = task % channels;
+      const T* in_plane = in + task * sizes.in_spatial;
+      T* out_plane = out + task * sizes.out_spatial;
+      const T* w = weight + c * sizes.kernel_size;
+      std::fill(out_plane, out_plane + sizes.out_spatial, bias != nullptr ? bias[c] : T(0));
+      const int64_t stride = problem.strides[2];
+      for (int64_t od = 0; od < od_num; ++od) {
+        for (int64_t oh = 0; oh < oh_num; ++oh) {
+          T* out_row = out_plane + (od * oh_num + oh) * ow_num;
+          for (int64_t kd = 0; kd < problem.kernel_dims[0]; ++kd) {
+            const int64_t id = InputIndex(problem, 0, od, kd);
+            if (!IsValidInput(problem, 0, id)) { continue; }
+            for (int64_t kh = 0; kh < problem.kernel_dims[1]; ++kh) {
+              const int64_t ih = InputIndex(problem, 1, oh, kh);
+              if (!IsValidInput(problem, 1, ih)) { continue; }
+              const T* in_row = in_plane + (id * ih_num + ih) * iw_num;
+              for (int64_t kw = 0; kw < problem.kernel_dims[2]; ++kw) {
+                const T value = w[(kd * problem.kernel_dims[1] + kh) * problem.kernel_dims[2] + kw];
+                const int64_t w_offset = kw * problem.dilation_rate[2] - problem.padding_before[2];
+                int64_t lo = 0;
+                int64_t hi = 0;
+                ValidRange(0, ow_num, stride, w_offset, iw_num, &lo, &hi);
+                const T* in_pos = in_row + w_offset;
+                if (stride == 1) {
+                  for (int64_t ow = lo; ow < hi; ++ow) { out_row[ow] += value * in_pos[ow]; }
+                } else {
+                  for (int64_t ow = lo; ow < hi; ++ow) {
+                    out_row[ow] += value * in_pos[ow * stride];
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    };
+    cpu_stream->ParallelFor(
+        0, problem.batch_size * channels,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t task = begin; task < end; ++task) { Task(task); }
+        },
+        1);
+  }
+}
+
+bool IsPointwise(const ConvCpuProblem& problem) {
+  for (int i = 0; i < 3; ++i) {
+    if (problem.kernel_dims[i] != 1 || problem.strides[i] != 1 || problem.padding_before[i] != 0
+        || problem.in_dims[i] != problem.out_dims[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+#ifdef WITH_ONEDNN
+
+// A oneDNN convolution of plain layouts, whose primitives are created at the first launch on an
+// engine and reused by the later ones.
+template<typename T>
+class ConvCpuEngine<T>::OneDnnConv final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OneDnnConv);
+  explicit OneDnnConv(const ConvCpuProblem& problem) : problem_(problem) {}
+  ~OneDnnConv() = default;
+
+  void Forward(ep::Stream* stream, const T* in, const T* weight, const T* bias, T* out) {
+    stream->As<ep::CpuStream>()->onednn_executor()->Launch(
+        [&](dnnl::engine* onednn_engine, dnnl::stream* onednn_stream) {
+          const bool with_bias = bias != nullptr;
+          dnnl::convolution_forward primitive;
+          dnnl::convolution_forward::primitive_desc primitive_desc;
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (onednn_engine != engine_) {
+              primitive_descs_[0].reset();
+              primitive_descs_[1].reset();
+              engine_ = onednn_engine;
+            }
+            if (!primitive_descs_[with_bias]) {
+              primitive_descs_[with_bias].reset(NewPrimitiveDesc(*onednn_engine, with_bias));
+              primitives_[with_bias] = dnnl::convolution_forward(*primitive_descs_[with_bias]);
+            }
+            primitive = primitives_[with_bias];
+            primitive_desc = *primitive_descs_[with_bias];
+          }
+          std::unordered_map<int, dnnl::memory> args{
+              {DNNL_ARG_SRC,
+               dnnl::memory(primitive_desc.src_desc(), *onednn_engine, const_cast<T*>(in))},
+              {DNNL_ARG_WEIGHTS,
+               dnnl::memory(primitive_desc.weights_desc(), *onednn_engine,
+                            const_cast<T*>(weight))},
+              {DNNL_ARG_DST, dnnl::memory(primitive_desc.dst_desc(), *onednn_engine, out)}};
+          if (with_bias) {
+            args.emplace(DNNL_ARG_BIAS, dnnl::memory(primitive_desc.bias_desc(), *onednn_engine,
+                                                     const_cast<T*>(bias)));
+          }
+          primitive.execute(*onednn_stream, args);
+        });
+  }
+
+ private:
+  dnnl::convolution_forward::primitive_desc* NewPrimitiveDesc(const dnnl::engine& engine,
+                                                              bool with_bias) const {
+    using tag = dnnl::memory::format_tag;
+    const int num_dims = problem_.num_spatial_dims;
+    const int first_dim = 3 - num_dims;
+    dnnl::memory::dims src_dims{problem_.batch_size, problem_.in_channels};
+    dnnl::memory::dims weights_dims{problem_.out_channels, problem_.in_channels};
+    dnnl::memory::dims dst_dims{problem_.batch_size, problem_.out_channels};
+    dnnl::memory::dims strides;
+    dnnl::memory::dims dilates;
+    dnnl::memory::dims padding_l;
+    dnnl::memory::dims padding_r;
+    for (int i = first_dim; i < 3; ++i) {
+      src_dims.push_back(problem_.in_dims[i]);
+      weights_dims.push_back(problem_.kernel_dims[i]);
+      dst_dims.push_back(problem_.out_dims[i]);
+      strides.push_back(problem_.strides[i]);
+      // the dilation of oneDNN counts the skipped elements
+      dilates.push_back(problem_.dilation_rate[i] - 1);
+      padding_l.push_back(problem_.padding_before[i]);
+      padding_r.push_back((problem_.out_dims[i] - 1) * problem_.strides[i]
+                          + (problem_.kernel_dims[i] - 1) * problem_.dilation_rate[i] + 1
+                          - problem_.in_dims[i] - problem_.padding_before[i]);
+    }
+    const tag channels_first_tags[3] = {tag::ncw, tag::nchw, tag::ncdhw};
+    const tag channels_last_tags[3] = {tag::nwc, tag::nhwc, tag::ndhwc};
+    const tag weights_first_tags[3] = {tag::oiw, tag::oihw, tag::oidhw};
+    const tag weights_last_tags[3] = {tag::owi, tag::ohwi, tag::odhwi};
+    const int tag_index = num_dims - 1;
+    const tag data_tag =
+        problem_.channels_last ? channels_last_tags[tag_index] : channels_first_tags[tag_index];
+    const tag weights_tag =
+        problem_.channels_last ? weights_last_tags[tag_index] : weights_first_tags[tag_index];
+    const auto data_type = dnnl::memory::data_type::f32;
+    const dnnl::memory::desc src_md(src_dims, data_type, data_tag);
+    const dnnl::memory::desc weights_md(weights_dims, data_type, weights_tag);
+    const dnnl::memory::desc dst_md(dst_dims, data_type, data_tag);
+    if (with_bias) {
+      const dnnl::memory::desc bias_md({problem_.out_channels}, data_type, tag::x);
+      const dnnl::convolution_forward::desc desc(
+          dnnl::prop_kind::forward_inference, dnnl::algorithm::convolution_direct, src_md,
+          weights_md, bias_md, dst_md, strides, dilates, padding_l, padding_r);
+      return new dnnl::convolution_forward::primitive_desc(desc, engine);
+    } else {
+      const dnnl::convolution_forward::desc desc(
+          dnnl::prop_kind::forward_inference, dnnl::algorithm::convolution_direct, src_md,
+          weights_md, dst_md, strides, dilates, padding_l, padding_r);
+      return new dnnl::convolution_forward::primitive_desc(desc, engine);
+    }
+  }
+
+  ConvCpuProblem problem_;
+  std::mutex mutex_;
+  dnnl::engine* engine_ = nullptr;
+  // without and with bias
+  std::unique_ptr<dnnl::convolution_forward::primitive_desc> primitive_descs_[2];
+  dnnl::convolution_forward primitives_[2];
+};
+
+#else
+
+template<typename T>
+class ConvCpuEngine<T>::OneDnnConv final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OneDnnConv);
+  explicit OneDnnConv(const ConvCpuProblem& problem) {}
+  ~OneDnnConv() = default;
+
+  void Forward(ep::Stream* stream, const T* in, const T* weight, const T* bias, T* out) {
+    UNIMPLEMENTED();
+  }
+};
+
+#endif  // WITH_ONEDNN
+
+template<typename T>
+ConvCpuEngine<T>::ConvCpuEngine(const ConvCpuProblem& problem)
+    : ConvCpuEngine(problem, [&]() {
+        if (IsSupported(problem, ConvCpuAlgorithm::kDepthwise)) {
+          return ConvCpuAlgorithm::kDepthwise;
+        }
+#ifdef WITH_ONEDNN
+        if (IsSupported(problem, ConvCpuAlgorithm::kOneDnn) && ep::primitive::OneDnnIsEnabled()) {
+          return ConvCpuAlgorithm::kOneDnn;
+        }
+#endif
+        if (IsSupported(problem, ConvCpuAlgorithm::kPointwise)) {
+          return ConvCpuAlgorithm::kPointwise;
+        }
+        return ConvCpuAlgorithm::kIm2ColGemm;
+      }()) {}
+
+template<typename T>
+ConvCpuEngine<T>::ConvCpuEngine(const ConvCpuProblem& problem, ConvCpuAlgorithm algorithm)
+    : problem_(problem), algorithm_(algorithm) {
+  CHECK_GT(problem_.groups, 0);
+  CHECK_EQ(problem_.in_channels % problem_.groups, 0);
+  CHECK_EQ(problem_.out_channels % problem_.groups, 0);
+  CHECK(IsSupported(problem_, algorithm_));
+  if (algorithm_ == ConvCpuAlgorithm::kOneDnn) { onednn_conv_.reset(new OneDnnConv(problem_)); }
+}
+
+template<typename T>
+ConvCpuEngine<T>::~ConvCpuEngine() = default;
+
+template<typename T>
+bool ConvCpuEngine<T>::IsSupported(const ConvCpuProblem& problem, ConvCpuAlgorithm algorithm) {
+  switch (algorithm) {
+    case ConvCpuAlgorithm::kIm2ColGemm: return true;
+    case ConvCpuAlgorithm::kPointwise: return IsPointwise(problem);
+    case ConvCpuAlgorithm::kDepthwise:
+      return problem.groups > 1 && problem.groups == problem.in_channels
+             && problem.groups == problem.out_channels;
+    case ConvCpuAlgorithm::kOneDnn:
+#ifdef WITH_ONEDNN
+      return std::is_same<T, float>::value && problem.groups == 1;
+#else
+      return false;
+#endif
+    default: return false;
+  }
+}
+
+template<typename T>
+void ConvCpuEngine<T>::Forward(ep::Stream* stream, const T* in, const T* weight, const T* bias,
+                               T* out) const {
+  if (problem_.batch_size == 0) { return; }
+  switch (algorithm_) {
+    case ConvCpuAlgorithm::kIm2ColGemm:
+      Im2ColGemmForward(stream, problem_, /*is_pointwise=*/false, in, weight, bias, out);
+      break;
+    case ConvCpuAlgorithm::kPointwise:
+      Im2ColGemmForward(stream, problem_, /*is_pointwise=*/true, in, weight, bias, out);
+      break;
+    case ConvCpuAlgorithm::kDepthwise:
+      DepthwiseForward(stream, problem_, in, weight, bias, out);
+      break;
+    case ConvCpuAlgorithm::kOneDnn: onednn_conv_->Forward(stream, in, weight, bias, out); break;
+    default: UNIMPLEMENTED();
+  }
+}
+
+template<typename T>
+void ConvCpuEngine<T>::BackwardData(ep::Stream* stream, const T* out_diff, const T* weight,
+                                    T* in_diff) const {
+  const ConvSizes sizes(problem_, sizeof(T));
+  const bool is_pointwise = IsPointwise(problem_);
+  const int64_t in_img_size = problem_.in_channels * sizes.in_spatial;
+  const int64_t out_img_size = problem_.out_channels * sizes.out_spatial;
+  const int64_t group_weight_size = sizes.out_channels_per_group * sizes.col_rows;
+  // a task per image, whose tiles scatter to overlapping positions of the image
+  auto Task = [&](int64_t n) {
+    const T* out_diff_img = out_diff + n * out_img_size;
+    T* in_diff_img = in_diff + n * in_img_size;
+    if (!is_pointwise) { std::fill(in_diff_img, in_diff_img + in_img_size, T(0)); }
+    for (int64_t first = 0; first < sizes.out_spatial; first += sizes.tile_size) {
+      const int64_t num = std::min(sizes.tile_size, sizes.out_spatial - first);
+      T* col = is_pointwise ? nullptr : ThreadLocalColBuffer<T>(sizes.col_rows * num);
+      for (int64_t g = 0; g < problem_.groups; ++g) {
+        const T* group_weight = weight + g * group_weight_size;
+        if (problem_.channels_last) {
+          // col = out_diff[first:first + num, group] * weight
+          T* group_in_diff = in_diff_img + g * sizes.in_channels_per_group;
+          T* c = is_pointwise ? group_in_diff + first * problem_.in_channels : col;
+          const int64_t ldc = is_pointwise ? problem_.in_channels : sizes.col_rows;
+          Gemm<T>(false, false, num, sizes.col_rows, sizes.out_channels_per_group,
+                  out_diff_img + first * problem_.out_channels + g * sizes.out_channels_per_group,
+                  problem_.out_channels, group_weight, sizes.col_rows, T(0), c, ldc);
+          if (!is_pointwise) { Col2ImTile(problem_, sizes, col, first, num, group_in_diff); }
+        } else {
+          // col = weight(T) * out_diff[group, first:first + num]
+          T* group_in_diff = in_diff_img + g * sizes.in_channels_per_group * sizes.in_spatial;
+          T* c = is_pointwise ? group_in_diff + first : col;
+          const int64_t ldc = is_pointwise ? sizes.in_spatial : num;
+          Gemm<T>(true, false, sizes.col_rows, num, sizes.out_channels_per_group, group_weight,
+                  sizes.col_rows,
+                  out_diff_img + g * sizes.out_channels_per_group * sizes.out_spatial + first,
+                  sizes.out_spatial, T(0), c, ldc);
+          if (!is_pointwise) { Col2ImTile(problem_, sizes, col, first, num, group_in_diff); }
+        }
+      }
+    }
+  };
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, problem_.batch_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t n = begin; n < end; ++n) { Task(n); }
+      },
+      1);
+}
+
+template<typename T>
+void ConvCpuEngine<T>::BackwardFilter(ep::Stream* stream, const T* out_diff, const T* in,
+                                      T* weight_diff) const {
+  const ConvSizes sizes(problem_, sizeof(T));
+  const bool is_pointwise = IsPointwise(problem_);
+  const int64_t in_img_size = problem_.in_channels * sizes.in_spatial;
+  const int64_t out_img_size = problem_.out_channels * sizes.out_spatial;
+  const int64_t group_weight_size = sizes.out_channels_per_group * sizes.col_rows;
+  const int64_t weight_size = problem_.groups * group_weight_size;
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  // every part of the images accumulates to its own weight diff, which are summed at last
+  const int64_t part_num = std::max<int64_t>(
+      std::min<int64_t>(problem_.batch_size, cpu_stream->device()->GetNumThreads()), 1);
+  std::vector<T> part_weight_diffs((part_num - 1) * weight_size);
+  auto Task = [&](int64_t part) {
+    T* part_weight_diff =
+        part == 0 ? weight_diff : part_weight_diffs.data() + (part - 1) * weight_size;
+    std::fill(part_weight_diff, part_weight_diff + weight_size, T(0));
+    const int64_t begin = problem_.batch_size * part / part_num;
+    const int64_t end = problem_.batch_size * (part + 1) / part_num;
+    for (int64_t n = begin; n < end; ++n) {
+      const T* out_diff_img = out_diff + n * out_img_size;
+      const T* in_img = in + n * in_img_size;
+      for (int64_t first = 0; first < sizes.out_spatial; first += sizes.tile_size) {
+        const int64_t num = std::min(sizes.tile_size, sizes.out_spatial - first);
+        T* col = is_pointwise ? nullptr : ThreadLocalColBuffer<T>(sizes.col_rows * num);
+        for (int64_t g = 0; g < problem_.groups; ++g) {
+          T* group_weight_diff = part_weight_diff + g * group_weight_size;
+          if (problem_.channels_last) {
+            // weight_diff += out_diff[first:first + num, group](T) * col
+            const T* group_in = in_img + g * sizes.in_channels_per_group;
+            const T* b = is_pointwise ? group_in + first * problem_.in_channels : col;
+            const int64_t ldb = is_pointwise ? problem_.in_channels : sizes.col_rows;
+            if (!is_pointwise) { Im2ColTile(problem_, sizes, group_in, first, num, col); }
+            Gemm<T>(true, false, sizes.out_channels_per_group, sizes.col_rows, num,
+                    out_diff_img + first * problem_.out_channels + g * sizes.out_channels_per_group,
+                    problem_.out_channels, b, ldb, T(1), group_weight_diff, sizes.col_rows);
+          } else {
+            // weight_diff += out_diff[group, first:first + num] * col(T)
+            const T* group_in = in_img + g * sizes.in_channels_per_group * sizes.in_spatial;
+            const T* b = is_pointwise ? group_in + first : col;
+            const int64_t ldb = is_pointwise ? sizes.in_spatial : num;
+            if (!is_pointwise) { Im2ColTile(problem_, sizes, group_in, first, num, col); }
+            Gemm<T>(false, true, sizes.out_channels_per_group, sizes.col_rows, num,
+                    out_diff_img + g * sizes.out_channels_per_group * sizes.out_spatial + first,
+                    sizes.out_spatial, b, ldb, T(1), group_weight_diff, sizes.col_rows);
+          }
+        }
+      }
+    }
+  };
+  cpu_stream->ParallelFor(
+      0, part_num,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t part = begin; part < end; ++part) { Task(part); }
+      },
+      1);
+  if (part_num == 1) { return; }
+  cpu_stream->ParallelFor(0, weight_size, [&](int64_t begin, int64_t end) {
+    for (int64_t part = 1; part < part_num; ++part) {
+      const T* part_weight_diff = part_weight_diffs.data() + (part - 1) * weight_size;
+      for (int64_t i = begin; i < end; ++i) { weight_diff[i] += part_weight_diff[i]; }
+    }
+  });
+}
+
+template class ConvCpuEngine<float>;
+template class ConvCpuEngine<double>;
+
+}  // namespace oneflow
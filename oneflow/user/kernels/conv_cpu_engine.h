@@ -0,0 +1,87 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CONV_CPU_ENGINE_H_
+#define ONEFLOW_USER_KERNELS_CONV_CPU_ENGINE_H_
+
+#include <memory>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/ep/include/stream.h"
+
+namespace oneflow {
+
+// A convolution of batch_size images whose spatial dims are padded to 3 by leading 1s. The weight
+// is [out_channels, in_channels / groups, kd, kh, kw] for channels first and
+// [out_channels, kd, kh, kw, in_channels / groups] for channels last.
+struct ConvCpuProblem {
+  int64_t batch_size = 0;
+  int64_t in_channels = 0;
+  int64_t out_channels = 0;
+  int64_t groups = 1;
+  // the number of the original spatial dims, the trailing ones of the 3 below
+  int32_t num_spatial_dims = 3;
+  int64_t in_dims[3] = {1, 1, 1};
+  int64_t out_dims[3] = {1, 1, 1};
+  int64_t kernel_dims[3] = {1, 1, 1};
+  int32_t strides[3] = {1, 1, 1};
+  int32_t dilation_rate[3] = {1, 1, 1};
+  int32_t padding_before[3] = {0, 0, 0};
+  bool channels_last = false;
+};
+
+enum class ConvCpuAlgorithm {
+  // columns of a tile of output positions at a time, multiplied by the weight
+  kIm2ColGemm,
+  // 1x1 kernels of stride 1 without padding, which multiply the images by the weight directly
+  kPointwise,
+  // a filter per channel, accumulated in place without columns
+  kDepthwise,
+  kOneDnn,
+};
+
+// Runs the convolutions of the cpu conv kernels. The work is split into tasks of an image and a
+// tile of output positions, which the threads of the stream run with their own column buffers.
+template<typename T>
+class ConvCpuEngine final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ConvCpuEngine);
+  // Selects the fastest supported algorithm for the forward pass.
+  explicit ConvCpuEngine(const ConvCpuProblem& problem);
+  ConvCpuEngine(const ConvCpuProblem& problem, ConvCpuAlgorithm algorithm);
+  ~ConvCpuEngine();
+
+  static bool IsSupported(const ConvCpuProblem& problem, ConvCpuAlgorithm algorithm);
+
+  const ConvCpuProblem& problem() const { return problem_; }
+  ConvCpuAlgorithm algorithm() const { return algorithm_; }
+
+  // out = conv(in, weight) + bias, bias may be nullptr.
+  void Forward(ep::Stream* stream, const T* in, const T* weight, const T* bias, T* out) const;
+  // Overwrites in_diff by the gradient of in.
+  void BackwardData(ep::Stream* stream, const T* out_diff, const T* weight, T* in_diff) const;
+  // Overwrites weight_diff by the gradient of weight.
+  void BackwardFilter(ep::Stream* stream, const T* out_diff, const T* in, T* weight_diff) const;
+
+ private:
+  class OneDnnConv;
+
+  ConvCpuProblem problem_;
+  ConvCpuAlgorithm algorithm_;
+  std::unique_ptr<OneDnnConv> onednn_conv_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CONV_CPU_ENGINE_H_
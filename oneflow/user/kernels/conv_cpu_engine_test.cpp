@@ -0,0 +1,365 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <thread>
+#include "oneflow/core/common/util.h"
+#include "oneflow/user/kernels/conv_cpu_engine.h"
+#include "oneflow/core/common/blas.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+#include "oneflow/core/ep/test/test_util.h"
+
+namespace oneflow {
+
+namespace {
+
+class ConvCpuEngineTest : public ep::test::TestCase {};
+
+// Same padding before and after.
+ConvCpuProblem MakeProblem(int64_t batch_size, int64_t in_channels, int64_t out_channels,
+                           int64_t groups, const std::vector<int64_t>& in_dims,
+                           const std::vector<int64_t>& kernel_dims,
+                           const std::vector<int32_t>& strides,
+                           const std::vector<int32_t>& dilation_rate,
+                           const std::vector<int32_t>& padding, bool channels_last) {
+  ConvCpuProblem problem;
+  problem.batch_size = batch_size;
+  problem.in_channels = in_channels;
+  problem.out_channels = out_channels;
+  problem.groups = groups;
+  problem.num_spatial_dims = in_dims.size();
+  problem.channels_last = channels_last;
+  const int first = 3 - in_dims.size();
+  for (int i = first; i < 3; ++i) {
+    const int j = i - first;
+    problem.in_dims[i] = in_dims.at(j);
+    problem.kernel_dims[i] = kernel_dims.at(j);
+    problem.strides[i] = strides.at(j);
+    problem.dilation_rate[i] = dilation_rate.at(j);
+    problem.padding_before[i] = padding.at(j);
+    problem.out_dims[i] =
+        (in_dims.at(j) + 2 * padding.at(j) - dilation_rate.at(j) * (kernel_dims.at(j) - 1) - 1)
+            / strides.at(j)
+        + 1;
+  }
+  return problem;
+}
+
+int64_t Volume(const int64_t* dims) { return dims[0] * dims[1] * dims[2]; }
+
+int64_t DataIndex(const ConvCpuProblem& problem, const int64_t* dims, int64_t channels, int64_t n,
+                  int64_t c, int64_t d, int64_t h, int64_t w) {
+  const int64_t spatial = (d * dims[1] + h) * dims[2] + w;
+  if (problem.channels_last) { return (n * Volume(dims) + spatial) * channels + c; }
+  return (n * channels + c) * Volume(dims) + spatial;
+}
+
+int64_t WeightIndex(const ConvCpuProblem& problem, int64_t f, int64_t c, int64_t kd, int64_t kh,
+                    int64_t kw) {
+  const int64_t group_channels = problem.in_channels / problem.groups;
+  const int64_t k = (kd * problem.kernel_dims[1] + kh) * problem.kernel_dims[2] + kw;
+  if (problem.channels_last) { return (f * Volume(problem.kernel_dims) + k) * group_channels + c; }
+  return (f * group_channels + c) * Volume(problem.kernel_dims) + k;
+}
+
+// Visit(in_index, weight_index, out_index) for every product of the convolution.
+void ForEachProduct(const ConvCpuProblem& problem,
+                    const std::function<void(int64_t, int64_t, int64_t)>& Visit) {
+  const int64_t group_channels = problem.in_channels / problem.groups;
+  const int64_t group_filters = problem.out_channels / problem.groups;
+  for (int64_t n = 0; n < problem.batch_size; ++n) {
+    for (int64_t f = 0; f < problem.out_channels; ++f) {
+      for (int64_t od = 0; od < problem.out_dims[0]; ++od) {
+        for (int64_t oh = 0; oh < problem.out_dims[1]; ++oh) {
+          for (int64_t ow = 0; ow < problem.out_dims[2]; ++ow) {
+            const int64_t out_index = DataIndex(problem, problem.out_dims, problem.out_channels,
+                                                n, f, od, oh, ow);
+            for (int64_t c = 0; c < group_channels; ++c) {
+              for (int64_t kd = 0; kd < problem.kernel_dims[0]; ++kd) {
+                for (int64_t kh = 0; kh < problem.kernel_dims[1]; ++kh) {
+                  for (int64_t kw = 0; kw < problem.kernel_dims[2]; ++kw) {
+                    const int64_t id = od * problem.strides[0] + kd * problem.dilation_rate[0]
+                                       - problem.padding_before[0];
+                    const int64_t ih = oh * problem.strides[1] + kh * problem.dilation_rate[1]
+                                       - problem.padding_before[1];
+                    const int64_t iw = ow * problem.strides[2] + kw * problem.dilation_rate[2]
+                                       - problem.padding_before[2];
+                    if (id < 0 || id >= problem.in_dims[0] || ih < 0 || ih >= problem.in_dims[1]
+                        || iw < 0 || iw >= problem.in_dims[2]) {
+                      continue;
+                    }
+                    const int64_t in_channel = f / group_filters * group_channels + c;
+                    Visit(DataIndex(problem, problem.in_dims, problem.in_channels, n, in_channel,
+                                    id, ih, iw),
+                          WeightIndex(problem, f, c, kd, kh, kw), out_index);
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template<typename T>
+std::vector<T> RandomVector(int64_t size, std::mt19937* gen) {
+  std::uniform_real_distribution<double> dis(-1, 1);
+  std::vector<T> vec(size);
+  for (auto& value : vec) { value = static_cast<T>(dis(*gen)); }
+  return vec;
+}
+
+template<typename T>
+void AssertNear(const std::vector<T>& values, const std::vector<double>& expected, double tol,
+                const std::string& what) {
+  ASSERT_EQ(values.size(), expected.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_NEAR(values[i], expected[i], tol * (1 + std::abs(expected[i]))) << what << " " << i;
+  }
+}
+
+template<typename T>
+void TestConvCpuEngine(ep::CpuDevice* device, const ConvCpuProblem& problem, double tol) {
+  std::mt19937 gen(0);
+  const int64_t in_size = problem.batch_size * problem.in_channels * Volume(problem.in_dims);
+  const int64_t out_size = problem.batch_size * problem.out_channels * Volume(problem.out_dims);
+  const int64_t weight_size = problem.out_channels * problem.in_channels / problem.groups
+                              * Volume(problem.kernel_dims);
+  const auto in = RandomVector<T>(in_size, &gen);
+  const auto weight = RandomVector<T>(weight_size, &gen);
+  const auto bias = RandomVector<T>(problem.out_channels, &gen);
+  const auto out_diff = RandomVector<T>(out_size, &gen);
+  std::vector<double> expected_out(out_size);
+  std::vector<double> expected_in_diff(in_size);
+  std::vector<double> expected_weight_diff(weight_size);
+  ForEachProduct(problem, [&](int64_t i, int64_t w, int64_t o) {
+    expected_out[o] += static_cast<double>(in[i]) * weight[w];
+    expected_in_diff[i] += static_cast<double>(weight[w]) * out_diff[o];
+    expected_weight_diff[w] += static_cast<double>(out_diff[o]) * in[i];
+  });
+  std::vector<double> expected_out_with_bias(expected_out);
+  const int64_t out_spatial = Volume(problem.out_dims);
+  for (int64_t i = 0; i < out_size; ++i) {
+    const int64_t f = problem.channels_last ? i % problem.out_channels
+                                            : i / out_spatial % problem.out_channels;
+    expected_out_with_bias[i] += bias[f];
+  }
+  for (int64_t thread_num : {1, 3}) {
+    device->SetNumThreads(thread_num);
+    ep::test::StreamGuard stream(device);
+    for (auto algorithm : {ConvCpuAlgorithm::kIm2ColGemm, ConvCpuAlgorithm::kPointwise,
+                           ConvCpuAlgorithm::kDepthwise, ConvCpuAlgorithm::kOneDnn}) {
+      if (!ConvCpuEngine<T>::IsSupported(problem, algorithm)) { continue; }
+      const std::string what = "algorithm " + std::to_string(static_cast<int>(algorithm))
+                               + " threads " + std::to_string(thread_num);
+      ConvCpuEngine<T> engine(problem, algorithm);
+      std::vector<T> out(out_size, T(7));
+      engine.Forward(stream.stream(), in.data(), weight.data(), nullptr, out.data());
+      AssertNear(out, expected_out, tol, what + " out");
+      engine.Forward(stream.stream(), in.data(), weight.data(), bias.data(), out.data());
+      AssertNear(out, expected_out_with_bias, tol, what + " out with bias");
+    }
+    ConvCpuEngine<T> engine(problem);
+    std::vector<T> in_diff(in_size, T(7));
+    engine.BackwardData(stream.stream(), out_diff.data(), weight.data(), in_diff.data());
+    AssertNear(in_diff, expected_in_diff, tol, "in diff");
+    std::vector<T> weight_diff(weight_size, T(7));
+    engine.BackwardFilter(stream.stream(), out_diff.data(), in.data(), weight_diff.data());
+    AssertNear(weight_diff, expected_weight_diff, tol, "weight diff");
+  }
+  device->SetNumThreads(1);
+}
+
+std::vector<ConvCpuProblem> TestProblems(bool channels_last) {
+  return {
+      MakeProblem(2, 3, 4, 1, {7, 9}, {3, 3}, {1, 1}, {1, 1}, {1, 1}, channels_last),
+      MakeProblem(3, 2, 3, 1, {8, 7}, {3, 2}, {2, 2}, {1, 1}, {0, 0}, channels_last),
+      MakeProblem(2, 3, 2, 1, {9, 9}, {3, 3}, {1, 2}, {2, 2}, {2, 1}, channels_last),
+      MakeProblem(2, 4, 6, 2, {6, 7}, {3, 3}, {1, 1}, {1, 1}, {1, 1}, channels_last),
+      MakeProblem(2, 5, 5, 5, {7, 8}, {3, 3}, {1, 1}, {1, 1}, {1, 1}, channels_last),
+      MakeProblem(2, 5, 5, 5, {9, 9}, {3, 3}, {2, 2}, {2, 1}, {1, 0}, channels_last),
+      MakeProblem(2, 6, 5, 1, {8, 8}, {1, 1}, {1, 1}, {1, 1}, {0, 0}, channels_last),
+      MakeProblem(2, 6, 4, 2, {5, 3}, {1, 1}, {1, 1}, {1, 1}, {0, 0}, channels_last),
+      MakeProblem(3, 2, 3, 1, {17}, {5}, {2}, {1}, {2}, channels_last),
+      MakeProblem(2, 2, 3, 1, {4, 5, 6}, {2, 3, 3}, {1, 2, 1}, {1, 1, 2}, {1, 1, 0},
+                  channels_last),
+      // several tiles per image, which start in the middle of the rows
+      MakeProblem(2, 64, 8, 1, {20, 19}, {3, 3}, {1, 1}, {1, 1}, {1, 1}, channels_last),
+      MakeProblem(0, 2, 3, 1, {5, 5}, {3, 3}, {1, 1}, {1, 1}, {1, 1}, channels_last),
+  };
+}
+
+}  // namespace
+
+TEST_F(ConvCpuEngineTest, same_as_reference) {
+  if (available_device_types_.count(DeviceType::kCPU) == 0) { return; }
+  auto device = device_manager_registry_.GetDevice(DeviceType::kCPU, 0);
+  auto* cpu_device = dynamic_cast<ep::CpuDevice*>(device.get());
+  for (bool channels_last : {false, true}) {
+    for (const auto& problem : TestProblems(channels_last)) {
+      TestConvCpuEngine<float>(cpu_device, problem, 1e-4);
+      TestConvCpuEngine<double>(cpu_device, problem, 1e-10);
+    }
+  }
+}
+
+namespace {
+
+// The cpu conv kernels before the engine: the columns of a whole image, then a gemm and another
+// rank 1 gemm for the bias per image.
+void LegacyForward(const ConvCpuProblem& problem, const float* in, const float* weight,
+                   const float* bias, float* out) {
+  const int64_t group_channels = problem.in_channels / problem.groups;
+  const int64_t group_filters = problem.out_channels / problem.groups;
+  const int64_t kernel_size = Volume(problem.kernel_dims);
+  const int64_t in_spatial = Volume(problem.in_dims);
+  const int64_t out_spatial = Volume(problem.out_dims);
+  std::vector<float> col(group_channels * kernel_size * out_spatial);
+  std::vector<float> ones(out_spatial, 1.0f);
+  for (int64_t n = 0; n < problem.batch_size; ++n) {
+    for (int64_t g = 0; g < problem.groups; ++g) {
+      float* col_pos = col.data();
+      const float* group_in = in + (n * problem.in_channels + g * group_channels) * in_spatial;
+      for (int64_t c = 0; c < group_channels; ++c) {
+        for (int64_t kd = 0; kd < problem.kernel_dims[0]; ++kd) {
+          for (int64_t kh = 0; kh < problem.kernel_dims[1]; ++kh) {
+            for (int64_t kw = 0; kw < problem.kernel_dims[2]; ++kw) {
+              for (int64_t od = 0; od < problem.out_dims[0]; ++od) {
+                for (int64_t oh = 0; oh < problem.out_dims[1]; ++oh) {
+                  for (int64_t ow = 0; ow < problem.out_dims[2]; ++ow) {
+                    const int64_t id = od * problem.strides[0] + kd * problem.dilation_rate[0]
+                                       - problem.padding_before[0];
+                    const int64_t ih = oh * problem.strides[1] + kh * problem.dilation_rate[1]
+                                       - problem.padding_before[1];
+                    const int64_t iw = ow * problem.strides[2] + kw * problem.dilation_rate[2]
+                                       - problem.padding_before[2];
+                    const bool valid = id >= 0 && id < problem.in_dims[0] && ih >= 0
+                                       && ih < problem.in_dims[1] && iw >= 0
+                                       && iw < problem.in_dims[2];
+                    *(col_pos++) =
+                        valid ? group_in[c * in_spatial
+                                         + (id * problem.in_dims[1] + ih) * problem.in_dims[2]
+                                         + iw]
+                              : 0.0f;
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+      float* group_out = out + (n * problem.out_channels + g * group_filters) * out_spatial;
+      cblas_gemm<float>(CblasRowMajor, CblasNoTrans, CblasNoTrans, group_filters, out_spatial,
+                        group_channels * kernel_size, 1.0f,
+                        weight + g * group_filters * group_channels * kernel_size,
+                        group_channels * kernel_size, col.data(), out_spatial, 0.0f, group_out,
+                        out_spatial);
+    }
+    cblas_gemm<float>(CblasRowMajor, CblasNoTrans, CblasNoTrans, problem.out_channels,
+                      out_spatial, 1, 1.0f, bias, 1, ones.data(), out_spatial, 1.0f,
+                      out + n * problem.out_channels * out_spatial, out_spatial);
+  }
+}
+
+}  // namespace
+
+TEST_F(ConvCpuEngineTest, benchmark) {
+  if (!ParseBooleanFromEnv("ONEFLOW_TEST_BENCHMARK", false)) {
+    GTEST_SKIP() << "set ONEFLOW_TEST_BENCHMARK=1 to run";
+  }
+  if (available_device_types_.count(DeviceType::kCPU) == 0) { return; }
+  auto device = device_manager_registry_.GetDevice(DeviceType::kCPU, 0);
+  auto* cpu_device = dynamic_cast<ep::CpuDevice*>(device.get());
+  const size_t old_thread_num = cpu_device->GetNumThreads();
+  const int64_t batch_size = 4;
+  const std::vector<std::pair<std::string, ConvCpuProblem>> layers = {
+      {"resnet50 conv1 7x7/2",
+       MakeProblem(batch_size, 3, 64, 1, {224, 224}, {7, 7}, {2, 2}, {1, 1}, {3, 3}, false)},
+      {"resnet50 res2 3x3",
+       MakeProblem(batch_size, 64, 64, 1, {56, 56}, {3, 3}, {1, 1}, {1, 1}, {1, 1}, false)},
+      {"resnet50 res2 1x1",
+       MakeProblem(batch_size, 256, 64, 1, {56, 56}, {1, 1}, {1, 1}, {1, 1}, {0, 0}, false)},
+      {"resnet50 res3 3x3/2",
+       MakeProblem(batch_size, 128, 128, 1, {56, 56}, {3, 3}, {2, 2}, {1, 1}, {1, 1}, false)},
+      {"resnet50 res5 3x3",
+       MakeProblem(batch_size, 512, 512, 1, {7, 7}, {3, 3}, {1, 1}, {1, 1}, {1, 1}, false)},
+      {"mobilenet_v2 depthwise 3x3",
+       MakeProblem(batch_size, 144, 144, 144, {56, 56}, {3, 3}, {1, 1}, {1, 1}, {1, 1}, false)},
+      {"mobilenet_v2 depthwise 3x3/2",
+       MakeProblem(batch_size, 96, 96, 96, {112, 112}, {3, 3}, {2, 2}, {1, 1}, {1, 1}, false)},
+      {"mobilenet_v2 pointwise 1x1",
+       MakeProblem(batch_size, 24, 144, 1, {56, 56}, {1, 1}, {1, 1}, {1, 1}, {0, 0}, false)},
+  };
+  const int64_t thread_num = std::max<int64_t>(1, std::thread::hardware_concurrency());
+  const double kMinSeconds = 0.2;
+  std::mt19937 gen(0);
+  for (size_t layer_index = 0; layer_index < layers.size(); ++layer_index) {
+    const auto& layer = layers.at(layer_index);
+    const ConvCpuProblem& problem = layer.second;
+    const int64_t weight_size = problem.out_channels * problem.in_channels / problem.groups
+                                * Volume(problem.kernel_dims);
+    const auto in = RandomVector<float>(
+        problem.batch_size * problem.in_channels * Volume(problem.in_dims), &gen);
+    const auto weight = RandomVector<float>(weight_size, &gen);
+    const auto bias = RandomVector<float>(problem.out_channels, &gen);
+    std::vector<float> out(problem.batch_size * problem.out_channels * Volume(problem.out_dims));
+    std::vector<float> expected(out.size());
+    const double gflop = 2.0 * out.size() * weight_size / problem.out_channels / 1e9;
+    auto GFlops = [&](const std::function<void()>& Run) {
+      Run();
+      const auto start = std::chrono::steady_clock::now();
+      int64_t iter_num = 0;
+      double seconds = 0;
+      while (seconds < kMinSeconds) {
+        Run();
+        iter_num += 1;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      }
+      return iter_num * gflop / seconds;
+    };
+    std::ostringstream report;
+    report << layer.first << ": legacy " << GFlops([&]() {
+      LegacyForward(problem, in.data(), weight.data(), bias.data(), expected.data());
+    }) << " GFLOPS";
+    ep::test::StreamGuard stream(device.get());
+    for (auto algorithm : {ConvCpuAlgorithm::kIm2ColGemm, ConvCpuAlgorithm::kPointwise,
+                           ConvCpuAlgorithm::kDepthwise, ConvCpuAlgorithm::kOneDnn}) {
+      if (!ConvCpuEngine<float>::IsSupported(problem, algorithm)) { continue; }
+      ConvCpuEngine<float> engine(problem, algorithm);
+      auto Run = [&]() {
+        engine.Forward(stream.stream(), in.data(), weight.data(), bias.data(), out.data());
+      };
+      cpu_device->SetNumThreads(1);
+      const double single_thread_gflops = GFlops(Run);
+      cpu_device->SetNumThreads(thread_num);
+      const double multi_thread_gflops = GFlops(Run);
+      cpu_device->SetNumThreads(old_thread_num);
+      for (size_t i = 0; i < out.size(); ++i) {
+        ASSERT_NEAR(out[i], expected[i], 1e-3 * (1 + std::abs(expected[i])));
+      }
+      report << ", algorithm " << static_cast<int>(algorithm) << " " << single_thread_gflops
+             << " on 1 thread " << multi_thread_gflops << " on " << thread_num << " threads";
+    }
+    RecordProperty("layer_" + std::to_string(layer_index), report.str());
+  }
+}
+
+}  // namespace oneflow
@@ -16,6 +16,7 @@ limitations under the License.
 
 #include "oneflow/user/kernels/distributions/normal_distribution.h"
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/distributions/philox_sampling.h"
 
 namespace oneflow {
 
@@ -25,8 +26,11 @@ void NormalDistribution<DeviceType::kCPU, T>::operator()(
     const std::shared_ptr<one::Generator>& generator) const {
   CHECK_GE(elem_cnt, 0);
   auto gen = CHECK_JUST(generator->Get<one::CPUGeneratorImpl>());
-  std::normal_distribution<T> random_distribution(mean_, std_);
-  for (int64_t i = 0; i < elem_cnt; ++i) { dptr[i] = random_distribution(gen->engine()); }
+  const T mean = mean_;
+  const T stddev = std_;
+  PhiloxParallelSample<PhiloxNormal<T>>(stream, gen.get(), elem_cnt, [=](int64_t i, T sample) {
+    dptr[i] = mean + sample * stddev;
+  });
 }
 
 #define INITIATE_CPU_NORMAL_DISTRIBUTION(T, typeproto)               \
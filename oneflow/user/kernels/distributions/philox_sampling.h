@@ -0,0 +1,108 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_DISTRIBUTIONS_PHILOX_SAMPLING_H_
+#define ONEFLOW_USER_KERNELS_DISTRIBUTIONS_PHILOX_SAMPLING_H_
+
+#include <cmath>
+#include "oneflow/core/common/philox.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/framework/random_generator_impl.h"
+
+namespace oneflow {
+
+// Blocks generated at once by a thread, and the least blocks worth a task of ParallelFor.
+constexpr int64_t kPhiloxBatchBlockNum = 256;
+constexpr int64_t kPhiloxParallelGrainBlockNum = 8192;
+
+// Maps the words of a Philox block to kSampleNum samples of uniform [0, 1).
+template<typename T>
+struct PhiloxUniform;
+
+template<>
+struct PhiloxUniform<float> {
+  using ValueType = float;
+  static constexpr int kSampleNum = Philox4x32::kBlockSize;
+  static void Sample(const uint32_t* bits, float* out) {
+    for (int i = 0; i < kSampleNum; ++i) { out[i] = (bits[i] >> 8) * (1.0f / (1 << 24)); }
+  }
+};
+
+template<>
+struct PhiloxUniform<double> {
+  using ValueType = double;
+  static constexpr int kSampleNum = Philox4x32::kBlockSize / 2;
+  static void Sample(const uint32_t* bits, double* out) {
+    for (int i = 0; i < kSampleNum; ++i) {
+      const uint64_t mantissa =
+          (static_cast<uint64_t>(bits[2 * i]) << 21) ^ (bits[2 * i + 1] >> 11);
+      out[i] = mantissa * (1.0 / (static_cast<uint64_t>(1) << 53));
+    }
+  }
+};
+
+// Standard normal samples by the Box-Muller transform of pairs of uniform samples.
+template<typename T>
+struct PhiloxNormal {
+  using ValueType = T;
+  static constexpr int kSampleNum = PhiloxUniform<T>::kSampleNum;
+  static void Sample(const uint32_t* bits, T* out) {
+    T uniform[kSampleNum];
+    PhiloxUniform<T>::Sample(bits, uniform);
+    for (int i = 0; i < kSampleNum; i += 2) {
+      // 1 - u is in (0, 1], which keeps the log finite
+      const T radius = std::sqrt(static_cast<T>(-2) * std::log(1 - uniform[i]));
+      const T theta = static_cast<T>(2 * M_PI) * uniform[i + 1];
+      out[i] = radius * std::cos(theta);
+      out[i + 1] = radius * std::sin(theta);
+    }
+  }
+};
+
+// Reserves the blocks of elem_cnt samples of Distribution from the Philox stream of the generator
+// and calls Transform(i, sample) for every i in [0, elem_cnt) in parallel on the stream. Sample i
+// only depends on the seed and offset of the generator, whatever the number of threads is.
+template<typename Distribution, typename F>
+void PhiloxParallelSample(ep::Stream* stream, one::CPUGeneratorImpl* generator, int64_t elem_cnt,
+                          const F& Transform) {
+  using T = typename Distribution::ValueType;
+  constexpr int64_t kSampleNum = Distribution::kSampleNum;
+  CHECK_GE(elem_cnt, 0);
+  if (elem_cnt == 0) { return; }
+  const int64_t block_num = (elem_cnt + kSampleNum - 1) / kSampleNum;
+  const uint64_t offset = generator->ReservePhiloxBlocks(block_num);
+  const Philox4x32& philox = generator->philox();
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, block_num,
+      [&](int64_t begin, int64_t end) {
+        uint32_t bits[kPhiloxBatchBlockNum * Philox4x32::kBlockSize];
+        T samples[kSampleNum];
+        for (int64_t batch_begin = begin; batch_begin < end; batch_begin += kPhiloxBatchBlockNum) {
+          const int64_t batch_size = std::min(end - batch_begin, kPhiloxBatchBlockNum);
+          philox.Generate(offset + batch_begin, batch_size, bits);
+          for (int64_t block = 0; block < batch_size; ++block) {
+            Distribution::Sample(bits + block * Philox4x32::kBlockSize, samples);
+            const int64_t first = (batch_begin + block) * kSampleNum;
+            const int64_t sample_num = std::min(elem_cnt - first, kSampleNum);
+            for (int64_t i = 0; i < sample_num; ++i) { Transform(first + i, samples[i]); }
+          }
+        }
+      },
+      kPhiloxParallelGrainBlockNum);
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_DISTRIBUTIONS_PHILOX_SAMPLING_H_
@@ -15,32 +15,21 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/kernels/distributions/uniform_distribution.h"
+#include "oneflow/user/kernels/distributions/philox_sampling.h"
 
 namespace oneflow {
 
-template<typename T, typename E = void>
-class CPUUniformDistributionImpl;
-
-template<typename T>
-class CPUUniformDistributionImpl<T,
-                                 typename std::enable_if<std::is_floating_point<T>::value>::type> {
- public:
-  CPUUniformDistributionImpl(T low, T high) : random_distribution_(low, high) {}
-
-  T operator()(std::mt19937& engine) { return random_distribution_(engine); }
-
- private:
-  std::uniform_real_distribution<T> random_distribution_;
-};
-
 template<typename T>
 void UniformDistribution<DeviceType::kCPU, T>::operator()(
     ep::Stream* stream, const int64_t elem_cnt, T* dptr,
     const std::shared_ptr<one::Generator>& generator) const {
   CHECK_GE(elem_cnt, 0);
   auto gen = CHECK_JUST(generator->Get<one::CPUGeneratorImpl>());
-  CPUUniformDistributionImpl<T> impl(low_, high_);
-  for (int64_t i = 0; i < elem_cnt; ++i) { dptr[i] = impl(gen->engine()); }
+  const T low = low_;
+  const T range = high_ - low_;
+  PhiloxParallelSample<PhiloxUniform<T>>(stream, gen.get(), elem_cnt, [=](int64_t i, T sample) {
+    dptr[i] = low + sample * range;
+  });
 }
 
 #define INITIATE_CPU_UNIFORM_DISTRIBUTION(T, typeproto)               \
@@ -17,6 +17,7 @@ limitations under the License.
 #include "oneflow/user/kernels/op_kernel_wrapper.h"
 #include "oneflow/core/kernel/kernel_util.h"
 #include "oneflow/user/kernels/dropout_kernel.h"
+#include "oneflow/user/kernels/distributions/philox_sampling.h"
 #include "oneflow/core/ep/include/primitive/add.h"
 
 namespace oneflow {
@@ -34,15 +35,14 @@ void FusedDropoutKernel(ep::Stream* stream, const int64_t elem_cnt,
                         const std::shared_ptr<one::CPUGeneratorImpl>& cpu_gen, const float rate,
                         float scale, const T* x, bool* mask, T* y) {
   /*
-  `uniform_real_distribution` interval is [a, b).
+  The uniform samples of `PhiloxUniform` interval is [0, 1).
   And `curand_uniform4` interval is (0, 1.0], so we use > in CUDA and use >= in CPU.
   */
-  std::uniform_real_distribution<float> random_distribution(GetZeroVal<float>(),
-                                                            GetOneVal<float>());
-  for (int64_t i = 0; i < elem_cnt; ++i) {
-    mask[i] = random_distribution(cpu_gen->engine()) >= rate;
-    y[i] = x[i] * static_cast<T>(mask[i]) * scale;
-  }
+  PhiloxParallelSample<PhiloxUniform<float>>(stream, cpu_gen.get(), elem_cnt,
+                                             [=](int64_t i, float sample) {
+                                               mask[i] = sample >= rate;
+                                               y[i] = x[i] * static_cast<T>(mask[i]) * scale;
+                                             });
 }
 
 template<typename T>
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/max_pool_kernel_util.h"
+#include "oneflow/user/kernels/pool_cpu_kernel_util.h"
 
 namespace oneflow {
 
@@ -40,146 +41,58 @@ std::shared_ptr<PoolOpKernelCache> CreatePoolOpKernelCache(user_op::KernelCacheC
   return cache;
 }
 
-namespace {
-
-template<typename T, typename IDX>
-void Maxpool2dForwardComputeCLast(const NdIndexOffsetHelper<IDX, 4>& index_helper, IDX elem_num,
-                                  const T* src, T* dest, int64_t* indice_ptr,
-                                  const int32_t padding_h, const int32_t padding_w,
-                                  const int32_t n_batch, const int32_t n_channel,
-                                  const int32_t x_height, const int32_t x_width,
-                                  const int32_t y_height, const int32_t y_width,
-                                  const int32_t kernel_size_h, const int32_t kernel_size_w,
-                                  const int32_t stride_h, const int32_t stride_w,
-                                  const int32_t dilation_h, const int32_t dilation_w) {
-  IDX n = 0, h = 0, w = 0, c = 0;
-  for (IDX num = 0; num < elem_num; ++num) {
-    index_helper.OffsetToNdIndex(num, n, h, w, c);
-
-    const IDX x_start_idx = n * x_height * x_width * n_channel;
-    const IDX y_start_idx = n * y_height * y_width * n_channel;
-    IDX hstart = h * stride_h - padding_h;
-    IDX wstart = w * stride_w - padding_w;
-    const IDX hend = (hstart + (kernel_size_h - 1) * dilation_h + 1) <= x_height
-                         ? (hstart + (kernel_size_h - 1) * dilation_h + 1)
-                         : x_height;
-    const IDX wend = (wstart + (kernel_size_w - 1) * dilation_w + 1) <= x_width
-                         ? (wstart + (kernel_size_w - 1) * dilation_w + 1)
-                         : x_width;
-
-    while (hstart < 0) { hstart += dilation_h; }
-    while (wstart < 0) { wstart += dilation_w; }
-    /* compute max value(src[src_idx]) in kernel box region, and save the value to dest[num] */
-    IDX max_index = hstart * x_width + wstart;
-    IDX src_idx = 0;
-    /* equal to -std::numeric_limits<T>::infinity(); */
-    T max_value = detail::numeric_limits<T>::lower_bound();
-
-    for (IDX i = hstart; i < hend; i += dilation_h) {
-      for (IDX j = wstart; j < wend; j += dilation_w) {
-        const IDX window_idx = i * x_width * n_channel + j * n_channel + c;
-        const IDX search_idx = x_start_idx + window_idx;
-        T val = src[search_idx];
-        if (val > max_value || detail::numerics<T>::isnan(val)) {
-          max_value = val;
-          max_index = window_idx;
-          src_idx = search_idx;
-        }
-      }
-    }
-    const IDX out_idx = y_start_idx + h * y_width * n_channel + w * n_channel + c;
-    dest[out_idx] = src[src_idx];
-    indice_ptr[out_idx] = max_index;
-  }
-}
-
-}  // namespace
-
 template<typename T, typename IDX>
 struct PoolKernelUtil<DeviceType::kCPU, T, IDX> {
   static void Maxpool1dForward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 2>& index_helper,
                                const IDX elem_num, const T* src, T* dest, int64_t* indice_ptr,
                                const MaxPoolParams3D& params_3d) {
-    Maxpool1dForwardCompute<T, IDX>(
-        index_helper, elem_num, src, dest, indice_ptr, params_3d.padding()[2],
-        params_3d.num_batch(), params_3d.num_channel(), params_3d.GetXShape5D().At(4),
-        params_3d.pool_size_3d()[2], params_3d.stride_3d()[2], params_3d.dilation_3d()[2]);
+    MaxPoolCpuKernelUtil<T>::Forward(stream, params_3d, src, dest, indice_ptr);
   }
 
   static void Maxpool1dBackward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 2>& index_helper,
                                 const IDX elem_num, const T* src, T* dest,
                                 const int64_t* indice_ptr, const MaxPoolParams3D& params_3d) {
-    Maxpool1dBackwardCompute<T, IDX>(index_helper, elem_num, src, dest, indice_ptr,
-                                     params_3d.num_batch(), params_3d.num_channel(),
-                                     params_3d.GetYShape5D().At(4), params_3d.GetXShape5D().At(4));
+    MaxPoolCpuKernelUtil<T>::Backward(stream, params_3d, src, indice_ptr, dest);
   }
 
   static void Maxpool2dForwardCFirst(ep::Stream* stream,
                                      const NdIndexOffsetHelper<IDX, 3>& index_helper,
                                      const IDX elem_num, const T* src, T* dest, int64_t* indice_ptr,
                                      const MaxPoolParams3D& params_3d) {
-    Maxpool2dForwardComputeCFirst<T, IDX>(
-        index_helper, elem_num, src, dest, indice_ptr, params_3d.padding()[1],
-        params_3d.padding()[2], params_3d.num_batch(), params_3d.num_channel(),
-        params_3d.GetXShape5D().At(3), params_3d.GetXShape5D().At(4), params_3d.pool_size_3d()[1],
-        params_3d.pool_size_3d()[2], params_3d.stride_3d()[1], params_3d.stride_3d()[2],
-        params_3d.dilation_3d()[1], params_3d.dilation_3d()[2]);
+    MaxPoolCpuKernelUtil<T>::Forward(stream, params_3d, src, dest, indice_ptr);
   }
 
   static void Maxpool2dBackwardCFirst(ep::Stream* stream,
                                       const NdIndexOffsetHelper<IDX, 3>& index_helper,
                                       const IDX elem_num, const T* src, T* dest,
                                       const int64_t* indice_ptr, const MaxPoolParams3D& params_3d) {
-    Maxpool2dBackwardComputeCFirst<T, IDX>(
-        index_helper, elem_num, src, dest, indice_ptr, params_3d.num_batch(),
-        params_3d.num_channel(), params_3d.GetYShape5D().At(3), params_3d.GetYShape5D().At(4),
-        params_3d.GetXShape5D().At(3), params_3d.GetXShape5D().At(4));
+    MaxPoolCpuKernelUtil<T>::Backward(stream, params_3d, src, indice_ptr, dest);
   }
 
   static void Maxpool2dForwardCLast(ep::Stream* stream,
                                     const NdIndexOffsetHelper<IDX, 4>& index_helper,
                                     const IDX elem_num, const T* src, T* dest, int64_t* indice_ptr,
                                     const MaxPoolParams3D& params_3d) {
-    Maxpool2dForwardComputeCLast<T, IDX>(
-        index_helper, elem_num, src, dest, indice_ptr, params_3d.padding()[1],
-        params_3d.padding()[2], params_3d.num_batch(), params_3d.num_channel(),
-        params_3d.GetXShape5D().At(3), params_3d.GetXShape5D().At(4), params_3d.GetYShape5D().At(3),
-        params_3d.GetYShape5D().At(4), params_3d.pool_size_3d()[1], params_3d.pool_size_3d()[2],
-        params_3d.stride_3d()[1], params_3d.stride_3d()[2], params_3d.dilation_3d()[1],
-        params_3d.dilation_3d()[2]);
+    MaxPoolCpuKernelUtil<T>::Forward(stream, params_3d, src, dest, indice_ptr);
   }
 
   static void Maxpool2dBackwardCLast(ep::Stream* stream,
                                      const NdIndexOffsetHelper<IDX, 4>& index_helper,
                                      const IDX elem_num, const T* src, T* dest,
                                      const int64_t* indice_ptr, const MaxPoolParams3D& params_3d) {
-    Maxpool2dBackwardComputeCLast<T, IDX>(
-        index_helper, elem_num, src, dest, indice_ptr, params_3d.num_batch(),
-        params_3d.num_channel(), params_3d.GetYShape5D().At(3), params_3d.GetYShape5D().At(4),
-        params_3d.GetXShape5D().At(3), params_3d.GetXShape5D().At(4));
+    MaxPoolCpuKernelUtil<T>::Backward(stream, params_3d, src, indice_ptr, dest);
   }
 
   static void Maxpool3dForward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 4>& index_helper,
                                const IDX elem_num, const T* src, T* dest, int64_t* indice_ptr,
                                const MaxPoolParams3D& params_3d) {
-    Maxpool3dForwardCompute<T, IDX>(
-        index_helper, elem_num, src, dest, indice_ptr, params_3d.padding()[0],
-        params_3d.padding()[1], params_3d.padding()[2], params_3d.num_batch(),
-        params_3d.num_channel(), params_3d.GetXShape5D().At(2), params_3d.GetXShape5D().At(3),
-        params_3d.GetXShape5D().At(4), params_3d.pool_size_3d()[0], params_3d.pool_size_3d()[1],
-        params_3d.pool_size_3d()[2], params_3d.stride_3d()[0], params_3d.stride_3d()[1],
-        params_3d.stride_3d()[2], params_3d.dilation_3d()[0], params_3d.dilation_3d()[1],
-        params_3d.dilation_3d()[2]);
+    MaxPoolCpuKernelUtil<T>::Forward(stream, params_3d, src, dest, indice_ptr);
   }
 
   static void Maxpool3dBackward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 4> index_helper,
                                 const IDX elem_num, const T* src, T* dest,
                                 const int64_t* indice_ptr, const MaxPoolParams3D& params_3d) {
-    Maxpool3dBackwardCompute<T, IDX>(index_helper, elem_num, src, dest, indice_ptr,
-                                     params_3d.num_batch(), params_3d.num_channel(),
-                                     params_3d.GetYShape5D().At(2), params_3d.GetYShape5D().At(3),
-                                     params_3d.GetYShape5D().At(4), params_3d.GetXShape5D().At(2),
-                                     params_3d.GetXShape5D().At(3), params_3d.GetXShape5D().At(4));
+    MaxPoolCpuKernelUtil<T>::Backward(stream, params_3d, src, indice_ptr, dest);
   }
 };
 
@@ -384,6 +384,6 @@ struct LarsUpdateKernelUtil {
                      const G* model_diff, T* model, T* momentum, T* data_tmp, T* model_diff_tmp);
 };
 
-#endif
-
 }  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_MODEL_UPDATE_KERNEL_UTIL_H_
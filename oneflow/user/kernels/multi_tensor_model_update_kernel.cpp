@@ -59,7 +59,7 @@ class MultiTensorSGDUpdateKernel final : public user_op::OpKernel,
 
     TensorTupleParams<2> tensor_tuple_params{};
     int32_t count = 0;
-    int32_t total_elem_cnt = 0;
+    int64_t total_elem_cnt = 0;
     for (int tensor_idx = 0; tensor_idx < n_tensor; tensor_idx++) {
       tensor_tuple_params.ptr[0][count] =
           (ctx->Tensor4ArgNameAndIndex("model", tensor_idx))->mut_dptr();
@@ -91,6 +91,9 @@ class MultiTensorSGDUpdateKernel final : public user_op::OpKernel,
                        && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value) \
                        && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
 
+REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_KERNEL(DeviceType::kCPU, float, float);
+REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_KERNEL(DeviceType::kCPU, double, double);
+
 #ifdef WITH_CUDA
 REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_KERNEL(DeviceType::kCUDA, float, float16);
 REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_KERNEL(DeviceType::kCUDA, float, float);
@@ -163,7 +166,7 @@ class MultiTensorAdamUpdateKernel final : public user_op::OpKernel,
 
     TensorTupleParams<4> tensor_tuple_params{};
     int32_t count = 0;
-    int32_t total_elem_cnt = 0;
+    int64_t total_elem_cnt = 0;
     for (int tensor_idx = 0; tensor_idx < n_tensor; tensor_idx++) {
       tensor_tuple_params.ptr[0][count] =
           (ctx->Tensor4ArgNameAndIndex("model", tensor_idx))->mut_dptr();
@@ -200,6 +203,9 @@ class MultiTensorAdamUpdateKernel final : public user_op::OpKernel,
                        && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value) \
                        && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
 
+REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_KERNEL(DeviceType::kCPU, float, float);
+REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_KERNEL(DeviceType::kCPU, double, double);
+
 #ifdef WITH_CUDA
 REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_KERNEL(DeviceType::kCUDA, float, float16);
 REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_KERNEL(DeviceType::kCUDA, float, float);
@@ -244,7 +250,7 @@ class MultiTensorSGDUpdateWithCastKernel final : public user_op::OpKernel,
 
     TensorTupleParams<3> tensor_tuple_params{};
     int32_t count = 0;
-    int32_t total_elem_cnt = 0;
+    int64_t total_elem_cnt = 0;
     for (int tensor_idx = 0; tensor_idx < n_tensor; tensor_idx++) {
       tensor_tuple_params.ptr[0][count] =
           (ctx->Tensor4ArgNameAndIndex("model", tensor_idx))->mut_dptr();
@@ -279,6 +285,8 @@ class MultiTensorSGDUpdateWithCastKernel final : public user_op::OpKernel,
                        && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value) \
                        && (user_op::HobDataType("model_copy", 0) == GetDataType<float16>::value));
 
+REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_WITH_CAST_KERNEL(DeviceType::kCPU, float, float);
+
 #ifdef WITH_CUDA
 REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_WITH_CAST_KERNEL(DeviceType::kCUDA, float, float);
 REGISTER_MULTI_TENSOR_UPDATE_SGD_UPDATE_WITH_CAST_KERNEL(DeviceType::kCUDA, float, float16);
@@ -350,7 +358,7 @@ class MultiTensorAdamUpdateWithCastKernel final : public user_op::OpKernel,
 
     TensorTupleParams<5> tensor_tuple_params{};
     int32_t count = 0;
-    int32_t total_elem_cnt = 0;
+    int64_t total_elem_cnt = 0;
     for (int tensor_idx = 0; tensor_idx < n_tensor; tensor_idx++) {
       tensor_tuple_params.ptr[0][count] =
           (ctx->Tensor4ArgNameAndIndex("model", tensor_idx))->mut_dptr();
@@ -390,6 +398,8 @@ class MultiTensorAdamUpdateWithCastKernel final : public user_op::OpKernel,
                        && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value) \
                        && (user_op::HobDataType("model_copy", 0) == GetDataType<float16>::value));
 
+REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_WITH_CAST_KERNEL(DeviceType::kCPU, float, float);
+
 #ifdef WITH_CUDA
 REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_WITH_CAST_KERNEL(DeviceType::kCUDA, float, float);
 REGISTER_MULTI_TENSOR_UPDATE_ADAM_UPDATE_WITH_CAST_KERNEL(DeviceType::kCUDA, float, float16);
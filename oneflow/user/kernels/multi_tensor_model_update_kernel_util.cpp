@@ -0,0 +1,234 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/user/kernels/model_update_kernel_util.h"
+#include "oneflow/user/kernels/multi_tensor_model_update_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// The elements of the tensors are split evenly over the threads, a task may cover the tail of a
+// tensor and the head of the next one.
+constexpr int64_t kParallelGrainSize = 32768;
+// Elements updated stage by stage, so that the stages without sqrt are vectorized.
+constexpr int64_t kUpdateBlockSize = 256;
+
+// Calls Update(tensor_idx, begin, end) for the parts of the tensors within the elements
+// [begin, end) of their concatenation, on the threads of the stream.
+template<int N, typename F>
+void ParallelForEachTensorRange(ep::Stream* stream, int64_t elem_cnt, int64_t n_tensor,
+                                const TensorTupleParams<N>& tensor_tuple_params, const F& Update) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, elem_cnt,
+      [&](int64_t begin, int64_t end) {
+        int64_t tensor_begin = 0;
+        for (int64_t tensor_idx = 0; tensor_idx < n_tensor && tensor_begin < end; ++tensor_idx) {
+          const int64_t tensor_end = tensor_begin + tensor_tuple_params.sizes[tensor_idx];
+          const int64_t range_begin = std::max(begin, tensor_begin);
+          const int64_t range_end = std::min(end, tensor_end);
+          if (range_begin < range_end) {
+            Update(tensor_idx, range_begin - tensor_begin, range_end - tensor_begin);
+          }
+          tensor_begin = tensor_end;
+        }
+      },
+      kParallelGrainSize);
+}
+
+template<typename T, typename G, typename C>
+void SGDUpdateRange(int64_t n, T scale, float l1, float l2, float weight_decay,
+                    float learning_rate, const G* model_diff, T* model, C* model_copy) {
+  if (model_copy != nullptr) {
+    for (int64_t i = 0; i < n; ++i) {
+      FusedSGDUpdateFunctor<T, G, C>()(model_diff + i, model + i, model_copy + i, scale, l1, l2,
+                                       weight_decay, learning_rate);
+    }
+  } else {
+    for (int64_t i = 0; i < n; ++i) {
+      SGDUpdateFunctor<T, G>()(model_diff + i, model + i, scale, l1, l2, weight_decay,
+                               learning_rate);
+    }
+  }
+}
+
+// The same arithmetic as AdamUpdateFunctor without amsgrad, a block at a time: the moments, the
+// square roots of the second moments, then the model.
+template<typename T, typename G, typename C>
+void AdamUpdateRange(int64_t n, T scale, float l1, float l2, float beta1, float beta2,
+                     float epsilon, float weight_decay, float bias_correction1,
+                     float bias_correction2, float learning_rate, const G* model_diff, T* model,
+                     C* model_copy, T* m, T* v) {
+  const T bias_correction2_sqrt = std::sqrt(static_cast<T>(bias_correction2));
+  const T step_size = learning_rate / bias_correction1;
+  T v_sqrt[kUpdateBlockSize];
+  for (int64_t block_begin = 0; block_begin < n; block_begin += kUpdateBlockSize) {
+    const int64_t block_size = std::min(kUpdateBlockSize, n - block_begin);
+    const G* block_model_diff = model_diff + block_begin;
+    T* block_model = model + block_begin;
+    T* block_m = m + block_begin;
+    T* block_v = v + block_begin;
+    for (int64_t i = 0; i < block_size; ++i) {
+      const T model_diff_t = CastScaleRegularizeGradientFunctor<T, G>()(
+          block_model_diff[i], block_model[i], scale, l1, l2);
+      block_m[i] = beta1 * block_m[i] + (1 - beta1) * model_diff_t;
+      const T next_v = beta2 * block_v[i] + (1 - beta2) * model_diff_t * model_diff_t;
+      block_v[i] = next_v;
+      v_sqrt[i] = next_v;
+    }
+    for (int64_t i = 0; i < block_size; ++i) { v_sqrt[i] = std::sqrt(v_sqrt[i]); }
+    for (int64_t i = 0; i < block_size; ++i) {
+      const T model_val = block_model[i];
+      const T denom = v_sqrt[i] / bias_correction2_sqrt + epsilon;
+      block_model[i] =
+          model_val - step_size * (block_m[i] / denom) - learning_rate * weight_decay * model_val;
+    }
+    if (model_copy != nullptr) {
+      C* block_model_copy = model_copy + block_begin;
+      for (int64_t i = 0; i < block_size; ++i) {
+        block_model_copy[i] = static_cast<C>(block_model[i]);
+      }
+    }
+  }
+}
+
+template<typename T, typename G, typename C, int N>
+void MultiTensorSGDUpdate(ep::Stream* stream, const int64_t elem_cnt, const int64_t n_tensor,
+                          T scale, float l1, float l2, float weight_decay, float learning_rate_val,
+                          const float* learning_rate, const T* scale_by_ptr,
+                          const int64_t* skip_if,
+                          const TensorTupleParams<N>& tensor_tuple_params) {
+  if (skip_if != nullptr && *skip_if != 0) { return; }
+  if (learning_rate != nullptr) { learning_rate_val = *learning_rate; }
+  if (scale_by_ptr != nullptr) { scale *= *scale_by_ptr; }
+  ParallelForEachTensorRange(
+      stream, elem_cnt, n_tensor, tensor_tuple_params,
+      [&](int64_t tensor_idx, int64_t begin, int64_t end) {
+        T* model = static_cast<T*>(tensor_tuple_params.ptr[0][tensor_idx]) + begin;
+        const G* model_diff = static_cast<const G*>(tensor_tuple_params.ptr[1][tensor_idx]) + begin;
+        C* model_copy = nullptr;
+        if (N == 3) {
+          model_copy = static_cast<C*>(tensor_tuple_params.ptr[2][tensor_idx]) + begin;
+        }
+        SGDUpdateRange<T, G, C>(end - begin, scale, l1, l2, weight_decay, learning_rate_val,
+                                model_diff, model, model_copy);
+      });
+}
+
+template<typename T, typename G, typename C, int N>
+void MultiTensorAdamUpdate(ep::Stream* stream, const int64_t elem_cnt, const int64_t n_tensor,
+                           T scale, float l1, float l2, float beta1, float beta2, float epsilon,
+                           float weight_decay, bool amsgrad, bool do_bias_correction,
+                           float learning_rate_val, float bias_correction1_val,
+                           float bias_correction2_val, const float* learning_rate,
+                           const T* scale_by_ptr, const int64_t* skip_if,
+                           const float* bias_correction1, const float* bias_correction2,
+                           const TensorTupleParams<N>& tensor_tuple_params) {
+  CHECK(!amsgrad) << "Multi Tensor Adam Update do not support amsgrad = True. ";
+  if (skip_if != nullptr && *skip_if != 0) { return; }
+  if (learning_rate != nullptr) { learning_rate_val = *learning_rate; }
+  if (scale_by_ptr != nullptr) { scale *= *scale_by_ptr; }
+  if (bias_correction1 != nullptr) { bias_correction1_val = *bias_correction1; }
+  if (bias_correction2 != nullptr) { bias_correction2_val = *bias_correction2; }
+  ParallelForEachTensorRange(
+      stream, elem_cnt, n_tensor, tensor_tuple_params,
+      [&](int64_t tensor_idx, int64_t begin, int64_t end) {
+        T* model = static_cast<T*>(tensor_tuple_params.ptr[0][tensor_idx]) + begin;
+        const G* model_diff = static_cast<const G*>(tensor_tuple_params.ptr[1][tensor_idx]) + begin;
+        T* m = static_cast<T*>(tensor_tuple_params.ptr[2][tensor_idx]) + begin;
+        T* v = static_cast<T*>(tensor_tuple_params.ptr[3][tensor_idx]) + begin;
+        C* model_copy = nullptr;
+        if (N == 5) {
+          model_copy = static_cast<C*>(tensor_tuple_params.ptr[4][tensor_idx]) + begin;
+        }
+        AdamUpdateRange<T, G, C>(end - begin, scale, l1, l2, beta1, beta2, epsilon, weight_decay,
+                                 bias_correction1_val, bias_correction2_val, learning_rate_val,
+                                 model_diff, model, model_copy, m, v);
+      });
+}
+
+}  // namespace
+
+template<typename T, typename G>
+struct MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(ep::Stream* stream, const int64_t elem_cnt, const int64_t n_tensor, T scale,
+                     float l1, float l2, float weight_decay, float learning_rate_val,
+                     const float* learning_rate, const T* scale_by_ptr, const int64_t* skip_if,
+                     TensorTupleParams<2> tensor_tuple_params) {
+    MultiTensorSGDUpdate<T, G, float16, 2>(stream, elem_cnt, n_tensor, scale, l1, l2,
+                                           weight_decay, learning_rate_val, learning_rate,
+                                           scale_by_ptr, skip_if, tensor_tuple_params);
+  }
+};
+
+template struct MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, float, float>;
+template struct MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, double, double>;
+
+template<typename T, typename G>
+struct MultiTensorAdamUpdateKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(ep::Stream* stream, const int64_t elem_cnt, const int64_t n_tensor, T scale,
+                     float l1, float l2, float beta1, float beta2, float epsilon,
+                     float weight_decay, bool amsgrad, bool do_bias_correction,
+                     float learning_rate_val, float bias_correction1_val,
+                     float bias_correction2_val, const float* learning_rate, const T* scale_by_ptr,
+                     const int64_t* skip_if, const float* bias_correction1,
+                     const float* bias_correction2, TensorTupleParams<4> tensor_tuple_params) {
+    MultiTensorAdamUpdate<T, G, float16, 4>(
+        stream, elem_cnt, n_tensor, scale, l1, l2, beta1, beta2, epsilon, weight_decay, amsgrad,
+        do_bias_correction, learning_rate_val, bias_correction1_val, bias_correction2_val,
+        learning_rate, scale_by_ptr, skip_if, bias_correction1, bias_correction2,
+        tensor_tuple_params);
+  }
+};
+
+template struct MultiTensorAdamUpdateKernelUtil<DeviceType::kCPU, float, float>;
+template struct MultiTensorAdamUpdateKernelUtil<DeviceType::kCPU, double, double>;
+
+template<typename T, typename G>
+struct MultiTensorSGDUpdateWithCastKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(ep::Stream* stream, const int64_t elem_cnt, const int64_t n_tensor, T scale,
+                     float l1, float l2, float weight_decay, float learning_rate_val,
+                     const float* learning_rate, const T* scale_by_ptr, const int64_t* skip_if,
+                     TensorTupleParams<3> tensor_tuple_params) {
+    MultiTensorSGDUpdate<T, G, float16, 3>(stream, elem_cnt, n_tensor, scale, l1, l2,
+                                           weight_decay, learning_rate_val, learning_rate,
+                                           scale_by_ptr, skip_if, tensor_tuple_params);
+  }
+};
+
+template struct MultiTensorSGDUpdateWithCastKernelUtil<DeviceType::kCPU, float, float>;
+
+template<typename T, typename G>
+struct MultiTensorAdamUpdateWithCastKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(ep::Stream* stream, const int64_t elem_cnt, const int64_t n_tensor, T scale,
+                     float l1, float l2, float beta1, float beta2, float epsilon,
+                     float weight_decay, bool amsgrad, bool do_bias_correction,
+                     float learning_rate_val, float bias_correction1_val,
+                     float bias_correction2_val, const float* learning_rate, const T* scale_by_ptr,
+                     const int64_t* skip_if, const float* bias_correction1,
+                     const float* bias_correction2, TensorTupleParams<5> tensor_tuple_params) {
+    MultiTensorAdamUpdate<T, G, float16, 5>(
+        stream, elem_cnt, n_tensor, scale, l1, l2, beta1, beta2, epsilon, weight_decay, amsgrad,
+        do_bias_correction, learning_rate_val, bias_correction1_val, bias_correction2_val,
+        learning_rate, scale_by_ptr, skip_if, bias_correction1, bias_correction2,
+        tensor_tuple_params);
+  }
+};
+
+template struct MultiTensorAdamUpdateWithCastKernelUtil<DeviceType::kCPU, float, float>;
+
+}  // namespace oneflow
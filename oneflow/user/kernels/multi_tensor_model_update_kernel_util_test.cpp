@@ -0,0 +1,208 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <random>
+#include "oneflow/user/kernels/model_update_kernel_util.h"
+#include "oneflow/user/kernels/multi_tensor_model_update_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+#include "oneflow/core/ep/test/test_util.h"
+
+namespace oneflow {
+
+namespace {
+
+class MultiTensorModelUpdateTest : public ep::test::TestCase {};
+
+constexpr float kScale = 0.5f;
+constexpr float kL1 = 1e-4f;
+constexpr float kL2 = 1e-3f;
+constexpr float kWeightDecay = 1e-2f;
+constexpr float kLearningRate = 0.1f;
+constexpr float kBeta1 = 0.9f;
+constexpr float kBeta2 = 0.999f;
+constexpr float kEpsilon = 1e-8f;
+constexpr float kBiasCorrection1 = 0.19f;
+constexpr float kBiasCorrection2 = 0.002f;
+
+struct Params {
+  explicit Params(const std::vector<int64_t>& sizes) {
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<float> dis(-1, 1);
+    auto Random = [&](int64_t size) {
+      std::vector<float> vec(size);
+      for (auto& value : vec) { value = dis(gen); }
+      return vec;
+    };
+    for (int64_t size : sizes) {
+      model.push_back(Random(size));
+      model_diff.push_back(Random(size));
+      m.push_back(Random(size));
+      std::vector<float> random_v = Random(size);
+      for (auto& value : random_v) { value = std::abs(value); }
+      v.push_back(random_v);
+      model_copy.emplace_back(size);
+    }
+  }
+  std::vector<std::vector<float>> model;
+  std::vector<std::vector<float>> model_diff;
+  std::vector<std::vector<float>> m;
+  std::vector<std::vector<float>> v;
+  std::vector<std::vector<float16>> model_copy;
+};
+
+// Launches the multi tensor update for every kMaxTuples tensors, as the kernels do.
+template<int N, typename F>
+void ForEachTensorTuple(const std::vector<void*>* ptrs, const std::vector<int64_t>& sizes,
+                        const F& Update) {
+  TensorTupleParams<N> tensor_tuple_params{};
+  int64_t count = 0;
+  int64_t total_elem_cnt = 0;
+  for (size_t tensor_idx = 0; tensor_idx < sizes.size(); ++tensor_idx) {
+    for (int i = 0; i < N; ++i) { tensor_tuple_params.ptr[i][count] = ptrs[i].at(tensor_idx); }
+    tensor_tuple_params.sizes[count] = sizes.at(tensor_idx);
+    count += 1;
+    total_elem_cnt += sizes.at(tensor_idx);
+    if (count == kMaxTuples || tensor_idx == sizes.size() - 1) {
+      Update(total_elem_cnt, count, tensor_tuple_params);
+      count = 0;
+      total_elem_cnt = 0;
+    }
+  }
+}
+
+void MultiTensorSGD(ep::Stream* stream, Params* params, const std::vector<int64_t>& sizes,
+                    bool with_cast) {
+  std::vector<void*> ptrs[3];
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    ptrs[0].push_back(params->model[i].data());
+    ptrs[1].push_back(params->model_diff[i].data());
+    ptrs[2].push_back(params->model_copy[i].data());
+  }
+  if (with_cast) {
+    ForEachTensorTuple<3>(ptrs, sizes, [&](int64_t elem_cnt, int64_t n_tensor,
+                                           const TensorTupleParams<3>& tensor_tuple_params) {
+      MultiTensorSGDUpdateWithCastKernelUtil<DeviceType::kCPU, float, float>::Update(
+          stream, elem_cnt, n_tensor, kScale, kL1, kL2, kWeightDecay, kLearningRate, nullptr,
+          nullptr, nullptr, tensor_tuple_params);
+    });
+  } else {
+    ForEachTensorTuple<2>(ptrs, sizes, [&](int64_t elem_cnt, int64_t n_tensor,
+                                           const TensorTupleParams<2>& tensor_tuple_params) {
+      MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, float, float>::Update(
+          stream, elem_cnt, n_tensor, kScale, kL1, kL2, kWeightDecay, kLearningRate, nullptr,
+          nullptr, nullptr, tensor_tuple_params);
+    });
+  }
+}
+
+void MultiTensorAdam(ep::Stream* stream, Params* params, const std::vector<int64_t>& sizes,
+                     bool with_cast) {
+  std::vector<void*> ptrs[5];
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    ptrs[0].push_back(params->model[i].data());
+    ptrs[1].push_back(params->model_diff[i].data());
+    ptrs[2].push_back(params->m[i].data());
+    ptrs[3].push_back(params->v[i].data());
+    ptrs[4].push_back(params->model_copy[i].data());
+  }
+  if (with_cast) {
+    ForEachTensorTuple<5>(ptrs, sizes, [&](int64_t elem_cnt, int64_t n_tensor,
+                                           const TensorTupleParams<5>& tensor_tuple_params) {
+      MultiTensorAdamUpdateWithCastKernelUtil<DeviceType::kCPU, float, float>::Update(
+          stream, elem_cnt, n_tensor, kScale, kL1, kL2, kBeta1, kBeta2, kEpsilon, kWeightDecay,
+          false, true, kLearningRate, kBiasCorrection1, kBiasCorrection2, nullptr, nullptr,
+          nullptr, nullptr, nullptr, tensor_tuple_params);
+    });
+  } else {
+    ForEachTensorTuple<4>(ptrs, sizes, [&](int64_t elem_cnt, int64_t n_tensor,
+                                           const TensorTupleParams<4>& tensor_tuple_params) {
+      MultiTensorAdamUpdateKernelUtil<DeviceType::kCPU, float, float>::Update(
+          stream, elem_cnt, n_tensor, kScale, kL1, kL2, kBeta1, kBeta2, kEpsilon, kWeightDecay,
+          false, true, kLearningRate, kBiasCorrection1, kBiasCorrection2, nullptr, nullptr,
+          nullptr, nullptr, nullptr, tensor_tuple_params);
+    });
+  }
+}
+
+// The update of the sgd_update and adam_update kernels, a tensor at a time.
+void SingleTensorSGD(ep::Stream* stream, Params* params, bool with_cast) {
+  for (size_t i = 0; i < params->model.size(); ++i) {
+    SGDUpdateKernelUtil<DeviceType::kCPU, float, float, float16>::Update(
+        stream, params->model[i].size(), kScale, kL1, kL2, kWeightDecay, kLearningRate, nullptr,
+        nullptr, nullptr, params->model_diff[i].data(), params->model[i].data(),
+        with_cast ? params->model_copy[i].data() : nullptr);
+  }
+}
+
+void SingleTensorAdam(ep::Stream* stream, Params* params, bool with_cast) {
+  for (size_t i = 0; i < params->model.size(); ++i) {
+    AdamUpdateKernelUtil<DeviceType::kCPU, float, float, float16>::Update(
+        stream, params->model[i].size(), kScale, kL1, kL2, kBeta1, kBeta2, kEpsilon, kWeightDecay,
+        false, true, kLearningRate, kBiasCorrection1, kBiasCorrection2, nullptr, nullptr, nullptr,
+        nullptr, nullptr, params->model_diff[i].data(), params->model[i].data(),
+        with_cast ? params->model_copy[i].data() : nullptr, params->m[i].data(),
+        params->v[i].data(), nullptr);
+  }
+}
+
+void AssertNear(const Params& params, const Params& expected) {
+  for (size_t i = 0; i < expected.model.size(); ++i) {
+    for (size_t j = 0; j < expected.model[i].size(); ++j) {
+      ASSERT_NEAR(params.model[i][j], expected.model[i][j], 1e-5) << i << " " << j;
+      ASSERT_NEAR(params.m[i][j], expected.m[i][j], 1e-6) << i << " " << j;
+      ASSERT_NEAR(params.v[i][j], expected.v[i][j], 1e-6) << i << " " << j;
+      // a half apart when the model is rounded the other way
+      ASSERT_NEAR(static_cast<float>(params.model_copy[i][j]),
+                  static_cast<float>(expected.model_copy[i][j]), 1e-3)
+          << i << " " << j;
+    }
+  }
+}
+
+}  // namespace
+
+TEST_F(MultiTensorModelUpdateTest, same_as_single_tensor_update) {
+  if (available_device_types_.count(DeviceType::kCPU) == 0) { return; }
+  auto device = device_manager_registry_.GetDevice(DeviceType::kCPU, 0);
+  auto* cpu_device = dynamic_cast<ep::CpuDevice*>(device.get());
+  const size_t old_thread_num = cpu_device->GetNumThreads();
+  // more than kMaxTuples tensors, empty ones, and ones larger than a task
+  std::vector<int64_t> sizes;
+  for (int i = 0; i < 70; ++i) { sizes.push_back((i * 37) % 300); }
+  sizes.push_back(100003);
+  sizes.push_back(0);
+  sizes.push_back(70001);
+  for (int64_t thread_num : {1, 4}) {
+    cpu_device->SetNumThreads(thread_num);
+    ep::test::StreamGuard stream(device.get());
+    for (bool with_cast : {false, true}) {
+      Params expected(sizes);
+      SingleTensorSGD(stream.stream(), &expected, with_cast);
+      Params params(sizes);
+      MultiTensorSGD(stream.stream(), &params, sizes, with_cast);
+      AssertNear(params, expected);
+
+      Params adam_expected(sizes);
+      SingleTensorAdam(stream.stream(), &adam_expected, with_cast);
+      Params adam_params(sizes);
+      MultiTensorAdam(stream.stream(), &adam_params, sizes, with_cast);
+      AssertNear(adam_params, adam_expected);
+    }
+  }
+  cpu_device->SetNumThreads(old_thread_num);
+}
+
+}  // namespace oneflow
@@ -0,0 +1,441 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/normalization_cpu_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// The elements a task of the threads visits at least, which is also the most elements of a run of
+// a channel whose sums are reduced by a task.
+constexpr int64_t kParallelGrain = 32768;
+// The most parts of the rows of channels last, whose partial sums are kept for each channel.
+constexpr int64_t kMaxRowParts = 256;
+// The independent partial sums of a run, which the compiler keeps in vector registers.
+constexpr int64_t kSumLanes = 32;
+// The elements of y which are normalized and then taken by the relu while they are in the cache.
+constexpr int64_t kBlockSize = 4096;
+constexpr int64_t kMaskWordSize = 32;
+
+// The parts of x whose sums of each channel are reduced by a task: the runs of at most
+// kParallelGrain elements of the planes of channels for an inner size > 1, or else the ranges of
+// rows of all the channels.
+struct SumParts {
+  explicit SumParts(const NormalizationCpuShape& shape) {
+    if (shape.inner_size > 1) {
+      runs_per_plane = (shape.inner_size + kParallelGrain - 1) / kParallelGrain;
+      run_size = (shape.inner_size + runs_per_plane - 1) / runs_per_plane;
+      num_parts = shape.outer_size * runs_per_plane;
+    } else {
+      const int64_t elem_cnt = shape.elem_cnt();
+      num_parts = std::min<int64_t>((elem_cnt + kParallelGrain - 1) / kParallelGrain,
+                                    std::min<int64_t>(shape.outer_size, kMaxRowParts));
+      num_parts = std::max<int64_t>(num_parts, 1);
+      rows_per_part = (shape.outer_size + num_parts - 1) / num_parts;
+    }
+  }
+
+  int64_t num_parts = 0;
+  int64_t runs_per_plane = 0;
+  int64_t run_size = 0;
+  int64_t rows_per_part = 0;
+};
+
+// Reduces two sums of each channel: SumRun(offset, size, channel, &sum0, &sum1) sums a run of a
+// channel for an inner size > 1, and SumRows(row_begin, row_end, sum0, sum1) adds rows of all the
+// channels to the sums of each channel for channels last.
+template<typename T, typename SumRunFn, typename SumRowsFn>
+void ReduceSums(ep::Stream* stream, const NormalizationCpuShape& shape, const SumRunFn& SumRun,
+                const SumRowsFn& SumRows, T* sum0, T* sum1) {
+  const int64_t channel_size = shape.channel_size;
+  if (shape.elem_cnt() == 0) {
+    std::fill(sum0, sum0 + channel_size, 0);
+    std::fill(sum1, sum1 + channel_size, 0);
+    return;
+  }
+  const SumParts parts(shape);
+  std::vector<T> partial0(parts.num_parts * channel_size, 0);
+  std::vector<T> partial1(parts.num_parts * channel_size, 0);
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  if (shape.inner_size > 1) {
+    cpu_stream->ParallelFor(
+        0, shape.outer_size * channel_size * parts.runs_per_plane,
+        [&](int64_t begin, int64_t end) {
+          FOR_RANGE(int64_t, task, begin, end) {
+            const int64_t plane = task / parts.runs_per_plane;
+            const int64_t run = task % parts.runs_per_plane;
+            const int64_t outer = plane / channel_size;
+            const int64_t channel = plane % channel_size;
+            const int64_t run_begin = run * parts.run_size;
+            const int64_t run_end = std::min(run_begin + parts.run_size, shape.inner_size);
+            const int64_t index = (outer * parts.runs_per_plane + run) * channel_size + channel;
+            SumRun(plane * shape.inner_size + run_begin, run_end - run_begin, channel,
+                   &partial0[index], &partial1[index]);
+          }
+        },
+        std::max<int64_t>(kParallelGrain / parts.run_size, 1));
+  } else {
+    cpu_stream->ParallelFor(
+        0, parts.num_parts,
+        [&](int64_t begin, int64_t end) {
+          FOR_RANGE(int64_t, part, begin, end) {
+            const int64_t row_begin = part * parts.rows_per_part;
+            const int64_t row_end = std::min(row_begin + parts.rows_per_part, shape.outer_size);
+            SumRows(row_begin, row_end, &partial0[part * channel_size],
+                    &partial1[part * channel_size]);
+          }
+        },
+        1);
+  }
+  FOR_RANGE(int64_t, channel, 0, channel_size) {
+    T channel_sum0 = 0;
+    T channel_sum1 = 0;
+    FOR_RANGE(int64_t, part, 0, parts.num_parts) {
+      channel_sum0 += partial0[part * channel_size + channel];
+      channel_sum1 += partial1[part * channel_size + channel];
+    }
+    sum0[channel] = channel_sum0;
+    sum1[channel] = channel_sum1;
+  }
+}
+
+template<typename T>
+T SumLanes(const T* lanes) {
+  T sum = 0;
+  FOR_RANGE(int64_t, lane, 0, kSumLanes) { sum += lanes[lane]; }
+  return sum;
+}
+
+template<typename T>
+void SumRunOfX(const T* x, int64_t size, T* sum, T* sum_square) {
+  T sum_lanes[kSumLanes] = {0};
+  T sum_square_lanes[kSumLanes] = {0};
+  int64_t i = 0;
+  for (; i + kSumLanes <= size; i += kSumLanes) {
+    FOR_RANGE(int64_t, lane, 0, kSumLanes) {
+      const T value = x[i + lane];
+      sum_lanes[lane] += value;
+      sum_square_lanes[lane] += value * value;
+    }
+  }
+  for (; i < size; ++i) {
+    sum_lanes[0] += x[i];
+    sum_square_lanes[0] += x[i] * x[i];
+  }
+  *sum = SumLanes(sum_lanes);
+  *sum_square = SumLanes(sum_square_lanes);
+}
+
+template<typename T>
+void SumRunOfGrad(const T* x, const T* dy, int64_t size, T mean, T* sum_dy, T* dotp) {
+  T sum_dy_lanes[kSumLanes] = {0};
+  T dotp_lanes[kSumLanes] = {0};
+  int64_t i = 0;
+  for (; i + kSumLanes <= size; i += kSumLanes) {
+    FOR_RANGE(int64_t, lane, 0, kSumLanes) {
+      sum_dy_lanes[lane] += dy[i + lane];
+      dotp_lanes[lane] += (x[i + lane] - mean) * dy[i + lane];
+    }
+  }
+  for (; i < size; ++i) {
+    sum_dy_lanes[0] += dy[i];
+    dotp_lanes[0] += (x[i] - mean) * dy[i];
+  }
+  *sum_dy = SumLanes(sum_dy_lanes);
+  *dotp = SumLanes(dotp_lanes);
+}
+
+// Calls ForRun(begin, end, channel) on the runs of a channel in [begin, end) for an inner size > 1,
+// or ForRow(begin, end, first_channel) on the pieces of rows in [begin, end) for channels last.
+template<typename ForRunFn, typename ForRowFn>
+void ForEachChannelRun(const NormalizationCpuShape& shape, int64_t begin, int64_t end,
+                       const ForRunFn& ForRun, const ForRowFn& ForRow) {
+  int64_t i = begin;
+  while (i < end) {
+    if (shape.inner_size > 1) {
+      const int64_t plane = i / shape.inner_size;
+      const int64_t run_end = std::min(end, (plane + 1) * shape.inner_size);
+      ForRun(i, run_end, plane % shape.channel_size);
+      i = run_end;
+    } else {
+      const int64_t first_channel = i % shape.channel_size;
+      const int64_t row_end = std::min(end, i - first_channel + shape.channel_size);
+      ForRow(i, row_end, first_channel);
+      i = row_end;
+    }
+  }
+}
+
+// y = x * scale + shift (+ addend), where addend may be y.
+template<typename T>
+void AffineBlock(const NormalizationCpuShape& shape, const T* x, const T* scale, const T* shift,
+                 const T* addend, T* y, int64_t begin, int64_t end) {
+  ForEachChannelRun(
+      shape, begin, end,
+      [&](int64_t run_begin, int64_t run_end, int64_t channel) {
+        const T channel_scale = scale[channel];
+        const T channel_shift = shift[channel];
+        if (addend != nullptr) {
+          FOR_RANGE(int64_t, i, run_begin, run_end) {
+            y[i] = x[i] * channel_scale + channel_shift + addend[i];
+          }
+        } else {
+          FOR_RANGE(int64_t, i, run_begin, run_end) { y[i] = x[i] * channel_scale + channel_shift; }
+        }
+      },
+      [&](int64_t row_begin, int64_t row_end, int64_t first_channel) {
+        const T* row_scale = scale + first_channel;
+        const T* row_shift = shift + first_channel;
+        const int64_t size = row_end - row_begin;
+        const T* x_row = x + row_begin;
+        T* y_row = y + row_begin;
+        if (addend != nullptr) {
+          const T* addend_row = addend + row_begin;
+          FOR_RANGE(int64_t, i, 0, size) {
+            y_row[i] = x_row[i] * row_scale[i] + row_shift[i] + addend_row[i];
+          }
+        } else {
+          FOR_RANGE(int64_t, i, 0, size) { y_row[i] = x_row[i] * row_scale[i] + row_shift[i]; }
+        }
+      });
+}
+
+// Takes the relu of the elements of a word of the mask, in two loops which the compiler unrolls for
+// a whole word.
+template<typename T>
+inline uint32_t ReluWord(T* y, int64_t size) {
+  uint32_t word = 0;
+  FOR_RANGE(int64_t, i, 0, size) { word |= static_cast<uint32_t>(y[i] > 0) << i; }
+  FOR_RANGE(int64_t, i, 0, size) { y[i] = y[i] > 0 ? y[i] : 0; }
+  return word;
+}
+
+template<typename T>
+inline void ReluGradWord(const T* dy, uint32_t word, int64_t size, T* dx) {
+  FOR_RANGE(int64_t, i, 0, size) { dx[i] = ((word >> i) & 1U) ? dy[i] : static_cast<T>(0); }
+}
+
+// Takes the relu of y in [begin, end), where begin is at a word of the mask.
+template<typename T>
+void ReluBlock(T* y, int32_t* mask, int64_t begin, int64_t end) {
+  int64_t word_begin = begin;
+  for (; word_begin + kMaskWordSize <= end; word_begin += kMaskWordSize) {
+    const uint32_t word = ReluWord(y + word_begin, kMaskWordSize);
+    mask[word_begin / kMaskWordSize] = static_cast<int32_t>(word);
+  }
+  if (word_begin < end) {
+    mask[word_begin / kMaskWordSize] =
+        static_cast<int32_t>(ReluWord(y + word_begin, end - word_begin));
+  }
+}
+
+template<typename T>
+void NormalizeWithScaleAndShift(ep::Stream* stream, const NormalizationCpuShape& shape, const T* x,
+                                const T* scale, const T* shift, const T* addend, T* y,
+                                int32_t* mask) {
+  const int64_t elem_cnt = shape.elem_cnt();
+  const int64_t num_words = (elem_cnt + kMaskWordSize - 1) / kMaskWordSize;
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_words,
+      [&](int64_t word_begin, int64_t word_end) {
+        const int64_t end = std::min(word_end * kMaskWordSize, elem_cnt);
+        for (int64_t block_begin = word_begin * kMaskWordSize; block_begin < end;
+             block_begin += kBlockSize) {
+          const int64_t block_end = std::min(block_begin + kBlockSize, end);
+          AffineBlock(shape, x, scale, shift, addend, y, block_begin, block_end);
+          if (mask != nullptr) { ReluBlock(y, mask, block_begin, block_end); }
+        }
+      },
+      kParallelGrain / kMaskWordSize);
+}
+
+}  // namespace
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::ComputeStatistics(ep::Stream* stream,
+                                                      const NormalizationCpuShape& shape,
+                                                      const T* x, float epsilon, float momentum,
+                                                      T* mean, T* inv_variance, T* moving_mean,
+                                                      T* moving_variance) {
+  const int64_t channel_size = shape.channel_size;
+  std::vector<T> sum(channel_size);
+  std::vector<T> sum_square(channel_size);
+  ReduceSums(
+      stream, shape,
+      [&](int64_t offset, int64_t size, int64_t channel, T* run_sum, T* run_sum_square) {
+        SumRunOfX(x + offset, size, run_sum, run_sum_square);
+      },
+      [&](int64_t row_begin, int64_t row_end, T* rows_sum, T* rows_sum_square) {
+        FOR_RANGE(int64_t, row, row_begin, row_end) {
+          const T* x_row = x + row * channel_size;
+          FOR_RANGE(int64_t, channel, 0, channel_size) {
+            rows_sum[channel] += x_row[channel];
+            rows_sum_square[channel] += x_row[channel] * x_row[channel];
+          }
+        }
+      },
+      sum.data(), sum_square.data());
+
+  const int64_t reduce_count = shape.outer_size * shape.inner_size;
+  const int64_t unbias_reduce_count = reduce_count - 1;
+  const T reduce_scale_factor = static_cast<T>(1) / reduce_count;
+  const T unbias_reduce_scale_factor = static_cast<T>(1) / unbias_reduce_count;
+  const T unbias_reduce_scale_factor_m2 = unbias_reduce_scale_factor * -static_cast<T>(2);
+  const T unbias_reduce_scale_factor_mn = reduce_count * unbias_reduce_scale_factor;
+  const T exponential_average_factor = 1.0f - momentum;
+  FOR_RANGE(int64_t, channel, 0, channel_size) {
+    const T channel_mean = sum[channel] * reduce_scale_factor;
+    const T mean_square = channel_mean * channel_mean;
+    const T variance = sum_square[channel] * reduce_scale_factor - mean_square;
+    const T unbias_variance = sum_square[channel] * unbias_reduce_scale_factor
+                              + unbias_reduce_scale_factor_m2 * channel_mean * sum[channel]
+                              + unbias_reduce_scale_factor_mn * mean_square;
+    mean[channel] = channel_mean;
+    inv_variance[channel] = static_cast<T>(1) / std::sqrt(variance + epsilon);
+    if (moving_mean != nullptr && moving_variance != nullptr) {
+      moving_mean[channel] =
+          moving_mean[channel] * momentum + channel_mean * exponential_average_factor;
+      moving_variance[channel] =
+          moving_variance[channel] * momentum + unbias_variance * exponential_average_factor;
+    }
+  }
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::Normalize(ep::Stream* stream,
+                                              const NormalizationCpuShape& shape, const T* x,
+                                              const T* mean, const T* inv_variance,
+                                              const T* gamma, const T* beta, const T* addend,
+                                              T* y, int32_t* mask) {
+  const int64_t channel_size = shape.channel_size;
+  std::vector<T> scale(channel_size);
+  std::vector<T> shift(channel_size);
+  FOR_RANGE(int64_t, channel, 0, channel_size) {
+    scale[channel] = gamma[channel] * inv_variance[channel];
+    shift[channel] = beta[channel] - mean[channel] * scale[channel];
+  }
+  NormalizeWithScaleAndShift(stream, shape, x, scale.data(), shift.data(), addend, y, mask);
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::InferenceNormalize(
+    ep::Stream* stream, const NormalizationCpuShape& shape, const T* x, const T* moving_mean,
+    const T* moving_variance, float epsilon, const T* gamma, const T* beta, const T* addend, T* y,
+    int32_t* mask) {
+  std::vector<T> inv_variance(shape.channel_size);
+  FOR_RANGE(int64_t, channel, 0, shape.channel_size) {
+    inv_variance[channel] = 1.0f / std::sqrt(moving_variance[channel] + epsilon);
+  }
+  Normalize(stream, shape, x, moving_mean, inv_variance.data(), gamma, beta, addend, y, mask);
+}
+
+// Borrows the MXNet implementation to compute dx, gamma_diff and beta_diff, see
+// https://github.com/apache/incubator-mxnet/blob/master/src/operator/nn/batch_norm.cc
+template<typename T>
+void NormalizationCpuKernelUtil<T>::Backward(ep::Stream* stream,
+                                             const NormalizationCpuShape& shape, const T* x,
+                                             const T* dy, const T* mean, const T* inv_variance,
+                                             const T* gamma, T* dx, T* gamma_diff, T* beta_diff) {
+  const int64_t channel_size = shape.channel_size;
+  std::vector<T> sum_dy(channel_size);
+  std::vector<T> dotp(channel_size);
+  ReduceSums(
+      stream, shape,
+      [&](int64_t offset, int64_t size, int64_t channel, T* run_sum_dy, T* run_dotp) {
+        SumRunOfGrad(x + offset, dy + offset, size, mean[channel], run_sum_dy, run_dotp);
+      },
+      [&](int64_t row_begin, int64_t row_end, T* rows_sum_dy, T* rows_dotp) {
+        FOR_RANGE(int64_t, row, row_begin, row_end) {
+          const T* x_row = x + row * channel_size;
+          const T* dy_row = dy + row * channel_size;
+          FOR_RANGE(int64_t, channel, 0, channel_size) {
+            rows_sum_dy[channel] += dy_row[channel];
+            rows_dotp[channel] += (x_row[channel] - mean[channel]) * dy_row[channel];
+          }
+        }
+      },
+      sum_dy.data(), dotp.data());
+
+  // the projection of dy on to the output, scaled by the standard deviation
+  const int64_t reduce_count = shape.outer_size * shape.inner_size;
+  std::vector<T> k(channel_size);
+  std::vector<T> iw(channel_size);
+  std::vector<T> grad_mean(channel_size);
+  FOR_RANGE(int64_t, channel, 0, channel_size) {
+    const T inv_variance_c = inv_variance[channel];
+    k[channel] = dotp[channel] * inv_variance_c * inv_variance_c / reduce_count;
+    iw[channel] = inv_variance_c * gamma[channel];
+    grad_mean[channel] = sum_dy[channel] / reduce_count;
+    gamma_diff[channel] = dotp[channel] * inv_variance_c;
+    beta_diff[channel] = sum_dy[channel];
+  }
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, shape.elem_cnt(),
+      [&](int64_t begin, int64_t end) {
+        ForEachChannelRun(
+            shape, begin, end,
+            [&](int64_t run_begin, int64_t run_end, int64_t channel) {
+              const T mean_c = mean[channel];
+              const T k_c = k[channel];
+              const T iw_c = iw[channel];
+              const T grad_mean_c = grad_mean[channel];
+              FOR_RANGE(int64_t, i, run_begin, run_end) {
+                dx[i] = (dy[i] - grad_mean_c - (x[i] - mean_c) * k_c) * iw_c;
+              }
+            },
+            [&](int64_t row_begin, int64_t row_end, int64_t first_channel) {
+              const int64_t size = row_end - row_begin;
+              const T* mean_row = mean + first_channel;
+              const T* k_row = k.data() + first_channel;
+              const T* iw_row = iw.data() + first_channel;
+              const T* grad_mean_row = grad_mean.data() + first_channel;
+              const T* x_row = x + row_begin;
+              const T* dy_row = dy + row_begin;
+              T* dx_row = dx + row_begin;
+              FOR_RANGE(int64_t, i, 0, size) {
+                dx_row[i] = (dy_row[i] - grad_mean_row[i] - (x_row[i] - mean_row[i]) * k_row[i])
+                            * iw_row[i];
+              }
+            });
+      },
+      kParallelGrain);
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::ReluBackward(ep::Stream* stream, int64_t elem_cnt,
+                                                 const T* dy, const int32_t* mask, T* dx) {
+  const int64_t num_words = (elem_cnt + kMaskWordSize - 1) / kMaskWordSize;
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_words,
+      [&](int64_t word_begin, int64_t word_end) {
+        FOR_RANGE(int64_t, word_index, word_begin, word_end) {
+          const int64_t offset = word_index * kMaskWordSize;
+          const uint32_t word = static_cast<uint32_t>(mask[word_index]);
+          if (offset + kMaskWordSize <= elem_cnt) {
+            ReluGradWord(dy + offset, word, kMaskWordSize, dx + offset);
+          } else {
+            ReluGradWord(dy + offset, word, elem_cnt - offset, dx + offset);
+          }
+        }
+      },
+      kParallelGrain / kMaskWordSize);
+}
+
+template struct NormalizationCpuKernelUtil<float>;
+template struct NormalizationCpuKernelUtil<double>;
+
+}  // namespace oneflow
@@ -0,0 +1,74 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/shape_view.h"
+#include "oneflow/core/ep/include/stream.h"
+
+namespace oneflow {
+
+// The view of x as [outer_size, channel_size, inner_size] around the normalized axis, so that
+// channels last is an inner size of 1.
+struct NormalizationCpuShape {
+  NormalizationCpuShape(const ShapeView& x_shape, int32_t axis)
+      : outer_size(x_shape.Count(0, axis)),
+        channel_size(x_shape.At(axis)),
+        inner_size(x_shape.Count(axis + 1)) {}
+  NormalizationCpuShape(int64_t outer_size, int64_t channel_size, int64_t inner_size)
+      : outer_size(outer_size), channel_size(channel_size), inner_size(inner_size) {}
+
+  int64_t elem_cnt() const { return outer_size * channel_size * inner_size; }
+
+  int64_t outer_size;
+  int64_t channel_size;
+  int64_t inner_size;
+};
+
+// The batch normalization of the cpu normalization kernels.
+//
+// The statistics are reduced by the threads of the stream in partial sums of parts of x, whose
+// split only depends on the shape, and the partial sums are added in order so that the results do
+// not depend on the number of threads. The elementwise passes are split by words of the relu mask,
+// where a word holds the signs of 32 consecutive elements of y.
+template<typename T>
+struct NormalizationCpuKernelUtil {
+  // Writes the mean and the inverse standard deviation of the batch, and updates the moving ones
+  // unless they are null.
+  static void ComputeStatistics(ep::Stream* stream, const NormalizationCpuShape& shape, const T* x,
+                                float epsilon, float momentum, T* mean, T* inv_variance,
+                                T* moving_mean, T* moving_variance);
+  // y = (x - mean) * inv_variance * gamma + beta, adding addend and taking the relu into y and
+  // mask when they are not null. addend may be y.
+  static void Normalize(ep::Stream* stream, const NormalizationCpuShape& shape, const T* x,
+                        const T* mean, const T* inv_variance, const T* gamma, const T* beta,
+                        const T* addend, T* y, int32_t* mask);
+  // Normalize with the moving statistics.
+  static void InferenceNormalize(ep::Stream* stream, const NormalizationCpuShape& shape, const T* x,
+                                 const T* moving_mean, const T* moving_variance, float epsilon,
+                                 const T* gamma, const T* beta, const T* addend, T* y,
+                                 int32_t* mask);
+  static void Backward(ep::Stream* stream, const NormalizationCpuShape& shape, const T* x,
+                       const T* dy, const T* mean, const T* inv_variance, const T* gamma, T* dx,
+                       T* gamma_diff, T* beta_diff);
+  // dx = dy where the mask of the relu is set, and 0 elsewhere.
+  static void ReluBackward(ep::Stream* stream, int64_t elem_cnt, const T* dy, const int32_t* mask,
+                           T* dx);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
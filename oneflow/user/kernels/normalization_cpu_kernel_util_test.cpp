@@ -0,0 +1,341 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include "oneflow/user/kernels/normalization_cpu_kernel_util.h"
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+#include "oneflow/core/ep/test/test_util.h"
+
+namespace oneflow {
+
+namespace {
+
+class NormalizationCpuKernelUtilTest : public ep::test::TestCase {};
+
+constexpr float kEpsilon = 1e-5;
+constexpr float kMomentum = 0.9;
+
+template<typename T>
+std::vector<T> RandomVector(int64_t size, double low, double high, std::mt19937* gen) {
+  std::uniform_real_distribution<double> dis(low, high);
+  std::vector<T> vec(size);
+  for (auto& value : vec) { value = static_cast<T>(dis(*gen)); }
+  return vec;
+}
+
+template<typename F>
+void ForEachElement(const NormalizationCpuShape& shape, const F& f) {
+  FOR_RANGE(int64_t, outer, 0, shape.outer_size) {
+    FOR_RANGE(int64_t, channel, 0, shape.channel_size) {
+      FOR_RANGE(int64_t, inner, 0, shape.inner_size) {
+        f((outer * shape.channel_size + channel) * shape.inner_size + inner, channel);
+      }
+    }
+  }
+}
+
+// The serial batch normalization of each channel in turn, in double.
+struct ReferenceNormalization {
+  template<typename T>
+  ReferenceNormalization(const NormalizationCpuShape& shape, const std::vector<T>& x,
+                         const std::vector<T>& dy, const std::vector<T>& gamma,
+                         const std::vector<T>& beta)
+      : mean(shape.channel_size, 0),
+        var(shape.channel_size, 0),
+        inv_variance(shape.channel_size, 0),
+        y(x.size()),
+        dx(x.size()),
+        gamma_diff(shape.channel_size, 0),
+        beta_diff(shape.channel_size, 0) {
+    const double count = shape.outer_size * shape.inner_size;
+    ForEachElement(shape, [&](int64_t i, int64_t c) { mean[c] += x[i] / count; });
+    ForEachElement(shape,
+                   [&](int64_t i, int64_t c) { var[c] += (x[i] - mean[c]) * (x[i] - mean[c]); });
+    FOR_RANGE(int64_t, c, 0, shape.channel_size) {
+      var[c] /= count;
+      inv_variance[c] = 1 / std::sqrt(var[c] + kEpsilon);
+    }
+    ForEachElement(shape, [&](int64_t i, int64_t c) {
+      y[i] = (x[i] - mean[c]) * inv_variance[c] * gamma[c] + beta[c];
+      gamma_diff[c] += (x[i] - mean[c]) * inv_variance[c] * dy[i];
+      beta_diff[c] += dy[i];
+    });
+    ForEachElement(shape, [&](int64_t i, int64_t c) {
+      const double x_hat = (x[i] - mean[c]) * inv_variance[c];
+      dx[i] = gamma[c] * inv_variance[c]
+              * (dy[i] - beta_diff[c] / count - x_hat * gamma_diff[c] / count);
+    });
+  }
+
+  std::vector<double> mean;
+  std::vector<double> var;
+  std::vector<double> inv_variance;
+  std::vector<double> y;
+  std::vector<double> dx;
+  std::vector<double> gamma_diff;
+  std::vector<double> beta_diff;
+};
+
+template<typename T>
+void AssertNear(const std::vector<T>& actual, const std::vector<double>& expected,
+                double tolerance) {
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); ++i) {
+    ASSERT_NEAR(actual[i], expected[i], tolerance * (1 + std::abs(expected[i]))) << i;
+  }
+}
+
+template<typename T>
+struct NormalizationResults {
+  std::vector<T> mean;
+  std::vector<T> inv_variance;
+  std::vector<T> moving_mean;
+  std::vector<T> moving_variance;
+  std::vector<T> y;
+  std::vector<int32_t> mask;
+  std::vector<T> dx;
+  std::vector<T> gamma_diff;
+  std::vector<T> beta_diff;
+};
+
+template<typename T>
+void TestNormalization(ep::Stream* stream, const NormalizationCpuShape& shape, double tolerance,
+                       NormalizationResults<T>* results) {
+  using Util = NormalizationCpuKernelUtil<T>;
+  std::mt19937 gen(0);
+  const int64_t elem_cnt = shape.elem_cnt();
+  const int64_t channel_size = shape.channel_size;
+  const int64_t num_words = (elem_cnt + 31) / 32;
+  // an offset mean of each channel, which the partial sums meet in float
+  std::vector<T> x = RandomVector<T>(elem_cnt, -1, 1, &gen);
+  ForEachElement(shape, [&](int64_t i, int64_t c) { x[i] += static_cast<T>(c % 3); });
+  const std::vector<T> dy = RandomVector<T>(elem_cnt, -1, 1, &gen);
+  const std::vector<T> addend = RandomVector<T>(elem_cnt, -1, 1, &gen);
+  const std::vector<T> gamma = RandomVector<T>(channel_size, 0.5, 1.5, &gen);
+  const std::vector<T> beta = RandomVector<T>(channel_size, -1, 1, &gen);
+  const std::vector<T> init_moving_mean = RandomVector<T>(channel_size, -1, 1, &gen);
+  const std::vector<T> init_moving_variance = RandomVector<T>(channel_size, 0.5, 1.5, &gen);
+  const ReferenceNormalization ref(shape, x, dy, gamma, beta);
+
+  results->mean.resize(channel_size);
+  results->inv_variance.resize(channel_size);
+  results->moving_mean = init_moving_mean;
+  results->moving_variance = init_moving_variance;
+  Util::ComputeStatistics(stream, shape, x.data(), kEpsilon, kMomentum, results->mean.data(),
+                          results->inv_variance.data(), results->moving_mean.data(),
+                          results->moving_variance.data());
+  if (elem_cnt == 0) { return; }
+  AssertNear(results->mean, ref.mean, tolerance);
+  AssertNear(results->inv_variance, ref.inv_variance, tolerance);
+  std::vector<double> expected_moving_mean(channel_size);
+  std::vector<double> expected_moving_variance(channel_size);
+  const double count = shape.outer_size * shape.inner_size;
+  FOR_RANGE(int64_t, c, 0, channel_size) {
+    expected_moving_mean[c] = init_moving_mean[c] * kMomentum + ref.mean[c] * (1 - kMomentum);
+    expected_moving_variance[c] = init_moving_variance[c] * kMomentum
+                                  + ref.var[c] * count / (count - 1) * (1 - kMomentum);
+  }
+  AssertNear(results->moving_mean, expected_moving_mean, tolerance);
+  AssertNear(results->moving_variance, expected_moving_variance, tolerance);
+
+  // without the relu
+  results->y.resize(elem_cnt);
+  Util::Normalize(stream, shape, x.data(), results->mean.data(), results->inv_variance.data(),
+                  gamma.data(), beta.data(), nullptr, results->y.data(), nullptr);
+  AssertNear(results->y, ref.y, tolerance);
+
+  // with the addend in place of y and the relu
+  std::vector<double> expected_y(elem_cnt);
+  std::vector<int32_t> expected_mask(num_words, 0);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) {
+    const double sum = ref.y[i] + addend[i];
+    expected_y[i] = sum > 0 ? sum : 0;
+    if (sum > 0) { expected_mask[i / 32] |= static_cast<int32_t>(1U << (i % 32)); }
+  }
+  results->y = addend;
+  results->mask.assign(num_words, 0);
+  Util::Normalize(stream, shape, x.data(), results->mean.data(), results->inv_variance.data(),
+                  gamma.data(), beta.data(), results->y.data(), results->y.data(),
+                  results->mask.data());
+  AssertNear(results->y, expected_y, tolerance);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) {
+    // a sum at about 0 may take either side
+    if (std::abs(ref.y[i] + addend[i]) < tolerance) { continue; }
+    ASSERT_EQ((results->mask[i / 32] >> (i % 32)) & 1, (expected_mask[i / 32] >> (i % 32)) & 1)
+        << i;
+  }
+
+  // the moving statistics of the inference are the ones of the batch
+  std::vector<T> moving_variance(channel_size);
+  FOR_RANGE(int64_t, c, 0, channel_size) { moving_variance[c] = ref.var[c]; }
+  std::vector<T> inference_y(elem_cnt);
+  Util::InferenceNormalize(stream, shape, x.data(), results->mean.data(), moving_variance.data(),
+                           kEpsilon, gamma.data(), beta.data(), nullptr, inference_y.data(),
+                           nullptr);
+  AssertNear(inference_y, ref.y, tolerance);
+
+  std::vector<T> relu_dx(elem_cnt);
+  Util::ReluBackward(stream, elem_cnt, dy.data(), results->mask.data(), relu_dx.data());
+  FOR_RANGE(int64_t, i, 0, elem_cnt) {
+    ASSERT_EQ(relu_dx[i], ((results->mask[i / 32] >> (i % 32)) & 1) ? dy[i] : 0) << i;
+  }
+
+  results->dx.resize(elem_cnt);
+  results->gamma_diff.resize(channel_size);
+  results->beta_diff.resize(channel_size);
+  Util::Backward(stream, shape, x.data(), dy.data(), results->mean.data(),
+                 results->inv_variance.data(), gamma.data(), results->dx.data(),
+                 results->gamma_diff.data(), results->beta_diff.data());
+  AssertNear(results->gamma_diff, ref.gamma_diff, tolerance * std::sqrt(count));
+  AssertNear(results->beta_diff, ref.beta_diff, tolerance * std::sqrt(count));
+  AssertNear(results->dx, ref.dx, tolerance);
+}
+
+std::vector<NormalizationCpuShape> NormalizationShapes() {
+  return {
+      // channels first, with a tail of the mask
+      {2, 3, 17},
+      // channels last
+      {7, 5, 1},
+      // the planes of a channel in several runs
+      {2, 2, 70001},
+      // the rows of channels last in several parts
+      {9000, 7, 1},
+      // a normalized last axis of a 3d x
+      {3, 4, 1},
+      {1, 1, 2},
+      {0, 3, 4},
+      {4, 3, 0},
+  };
+}
+
+}  // namespace
+
+TEST_F(NormalizationCpuKernelUtilTest, same_as_reference) {
+  if (available_device_types_.count(DeviceType::kCPU) == 0) { return; }
+  auto device = device_manager_registry_.GetDevice(DeviceType::kCPU, 0);
+  auto* cpu_device = dynamic_cast<ep::CpuDevice*>(device.get());
+  const size_t old_thread_num = cpu_device->GetNumThreads();
+  for (const auto& shape : NormalizationShapes()) {
+    std::vector<NormalizationResults<float>> float_results(2);
+    std::vector<NormalizationResults<double>> double_results(2);
+    FOR_RANGE(int64_t, i, 0, 2) {
+      cpu_device->SetNumThreads(i == 0 ? 1 : 3);
+      ep::test::StreamGuard stream(device.get());
+      TestNormalization<float>(stream.stream(), shape, 1e-4, &float_results[i]);
+      TestNormalization<double>(stream.stream(), shape, 1e-9, &double_results[i]);
+      if (HasFatalFailure()) { return; }
+    }
+    if (shape.elem_cnt() == 0) { continue; }
+    // the sums do not depend on the number of threads
+    ASSERT_EQ(float_results[0].mean, float_results[1].mean);
+    ASSERT_EQ(float_results[0].inv_variance, float_results[1].inv_variance);
+    ASSERT_EQ(float_results[0].moving_variance, float_results[1].moving_variance);
+    ASSERT_EQ(float_results[0].y, float_results[1].y);
+    ASSERT_EQ(float_results[0].mask, float_results[1].mask);
+    ASSERT_EQ(float_results[0].dx, float_results[1].dx);
+    ASSERT_EQ(float_results[0].gamma_diff, float_results[1].gamma_diff);
+    ASSERT_EQ(double_results[0].dx, double_results[1].dx);
+  }
+  cpu_device->SetNumThreads(old_thread_num);
+}
+
+TEST_F(NormalizationCpuKernelUtilTest, benchmark) {
+  if (!ParseBooleanFromEnv("ONEFLOW_TEST_BENCHMARK", false)) {
+    GTEST_SKIP() << "set ONEFLOW_TEST_BENCHMARK=1 to run";
+  }
+  if (available_device_types_.count(DeviceType::kCPU) == 0) { return; }
+  auto device = device_manager_registry_.GetDevice(DeviceType::kCPU, 0);
+  auto* cpu_device = dynamic_cast<ep::CpuDevice*>(device.get());
+  const size_t old_thread_num = cpu_device->GetNumThreads();
+  const int64_t thread_num = std::max<int64_t>(1, std::thread::hardware_concurrency());
+  const double kMinSeconds = 0.2;
+  using Util = NormalizationCpuKernelUtil<float>;
+  auto ElemsPerSecond = [&](int64_t elem_cnt, const std::function<void()>& Run) {
+    Run();
+    const auto start = std::chrono::steady_clock::now();
+    int64_t iter_num = 0;
+    double seconds = 0;
+    while (seconds < kMinSeconds) {
+      Run();
+      iter_num += 1;
+      seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return iter_num * elem_cnt / seconds;
+  };
+  int64_t case_index = 0;
+  auto Report = [&](const std::string& name, int64_t elem_cnt, const std::function<void()>& Run) {
+    std::ostringstream report;
+    report << name << ":";
+    cpu_device->SetNumThreads(1);
+    report << " 1 thread " << ElemsPerSecond(elem_cnt, Run) << " elems/s";
+    cpu_device->SetNumThreads(thread_num);
+    report << ", " << thread_num << " threads " << ElemsPerSecond(elem_cnt, Run) << " elems/s";
+    cpu_device->SetNumThreads(old_thread_num);
+    RecordProperty("case_" + std::to_string(case_index++), report.str());
+  };
+  ep::test::StreamGuard stream_guard(device.get());
+  ep::Stream* stream = stream_guard.stream();
+  std::mt19937 gen(0);
+  // the batch norms of the first stage of resnet50
+  for (const auto& named_shape : {
+           std::make_pair(std::string("resnet50 batch norm channels first"),
+                          NormalizationCpuShape(8, 64, 56 * 56)),
+           std::make_pair(std::string("resnet50 batch norm channels last"),
+                          NormalizationCpuShape(8 * 56 * 56, 64, 1)),
+       }) {
+    const NormalizationCpuShape& shape = named_shape.second;
+    const int64_t elem_cnt = shape.elem_cnt();
+    const auto x = RandomVector<float>(elem_cnt, -1, 1, &gen);
+    const auto dy = RandomVector<float>(elem_cnt, -1, 1, &gen);
+    const auto gamma = RandomVector<float>(shape.channel_size, 0.5, 1.5, &gen);
+    const auto beta = RandomVector<float>(shape.channel_size, -1, 1, &gen);
+    std::vector<float> mean(shape.channel_size);
+    std::vector<float> inv_variance(shape.channel_size);
+    std::vector<float> moving_mean(shape.channel_size, 0);
+    std::vector<float> moving_variance(shape.channel_size, 1);
+    std::vector<float> gamma_diff(shape.channel_size);
+    std::vector<float> beta_diff(shape.channel_size);
+    std::vector<float> y(elem_cnt);
+    std::vector<float> dx(elem_cnt);
+    std::vector<int32_t> mask((elem_cnt + 31) / 32);
+    Report(named_shape.first + " train", elem_cnt, [&]() {
+      Util::ComputeStatistics(stream, shape, x.data(), kEpsilon, kMomentum, mean.data(),
+                              inv_variance.data(), moving_mean.data(), moving_variance.data());
+      Util::Normalize(stream, shape, x.data(), mean.data(), inv_variance.data(), gamma.data(),
+                      beta.data(), nullptr, y.data(), nullptr);
+    });
+    Report(named_shape.first + " inference", elem_cnt, [&]() {
+      Util::InferenceNormalize(stream, shape, x.data(), moving_mean.data(),
+                               moving_variance.data(), kEpsilon, gamma.data(), beta.data(),
+                               nullptr, y.data(), nullptr);
+    });
+    Report(named_shape.first + " inference add relu", elem_cnt, [&]() {
+      Util::InferenceNormalize(stream, shape, x.data(), moving_mean.data(),
+                               moving_variance.data(), kEpsilon, gamma.data(), beta.data(),
+                               dy.data(), y.data(), mask.data());
+    });
+    Report(named_shape.first + " grad", elem_cnt, [&]() {
+      Util::Backward(stream, shape, x.data(), dy.data(), mean.data(), inv_variance.data(),
+                     gamma.data(), dx.data(), gamma_diff.data(), beta_diff.data());
+    });
+  }
+}
+
+}  // namespace oneflow
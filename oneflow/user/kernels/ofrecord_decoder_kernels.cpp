@@ -26,6 +26,7 @@ limitations under the License.
 #include "oneflow/user/kernels/op_kernel_wrapper.h"
 #include "oneflow/user/kernels/random_seed_util.h"
 #include "oneflow/user/image/jpeg_decoder.h"
+#include "oneflow/user/data/ofrecord_view.h"
 
 #include <opencv2/opencv.hpp>
 #include <jpeglib.h>
@@ -35,42 +36,32 @@ namespace oneflow {
 namespace {
 
 template<typename T>
-void DecodeOneRawOFRecord(const Feature& feature, T* dptr, int64_t sample_elem_cnt, bool truncate,
-                          bool dim1_varying_length) {
+void DecodeOneRawOFRecord(const data::OFRecordFeatureView& feature, T* dptr,
+                          int64_t sample_elem_cnt, bool truncate, bool dim1_varying_length) {
   if (feature.has_bytes_list()) {
-    CHECK_EQ(feature.bytes_list().value_size(), 1);
-    const auto& value0 = feature.bytes_list().value(0);
-    auto in_dptr = reinterpret_cast<const int8_t*>(value0.c_str());
-    sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, value0.size());
+    CHECK_EQ(feature.value_size(), 1);
+    auto in_dptr = reinterpret_cast<const int8_t*>(feature.bytes_data(0));
+    sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, feature.bytes_size(0));
     std::transform(in_dptr, in_dptr + sample_elem_cnt, dptr,
                    [](int8_t v) { return static_cast<T>(v); });
-  }
-#define DEFINE_ONE_ELIF(PbT, CppT)                                                       \
-  else if (feature.has_##PbT##_list()) {                                                 \
-    const auto& list = feature.PbT##_list();                                             \
-    const CppT* in_dptr = list.value().data();                                           \
-    const int64_t padding_elem_num = truncate ? sample_elem_cnt - list.value_size() : 0; \
-    if (truncate) {                                                                      \
-      sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, list.value_size());           \
-    } else {                                                                             \
-      if (dim1_varying_length) {                                                         \
-        sample_elem_cnt = list.value_size();                                             \
-      } else {                                                                           \
-        CHECK_EQ(sample_elem_cnt, list.value_size());                                    \
-      }                                                                                  \
-    }                                                                                    \
-    std::transform(in_dptr, in_dptr + sample_elem_cnt, dptr,                             \
-                   [](CppT v) { return static_cast<T>(v); });                            \
-    if (padding_elem_num > 0) {                                                          \
-      std::memset(dptr + sample_elem_cnt, 0, padding_elem_num * sizeof(T));              \
-    }                                                                                    \
-  }
-  DEFINE_ONE_ELIF(float, float)
-  DEFINE_ONE_ELIF(double, double)
-  DEFINE_ONE_ELIF(int32, int32_t)
-  DEFINE_ONE_ELIF(int64, int64_t)
-#undef DEFINE_ONE_ELIF
-  else {
+  } else if (feature.has_float_list() || feature.has_double_list() || feature.has_int32_list()
+             || feature.has_int64_list()) {
+    const int64_t value_size = feature.value_size();
+    const int64_t padding_elem_num = truncate ? sample_elem_cnt - value_size : 0;
+    if (truncate) {
+      sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, value_size);
+    } else {
+      if (dim1_varying_length) {
+        sample_elem_cnt = value_size;
+      } else {
+        CHECK_EQ(sample_elem_cnt, value_size);
+      }
+    }
+    feature.CopyValues(sample_elem_cnt, dptr);
+    if (padding_elem_num > 0) {
+      std::memset(dptr + sample_elem_cnt, 0, padding_elem_num * sizeof(T));
+    }
+  } else {
     UNIMPLEMENTED();
   }
 }
@@ -98,13 +89,13 @@ class OFRecordRawDecoderKernel final : public user_op::OpKernel {
     bool truncate = ctx->Attr<bool>("truncate");
     bool dim1_varying_length = ctx->Attr<bool>("dim1_varying_length");
 
+    const std::vector<std::string> names{name};
     MultiThreadLoop(record_num, [&](size_t i) {
       const OFRecord& record = *(records + i);
       T* dptr = out_dptr + i * sample_elem_cnt;
-      CHECK(record.feature().find(name) != record.feature().end())
-          << "Field " << name << " not found";
-      const Feature& feature = record.feature().at(name);
-      DecodeOneRawOFRecord(feature, dptr, sample_elem_cnt, truncate, dim1_varying_length);
+      data::OFRecordView view;
+      view.Reset(record, names);
+      DecodeOneRawOFRecord(view.Get(name), dptr, sample_elem_cnt, truncate, dim1_varying_length);
     });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
@@ -141,17 +132,18 @@ class OFRecordBytesDecoderKernel final : public user_op::OpKernel {
     const auto* records = in->dptr<OFRecord>();
     auto* buffers = out->mut_dptr<TensorBuffer>();
     const std::string& name = ctx->Attr<std::string>("name");
+    const std::vector<std::string> names{name};
     MultiThreadLoop(num_instances, [&](size_t i) {
       const OFRecord& record = *(records + i);
       TensorBuffer* buffer = buffers + i;
-      auto it = record.feature().find(name);
-      CHECK(it != record.feature().end()) << "Field " << name << " not found";
-      const Feature& feature = it->second;
+      data::OFRecordView view;
+      view.Reset(record, names);
+      const data::OFRecordFeatureView& feature = view.Get(name);
       CHECK(feature.has_bytes_list());
-      CHECK_EQ(feature.bytes_list().value_size(), 1);
-      const int64_t size = feature.bytes_list().value(0).size();
+      CHECK_EQ(feature.value_size(), 1);
+      const int64_t size = feature.bytes_size(0);
       buffer->Resize(Shape({size}), DataType::kUInt8);
-      memcpy(buffer->mut_data(), feature.bytes_list().value(0).data(), size);
+      memcpy(buffer->mut_data(), feature.bytes_data(0), size);
     });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
@@ -168,23 +160,23 @@ namespace {
 void DecodeRandomCropImageFromOneRecord(const OFRecord& record, TensorBuffer* buffer,
                                         const std::string& name, const std::string& color_space,
                                         RandomCropGenerator* random_crop_gen) {
-  CHECK(record.feature().find(name) != record.feature().end()) << "Field " << name << " not found";
-  const Feature& feature = record.feature().at(name);
+  data::OFRecordView view;
+  view.Reset(record, {name});
+  const data::OFRecordFeatureView& feature = view.Get(name);
   CHECK(feature.has_bytes_list());
-  CHECK(feature.bytes_list().value_size() == 1);
-  const std::string& src_data = feature.bytes_list().value(0);
+  CHECK(feature.value_size() == 1);
+  const auto* src_data = reinterpret_cast<const unsigned char*>(feature.bytes_data(0));
+  const size_t src_size = feature.bytes_size(0);
   cv::Mat image;
 
-  if (JpegPartialDecodeRandomCropImage(reinterpret_cast<const unsigned char*>(src_data.data()),
-                                       src_data.size(), random_crop_gen, nullptr, 0, &image)) {
+  if (JpegPartialDecodeRandomCropImage(src_data, src_size, random_crop_gen, nullptr, 0, &image)) {
     // convert color space
     // jpeg decode output RGB
     if (ImageUtil::IsColor(color_space) && color_space != "RGB") {
       ImageUtil::ConvertColor("RGB", image, color_space, image);
     }
   } else {
-    OpenCvPartialDecodeRandomCropImage(reinterpret_cast<const unsigned char*>(src_data.data()),
-                                       src_data.size(), random_crop_gen, color_space, image);
+    OpenCvPartialDecodeRandomCropImage(src_data, src_size, random_crop_gen, color_space, image);
     // convert color space
     // opencv decode output BGR
     if (ImageUtil::IsColor(color_space) && color_space != "BGR") {
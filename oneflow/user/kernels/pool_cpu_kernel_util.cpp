@@ -0,0 +1,433 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/pool_cpu_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// The window elements a task of the threads visits at least.
+constexpr int64_t kParallelGrain = 32768;
+
+// The windows of the output positions along a spatial dim, clipped by the input.
+struct PoolWindows {
+  std::vector<int64_t> begin;
+  std::vector<int64_t> end;
+  // the sizes of the windows of avg pool, counted with the padding
+  std::vector<int64_t> padded_size;
+  // the outputs in [inner_begin, inner_end) have their whole windows inside the input
+  int64_t inner_begin = 0;
+  int64_t inner_end = 0;
+};
+
+struct PoolGeometry {
+  PoolGeometry(const Shape& x_5d, const Shape& y_5d, const std::vector<int32_t>& padding_3d,
+               const std::vector<int32_t>& pool_size_3d, const std::vector<int32_t>& stride_3d,
+               const std::vector<int32_t>& dilation_3d, bool is_avg) {
+    batch_size = x_5d.At(0);
+    channels = x_5d.At(1);
+    FOR_RANGE(int32_t, i, 0, 3) {
+      in[i] = x_5d.At(i + 2);
+      out[i] = y_5d.At(i + 2);
+      padding[i] = padding_3d.at(i);
+      kernel[i] = pool_size_3d.at(i);
+      stride[i] = stride_3d.at(i);
+      dilation[i] = dilation_3d.at(i);
+      in_spatial *= in[i];
+      out_spatial *= out[i];
+      window_size *= kernel[i];
+      InitWindows(i, is_avg);
+    }
+  }
+
+  void InitWindows(int32_t i, bool is_avg) {
+    PoolWindows* windows_i = &windows[i];
+    windows_i->begin.resize(out[i]);
+    windows_i->end.resize(out[i]);
+    windows_i->padded_size.resize(out[i]);
+    bool has_inner = false;
+    FOR_RANGE(int64_t, o, 0, out[i]) {
+      const int64_t start = o * stride[i] - padding[i];
+      bool inside = false;
+      if (is_avg) {
+        const int64_t padded_end = std::min<int64_t>(start + kernel[i], in[i] + padding[i]);
+        windows_i->begin[o] = std::max<int64_t>(start, 0);
+        windows_i->end[o] = std::min(padded_end, in[i]);
+        windows_i->padded_size[o] = padded_end - start;
+        inside = start >= 0 && start + kernel[i] <= in[i];
+      } else {
+        const int64_t end = start + (kernel[i] - 1) * dilation[i] + 1;
+        int64_t begin = start;
+        while (begin < 0) { begin += dilation[i]; }
+        windows_i->begin[o] = begin;
+        windows_i->end[o] = std::min(end, in[i]);
+        inside = start >= 0 && end <= in[i];
+      }
+      if (inside) {
+        if (!has_inner) {
+          windows_i->inner_begin = o;
+          has_inner = true;
+        }
+        windows_i->inner_end = o + 1;
+      }
+    }
+  }
+
+  // The tasks of planes of channels first images.
+  int64_t PlaneGrain() const {
+    return std::max<int64_t>(kParallelGrain / std::max<int64_t>(out_spatial * window_size, 1), 1);
+  }
+
+  int64_t batch_size = 0;
+  int64_t channels = 0;
+  int64_t in[3] = {1, 1, 1};
+  int64_t out[3] = {1, 1, 1};
+  int64_t padding[3] = {0, 0, 0};
+  int64_t kernel[3] = {1, 1, 1};
+  int64_t stride[3] = {1, 1, 1};
+  int64_t dilation[3] = {1, 1, 1};
+  int64_t in_spatial = 1;
+  int64_t out_spatial = 1;
+  int64_t window_size = 1;
+  PoolWindows windows[3];
+};
+
+PoolGeometry MakeMaxPoolGeometry(const MaxPoolParams3D& params_3d) {
+  return PoolGeometry(params_3d.GetXShape5D(), params_3d.GetYShape5D(), params_3d.padding(),
+                      params_3d.pool_size_3d(), params_3d.stride_3d(), params_3d.dilation_3d(),
+                      /*is_avg=*/false);
+}
+
+PoolGeometry MakeAvgPoolGeometry(const AvgPoolParams3D& params_3d) {
+  return PoolGeometry(params_3d.GetXShape5D(), params_3d.GetYShape5D(), params_3d.padding(),
+                      params_3d.pool_size_3d(), params_3d.stride_3d(), {1, 1, 1},
+                      /*is_avg=*/true);
+}
+
+// Takes x[offset + o * stride] into the maxima of the outputs in [begin, end), where a nan is
+// greater than everything like in the window walks of the kernels. The maxima remember the step
+// of the window they were taken at rather than their offsets, which keeps the lanes of the values
+// and of the steps alike in width so that the loop is vectorized.
+template<typename T>
+inline void MaxPoolStep(const T* x, int64_t offset, int64_t stride, int64_t begin, int64_t end,
+                        int32_t step, T* y, int32_t* steps) {
+  for (int64_t o = begin; o < end; ++o) {
+    const T val = x[offset + o * stride];
+    const bool greater = val > y[o] || detail::numerics<T>::isnan(val);
+    y[o] = greater ? val : y[o];
+    steps[o] = greater ? step : steps[o];
+  }
+}
+
+// steps is a buffer of a row of outputs, and step_offsets one of the window size.
+template<typename T>
+void MaxPoolPlaneCFirst(const PoolGeometry& g, const T* x, T* y, int64_t* indice, int32_t* steps,
+                        int64_t* step_offsets) {
+  const PoolWindows& wt = g.windows[0];
+  const PoolWindows& wh = g.windows[1];
+  const PoolWindows& ww = g.windows[2];
+  const int64_t in_hw = g.in[1] * g.in[2];
+  FOR_RANGE(int64_t, ot, 0, g.out[0]) {
+    FOR_RANGE(int64_t, oh, 0, g.out[1]) {
+      const int64_t row = (ot * g.out[1] + oh) * g.out[2];
+      T* y_row = y + row;
+      int64_t* indice_row = indice + row;
+      const int64_t first_row = wt.begin[ot] * in_hw + wh.begin[oh] * g.in[2];
+      const auto WalkWindow = [&](int64_t ow) {
+        T max_value = detail::numeric_limits<T>::lower_bound();
+        int64_t max_index = first_row + ww.begin[ow];
+        for (int64_t it = wt.begin[ot]; it < wt.end[ot]; it += g.dilation[0]) {
+          for (int64_t ih = wh.begin[oh]; ih < wh.end[oh]; ih += g.dilation[1]) {
+            for (int64_t iw = ww.begin[ow]; iw < ww.end[ow]; iw += g.dilation[2]) {
+              const int64_t index = it * in_hw + ih * g.in[2] + iw;
+              const T val = x[index];
+              if (val > max_value || detail::numerics<T>::isnan(val)) {
+                max_value = val;
+                max_index = index;
+              }
+            }
+          }
+        }
+        y_row[ow] = max_value;
+        indice_row[ow] = max_index;
+      };
+      FOR_RANGE(int64_t, ow, 0, ww.inner_begin) { WalkWindow(ow); }
+      FOR_RANGE(int64_t, ow, ww.inner_end, g.out[2]) { WalkWindow(ow); }
+      if (ww.inner_begin >= ww.inner_end) { continue; }
+      FOR_RANGE(int64_t, ow, ww.inner_begin, ww.inner_end) {
+        y_row[ow] = detail::numeric_limits<T>::lower_bound();
+        steps[ow] = 0;
+      }
+      int32_t step = 0;
+      for (int64_t it = wt.begin[ot]; it < wt.end[ot]; it += g.dilation[0]) {
+        for (int64_t ih = wh.begin[oh]; ih < wh.end[oh]; ih += g.dilation[1]) {
+          FOR_RANGE(int64_t, kw, 0, g.kernel[2]) {
+            const int64_t offset = it * in_hw + ih * g.in[2] + kw * g.dilation[2] - g.padding[2];
+            step_offsets[step] = offset;
+            MaxPoolStep(x, offset, g.stride[2], ww.inner_begin, ww.inner_end, step, y_row, steps);
+            ++step;
+          }
+        }
+      }
+      FOR_RANGE(int64_t, ow, ww.inner_begin, ww.inner_end) {
+        indice_row[ow] = step_offsets[steps[ow]] + ow * g.stride[2];
+      }
+    }
+  }
+}
+
+// steps is a buffer of the channels, and step_offsets one of the window size.
+template<typename T>
+void MaxPoolPositionsCLast(const PoolGeometry& g, const T* x, T* y, int64_t* indice,
+                           int64_t begin, int64_t end, int32_t* steps, int64_t* step_offsets) {
+  const PoolWindows& wt = g.windows[0];
+  const PoolWindows& wh = g.windows[1];
+  const PoolWindows& ww = g.windows[2];
+  const int64_t c = g.channels;
+  FOR_RANGE(int64_t, p, begin, end) {
+    const int64_t n = p / g.out_spatial;
+    const int64_t ow = p % g.out[2];
+    const int64_t oh = p / g.out[2] % g.out[1];
+    const int64_t ot = p / (g.out[1] * g.out[2]) % g.out[0];
+    const T* x_n = x + n * g.in_spatial * c;
+    T* y_p = y + p * c;
+    int64_t* indice_p = indice + p * c;
+    FOR_RANGE(int64_t, i, 0, c) {
+      y_p[i] = detail::numeric_limits<T>::lower_bound();
+      steps[i] = 0;
+    }
+    int32_t step = 0;
+    for (int64_t it = wt.begin[ot]; it < wt.end[ot]; it += g.dilation[0]) {
+      for (int64_t ih = wh.begin[oh]; ih < wh.end[oh]; ih += g.dilation[1]) {
+        for (int64_t iw = ww.begin[ow]; iw < ww.end[ow]; iw += g.dilation[2]) {
+          const int64_t offset = ((it * g.in[1] + ih) * g.in[2] + iw) * c;
+          step_offsets[step] = offset;
+          MaxPoolStep(x_n, offset, 1, 0, c, step, y_p, steps);
+          ++step;
+        }
+      }
+    }
+    FOR_RANGE(int64_t, i, 0, c) { indice_p[i] = step_offsets[steps[i]] + i; }
+  }
+}
+
+template<typename T>
+void AvgPoolPlane(const PoolGeometry& g, bool count_include_pad, int32_t divisor_override,
+                  const T* x, T* y) {
+  const PoolWindows& wt = g.windows[0];
+  const PoolWindows& wh = g.windows[1];
+  const PoolWindows& ww = g.windows[2];
+  const int64_t in_hw = g.in[1] * g.in[2];
+  FOR_RANGE(int64_t, ot, 0, g.out[0]) {
+    FOR_RANGE(int64_t, oh, 0, g.out[1]) {
+      T* y_row = y + (ot * g.out[1] + oh) * g.out[2];
+      const int64_t padded_th = wt.padded_size[ot] * wh.padded_size[oh];
+      const int64_t size_th = (wt.end[ot] - wt.begin[ot]) * (wh.end[oh] - wh.begin[oh]);
+      const auto Divisor = [&](int64_t padded_w, int64_t size_w) -> T {
+        if (divisor_override != 0) { return static_cast<T>(divisor_override); }
+        return static_cast<T>(count_include_pad ? padded_th * padded_w : size_th * size_w);
+      };
+      const auto WalkWindow = [&](int64_t ow) {
+        T sum = 0;
+        FOR_RANGE(int64_t, it, wt.begin[ot], wt.end[ot]) {
+          FOR_RANGE(int64_t, ih, wh.begin[oh], wh.end[oh]) {
+            FOR_RANGE(int64_t, iw, ww.begin[ow], ww.end[ow]) {
+              sum += x[it * in_hw + ih * g.in[2] + iw];
+            }
+          }
+        }
+        y_row[ow] = sum / Divisor(ww.padded_size[ow], ww.end[ow] - ww.begin[ow]);
+      };
+      FOR_RANGE(int64_t, ow, 0, ww.inner_begin) { WalkWindow(ow); }
+      FOR_RANGE(int64_t, ow, ww.inner_end, g.out[2]) { WalkWindow(ow); }
+      const int64_t inner_begin = ww.inner_begin;
+      const int64_t inner_end = ww.inner_end;
+      const int64_t stride = g.stride[2];
+      FOR_RANGE(int64_t, ow, inner_begin, inner_end) { y_row[ow] = 0; }
+      FOR_RANGE(int64_t, it, wt.begin[ot], wt.end[ot]) {
+        FOR_RANGE(int64_t, ih, wh.begin[oh], wh.end[oh]) {
+          FOR_RANGE(int64_t, kw, 0, g.kernel[2]) {
+            const int64_t offset = it * in_hw + ih * g.in[2] + kw - g.padding[2];
+            for (int64_t ow = inner_begin; ow < inner_end; ++ow) {
+              y_row[ow] += x[offset + ow * stride];
+            }
+          }
+        }
+      }
+      const T divisor = Divisor(g.kernel[2], g.kernel[2]);
+      FOR_RANGE(int64_t, ow, inner_begin, inner_end) { y_row[ow] = y_row[ow] / divisor; }
+    }
+  }
+}
+
+// delta is a buffer of a row of outputs.
+template<typename T>
+void AvgPoolPlaneGrad(const PoolGeometry& g, bool count_include_pad, int32_t divisor_override,
+                      const T* dy, T* dx, T* delta) {
+  const PoolWindows& wt = g.windows[0];
+  const PoolWindows& wh = g.windows[1];
+  const PoolWindows& ww = g.windows[2];
+  const int64_t in_hw = g.in[1] * g.in[2];
+  FOR_RANGE(int64_t, ot, 0, g.out[0]) {
+    FOR_RANGE(int64_t, oh, 0, g.out[1]) {
+      const T* dy_row = dy + (ot * g.out[1] + oh) * g.out[2];
+      const int64_t padded_th = wt.padded_size[ot] * wh.padded_size[oh];
+      const int64_t size_th = (wt.end[ot] - wt.begin[ot]) * (wh.end[oh] - wh.begin[oh]);
+      const auto Divisor = [&](int64_t padded_w, int64_t size_w) -> T {
+        if (divisor_override != 0) { return static_cast<T>(divisor_override); }
+        return static_cast<T>(count_include_pad ? padded_th * padded_w : size_th * size_w);
+      };
+      const auto WalkWindow = [&](int64_t ow) {
+        const T grad_delta = dy_row[ow] / Divisor(ww.padded_size[ow], ww.end[ow] - ww.begin[ow]);
+        FOR_RANGE(int64_t, it, wt.begin[ot], wt.end[ot]) {
+          FOR_RANGE(int64_t, ih, wh.begin[oh], wh.end[oh]) {
+            FOR_RANGE(int64_t, iw, ww.begin[ow], ww.end[ow]) {
+              dx[it * in_hw + ih * g.in[2] + iw] += grad_delta;
+            }
+          }
+        }
+      };
+      FOR_RANGE(int64_t, ow, 0, ww.inner_begin) { WalkWindow(ow); }
+      FOR_RANGE(int64_t, ow, ww.inner_end, g.out[2]) { WalkWindow(ow); }
+      const int64_t inner_begin = ww.inner_begin;
+      const int64_t inner_end = ww.inner_end;
+      const int64_t stride = g.stride[2];
+      const T divisor = Divisor(g.kernel[2], g.kernel[2]);
+      FOR_RANGE(int64_t, ow, inner_begin, inner_end) { delta[ow] = dy_row[ow] / divisor; }
+      FOR_RANGE(int64_t, it, wt.begin[ot], wt.end[ot]) {
+        FOR_RANGE(int64_t, ih, wh.begin[oh], wh.end[oh]) {
+          FOR_RANGE(int64_t, kw, 0, g.kernel[2]) {
+            // the outputs of a row take distinct elements at a window offset
+            T* dx_offset =
+                dx + it * in_hw + ih * g.in[2] + kw - g.padding[2] + inner_begin * stride;
+            const T* delta_inner = delta + inner_begin;
+            const int64_t inner_size = inner_end - inner_begin;
+            if (stride == 1) {
+              for (int64_t i = 0; i < inner_size; ++i) { dx_offset[i] += delta_inner[i]; }
+            } else {
+              for (int64_t i = 0; i < inner_size; ++i) { dx_offset[i * stride] += delta_inner[i]; }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+template<typename T>
+void MaxPoolCpuKernelUtil<T>::Forward(ep::Stream* stream, const MaxPoolParams3D& params_3d,
+                                      const T* x, T* y, int64_t* indice) {
+  const PoolGeometry g = MakeMaxPoolGeometry(params_3d);
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  if (params_3d.data_format() == "channels_first") {
+    cpu_stream->ParallelFor(
+        0, g.batch_size * g.channels,
+        [&](int64_t begin, int64_t end) {
+          std::vector<int32_t> steps(g.out[2]);
+          std::vector<int64_t> step_offsets(g.window_size);
+          FOR_RANGE(int64_t, plane, begin, end) {
+            MaxPoolPlaneCFirst(g, x + plane * g.in_spatial, y + plane * g.out_spatial,
+                               indice + plane * g.out_spatial, steps.data(), step_offsets.data());
+          }
+        },
+        g.PlaneGrain());
+  } else {
+    CHECK_EQ(params_3d.data_format(), "channels_last");
+    const int64_t grain =
+        std::max<int64_t>(kParallelGrain / std::max<int64_t>(g.channels * g.window_size, 1), 1);
+    cpu_stream->ParallelFor(
+        0, g.batch_size * g.out_spatial,
+        [&](int64_t begin, int64_t end) {
+          std::vector<int32_t> steps(g.channels);
+          std::vector<int64_t> step_offsets(g.window_size);
+          MaxPoolPositionsCLast(g, x, y, indice, begin, end, steps.data(), step_offsets.data());
+        },
+        grain);
+  }
+}
+
+template<typename T>
+void MaxPoolCpuKernelUtil<T>::Backward(ep::Stream* stream, const MaxPoolParams3D& params_3d,
+                                       const T* dy, const int64_t* indice, T* dx) {
+  const PoolGeometry g = MakeMaxPoolGeometry(params_3d);
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  // The windows of a plane, or of an image for channels last, only cover its own elements.
+  const bool channels_first = params_3d.data_format() == "channels_first";
+  const int64_t num_blocks = channels_first ? g.batch_size * g.channels : g.batch_size;
+  const int64_t in_block = channels_first ? g.in_spatial : g.in_spatial * g.channels;
+  const int64_t out_block = channels_first ? g.out_spatial : g.out_spatial * g.channels;
+  cpu_stream->ParallelFor(
+      0, num_blocks,
+      [&](int64_t begin, int64_t end) {
+        FOR_RANGE(int64_t, block, begin, end) {
+          const T* dy_block = dy + block * out_block;
+          const int64_t* indice_block = indice + block * out_block;
+          T* dx_block = dx + block * in_block;
+          FOR_RANGE(int64_t, i, 0, out_block) { dx_block[indice_block[i]] += dy_block[i]; }
+        }
+      },
+      std::max<int64_t>(kParallelGrain / std::max<int64_t>(out_block, 1), 1));
+}
+
+template<typename T>
+void AvgPoolCpuKernelUtil<T>::Forward(ep::Stream* stream, const AvgPoolParams3D& params_3d,
+                                      const T* x, T* y) {
+  const PoolGeometry g = MakeAvgPoolGeometry(params_3d);
+  const bool count_include_pad = params_3d.count_include_pad();
+  const int32_t divisor_override = params_3d.divisor_override();
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, g.batch_size * g.channels,
+      [&](int64_t begin, int64_t end) {
+        FOR_RANGE(int64_t, plane, begin, end) {
+          AvgPoolPlane(g, count_include_pad, divisor_override, x + plane * g.in_spatial,
+                       y + plane * g.out_spatial);
+        }
+      },
+      g.PlaneGrain());
+}
+
+template<typename T>
+void AvgPoolCpuKernelUtil<T>::Backward(ep::Stream* stream, const AvgPoolParams3D& params_3d,
+                                       const T* dy, T* dx) {
+  const PoolGeometry g = MakeAvgPoolGeometry(params_3d);
+  const bool count_include_pad = params_3d.count_include_pad();
+  const int32_t divisor_override = params_3d.divisor_override();
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, g.batch_size * g.channels,
+      [&](int64_t begin, int64_t end) {
+        std::vector<T> delta(g.out[2]);
+        FOR_RANGE(int64_t, plane, begin, end) {
+          AvgPoolPlaneGrad(g, count_include_pad, divisor_override, dy + plane * g.out_spatial,
+                           dx + plane * g.in_spatial, delta.data());
+        }
+      },
+      g.PlaneGrain());
+}
+
+#define INSTANTIATE_MAX_POOL_CPU_KERNEL_UTIL(type_cpp, type_proto) \
+  template struct MaxPoolCpuKernelUtil<type_cpp>;
+OF_PP_FOR_EACH_TUPLE(INSTANTIATE_MAX_POOL_CPU_KERNEL_UTIL, POOL_DATA_TYPE_CPU_SEQ)
+#undef INSTANTIATE_MAX_POOL_CPU_KERNEL_UTIL
+
+#define INSTANTIATE_AVG_POOL_CPU_KERNEL_UTIL(type_cpp, type_proto) \
+  template struct AvgPoolCpuKernelUtil<type_cpp>;
+OF_PP_FOR_EACH_TUPLE(INSTANTIATE_AVG_POOL_CPU_KERNEL_UTIL, AVG_POOL_DATA_TYPE_CPU_SEQ)
+#undef INSTANTIATE_AVG_POOL_CPU_KERNEL_UTIL
+
+}  // namespace oneflow
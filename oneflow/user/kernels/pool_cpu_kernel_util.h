@@ -0,0 +1,53 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_POOL_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_POOL_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/user/kernels/max_pool_kernel_util.h"
+#include "oneflow/user/kernels/avg_pool_kernel_util.h"
+
+namespace oneflow {
+
+// The pooling of the cpu max and avg pool kernels, for 1d, 2d and 3d pools alike.
+//
+// Channels first images are split between the threads of the stream by planes of a channel of a
+// sample. In a row of output positions, those whose windows lie inside the plane are reduced
+// together in vector lanes, one window offset at a time, and only the ones at the borders walk
+// their windows alone. Channels last images are split by output positions, whose channels are
+// reduced together in vector lanes.
+//
+// The indices of max pool are the offsets of the maxima in the plane of a channel for channels
+// first, and in the image of a sample (with the channels) for channels last.
+template<typename T>
+struct MaxPoolCpuKernelUtil {
+  static void Forward(ep::Stream* stream, const MaxPoolParams3D& params_3d, const T* x, T* y,
+                      int64_t* indice);
+  // Adds the gradient of x to dx.
+  static void Backward(ep::Stream* stream, const MaxPoolParams3D& params_3d, const T* dy,
+                       const int64_t* indice, T* dx);
+};
+
+// Avg pool only supports channels first, like its kernels.
+template<typename T>
+struct AvgPoolCpuKernelUtil {
+  static void Forward(ep::Stream* stream, const AvgPoolParams3D& params_3d, const T* x, T* y);
+  // Adds the gradient of x to dx.
+  static void Backward(ep::Stream* stream, const AvgPoolParams3D& params_3d, const T* dy, T* dx);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_POOL_CPU_KERNEL_UTIL_H_
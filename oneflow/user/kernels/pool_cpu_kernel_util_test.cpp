@@ -0,0 +1,431 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include "oneflow/user/kernels/pool_cpu_kernel_util.h"
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+#include "oneflow/core/ep/test/test_util.h"
+
+namespace oneflow {
+
+namespace {
+
+class PoolCpuKernelUtilTest : public ep::test::TestCase {};
+
+struct PoolCase {
+  int32_t dim;
+  // with the batch and channel axes
+  std::vector<int64_t> x_shape;
+  std::string data_format;
+  std::vector<int32_t> kernel_size;
+  std::vector<int32_t> stride;
+  std::vector<int32_t> padding;
+  std::vector<int32_t> dilation;
+  bool ceil_mode;
+};
+
+MaxPoolParams3D MakeMaxPoolParams(const PoolCase& c) {
+  return MaxPoolParams3D(c.dim, Shape(DimVector(c.x_shape.begin(), c.x_shape.end())),
+                         c.data_format, c.padding, c.kernel_size, c.stride, c.dilation,
+                         /*return_indices=*/true, c.ceil_mode);
+}
+
+AvgPoolParams3D MakeAvgPoolParams(const PoolCase& c, bool count_include_pad,
+                                  int32_t divisor_override) {
+  return AvgPoolParams3D(c.dim, Shape(DimVector(c.x_shape.begin(), c.x_shape.end())),
+                         c.data_format, c.padding, c.kernel_size, c.stride, c.ceil_mode,
+                         count_include_pad, divisor_override);
+}
+
+// The offset of an element of a 5d [n, c, t, h, w] index, and the index of max pool in its plane
+// or image.
+struct Layout {
+  Layout(const Shape& shape_5d, bool channels_last)
+      : channels(shape_5d.At(1)), channels_last(channels_last) {
+    FOR_RANGE(int32_t, i, 0, 3) { dims[i] = shape_5d.At(i + 2); }
+  }
+  int64_t Spatial(int64_t t, int64_t h, int64_t w) const { return (t * dims[1] + h) * dims[2] + w; }
+  int64_t Offset(int64_t n, int64_t c, int64_t t, int64_t h, int64_t w) const {
+    const int64_t spatial = dims[0] * dims[1] * dims[2];
+    if (channels_last) { return (n * spatial + Spatial(t, h, w)) * channels + c; }
+    return (n * channels + c) * spatial + Spatial(t, h, w);
+  }
+  int64_t Index(int64_t c, int64_t t, int64_t h, int64_t w) const {
+    return channels_last ? Spatial(t, h, w) * channels + c : Spatial(t, h, w);
+  }
+  int64_t channels;
+  bool channels_last;
+  int64_t dims[3];
+};
+
+template<typename F>
+void ForEachOutput(const Shape& y_5d, const F& f) {
+  FOR_RANGE(int64_t, n, 0, y_5d.At(0)) {
+    FOR_RANGE(int64_t, c, 0, y_5d.At(1)) {
+      FOR_RANGE(int64_t, t, 0, y_5d.At(2)) {
+        FOR_RANGE(int64_t, h, 0, y_5d.At(3)) {
+          FOR_RANGE(int64_t, w, 0, y_5d.At(4)) { f(n, c, t, h, w); }
+        }
+      }
+    }
+  }
+}
+
+template<typename T>
+bool IsNan(T value) {
+  return value != value;
+}
+
+template<typename T>
+void ReferenceMaxPool(const MaxPoolParams3D& p, const std::vector<T>& x, std::vector<T>* y,
+                      std::vector<int64_t>* indice, const std::vector<T>& dy, std::vector<T>* dx) {
+  const bool channels_last = p.data_format() == "channels_last";
+  const Layout x_layout(p.GetXShape5D(), channels_last);
+  const Layout y_layout(p.GetYShape5D(), channels_last);
+  y->assign(p.GetYShape5D().elem_cnt(), 0);
+  indice->assign(y->size(), 0);
+  dx->assign(x.size(), 0);
+  ForEachOutput(p.GetYShape5D(), [&](int64_t n, int64_t c, int64_t ot, int64_t oh, int64_t ow) {
+    const int64_t o[3] = {ot, oh, ow};
+    T max_value = 0;
+    int64_t max_index = -1;
+    int64_t max_offset = -1;
+    FOR_RANGE(int64_t, kt, 0, p.pool_size_3d()[0]) {
+      FOR_RANGE(int64_t, kh, 0, p.pool_size_3d()[1]) {
+        FOR_RANGE(int64_t, kw, 0, p.pool_size_3d()[2]) {
+          const int64_t k[3] = {kt, kh, kw};
+          int64_t i[3];
+          bool inside = true;
+          FOR_RANGE(int32_t, d, 0, 3) {
+            i[d] = o[d] * p.stride_3d()[d] - p.padding()[d] + k[d] * p.dilation_3d()[d];
+            inside = inside && i[d] >= 0 && i[d] < x_layout.dims[d];
+          }
+          if (!inside) { continue; }
+          const int64_t offset = x_layout.Offset(n, c, i[0], i[1], i[2]);
+          const T val = x[offset];
+          if (max_index < 0 || val > max_value || IsNan(val)) {
+            max_value = val;
+            max_index = x_layout.Index(c, i[0], i[1], i[2]);
+            max_offset = offset;
+          }
+        }
+      }
+    }
+    const int64_t y_offset = y_layout.Offset(n, c, ot, oh, ow);
+    (*y)[y_offset] = max_value;
+    (*indice)[y_offset] = max_index;
+    (*dx)[max_offset] += dy[y_offset];
+  });
+}
+
+template<typename T>
+void ReferenceAvgPool(const AvgPoolParams3D& p, const std::vector<T>& x, std::vector<T>* y,
+                      const std::vector<T>& dy, std::vector<T>* dx) {
+  const Layout x_layout(p.GetXShape5D(), false);
+  const Layout y_layout(p.GetYShape5D(), false);
+  y->assign(p.GetYShape5D().elem_cnt(), 0);
+  dx->assign(x.size(), 0);
+  ForEachOutput(p.GetYShape5D(), [&](int64_t n, int64_t c, int64_t ot, int64_t oh, int64_t ow) {
+    const int64_t o[3] = {ot, oh, ow};
+    int64_t begin[3];
+    int64_t end[3];
+    int64_t padded_size = 1;
+    int64_t size = 1;
+    FOR_RANGE(int32_t, d, 0, 3) {
+      const int64_t start = o[d] * p.stride_3d()[d] - p.padding()[d];
+      const int64_t padded_end =
+          std::min<int64_t>(start + p.pool_size_3d()[d], x_layout.dims[d] + p.padding()[d]);
+      begin[d] = std::max<int64_t>(start, 0);
+      end[d] = std::min<int64_t>(padded_end, x_layout.dims[d]);
+      padded_size *= padded_end - start;
+      size *= end[d] - begin[d];
+    }
+    T divisor = p.count_include_pad() ? padded_size : size;
+    if (p.divisor_override() != 0) { divisor = p.divisor_override(); }
+    const int64_t y_offset = y_layout.Offset(n, c, ot, oh, ow);
+    T sum = 0;
+    FOR_RANGE(int64_t, it, begin[0], end[0]) {
+      FOR_RANGE(int64_t, ih, begin[1], end[1]) {
+        FOR_RANGE(int64_t, iw, begin[2], end[2]) {
+          sum += x[x_layout.Offset(n, c, it, ih, iw)];
+          (*dx)[x_layout.Offset(n, c, it, ih, iw)] += dy[y_offset] / divisor;
+        }
+      }
+    }
+    (*y)[y_offset] = sum / divisor;
+  });
+}
+
+template<typename T>
+std::vector<T> RandomVector(int64_t size, std::mt19937* gen) {
+  std::vector<T> vec(size);
+  if (std::is_floating_point<T>::value) {
+    std::uniform_real_distribution<double> dis(-1, 1);
+    for (auto& value : vec) { value = static_cast<T>(dis(*gen)); }
+  } else {
+    // many ties, which take the first maximum of a window
+    std::uniform_int_distribution<int> dis(-5, 5);
+    for (auto& value : vec) { value = static_cast<T>(dis(*gen)); }
+  }
+  return vec;
+}
+
+template<typename T>
+void AssertNear(const std::vector<T>& actual, const std::vector<T>& expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); ++i) {
+    if (IsNan(expected[i])) {
+      ASSERT_TRUE(IsNan(actual[i])) << i;
+    } else {
+      ASSERT_NEAR(actual[i], expected[i], 1e-5 * (1 + std::abs(expected[i]))) << i;
+    }
+  }
+}
+
+std::vector<PoolCase> MaxPoolCases() {
+  return {
+      {1, {2, 3, 17}, "channels_first", {3}, {2}, {1}, {1}, false},
+      {1, {2, 3, 17}, "channels_first", {4}, {1}, {2}, {2}, true},
+      {2, {2, 3, 13, 11}, "channels_first", {3, 3}, {2, 2}, {1, 1}, {1, 1}, false},
+      {2, {2, 3, 13, 11}, "channels_first", {2, 2}, {2, 2}, {0, 0}, {1, 1}, false},
+      {2, {2, 3, 13, 11}, "channels_first", {3, 2}, {1, 3}, {1, 1}, {2, 3}, false},
+      {2, {2, 3, 13, 11}, "channels_first", {3, 3}, {2, 2}, {0, 0}, {1, 1}, true},
+      {2, {1, 2, 2, 3}, "channels_first", {3, 3}, {1, 1}, {1, 1}, {1, 1}, false},
+      {2, {2, 13, 11, 5}, "channels_last", {3, 3}, {2, 2}, {1, 1}, {1, 1}, false},
+      {2, {2, 13, 11, 19}, "channels_last", {3, 2}, {1, 3}, {1, 1}, {2, 1}, true},
+      {3, {2, 2, 5, 7, 6}, "channels_first", {2, 3, 3}, {1, 2, 2}, {1, 1, 0}, {1, 1, 1}, false},
+      {3, {2, 5, 7, 6, 3}, "channels_last", {2, 3, 3}, {1, 2, 2}, {1, 1, 0}, {1, 1, 1}, true},
+      {2, {0, 3, 5, 5}, "channels_first", {3, 3}, {2, 2}, {1, 1}, {1, 1}, false},
+  };
+}
+
+std::vector<PoolCase> AvgPoolCases() {
+  return {
+      {1, {2, 3, 17}, "channels_first", {3}, {2}, {1}, {1}, false},
+      {1, {2, 3, 17}, "channels_first", {4}, {3}, {2}, {1}, true},
+      {2, {2, 3, 13, 11}, "channels_first", {3, 3}, {2, 2}, {1, 1}, {1, 1}, false},
+      {2, {2, 3, 13, 11}, "channels_first", {2, 2}, {2, 2}, {0, 0}, {1, 1}, false},
+      {2, {2, 3, 13, 11}, "channels_first", {3, 2}, {1, 1}, {1, 1}, {1, 1}, true},
+      {2, {2, 3, 13, 11}, "channels_first", {3, 3}, {2, 3}, {0, 1}, {1, 1}, true},
+      {2, {2, 2, 7, 7}, "channels_first", {7, 7}, {1, 1}, {0, 0}, {1, 1}, false},
+      {3, {2, 2, 5, 7, 6}, "channels_first", {2, 3, 3}, {1, 2, 2}, {1, 1, 0}, {1, 1, 1}, false},
+      {3, {2, 2, 5, 7, 6}, "channels_first", {3, 2, 3}, {2, 1, 1}, {1, 0, 1}, {1, 1, 1}, true},
+  };
+}
+
+template<typename T>
+void TestMaxPool(ep::Stream* stream, const PoolCase& pool_case, bool with_nan) {
+  std::mt19937 gen(0);
+  const MaxPoolParams3D params = MakeMaxPoolParams(pool_case);
+  std::vector<T> x = RandomVector<T>(params.GetXShape5D().elem_cnt(), &gen);
+  const std::vector<T> dy = RandomVector<T>(params.GetYShape5D().elem_cnt(), &gen);
+  if (with_nan) {
+    for (size_t i = 0; i < x.size(); i += 7) { x[i] = std::numeric_limits<T>::quiet_NaN(); }
+  }
+  std::vector<T> expected_y;
+  std::vector<int64_t> expected_indice;
+  std::vector<T> expected_dx;
+  ReferenceMaxPool(params, x, &expected_y, &expected_indice, dy, &expected_dx);
+  std::vector<T> y(expected_y.size());
+  std::vector<int64_t> indice(expected_y.size());
+  std::vector<T> dx(x.size(), 0);
+  MaxPoolCpuKernelUtil<T>::Forward(stream, params, x.data(), y.data(), indice.data());
+  MaxPoolCpuKernelUtil<T>::Backward(stream, params, dy.data(), indice.data(), dx.data());
+  AssertNear(y, expected_y);
+  ASSERT_EQ(indice, expected_indice);
+  AssertNear(dx, expected_dx);
+}
+
+template<typename T>
+void TestAvgPool(ep::Stream* stream, const PoolCase& pool_case, bool count_include_pad,
+                 int32_t divisor_override) {
+  std::mt19937 gen(0);
+  const AvgPoolParams3D params = MakeAvgPoolParams(pool_case, count_include_pad, divisor_override);
+  const std::vector<T> x = RandomVector<T>(params.GetXShape5D().elem_cnt(), &gen);
+  const std::vector<T> dy = RandomVector<T>(params.GetYShape5D().elem_cnt(), &gen);
+  std::vector<T> expected_y;
+  std::vector<T> expected_dx;
+  ReferenceAvgPool(params, x, &expected_y, dy, &expected_dx);
+  std::vector<T> y(expected_y.size());
+  std::vector<T> dx(x.size(), 0);
+  AvgPoolCpuKernelUtil<T>::Forward(stream, params, x.data(), y.data());
+  AvgPoolCpuKernelUtil<T>::Backward(stream, params, dy.data(), dx.data());
+  AssertNear(y, expected_y);
+  AssertNear(dx, expected_dx);
+}
+
+}  // namespace
+
+TEST_F(PoolCpuKernelUtilTest, same_as_reference) {
+  if (available_device_types_.count(DeviceType::kCPU) == 0) { return; }
+  auto device = device_manager_registry_.GetDevice(DeviceType::kCPU, 0);
+  auto* cpu_device = dynamic_cast<ep::CpuDevice*>(device.get());
+  const size_t old_thread_num = cpu_device->GetNumThreads();
+  for (int64_t thread_num : {1, 3}) {
+    cpu_device->SetNumThreads(thread_num);
+    ep::test::StreamGuard stream(device.get());
+    for (const auto& pool_case : MaxPoolCases()) {
+      TestMaxPool<float>(stream.stream(), pool_case, false);
+      TestMaxPool<float>(stream.stream(), pool_case, true);
+      TestMaxPool<double>(stream.stream(), pool_case, false);
+      TestMaxPool<int32_t>(stream.stream(), pool_case, false);
+    }
+    for (const auto& pool_case : AvgPoolCases()) {
+      for (bool count_include_pad : {false, true}) {
+        for (int32_t divisor_override : {0, 5}) {
+          TestAvgPool<float>(stream.stream(), pool_case, count_include_pad, divisor_override);
+          TestAvgPool<double>(stream.stream(), pool_case, count_include_pad, divisor_override);
+        }
+      }
+    }
+  }
+  cpu_device->SetNumThreads(old_thread_num);
+}
+
+TEST_F(PoolCpuKernelUtilTest, benchmark) {
+  if (!ParseBooleanFromEnv("ONEFLOW_TEST_BENCHMARK", false)) {
+    GTEST_SKIP() << "set ONEFLOW_TEST_BENCHMARK=1 to run";
+  }
+  if (available_device_types_.count(DeviceType::kCPU) == 0) { return; }
+  auto device = device_manager_registry_.GetDevice(DeviceType::kCPU, 0);
+  auto* cpu_device = dynamic_cast<ep::CpuDevice*>(device.get());
+  const size_t old_thread_num = cpu_device->GetNumThreads();
+  const int64_t thread_num = std::max<int64_t>(1, std::thread::hardware_concurrency());
+  const double kMinSeconds = 0.2;
+  std::mt19937 gen(0);
+  auto ElemsPerSecond = [&](int64_t elem_cnt, const std::function<void()>& Run) {
+    Run();
+    const auto start = std::chrono::steady_clock::now();
+    int64_t iter_num = 0;
+    double seconds = 0;
+    while (seconds < kMinSeconds) {
+      Run();
+      iter_num += 1;
+      seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return iter_num * elem_cnt / seconds;
+  };
+  // Reports the input elements per second of the serial window walks of the kernel utils, which
+  // the cpu kernels ran before, and of the cpu kernel utils.
+  int64_t case_index = 0;
+  auto Report = [&](const std::string& name, int64_t elem_cnt, const std::function<void()>& Legacy,
+                    const std::function<void()>& Run) {
+    std::ostringstream report;
+    report << name << ":";
+    if (Legacy) { report << " legacy " << ElemsPerSecond(elem_cnt, Legacy) << " elems/s,"; }
+    cpu_device->SetNumThreads(1);
+    report << " 1 thread " << ElemsPerSecond(elem_cnt, Run) << " elems/s";
+    cpu_device->SetNumThreads(thread_num);
+    report << ", " << thread_num << " threads " << ElemsPerSecond(elem_cnt, Run) << " elems/s";
+    cpu_device->SetNumThreads(old_thread_num);
+    RecordProperty("case_" + std::to_string(case_index++), report.str());
+  };
+  ep::test::StreamGuard stream_guard(device.get());
+  ep::Stream* stream = stream_guard.stream();
+  {
+    const PoolCase resnet_cf{2, {4, 64, 112, 112}, "channels_first", {3, 3}, {2, 2}, {1, 1},
+                             {1, 1}, false};
+    const MaxPoolParams3D p = MakeMaxPoolParams(resnet_cf);
+    const int64_t elem_cnt = p.GetXShape5D().elem_cnt();
+    const auto x = RandomVector<float>(elem_cnt, &gen);
+    std::vector<float> y(p.GetYShape5D().elem_cnt());
+    std::vector<int64_t> indice(y.size());
+    std::vector<float> dx(elem_cnt);
+    const Shape y_5d = p.GetYShape5D();
+    DimVector y_3d = {y_5d.At(0) * y_5d.At(1), y_5d.At(3), y_5d.At(4)};
+    NdIndexOffsetHelper<int64_t, 3> index_helper(y_3d.data());
+    Report(
+        "resnet50 max pool 3x3/2 channels first", elem_cnt,
+        [&]() {
+          Maxpool2dForwardComputeCFirst<float, int64_t>(
+              index_helper, y.size(), x.data(), y.data(), indice.data(), 1, 1, 4, 64, 112, 112, 3,
+              3, 2, 2, 1, 1);
+        },
+        [&]() {
+          MaxPoolCpuKernelUtil<float>::Forward(stream, p, x.data(), y.data(), indice.data());
+        });
+    Report(
+        "resnet50 max pool 3x3/2 channels first grad", elem_cnt,
+        [&]() {
+          std::fill(dx.begin(), dx.end(), 0);
+          Maxpool2dBackwardComputeCFirst<float, int64_t>(index_helper, y.size(), y.data(),
+                                                         dx.data(), indice.data(), 4, 64, 56, 56,
+                                                         112, 112);
+        },
+        [&]() {
+          std::fill(dx.begin(), dx.end(), 0);
+          MaxPoolCpuKernelUtil<float>::Backward(stream, p, y.data(), indice.data(), dx.data());
+        });
+  }
+  {
+    const PoolCase resnet_cl{2, {4, 112, 112, 64}, "channels_last", {3, 3}, {2, 2}, {1, 1},
+                             {1, 1}, false};
+    const MaxPoolParams3D p = MakeMaxPoolParams(resnet_cl);
+    const int64_t elem_cnt = p.GetXShape5D().elem_cnt();
+    const auto x = RandomVector<float>(elem_cnt, &gen);
+    std::vector<float> y(p.GetYShape5D().elem_cnt());
+    std::vector<int64_t> indice(y.size());
+    Report("resnet50 max pool 3x3/2 channels last", elem_cnt, nullptr, [&]() {
+      MaxPoolCpuKernelUtil<float>::Forward(stream, p, x.data(), y.data(), indice.data());
+    });
+  }
+  for (const auto& avg_case : {
+           std::make_pair(std::string("densenet avg pool 2x2/2"),
+                          PoolCase{2, {4, 128, 56, 56}, "channels_first", {2, 2}, {2, 2}, {0, 0},
+                                   {1, 1}, false}),
+           std::make_pair(std::string("inception avg pool 3x3/1"),
+                          PoolCase{2, {4, 192, 35, 35}, "channels_first", {3, 3}, {1, 1}, {1, 1},
+                                   {1, 1}, false}),
+       }) {
+    const PoolCase& c = avg_case.second;
+    const AvgPoolParams3D p = MakeAvgPoolParams(c, true, 0);
+    const int64_t elem_cnt = p.GetXShape5D().elem_cnt();
+    const auto x = RandomVector<float>(elem_cnt, &gen);
+    std::vector<float> y(p.GetYShape5D().elem_cnt());
+    std::vector<float> dx(elem_cnt);
+    const Shape x_5d = p.GetXShape5D();
+    const Shape y_5d = p.GetYShape5D();
+    DimVector y_3d = {y_5d.At(0) * y_5d.At(1), y_5d.At(3), y_5d.At(4)};
+    NdIndexOffsetHelper<int64_t, 3> index_helper(y_3d.data());
+    Report(
+        avg_case.first, elem_cnt,
+        [&]() {
+          Avgpool2dForwardCompute<float, int64_t>(
+              index_helper, y.size(), x.data(), y.data(), c.padding[0], c.padding[1], x_5d.At(0),
+              x_5d.At(1), x_5d.At(3), x_5d.At(4), c.kernel_size[0], c.kernel_size[1], c.stride[0],
+              c.stride[1], true, 0);
+        },
+        [&]() { AvgPoolCpuKernelUtil<float>::Forward(stream, p, x.data(), y.data()); });
+    Report(
+        avg_case.first + " grad", elem_cnt,
+        [&]() {
+          std::fill(dx.begin(), dx.end(), 0);
+          Avgpool2dBackwardCompute<float, int64_t>(
+              index_helper, y.size(), y.data(), dx.data(), c.padding[0], c.padding[1], x_5d.At(0),
+              x_5d.At(1), x_5d.At(3), x_5d.At(4), c.kernel_size[0], c.kernel_size[1], c.stride[0],
+              c.stride[1], true, 0);
+        },
+        [&]() {
+          std::fill(dx.begin(), dx.end(), 0);
+          AvgPoolCpuKernelUtil<float>::Backward(stream, p, y.data(), dx.data());
+        });
+  }
+}
+
+}  // namespace oneflow
@@ -14,15 +14,14 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/random_mask_generator.h"
+#include "oneflow/user/kernels/distributions/philox_sampling.h"
 
 namespace oneflow {
 
 void RandomMaskGenerator<DeviceType::kCPU>::Generate(ep::Stream* stream, const int64_t n,
                                                      const float rate, bool* mask) {
-  CHECK_GE(n, 0);
-  std::uniform_real_distribution<float> random_distribution(GetZeroVal<float>(),
-                                                            GetOneVal<float>());
-  for (int64_t i = 0; i < n; ++i) { mask[i] = random_distribution(generator_->engine()) > rate; }
+  PhiloxParallelSample<PhiloxUniform<float>>(
+      stream, generator_.get(), n, [=](int64_t i, float sample) { mask[i] = sample > rate; });
 }
 
 template class RandomMaskGenerator<DeviceType::kCPU>;
@@ -21,6 +21,7 @@ limitations under the License.
 #include "oneflow/core/kernel/cuda_graph_support.h"
 #include "oneflow/core/ep/include/primitive/cast.h"
 #include "oneflow/core/ep/include/primitive/fill.h"
+#include "oneflow/core/ep/include/primitive/reduce.h"
 
 #ifdef WITH_CUDA
 #include "oneflow/core/ep/cuda/cuda_device.h"
@@ -64,6 +65,21 @@ std::unique_ptr<ep::primitive::Fill> NewFillPrimitive(Context* ctx) {
   return ep::primitive::NewPrimitive<ep::primitive::FillFactory>(ctx->device_type(), data_type);
 }
 
+template<typename Context>
+std::unique_ptr<ep::primitive::Reduce> NewReducePrimitive(Context* ctx,
+                                                          ep::primitive::BinaryOp op) {
+  const user_op::TensorDesc* input_desc = ctx->TensorDesc4ArgNameAndIndex("input_tensor", 0);
+  const DataType dst_type = ctx->TensorDesc4ArgNameAndIndex("output_tensor", 0)->data_type();
+  return ep::primitive::NewPrimitive<ep::primitive::ReduceFactory>(
+      ctx->device_type(), op, input_desc->data_type(), dst_type, input_desc->shape().NumAxes());
+}
+
+auto ReducePrimitiveExists(ep::primitive::BinaryOp op) {
+  return hob::make_custom("ReducePrimitiveExists", [op](const user_op::KernelRegContext& ctx) {
+    return NewReducePrimitive(&ctx, op).operator bool();
+  });
+}
+
 auto ReduceMatmulTransAPrimitiveExists() {
   return hob::make_custom("ReduceMatmulTransAPrimitiveExists",
                           [](const user_op::KernelRegContext& ctx) {
@@ -123,8 +139,56 @@ class ReduceKernel final : public user_op::OpKernel, public user_op::CudaGraphSu
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
+template<ep::primitive::BinaryOp op>
+class ReducePrimitiveKernel final : public user_op::OpKernel, public user_op::CudaGraphSupport {
+ public:
+  ReducePrimitiveKernel() = default;
+  ~ReducePrimitiveKernel() = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* input_tensor = ctx->Tensor4ArgNameAndIndex("input_tensor", 0);
+    user_op::Tensor* output_tensor = ctx->Tensor4ArgNameAndIndex("output_tensor", 0);
+    const auto& axis = ctx->Attr<std::vector<int32_t>>("axis");
+    const int64_t output_elem_cnt = output_tensor->shape_view().elem_cnt();
+
+    if (input_tensor->shape_view().elem_cnt() == 0) {
+      if (output_elem_cnt != 0) {
+        const Scalar init_value =
+            op == ep::primitive::BinaryOp::kLogicalAnd ? Scalar(1) : Scalar(0);
+        std::unique_ptr<ep::primitive::Fill> fill = NewFillPrimitive(ctx);
+        CHECK(fill);
+        fill->Launch(ctx->stream(), output_tensor->mut_dptr(), init_value, output_elem_cnt);
+      }
+      return;
+    }
+    const ShapeView& in_shape = input_tensor->shape_view();
+    const Shape& reduced_shape = CreateReducedShape(in_shape, {axis.begin(), axis.end()});
+    std::unique_ptr<ep::primitive::Reduce> reduce = NewReducePrimitive(ctx, op);
+    CHECK(reduce);
+    reduce->Launch(ctx->stream(), in_shape.NumAxes(), in_shape.ptr(), input_tensor->dptr(),
+                   reduced_shape.dim_vec().data(), output_tensor->mut_dptr());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
 }  // namespace
 
+#define REGISTER_REDUCE_PRIMITIVE_KERNEL(op_name, binary_op, device)                \
+  REGISTER_USER_KERNEL(op_name)                                                     \
+      .SetCreateFn<ReducePrimitiveKernel<ep::primitive::BinaryOp::binary_op>>()     \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                         \
+                       && ReducePrimitiveExists(ep::primitive::BinaryOp::binary_op) \
+                       && FillPrimitiveExists());
+
+// CPU reductions run on the reduce primitive, which needs no temporary buffer
+REGISTER_REDUCE_PRIMITIVE_KERNEL("reduce_sum", kAdd, DeviceType::kCPU)
+REGISTER_REDUCE_PRIMITIVE_KERNEL("reduce_prod", kMul, DeviceType::kCPU)
+REGISTER_REDUCE_PRIMITIVE_KERNEL("reduce_max", kMax, DeviceType::kCPU)
+REGISTER_REDUCE_PRIMITIVE_KERNEL("reduce_min", kMin, DeviceType::kCPU)
+REGISTER_REDUCE_PRIMITIVE_KERNEL("reduce_all", kLogicalAnd, DeviceType::kCPU)
+REGISTER_REDUCE_PRIMITIVE_KERNEL("reduce_any", kLogicalOr, DeviceType::kCPU)
+
 #define REGISTER_REDUCE_XPU_KERNEL(op_name, binary_func, device, dtype)                            \
   REGISTER_USER_KERNEL(op_name)                                                                    \
       .SetCreateFn<ReduceKernel<binary_func, device, dtype, dtype>>()                              \
@@ -160,7 +224,6 @@ class ReduceKernel final : public user_op::OpKernel, public user_op::CudaGraphSu
   REGISTER_REDUCE_ARITHMETIC_KERNELS(device, int32_t)        \
   REGISTER_REDUCE_ARITHMETIC_KERNELS(device, int64_t)
 
-REGISTER_REDUCE_ARITHMETIC_KERNELS_BY_DEVICE(DeviceType::kCPU)
 #ifdef WITH_CUDA
 REGISTER_REDUCE_ARITHMETIC_KERNELS_BY_DEVICE(DeviceType::kCUDA)
 #endif
@@ -175,11 +238,9 @@ REGISTER_REDUCE_ARITHMETIC_KERNELS_BY_DEVICE(DeviceType::kCUDA)
   REGISTER_REDUCE_SUM_KERNELS(device, int32_t)        \
   REGISTER_REDUCE_SUM_KERNELS(device, int64_t)
 
-REGISTER_REDUCE_SUM_KERNELS_BY_DEVICE(DeviceType::kCPU)
 #ifdef WITH_CUDA
 REGISTER_REDUCE_SUM_KERNELS_BY_DEVICE(DeviceType::kCUDA)
 #endif
-REGISTER_REDUCE_SUM_KERNELS(DeviceType::kCPU, float)
 
 #define REGISTER_REDUCE_LOGICAL_KERNELS(device)                                    \
   REGISTER_REDUCE_LOGICAL_XPU_KERNEL("reduce_any", BinaryFuncAny, device, bool)    \
@@ -197,7 +258,6 @@ REGISTER_REDUCE_SUM_KERNELS(DeviceType::kCPU, float)
   REGISTER_REDUCE_LOGICAL_XPU_KERNEL("reduce_any", BinaryFuncAny, device, int64_t) \
   REGISTER_REDUCE_LOGICAL_XPU_KERNEL("reduce_all", BinaryFuncAll, device, int64_t)
 
-REGISTER_REDUCE_LOGICAL_KERNELS(DeviceType::kCPU)
 #ifdef WITH_CUDA
 REGISTER_REDUCE_LOGICAL_KERNELS(DeviceType::kCUDA)
 
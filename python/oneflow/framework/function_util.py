@@ -238,10 +238,37 @@ def policy_time_line(func_desc):
     return "use_time_line_algo"
 
 
+@oneflow_function_config("static_mem_alloc_policy_white_list.policy_mem_size_best_fit")
+def policy_mem_size_best_fit(func_desc):
+    """A static memory allocation policy called: mem_size_best_fit
+
+    Args:
+        func_desc ([type]): [description]
+
+    Returns:
+        [type]: [description]
+    """
+    return "use_mem_size_best_fit_algo"
+
+
+@oneflow_function_config("static_mem_alloc_policy_white_list.policy_mem_volume_first")
+def policy_mem_volume_first(func_desc):
+    """A static memory allocation policy called: mem_volume_first
+
+    Args:
+        func_desc ([type]): [description]
+
+    Returns:
+        [type]: [description]
+    """
+    return "use_mem_volume_first_algo"
+
+
 @oneflow_function_config("static_mem_alloc_algo_white_list.show")
 def show_static_mem_alloc_algo_white_list(func_desc):
     """Show configuration of  static memory allocation policy,
-          including: "use_mem_size_first_algo", "use_mutual_exclusion_first_algo", "use_time_line_algo"
+          including: "use_mem_size_first_algo", "use_mutual_exclusion_first_algo", "use_time_line_algo",
+          "use_mem_size_best_fit_algo", "use_mem_volume_first_algo"
 
     Args:
         func_desc ([type]): [description]
@@ -253,6 +280,8 @@ def show_static_mem_alloc_algo_white_list(func_desc):
         "use_mem_size_first_algo",
         "use_mutual_exclusion_first_algo",
         "use_time_line_algo",
+        "use_mem_size_best_fit_algo",
+        "use_mem_volume_first_algo",
     ]
 
 
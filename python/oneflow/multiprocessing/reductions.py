@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 """
+import os
 from multiprocessing.reduction import ForkingPickler
 
 import numpy as np
@@ -56,6 +57,37 @@ def rebuild_shm_tensor(shm, shape, dtype, requires_grad):
     return t
 
 
+def rebuild_pooled_shm_tensor(name, shape, dtype, requires_grad):
+    # The segment stays mapped in this process, the next batch sent through it
+    # maps nothing. Releasing it only hands it back to the pool of its producer.
+    shm = flow._oneflow_internal.multiprocessing.attach_pooled_shared_memory(name)
+
+    def release_shm():
+        flow._oneflow_internal.multiprocessing.release_pooled_shared_memory(name)
+
+    arr = np.ndarray(
+        shape,
+        dtype=dtype,
+        buffer=shm.buf,
+        offset=flow._oneflow_internal.multiprocessing.pooled_shared_memory_header_size,
+    )
+    t = flow.from_numpy(arr)
+    t._register_storage_delete_hook(release_shm)
+    t.requires_grad = requires_grad
+
+    return t
+
+
+def _use_shm_pool():
+    # Only the tensors a DataLoader worker sends to the main process go through
+    # the pool, they are received once and released by the receiver.
+    if os.getenv("ONEFLOW_DATALOADER_SHM_POOL", "1") == "0":
+        return False
+    from oneflow.utils.data._utils.worker import get_worker_info
+
+    return get_worker_info() is not None
+
+
 def rebuild_empty_parameter(shape, dtype, requires_grad):
     t = flow.tensor([], dtype=dtype)
     t = t.reshape(*shape)
@@ -79,6 +111,21 @@ def reduce_tensor(tensor):
 
     if tensor_data.nbytes == 0:
         return (rebuild_empty_tensor, (tensor.shape, tensor.dtype, requires_grad))
+    elif _use_shm_pool():
+        shm = flow._oneflow_internal.multiprocessing.acquire_pooled_shared_memory(
+            tensor_data.nbytes
+        )
+        shm_numpy = np.ndarray(
+            tensor_data.shape,
+            dtype=tensor_data.dtype,
+            buffer=shm.buf,
+            offset=flow._oneflow_internal.multiprocessing.pooled_shared_memory_header_size,
+        )
+        shm_numpy[:] = tensor_data[:]
+        return (
+            rebuild_pooled_shm_tensor,
+            (shm.name, tensor_data.shape, tensor_data.dtype, requires_grad),
+        )
     else:
         shm = shared_memory.SharedMemory(create=True, size=tensor_data.nbytes)
         shm_numpy = np.ndarray(
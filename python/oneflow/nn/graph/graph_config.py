@@ -278,14 +278,86 @@ class GraphConfig(object):
         """
         self.proto.cudnn_conv_heuristic_search_algo = mode
 
-    def enable_straighten_algorithm(self, mode: bool = True):
+    def enable_straighten_algorithm(
+        self, mode: bool = True, objective: str = "overlap", memory_weight: float = 1.0
+    ):
         r""" Whether enable the straighten algorithm.
 
         If using nccl compute stream, turning it on might not speed up the training.
         If not using nccl compute stream, turning it on might slow down data parallelism by 0.6% and slow down model parallelism by 6%.
         Considering memory, enabling the straighten algorithm is forbidden with one machine/device only, and not recommended under pipeline parallelism. 
+
+        With ``objective="memory"``, the tasks are ordered to lower the peak memory of the activations instead, which also works with one device.
+        ``memory_weight`` in [0, 1] trades the memory off against the overlap of transfers and computation, 1 orders by memory only.
+        The predicted peak memory before and after straightening is logged.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.m = flow.nn.Linear(3, 3)
+                    self.config.enable_straighten_algorithm(True, objective="memory")
+                def build(self, x):
+                    return self.m(x)
+
+            graph = Graph()
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+            objective (str, optional): "overlap" or "memory". The default value is "overlap".
+            memory_weight (float, optional): The default value is 1.0.
         """
+        assert objective in ("overlap", "memory"), "unknown objective: " + objective
+        assert 0 <= memory_weight <= 1, "memory_weight should be in [0, 1]"
         self.proto.enable_straighten_algorithm_in_task_graph = mode
+        self.proto.straighten_algorithm_tag_in_task_graph = (
+            job_conf_pb.kCompressMemory
+            if objective == "memory"
+            else job_conf_pb.kOverlap4Transfer
+        )
+        self.proto.straighten_memory_weight_in_task_graph = memory_weight
+
+    def enable_auto_parallel(
+        self,
+        mode: bool = True,
+        computation_cost_ratio: float = 0.05,
+        memory_weight: float = 0.01,
+    ):
+        r""" Whether search the sbp signatures of the whole graph instead of inferring them op by op.
+
+        The search minimizes the cost of computing, boxing and memory in total, the sbp set by the user,
+        e.g. on the inputs, the parameters or by ``to_global``, are kept. The predicted cost before and after the search is logged.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.m = flow.nn.Linear(3, 3)
+                    self.config.enable_auto_parallel(True)
+                def build(self, x):
+                    return self.m(x)
+
+            graph = Graph()
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+            computation_cost_ratio (float, optional): cost of computing on a byte of input relative to transferring a byte. The default value is 0.05.
+            memory_weight (float, optional): cost of keeping a byte of output relative to transferring a byte. The default value is 0.01.
+        """
+        assert computation_cost_ratio >= 0 and memory_weight >= 0
+        self.proto.enable_auto_parallel = mode
+        self.proto.auto_parallel_computation_cost_ratio = computation_cost_ratio
+        self.proto.auto_parallel_memory_weight = memory_weight
 
     def _generate_optimizer_and_variable_configs(
         self, opt_dict: OptDict = None, variables_conf: OrderedDict = None,
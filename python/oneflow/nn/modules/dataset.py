@@ -55,11 +55,18 @@ class OFRecordReader(Module):
         placement: flow.placement = None,
         sbp: Union[flow.sbp.sbp, List[flow.sbp.sbp]] = None,
         name: Optional[str] = None,
+        use_record_index: bool = False,
+        start_cursor: int = 0,
     ):
         super().__init__()
 
         if name is not None:
             print("WARNING: name has been deprecated and has NO effect.\n")
+        # With use_record_index, records are read by position through the `<part>.idx` files
+        # written by oneflow.utils.data.record_index: random_shuffle permutes the whole dataset
+        # every epoch and start_cursor is the number of samples this rank already consumed.
+        self.use_record_index = use_record_index
+        self.start_cursor = start_cursor
         self.ofrecord_dir = ofrecord_dir
         self.batch_size = batch_size
         self.data_part_num = data_part_num
@@ -104,6 +111,8 @@ class OFRecordReader(Module):
                 random_shuffle=self.random_shuffle,
                 shuffle_after_epoch=self.shuffle_after_epoch,
                 seed=self.seed,
+                use_record_index=self.use_record_index,
+                start_cursor=self.start_cursor,
                 sbp=self.sbp,
                 placement=self.placement,
             )
@@ -119,6 +128,8 @@ class OFRecordReader(Module):
                 random_shuffle=self.random_shuffle,
                 shuffle_after_epoch=self.shuffle_after_epoch,
                 seed=self.seed,
+                use_record_index=self.use_record_index,
+                start_cursor=self.start_cursor,
                 device=self.device,
             )
         return res
@@ -1032,6 +1043,11 @@ class OneRecReader(Module):
         shuffle_buffer_size (int): shuffle buffer size, default to 1024
         shuffle_after_epoch (bool): if shuffle after each epoch
         verify_example (bool): if verify example, defaults to True
+        use_record_index (bool): read records by position through the ``<file>.idx`` files written by
+            ``oneflow.utils.data.record_index``, shuffle then permutes the whole dataset every epoch
+            with the same seed on every rank, defaults to False
+        start_cursor (int): number of samples this rank already consumed, reading resumes right
+            after them, only used with use_record_index, defaults to 0
         placement (Optional[oneflow._oneflow_internal.placement]): The placement attribute allows you to specify which physical device the output tensor is stored on.
         sbp (Optional[Union[oneflow._oneflow_internal.sbp.sbp, List[oneflow._oneflow_internal.sbp.sbp]]]): When creating a global tensor, specify the SBP of the output tensor.
 
@@ -1076,11 +1092,18 @@ class OneRecReader(Module):
         verify_example: bool = True,
         placement: flow.placement = None,
         sbp: Union[flow.sbp.sbp, List[flow.sbp.sbp]] = None,
+        use_record_index: bool = False,
+        start_cursor: int = 0,
     ):
 
         super().__init__()
 
         _handle_shuffle_args(self, shuffle, random_seed)
+        if use_record_index and random_seed is None:
+            # the permutation must be the same on every rank
+            self.random_seed = -1
+        self.use_record_index = use_record_index
+        self.start_cursor = start_cursor
         _handle_distributed_args(self, None, placement, sbp)
 
         if shuffle_mode not in ["batch", "instance"]:
@@ -1107,6 +1130,8 @@ class OneRecReader(Module):
                 shuffle_after_epoch=self.shuffle_after_epoch,
                 random_seed=self.random_seed,
                 verify_example=self.verify_example,
+                use_record_index=self.use_record_index,
+                start_cursor=self.start_cursor,
                 device=self.device,
             )
         else:
@@ -1120,6 +1145,8 @@ class OneRecReader(Module):
                 shuffle_after_epoch=self.shuffle_after_epoch,
                 random_seed=self.random_seed,
                 verify_example=self.verify_example,
+                use_record_index=self.use_record_index,
+                start_cursor=self.start_cursor,
                 placement=self.placement,
                 sbp=self.sbp,
             )
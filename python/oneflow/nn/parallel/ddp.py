@@ -15,6 +15,7 @@ limitations under the License.
 """
 import warnings
 from collections import OrderedDict
+from typing import Optional
 
 import oneflow as flow
 from oneflow.support.env_var_util import parse_boolean_from_env
@@ -66,14 +67,21 @@ def allreduce_fn(module, param):
 
 
 def DistributedDataParallel(
-    module: "flow.nn.Module", *, broadcast_buffers: bool = True, bucket_size: int = 10
+    module: "flow.nn.Module",
+    *,
+    broadcast_buffers: bool = True,
+    bucket_size: int = 10,
+    bucket_cap_mb: Optional[float] = None,
 ):
+    # If bucket_cap_mb is set, grads are bucketed by the native reducer into flat buckets of at
+    # most bucket_cap_mb megabytes, instead of bucket_size parameters per bucket in python hooks.
     assert all(x.dtype == flow.float32 for x in module.parameters())
     if parse_boolean_from_env("ONEFLOW_DISABLE_VIEW", False):
         warnings.warn(
             "because the environment variable 'ONEFLOW_DISABLE_VIEW' is set to true, so the view mechanism is disabled, and we will set bucket_size = 1"
         )
         bucket_size = 1
+        bucket_cap_mb = None
     world_size = flow.env.get_world_size()
     with flow.no_grad():
         for x in module.parameters():
@@ -119,6 +127,15 @@ def DistributedDataParallel(
         for i in range(0, len(reversed_param_list), bucket_size)
     ]
 
+    module._reducer = None
+    if bucket_cap_mb is not None:
+        module._reducer = flow._oneflow_internal.autograd.Reducer(
+            convert_to_tensor_tuple(reversed_param_list[::-1]),
+            int(bucket_cap_mb * 1024 * 1024),
+            1 / world_size,
+        )
+        module._buckets = []
+
     bucket_elems = 0
     module._bucket_tensors = []
     for b in module._buckets:
@@ -144,7 +161,7 @@ def DistributedDataParallel(
         return None
 
     for param in module.parameters():
-        if param.requires_grad:
+        if param.requires_grad and module._reducer is None:
             param.register_hook(grad_setting_fn(module, param))
             param._register_post_grad_accumulation_hook(inplace_mul_and_return_none)
             param._register_post_grad_accumulation_hook(allreduce_fn(module, param))
@@ -153,6 +170,8 @@ def DistributedDataParallel(
         ddp_state_for_reversed_params = module._ddp_state_for_reversed_params
         for state in ddp_state_for_reversed_params.values():
             state[0], state[1] = False, False
+        if module._reducer is not None:
+            module._reducer.prepare_for_backward()
         if isinstance(output, (tuple, list)):
             if isinstance(output[0], dict):
                 # For List[Dict[Tensor]] return type.
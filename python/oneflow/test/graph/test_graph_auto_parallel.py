@@ -0,0 +1,104 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+class _MLP(flow.nn.Module):
+    def __init__(self):
+        super().__init__()
+        self.fc1 = flow.nn.Linear(32, 64)
+        self.fc2 = flow.nn.Linear(64, 64)
+        self.fc3 = flow.nn.Linear(64, 8)
+
+    def forward(self, x):
+        h = flow.relu(self.fc1(x))
+        h = h + flow.relu(self.fc2(h))
+        return self.fc3(h)
+
+
+def _run_graph(placement, param_sbp, input_sbp, auto_parallel):
+    flow.manual_seed(0)
+    model = _MLP().to_global(placement=placement, sbp=param_sbp)
+    optimizer = flow.optim.SGD(model.parameters(), lr=0.1)
+
+    class AutoParallelGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.add_optimizer(optimizer)
+            self.config.enable_auto_parallel(auto_parallel)
+
+        def build(self, x):
+            loss = self.model(x).square().mean()
+            loss.backward()
+            return loss
+
+    graph = AutoParallelGraph()
+    x = flow.tensor(
+        np.random.RandomState(0).rand(16, 32).astype(np.float32),
+        placement=placement,
+        sbp=input_sbp,
+    )
+    losses = []
+    for _ in range(4):
+        loss = graph(x).to_global(sbp=[flow.sbp.broadcast] * len(param_sbp))
+        losses.append(loss.to_local().numpy())
+    return losses
+
+
+def _test_auto_parallel(test_case, placement, param_sbp, input_sbp):
+    expect = _run_graph(placement, param_sbp, input_sbp, auto_parallel=False)
+    losses = _run_graph(placement, param_sbp, input_sbp, auto_parallel=True)
+    test_case.assertTrue(np.allclose(losses, expect, rtol=1e-4, atol=1e-4))
+
+
+@flow.unittest.skip_unless_1n2d()
+class TestGraphAutoParallel1D(flow.unittest.TestCase):
+    def test_data_parallel(test_case):
+        _test_auto_parallel(
+            test_case,
+            flow.placement("cpu", ranks=[0, 1]),
+            [flow.sbp.broadcast],
+            [flow.sbp.split(0)],
+        )
+
+    def test_broadcast_input(test_case):
+        _test_auto_parallel(
+            test_case,
+            flow.placement("cpu", ranks=[0, 1]),
+            [flow.sbp.broadcast],
+            [flow.sbp.broadcast],
+        )
+
+
+@flow.unittest.skip_unless_1n4d()
+class TestGraphAutoParallel2D(flow.unittest.TestCase):
+    def test_hybrid_parallel(test_case):
+        _test_auto_parallel(
+            test_case,
+            flow.placement("cpu", ranks=[[0, 1], [2, 3]]),
+            [flow.sbp.broadcast, flow.sbp.broadcast],
+            [flow.sbp.split(0), flow.sbp.broadcast],
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,104 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+_PARALLEL_BUILD_ENV = "ONEFLOW_ENABLE_PARALLEL_TASK_GRAPH_BUILD"
+
+
+class _WideBlock(flow.nn.Module):
+    def __init__(self, hidden, branch_num):
+        super().__init__()
+        self.branches = flow.nn.ModuleList(
+            [flow.nn.Linear(hidden, hidden) for _ in range(branch_num)]
+        )
+
+    def forward(self, x):
+        out = None
+        for branch in self.branches:
+            y = flow.relu(branch(x))
+            out = y if out is None else out + y
+        return out
+
+
+class _SyntheticModel(flow.nn.Module):
+    def __init__(self, hidden, depth, branch_num):
+        super().__init__()
+        self.blocks = flow.nn.Sequential(
+            *[_WideBlock(hidden, branch_num) for _ in range(depth)]
+        )
+
+    def forward(self, x):
+        return self.blocks(x).sum()
+
+
+class _TrainGraph(flow.nn.Graph):
+    def __init__(self, model, optimizer):
+        super().__init__()
+        self.model = model
+        self.add_optimizer(optimizer)
+
+    def build(self, x):
+        loss = self.model(x)
+        loss.backward()
+        return loss
+
+
+def _train(parallel_build, state_dict, x, hidden, depth, branch_num):
+    # The task graph is built when the graph is compiled, i.e. on its first call.
+    old_value = os.environ.get(_PARALLEL_BUILD_ENV)
+    os.environ[_PARALLEL_BUILD_ENV] = "1" if parallel_build else "0"
+    try:
+        model = _SyntheticModel(hidden, depth, branch_num)
+        model.load_state_dict(state_dict)
+        optimizer = flow.optim.SGD(model.parameters(), lr=0.01)
+        graph = _TrainGraph(model, optimizer)
+        losses = [graph(x).numpy() for _ in range(3)]
+    finally:
+        if old_value is None:
+            del os.environ[_PARALLEL_BUILD_ENV]
+        else:
+            os.environ[_PARALLEL_BUILD_ENV] = old_value
+    return losses, model.state_dict()
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphParallelTaskGraphBuild(oneflow.unittest.TestCase):
+    def test_same_as_serial_build(test_case):
+        hidden, depth, branch_num = 16, 8, 4
+        state_dict = _SyntheticModel(hidden, depth, branch_num).state_dict()
+        x = flow.randn(4, hidden)
+        serial_losses, serial_state_dict = _train(
+            False, state_dict, x, hidden, depth, branch_num
+        )
+        parallel_losses, parallel_state_dict = _train(
+            True, state_dict, x, hidden, depth, branch_num
+        )
+        for serial_loss, parallel_loss in zip(serial_losses, parallel_losses):
+            test_case.assertTrue(np.array_equal(serial_loss, parallel_loss))
+        for key, value in serial_state_dict.items():
+            test_case.assertTrue(
+                np.array_equal(value.numpy(), parallel_state_dict[key].numpy())
+            )
+
+
+if __name__ == "__main__":
+    unittest.main()
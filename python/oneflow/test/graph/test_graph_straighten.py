@@ -0,0 +1,82 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+class _BranchyModel(flow.nn.Module):
+    def __init__(self):
+        super().__init__()
+        self.branches = flow.nn.ModuleList([flow.nn.Linear(64, 256) for _ in range(4)])
+        self.head = flow.nn.Linear(256, 8)
+
+    def forward(self, x):
+        y = sum(flow.relu(branch(x)) for branch in self.branches)
+        return self.head(y)
+
+
+def _run_graph(test_case, device, **straighten_kwargs):
+    flow.manual_seed(0)
+    model = _BranchyModel().to(device)
+    optimizer = flow.optim.SGD(model.parameters(), lr=0.01)
+
+    class StraightenGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.add_optimizer(optimizer)
+            self.config.enable_straighten_algorithm(**straighten_kwargs)
+
+        def build(self, x):
+            loss = self.model(x).sum()
+            loss.backward()
+            return loss
+
+    graph = StraightenGraph()
+    x = flow.tensor(
+        np.random.RandomState(0).rand(16, 64).astype(np.float32), device=device
+    )
+    return [graph(x).numpy() for _ in range(3)]
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphStraighten(flow.unittest.TestCase):
+    def test_compress_memory(test_case):
+        for device in ["cpu", "cuda"]:
+            if device == "cuda" and not flow.cuda.is_available():
+                continue
+            expect = _run_graph(test_case, device, mode=False)
+            for memory_weight in [1.0, 0.5, 0.0]:
+                losses = _run_graph(
+                    test_case,
+                    device,
+                    mode=True,
+                    objective="memory",
+                    memory_weight=memory_weight,
+                )
+                test_case.assertTrue(np.allclose(losses, expect, rtol=1e-4, atol=1e-4))
+
+    def test_invalid_memory_weight(test_case):
+        with test_case.assertRaises(AssertionError):
+            _run_graph(test_case, "cpu", objective="memory", memory_weight=2.0)
+
+
+if __name__ == "__main__":
+    unittest.main()
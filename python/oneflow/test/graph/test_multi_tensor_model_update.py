@@ -0,0 +1,130 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+from collections import OrderedDict
+import numpy as np
+import os
+
+from test_util import GenArgList
+
+import oneflow as flow
+
+
+def compare_with_numpy(
+    test_case, device, optimizer, shapes, learning_rate, weight_decay, train_iters
+):
+    os.environ["ONEFLOW_ENABLE_MULTI_TENSOR_MODEL_UPDATE"] = "1"
+    init_values = [np.random.uniform(size=shape).astype(np.float32) for shape in shapes]
+    masks = [
+        [np.random.uniform(size=shape).astype(np.float32) for shape in shapes]
+        for _ in range(train_iters)
+    ]
+
+    class CustomModule(flow.nn.Module):
+        def __init__(self):
+            super().__init__()
+            self.params = flow.nn.ParameterList(
+                [
+                    flow.nn.Parameter(flow.tensor(value, device=flow.device(device)))
+                    for value in init_values
+                ]
+            )
+
+        def forward(self, mask_list):
+            out = 0
+            for param, mask in zip(self.params, mask_list):
+                out += flow.sum(param * mask)
+            return out
+
+    module = CustomModule()
+    if optimizer == "sgd":
+        of_optimizer = flow.optim.SGD(
+            module.parameters(), lr=learning_rate, weight_decay=weight_decay
+        )
+    else:
+        of_optimizer = flow.optim.Adam(
+            module.parameters(),
+            lr=learning_rate,
+            betas=(0.9, 0.999),
+            eps=1e-8,
+            weight_decay=weight_decay,
+            do_bias_correction=True,
+        )
+
+    class CustomGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.m = module
+            self.add_optimizer(of_optimizer)
+            self.config.allow_fuse_model_update_ops(True)
+
+        def build(self, mask_list):
+            loss = self.m(mask_list)
+            loss.backward()
+            return loss
+
+    graph = CustomGraph()
+    for i in range(train_iters):
+        graph(
+            [
+                flow.tensor(mask, dtype=flow.float32, device=flow.device(device))
+                for mask in masks[i]
+            ]
+        )
+    os.environ["ONEFLOW_ENABLE_MULTI_TENSOR_MODEL_UPDATE"] = "0"
+
+    xs = [value.copy() for value in init_values]
+    ms = [np.zeros_like(value) for value in init_values]
+    vs = [np.zeros_like(value) for value in init_values]
+    for i in range(train_iters):
+        for j in range(len(shapes)):
+            grad = masks[i][j]
+            if optimizer == "sgd":
+                xs[j] = xs[j] - learning_rate * (grad + weight_decay * xs[j])
+            else:
+                ms[j] = 0.9 * ms[j] + 0.1 * grad
+                vs[j] = 0.999 * vs[j] + 0.001 * grad * grad
+                bias_correction1 = 1 - 0.9 ** (i + 1)
+                bias_correction2 = 1 - 0.999 ** (i + 1)
+                denom = np.sqrt(vs[j]) / np.sqrt(bias_correction2) + 1e-8
+                xs[j] = (
+                    xs[j]
+                    - learning_rate / bias_correction1 * ms[j] / denom
+                    - learning_rate * weight_decay * xs[j]
+                )
+    for param, x in zip(module.params, xs):
+        test_case.assertTrue(np.allclose(param.numpy(), x, rtol=1e-4, atol=1e-4))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestMultiTensorModelUpdate(flow.unittest.TestCase):
+    def test_multi_tensor_model_update(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu"]
+        if not os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+            arg_dict["device"].append("cuda")
+        arg_dict["optimizer"] = ["sgd", "adam"]
+        # more tensors than a launch of the kernel takes, and a large one
+        arg_dict["shapes"] = [[(4, 4), (3,), (100, 500)] * 12]
+        arg_dict["learning_rate"] = [1e-3]
+        arg_dict["weight_decay"] = [0.0, 1e-2]
+        arg_dict["train_iters"] = [5]
+        for arg in GenArgList(arg_dict):
+            compare_with_numpy(test_case, *arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
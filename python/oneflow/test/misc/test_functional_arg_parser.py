@@ -0,0 +1,84 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import logging
+import os
+import timeit
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+_CALL_NUM = 20000
+
+
+def _us_per_call(stmt, **names):
+    seconds = min(timeit.repeat(stmt, globals=names, number=_CALL_NUM, repeat=5))
+    return seconds / _CALL_NUM * 1e6
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFunctionalArgParser(flow.unittest.TestCase):
+    def test_keyword_arguments(test_case):
+        x = flow.tensor(np.arange(6, dtype=np.float32).reshape(2, 3))
+        expect = np.array([[3.0], [12.0]], dtype=np.float32)
+        y = flow._C.reduce_sum(x, dim=[1], keepdim=True)
+        test_case.assertTrue(np.array_equal(y.numpy(), expect))
+        # keywords which are not interned are compared by value
+        kwargs = {"".join(["keep", "dim"]): True, "".join(["di", "m"]): [1]}
+        y = flow._C.reduce_sum(x, **kwargs)
+        test_case.assertTrue(np.array_equal(y.numpy(), expect))
+        y = flow._C.reduce_sum(x=x, dim=[1])
+        test_case.assertTrue(np.array_equal(y.numpy(), expect.reshape(2)))
+
+    def test_positional_arguments_as_list(test_case):
+        y = flow._C.empty(2, 3, dtype=flow.float32)
+        test_case.assertEqual(y.shape, (2, 3))
+        y = flow._C.empty((4, 5), dtype=flow.float32)
+        test_case.assertEqual(y.shape, (4, 5))
+
+    def test_invalid_keyword_arguments(test_case):
+        x = flow.ones(2, 3)
+        with test_case.assertRaises(TypeError) as context:
+            flow._C.relu(x, bogus=True)
+        test_case.assertTrue(
+            "unexpected keyword argument 'bogus'" in str(context.exception)
+        )
+        with test_case.assertRaises(TypeError) as context:
+            flow._C.relu(x, x=x)
+        test_case.assertTrue(
+            "multiple values for argument 'x'" in str(context.exception)
+        )
+
+    @unittest.skipUnless(
+        os.getenv("ONEFLOW_TEST_BENCHMARK"), "set ONEFLOW_TEST_BENCHMARK=1 to run"
+    )
+    def test_call_overhead(test_case):
+        x = flow.ones(2, 3)
+        y = flow.ones(2, 3)
+        for name, stmt in [
+            ("positional", "flow._C.add(x, y)"),
+            ("keywords", "flow._C.reduce_sum(x, dim=[1], keepdim=True)"),
+            ("defaults", "flow._C.relu(x)"),
+            ("positional list", "flow._C.empty(2, 3, dtype=flow.float32)"),
+        ]:
+            us = _us_per_call(stmt, flow=flow, x=x, y=y)
+            logging.getLogger(__name__).info("%s: %.2f us per call", name, us)
+
+
+if __name__ == "__main__":
+    unittest.main()
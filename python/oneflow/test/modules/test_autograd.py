@@ -14,6 +14,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 
+import os
+import subprocess
+import sys
 import unittest
 from collections import OrderedDict
 
@@ -149,6 +152,60 @@ class TestAutograd(flow.unittest.TestCase):
             z.sum().backward()
         return (x.grad, y.grad)
 
+    def _test_backward_plan_reuse(test_case):
+        np_x = np.random.rand(4, 5).astype(np.float32)
+        np_y = np.random.rand(4, 5).astype(np.float32)
+        for _ in range(3):
+            x = flow.tensor(np_x, requires_grad=True)
+            y = flow.tensor(np_y, requires_grad=True)
+            # independent branches which join again, y is used twice
+            branches = [x * 2, x.exp(), x * y, y * y]
+            out = branches[0] * branches[1] + branches[2] - branches[3]
+            out.sum().backward()
+            test_case.assertTrue(
+                np.allclose(
+                    x.grad.numpy(),
+                    2 * np.exp(np_x) + 2 * np_x * np.exp(np_x) + np_y,
+                    1e-4,
+                    1e-4,
+                )
+            )
+            test_case.assertTrue(
+                np.allclose(y.grad.numpy(), np_x - 2 * np_y, 1e-4, 1e-4)
+            )
+
+            x = flow.tensor(np_x, requires_grad=True)
+            y = flow.tensor(np_y, requires_grad=True)
+            out = (x * 2).exp() + y * y
+            (x_grad,) = flow.autograd.grad(out.sum(), x)
+            test_case.assertTrue(
+                np.allclose(x_grad.numpy(), 2 * np.exp(2 * np_x), 1e-4, 1e-4)
+            )
+            test_case.assertIsNone(y.grad)
+
+    def test_backward_plan_reuse(test_case):
+        test_case._test_backward_plan_reuse()
+
+    def test_backward_plan_reuse_with_envs(test_case):
+        # the plan cache size and the concurrent branches are read once per process
+        for cache_size in ["0", "16"]:
+            for concurrent in ["0", "1"]:
+                env = dict(os.environ)
+                env["ONEFLOW_AUTOGRAD_PLAN_CACHE_SIZE"] = cache_size
+                env["ONEFLOW_AUTOGRAD_ENABLE_CONCURRENT_BRANCHES"] = concurrent
+                result = subprocess.run(
+                    [
+                        sys.executable,
+                        os.path.abspath(__file__),
+                        "TestAutograd.test_backward_plan_reuse",
+                    ],
+                    env=env,
+                    stdout=subprocess.PIPE,
+                    stderr=subprocess.STDOUT,
+                    universal_newlines=True,
+                )
+                test_case.assertEqual(result.returncode, 0, result.stdout)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -447,6 +447,131 @@ def _test_bn_relu_eval(test_case, device, batch, channel, height, width):
     )
 
 
+def _np_bn_add_relu(x, addend, mean, var, weight, bias, axis, eps):
+    shape = [1] * x.ndim
+    shape[axis] = x.shape[axis]
+    y = (x - mean.reshape(shape)) / np.sqrt(var.reshape(shape) + eps)
+    y = y * weight.reshape(shape) + bias.reshape(shape)
+    if addend is not None:
+        y = y + addend
+    return np.maximum(y, 0)
+
+
+def _test_bn_add_relu_cpu(test_case, shape, axis, with_addend, is_training):
+    channel = shape[axis]
+    x = np.random.randn(*shape).astype(np.float32)
+    addend = np.random.randn(*shape).astype(np.float32) if with_addend else None
+    weight = np.random.randn(channel).astype(np.float32)
+    bias = np.random.randn(channel).astype(np.float32)
+    running_mean = np.random.randn(channel).astype(np.float32)
+    running_var = np.random.uniform(0.5, 1.5, channel).astype(np.float32)
+    moving_mean = flow.tensor(running_mean)
+    moving_variance = flow.tensor(running_var)
+    with flow.no_grad():
+        out = flow._C.normalization_add_relu(
+            flow.tensor(x),
+            flow.tensor(addend) if with_addend else None,
+            moving_mean,
+            moving_variance,
+            flow.tensor(weight),
+            flow.tensor(bias),
+            axis=axis,
+            epsilon=1e-5,
+            momentum=0.1,
+            is_training=is_training,
+        )
+    reduce_axes = tuple(i for i in range(len(shape)) if i != axis)
+    if is_training:
+        mean = x.mean(axis=reduce_axes)
+        var = x.var(axis=reduce_axes)
+        count = x.size // channel
+        expected_moving_mean = running_mean * 0.9 + mean * 0.1
+        expected_moving_var = running_var * 0.9 + var * count / (count - 1) * 0.1
+    else:
+        mean = running_mean
+        var = running_var
+        expected_moving_mean = running_mean
+        expected_moving_var = running_var
+    expected = _np_bn_add_relu(x, addend, mean, var, weight, bias, axis, 1e-5)
+    test_case.assertTrue(np.allclose(out.numpy(), expected, atol=1e-4, rtol=1e-4))
+    test_case.assertTrue(
+        np.allclose(moving_mean.numpy(), expected_moving_mean, atol=1e-4, rtol=1e-4)
+    )
+    test_case.assertTrue(
+        np.allclose(moving_variance.numpy(), expected_moving_var, atol=1e-4, rtol=1e-4)
+    )
+
+
+def _test_bn_add_relu_cpu_grad(test_case, shape, axis):
+    channel = shape[axis]
+    x = np.random.randn(*shape).astype(np.float32)
+    addend = np.random.randn(*shape).astype(np.float32)
+    weight = np.random.randn(channel).astype(np.float32)
+    bias = np.random.randn(channel).astype(np.float32)
+    dy = np.random.randn(*shape).astype(np.float32)
+
+    def run(fused):
+        inputs = [
+            flow.tensor(value, requires_grad=True)
+            for value in (x, addend, weight, bias)
+        ]
+        moving_mean = flow.zeros(channel)
+        moving_variance = flow.ones(channel)
+        if fused:
+            out = flow._C.normalization_add_relu(
+                inputs[0],
+                inputs[1],
+                moving_mean,
+                moving_variance,
+                inputs[2],
+                inputs[3],
+                axis=axis,
+                epsilon=1e-5,
+                momentum=0.1,
+                is_training=True,
+            )
+        else:
+            out = flow._C.normalization(
+                inputs[0],
+                moving_mean,
+                moving_variance,
+                inputs[2],
+                inputs[3],
+                axis=axis,
+                epsilon=1e-5,
+                momentum=0.1,
+                is_training=True,
+            )
+            out = flow.relu(out + inputs[1])
+        (out * flow.tensor(dy)).sum().backward()
+        return [out.numpy()] + [tensor.grad.numpy() for tensor in inputs]
+
+    for fused_result, origin_result in zip(run(True), run(False)):
+        test_case.assertTrue(
+            np.allclose(fused_result, origin_result, atol=1e-4, rtol=1e-4)
+        )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestBnAddReluCpu(flow.unittest.TestCase):
+    def test_bn_add_relu_cpu(test_case):
+        arg_dict = OrderedDict()
+        # channels first, channels last and a large plane
+        arg_dict["shape_and_axis"] = [
+            ((2, 6, 5, 7), 1),
+            ((2, 5, 7, 6), 3),
+            ((1, 2, 200, 200), 1),
+        ]
+        arg_dict["with_addend"] = [True, False]
+        arg_dict["is_training"] = [True, False]
+        for arg in GenArgList(arg_dict):
+            _test_bn_add_relu_cpu(test_case, *arg[0], *arg[1:])
+
+    def test_bn_add_relu_cpu_grad(test_case):
+        for shape, axis in [((2, 6, 5, 7), 1), ((2, 5, 7, 6), 3)]:
+            _test_bn_add_relu_cpu_grad(test_case, shape, axis)
+
+
 @flow.unittest.skip_unless_1n1d()
 @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test gpu cases")
 class TestBnAddRelu(flow.unittest.TestCase):
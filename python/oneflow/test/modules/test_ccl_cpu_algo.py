@@ -0,0 +1,104 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import unittest
+
+import oneflow as flow
+import oneflow.unittest
+
+# The cpu collective algorithm (ONEFLOW_CCL_CPU_ALGO) is read once per process, so every
+# algorithm runs in 4 processes of its own. A chunk size of 4KB makes the larger sizes
+# go through the pipelined ring in several chunks.
+
+_WORLD_SIZE = 4
+_ALGOS = ["ring", "recursive_doubling", "tree", "shm", "auto"]
+
+_SCRIPT = """
+import numpy as np
+
+import oneflow as flow
+
+rank = flow.env.get_rank()
+world_size = flow.env.get_world_size()
+placement = flow.placement("cpu", ranks=list(range(world_size)))
+cases = [
+    ("all_reduce", flow.sbp.partial_sum, flow.sbp.broadcast,
+     lambda arrs: np.sum(arrs, axis=0)),
+    ("reduce_scatter", flow.sbp.partial_sum, flow.sbp.split(0),
+     lambda arrs: np.array_split(np.sum(arrs, axis=0), world_size)[rank]),
+    ("all_gather", flow.sbp.split(0), flow.sbp.broadcast,
+     lambda arrs: np.concatenate(arrs)),
+]
+for size in [7, 1 << 8, (1 << 14) + 3]:
+    arrs = [
+        np.random.RandomState(i).rand(size).astype(np.float32)
+        for i in range(world_size)
+    ]
+    local = flow.tensor(arrs[rank])
+    for name, src_sbp, dst_sbp, expect in cases:
+        x = local.to_global(placement=placement, sbp=src_sbp)
+        out = x.to_global(sbp=dst_sbp).to_local().numpy()
+        assert np.allclose(out, expect(arrs), rtol=1e-4, atol=1e-4), (name, size)
+"""
+
+
+def _free_port():
+    with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as sock:
+        sock.bind(("127.0.0.1", 0))
+        return sock.getsockname()[1]
+
+
+def _run(algo, script_path):
+    env = dict(os.environ)
+    env["ONEFLOW_CCL_CPU_ALGO"] = algo
+    env["ONEFLOW_CCL_CPU_CHUNK_SIZE"] = str(4 << 10)
+    result = subprocess.run(
+        [
+            sys.executable,
+            "-m",
+            "oneflow.distributed.launch",
+            "--nproc_per_node",
+            str(_WORLD_SIZE),
+            "--master_port",
+            str(_free_port()),
+            script_path,
+        ],
+        env=env,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.STDOUT,
+        universal_newlines=True,
+    )
+    return result.returncode, result.stdout
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestCclCpuAlgo(flow.unittest.TestCase):
+    def test_collectives(test_case):
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            script_path = os.path.join(tmp_dir, "ccl_cpu_algo.py")
+            with open(script_path, "w") as f:
+                f.write(_SCRIPT)
+            for algo in _ALGOS:
+                returncode, stdout = _run(algo, script_path)
+                test_case.assertEqual(returncode, 0, "{}\n{}".format(algo, stdout))
+
+
+if __name__ == "__main__":
+    unittest.main()
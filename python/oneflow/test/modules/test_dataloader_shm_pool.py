@@ -0,0 +1,84 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+from oneflow.utils.data import DataLoader, Dataset
+
+_SAMPLE_NUM = 64
+_EPOCH_NUM = 3
+
+
+class _ImageDataset(Dataset):
+    def __len__(self):
+        return _SAMPLE_NUM
+
+    def __getitem__(self, index):
+        # several sizes so that the samples go through several size classes
+        shape = (3, 32 * (1 + index % 4), 48)
+        rng = np.random.RandomState(index)
+        return flow.tensor(rng.randint(0, 256, size=shape).astype(np.uint8))
+
+
+def _shm_names():
+    return set(name for name in os.listdir("/dev/shm") if name.startswith("ofshm_"))
+
+
+def _load(use_pool):
+    os.environ["ONEFLOW_DATALOADER_SHM_POOL"] = "1" if use_pool else "0"
+    loader = DataLoader(
+        _ImageDataset(), batch_size=None, num_workers=2, persistent_workers=True,
+    )
+    # the later epochs go through the segments released in the earlier ones
+    epochs = [[image.numpy().copy() for image in loader] for _ in range(_EPOCH_NUM)]
+    del loader
+    return epochs
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestDataLoaderShmPool(flow.unittest.TestCase):
+    def setUp(test_case):
+        test_case.old_env = os.environ.get("ONEFLOW_DATALOADER_SHM_POOL")
+
+    def tearDown(test_case):
+        if test_case.old_env is None:
+            os.environ.pop("ONEFLOW_DATALOADER_SHM_POOL", None)
+        else:
+            os.environ["ONEFLOW_DATALOADER_SHM_POOL"] = test_case.old_env
+
+    def test_same_as_without_pool(test_case):
+        dataset = _ImageDataset()
+        expected = [dataset[i].numpy() for i in range(_SAMPLE_NUM)]
+        for use_pool in [True, False]:
+            epochs = _load(use_pool)
+            test_case.assertEqual(len(epochs), _EPOCH_NUM)
+            for images in epochs:
+                test_case.assertEqual(len(images), _SAMPLE_NUM)
+                for image, expected_image in zip(images, expected):
+                    test_case.assertTrue(np.array_equal(image, expected_image))
+
+    def test_unlink_at_worker_exit(test_case):
+        shm_names = _shm_names()
+        _load(True)
+        test_case.assertEqual(_shm_names() - shm_names, set())
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -105,6 +105,87 @@ class TestDDP(flow.unittest.TestCase):
         for dev_type in test_device:
             test_case._test_ddp_multiple_buckets(dev_type)
 
+    def _test_ddp_native_reducer(test_case, dev_type, reassign_grad):
+        class Mul(flow.nn.Module):
+            def __init__(self):
+                super().__init__()
+                for i in range(10):
+                    self.register_parameter(
+                        f"w{i}", flow.nn.Parameter(flow.Tensor([i % 2 + 1, i % 2 + 1]))
+                    )
+
+            def forward(self, x):
+                for i in range(10):
+                    x = x * getattr(self, f"w{i}")
+                return x
+
+        rank = flow.env.get_rank()
+        if rank == 0:
+            x = flow.Tensor([1, 1])
+        elif rank == 1:
+            x = flow.Tensor([2, 2])
+        else:
+            raise ValueError()
+
+        x = x.to(dev_type)
+        m = Mul().to(dev_type)
+        # every grad takes 512 bytes in a bucket, so each bucket holds 3 of them
+        m = ddp(m, bucket_cap_mb=1536 / 1024 / 1024)
+        test_case.assertEqual(m._reducer.bucket_num, 4)
+
+        for _ in range(2):
+            for i in range(10):
+                # a reassigned grad is not a view of its bucket, the reducer copies it
+                # into the bucket before the all-reduce
+                getattr(m, f"w{i}").grad = (
+                    flow.zeros(2, device=dev_type) if reassign_grad else None
+                )
+            y = m(x)
+            y.sum().backward()
+
+            for i in range(10):
+                test_case.assertTrue(
+                    np_allclose_with_shape(
+                        getattr(m, f"w{i}").grad.numpy(),
+                        np.array([48, 48]) if i % 2 == 0 else np.array([24, 24]),
+                    )
+                )
+
+    def test_ddp_native_reducer(test_case):
+        for dev_type in test_device:
+            test_case._test_ddp_native_reducer(dev_type, reassign_grad=False)
+
+    def test_ddp_native_reducer_with_reassigned_grad(test_case):
+        for dev_type in test_device:
+            test_case._test_ddp_native_reducer(dev_type, reassign_grad=True)
+
+    def _test_ddp_native_reducer_same_as_python_buckets(test_case, dev_type):
+        def train(bucket_cap_mb):
+            flow.manual_seed(0)
+            layers = [flow.nn.Linear(16, 16) for _ in range(6)]
+            model = flow.nn.Sequential(*layers).to(dev_type)
+            model = ddp(model, bucket_size=2, bucket_cap_mb=bucket_cap_mb)
+            optimizer = flow.optim.SGD(model.parameters(), lr=0.1)
+            x = flow.randn(4, 16, generator=generator).to(dev_type)
+            for _ in range(3):
+                optimizer.zero_grad()
+                model(x).sum().backward()
+                optimizer.step()
+            return [param.numpy() for param in model.parameters()]
+
+        generator = flow.Generator()
+        generator.manual_seed(flow.env.get_rank())
+        expected = train(None)
+        # a cap of 1KB puts every param in a bucket of its own, 8KB packs several
+        for bucket_cap_mb in [1 / 1024, 8 / 1024]:
+            generator.manual_seed(flow.env.get_rank())
+            for param, expected_param in zip(train(bucket_cap_mb), expected):
+                test_case.assertTrue(np.allclose(param, expected_param, atol=1e-5))
+
+    def test_ddp_native_reducer_same_as_python_buckets(test_case):
+        for dev_type in test_device:
+            test_case._test_ddp_native_reducer_same_as_python_buckets(dev_type)
+
     def _test_ddp_with_unused_param(test_case, dev_type):
         class Model(flow.nn.Module):
             def __init__(self):
@@ -181,11 +181,12 @@ def do_test_dropout_addend_numpy_fp16_p1(test_case, shape):
 def fixed_cpu_seed_dropout_test(test_case):
     gen1 = flow.Generator()
     gen1.manual_seed(5)
+    # the masks of the Philox stream of the CPU generator
     dropped_array1 = np.array(
         [
-            [0.000000, 0.000000, 1.333333],
             [1.333333, 0.000000, 1.333333],
-            [1.333333, 1.333333, 1.333333],
+            [1.333333, 1.333333, 0.000000],
+            [1.333333, 0.000000, 1.333333],
         ]
     ).astype(np.float32)
     dropout1 = flow.nn.Dropout(p=0.25, generator=gen1)
@@ -198,7 +199,7 @@ def fixed_cpu_seed_dropout_test(test_case):
     gen2.manual_seed(7)
     dropout2 = flow.nn.Dropout(p=0.5, generator=gen2)
     dropped_array2 = np.array(
-        [[0.0, 0.0, 2.0], [0.0, 0.0, 2.0], [2.0, 0.0, 2.0]]
+        [[2.0, 2.0, 0.0], [0.0, 0.0, 2.0], [0.0, 2.0, 0.0]]
     ).astype(np.float32)
     out2 = dropout2(x)
     test_case.assertTrue(
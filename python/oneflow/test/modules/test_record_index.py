@@ -0,0 +1,115 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import struct
+import tempfile
+import unittest
+
+import oneflow as flow
+import oneflow.unittest
+import oneflow.core.record.record_pb2 as record_pb
+from oneflow.utils.data.record_index import build_record_index, record_index_path
+
+_PART_SIZES = [7, 5, 9]
+_RECORD_NUM = sum(_PART_SIZES)
+_BATCH_SIZE = 3
+
+
+def _write_parts(data_dir):
+    record_id = 0
+    paths = []
+    for part, size in enumerate(_PART_SIZES):
+        path = os.path.join(data_dir, "part-{}".format(part))
+        with open(path, "wb") as f:
+            for _ in range(size):
+                record = record_pb.OFRecord()
+                record.feature["id"].int32_list.value.append(record_id)
+                # payloads of different sizes, so offsets can't be guessed from the index
+                record.feature["pad"].bytes_list.value.append(b"x" * (record_id % 5))
+                payload = record.SerializeToString()
+                f.write(struct.pack("<q", len(payload)))
+                f.write(payload)
+                record_id += 1
+        paths.append(path)
+    return paths
+
+
+def _read_ids(data_dir, sample_num, shuffle, start_cursor=0):
+    reader = flow.nn.OFRecordReader(
+        data_dir,
+        batch_size=_BATCH_SIZE,
+        data_part_num=len(_PART_SIZES),
+        random_shuffle=shuffle,
+        random_seed=7,
+        use_record_index=True,
+        start_cursor=start_cursor,
+    )
+    decoder = flow.nn.OFRecordRawDecoder("id", shape=(), dtype=flow.int32)
+    ids = []
+    while len(ids) < sample_num:
+        ids.extend(decoder(reader()).numpy().flatten().tolist())
+    return ids[:sample_num]
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestRecordIndex(flow.unittest.TestCase):
+    def test_index_file(test_case):
+        with tempfile.TemporaryDirectory() as data_dir:
+            paths = _write_parts(data_dir)
+            for path, size in zip(paths, _PART_SIZES):
+                test_case.assertEqual(build_record_index(path), size)
+                with open(record_index_path(path), "rb") as f:
+                    index = f.read()
+                test_case.assertEqual(index[:8], b"OFRIDX01")
+                fmt, _, record_num, data_size = struct.unpack("<iiqq", index[8:32])
+                test_case.assertEqual((fmt, record_num), (0, size))
+                test_case.assertEqual(data_size, os.path.getsize(path))
+                test_case.assertEqual(len(index), 32 + 8 * size)
+
+    def test_sequential_read(test_case):
+        with tempfile.TemporaryDirectory() as data_dir:
+            paths = _write_parts(data_dir)
+            for path in paths[:2]:
+                build_record_index(path)
+            # the last part has no index and is scanned by the reader
+            ids = _read_ids(data_dir, 2 * _RECORD_NUM, shuffle=False)
+            test_case.assertEqual(ids, list(range(_RECORD_NUM)) * 2)
+
+    def test_global_shuffle_and_resume(test_case):
+        with tempfile.TemporaryDirectory() as data_dir:
+            for path in _write_parts(data_dir):
+                build_record_index(path)
+            ids = _read_ids(data_dir, 3 * _RECORD_NUM, shuffle=True)
+            epochs = [
+                ids[i * _RECORD_NUM : (i + 1) * _RECORD_NUM] for i in range(3)
+            ]
+            for epoch in epochs:
+                test_case.assertEqual(sorted(epoch), list(range(_RECORD_NUM)))
+            test_case.assertNotEqual(epochs[0], list(range(_RECORD_NUM)))
+            test_case.assertNotEqual(epochs[0], epochs[1])
+            test_case.assertEqual(
+                ids, _read_ids(data_dir, 3 * _RECORD_NUM, shuffle=True)
+            )
+            # resume in the middle of the second epoch
+            cursor = _RECORD_NUM + 4
+            resumed = _read_ids(
+                data_dir, 2 * _RECORD_NUM - 4, shuffle=True, start_cursor=cursor
+            )
+            test_case.assertEqual(resumed, ids[cursor:])
+
+
+if __name__ == "__main__":
+    unittest.main()
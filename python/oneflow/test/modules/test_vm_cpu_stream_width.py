@@ -0,0 +1,156 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import logging
+import os
+import subprocess
+import sys
+import tempfile
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+# A wide DAG of small eager cpu ops, with in-place updates between its branches,
+# run with the cpu compute stream on 1 or more worker threads
+# (ONEFLOW_VM_CPU_COMPUTE_STREAM_WIDTH). The width is read when the vm starts,
+# so every width runs in a process of its own. The script saves the outputs of
+# every iteration, or with --benchmark the seconds per iteration after a warmup.
+
+_WIDTHS = [1, 2, 4]
+_BRANCH_NUM = 16
+_DEPTH = 4
+_ITER_NUM = 3
+
+_SCRIPT = """
+import sys
+import time
+
+import numpy as np
+
+import oneflow as flow
+
+branch_num, depth, iter_num = int(sys.argv[2]), int(sys.argv[3]), int(sys.argv[4])
+benchmark = "--benchmark" in sys.argv
+rng = np.random.RandomState(0)
+x = flow.tensor(rng.rand(64, 128).astype(np.float32))
+weights = [
+    [flow.tensor(rng.rand(128, 128).astype(np.float32) / 128) for _ in range(depth)]
+    for _ in range(branch_num)
+]
+acc = flow.zeros(64, 1)
+
+
+def run():
+    sums = []
+    for branch in weights:
+        y = x
+        for w in branch:
+            y = flow.relu(flow.matmul(y, w) + y)
+        s = flow.sum(y, dim=1, keepdim=True)
+        acc.add_(s)
+        sums.append(s)
+    sums.append(acc.clone())
+    return flow.cat(sums, dim=1).numpy()
+
+
+if benchmark:
+    run()
+    start = time.perf_counter()
+    for _ in range(iter_num):
+        run()
+    np.save(sys.argv[1], np.array((time.perf_counter() - start) / iter_num))
+else:
+    np.save(sys.argv[1], np.stack([run() for _ in range(iter_num)]))
+"""
+
+
+def _expected():
+    rng = np.random.RandomState(0)
+    x = rng.rand(64, 128).astype(np.float32)
+    weights = [
+        [rng.rand(128, 128).astype(np.float32) / 128 for _ in range(_DEPTH)]
+        for _ in range(_BRANCH_NUM)
+    ]
+    sums = []
+    for branch in weights:
+        y = x
+        for w in branch:
+            y = np.maximum(np.matmul(y, w) + y, 0)
+        sums.append(np.sum(y, axis=1, keepdims=True))
+    acc = np.sum(np.concatenate(sums, axis=1), axis=1, keepdims=True)
+    return np.stack(
+        [np.concatenate(sums + [acc * (i + 1)], axis=1) for i in range(_ITER_NUM)]
+    )
+
+
+def _run(width, out_path, branch_num, depth, iter_num, benchmark=False):
+    env = dict(os.environ)
+    env["ONEFLOW_VM_CPU_COMPUTE_STREAM_WIDTH"] = str(width)
+    args = [out_path, str(branch_num), str(depth), str(iter_num)]
+    if benchmark:
+        args.append("--benchmark")
+    result = subprocess.run(
+        [sys.executable, "-c", _SCRIPT] + args,
+        env=env,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.STDOUT,
+        universal_newlines=True,
+    )
+    return result.returncode, result.stdout
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestVmCpuStreamWidth(flow.unittest.TestCase):
+    def test_wide_dag_same_for_every_width(test_case):
+        expected = _expected()
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            outs = []
+            for width in _WIDTHS:
+                out_path = os.path.join(tmp_dir, "out_{}.npy".format(width))
+                returncode, stdout = _run(
+                    width, out_path, _BRANCH_NUM, _DEPTH, _ITER_NUM
+                )
+                test_case.assertEqual(returncode, 0, stdout)
+                outs.append(np.load(out_path))
+            test_case.assertTrue(np.allclose(outs[0], expected, rtol=1e-4, atol=1e-4))
+            for out in outs[1:]:
+                test_case.assertTrue(np.allclose(out, outs[0], rtol=1e-5, atol=1e-5))
+
+    @unittest.skipUnless(
+        os.getenv("ONEFLOW_TEST_BENCHMARK"), "set ONEFLOW_TEST_BENCHMARK=1 to run"
+    )
+    def test_wide_dag_benchmark(test_case):
+        branch_num, depth, iter_num = 32, 8, 20
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            for width in _WIDTHS:
+                out_path = os.path.join(tmp_dir, "seconds_{}.npy".format(width))
+                returncode, stdout = _run(
+                    width, out_path, branch_num, depth, iter_num, benchmark=True
+                )
+                test_case.assertEqual(returncode, 0, stdout)
+                logging.getLogger(__name__).info(
+                    "cpu compute stream width %d, %d branches of %d ops: %.3f ms",
+                    width,
+                    branch_num,
+                    depth * 3 + 2,
+                    float(np.load(out_path)) * 1000,
+                )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,120 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import argparse
+import os
+import struct
+
+__all__ = ["build_record_index", "record_index_path"]
+
+# Layout of the sidecar, see oneflow/user/data/record_index.h
+_MAGIC = b"OFRIDX01"
+_FORMATS = {"ofrecord": 0, "onerec": 1}
+_ONEREC_MAGIC = 0x24434552454E4F5E
+_ONEREC_HEADER_SIZE = 24
+_ONEREC_FOOTER_SIZE = 8
+_ONEREC_ALIGNMENT = 8
+
+
+def record_index_path(data_path: str) -> str:
+    return data_path + ".idx"
+
+
+def _scan_ofrecord(f, data_size):
+    offsets = []
+    offset = 0
+    while offset < data_size:
+        f.seek(offset)
+        header = f.read(8)
+        if len(header) != 8:
+            raise ValueError("truncated OFRecord at offset {}".format(offset))
+        (size,) = struct.unpack("<q", header)
+        if size <= 0:
+            raise ValueError("bad OFRecord size {} at offset {}".format(size, offset))
+        offsets.append(offset)
+        offset += 8 + size
+    if offset != data_size:
+        raise ValueError("truncated OFRecord at offset {}".format(offsets[-1]))
+    return offsets
+
+
+def _scan_onerec(f, data_size):
+    offsets = []
+    offset = 0
+    while offset < data_size:
+        f.seek(offset)
+        header = f.read(_ONEREC_HEADER_SIZE)
+        if len(header) != _ONEREC_HEADER_SIZE:
+            raise ValueError("truncated OneRec record at offset {}".format(offset))
+        magic, reserved, payload_size = struct.unpack("<qii", header[:16])
+        if magic != _ONEREC_MAGIC or reserved != 0 or payload_size < 0:
+            raise ValueError("bad OneRec record at offset {}".format(offset))
+        padded_size = (
+            (payload_size + _ONEREC_ALIGNMENT - 1) // _ONEREC_ALIGNMENT
+        ) * _ONEREC_ALIGNMENT
+        offsets.append(offset)
+        offset += _ONEREC_HEADER_SIZE + padded_size + _ONEREC_FOOTER_SIZE
+    if offset != data_size:
+        raise ValueError("truncated OneRec record at offset {}".format(offsets[-1]))
+    return offsets
+
+
+def build_record_index(data_path: str, format: str = "ofrecord") -> int:
+    """Writes the record index of an OFRecord or OneRec data part to ``<data_path>.idx``.
+
+    The index lets ``OFRecordReader`` and ``OneRecReader`` with ``use_record_index=True`` read
+    records by position. It has to be rebuilt whenever the data part changes.
+
+    Args:
+        data_path (str): path of the data part
+        format (str): "ofrecord" or "onerec"
+
+    Returns:
+        the number of records in the data part
+    """
+    if format not in _FORMATS:
+        raise ValueError("format should be one of {}".format(list(_FORMATS.keys())))
+    data_size = os.path.getsize(data_path)
+    with open(data_path, "rb") as f:
+        if format == "ofrecord":
+            offsets = _scan_ofrecord(f, data_size)
+        else:
+            offsets = _scan_onerec(f, data_size)
+    index_path = record_index_path(data_path)
+    tmp_path = index_path + ".tmp"
+    with open(tmp_path, "wb") as f:
+        f.write(_MAGIC)
+        f.write(struct.pack("<iiqq", _FORMATS[format], 0, len(offsets), data_size))
+        f.write(struct.pack("<{}q".format(len(offsets)), *offsets))
+    os.replace(tmp_path, index_path)
+    return len(offsets)
+
+
+def _main():
+    parser = argparse.ArgumentParser(
+        description="Write the record index next to OFRecord or OneRec data parts."
+    )
+    parser.add_argument("files", nargs="+", help="data parts to index")
+    parser.add_argument(
+        "--format", choices=list(_FORMATS.keys()), default="ofrecord",
+    )
+    args = parser.parse_args()
+    for path in args.files:
+        record_num = build_record_index(path, args.format)
+        print("{}: {} records".format(record_index_path(path), record_num))
+
+
+if __name__ == "__main__":
+    _main()
@@ -522,7 +522,7 @@ class Generator:
                 )
 
             if len(schema_types) > 0:
-                module_fmt += '    {{"{0}", (PyCFunction)functional::{1}, METH_VARARGS | METH_KEYWORDS, NULL}},\n'.format(
+                module_fmt += '    ONEFLOW_FUNCTIONAL_METHOD_DEF("{0}", functional::{1}, functional::{1}_fastcall),\n'.format(
                     name, name
                 )
 
@@ -531,7 +531,7 @@ class Generator:
                     name
                 )
                 schema_fmt += "\n"
-                schema_fmt += "PyObject* {0}(PyObject* self, PyObject* args, PyObject* kwargs) {{\n".format(
+                schema_fmt += "static PyObject* {0}_impl(const PythonArguments& args) {{\n".format(
                     name
                 )
                 schema_fmt += "  HANDLE_ERRORS\n"
@@ -541,7 +541,7 @@ class Generator:
                     ", ".join(schema_types), name
                 )
                 schema_fmt += "  ParsedArgs<{0}> r;\n".format(max_args_count)
-                schema_fmt += "  int idx = parser.Parse(args, kwargs, &r);\n"
+                schema_fmt += "  int idx = parser.Parse(args, &r);\n"
                 i = 0
                 for block in blocks:
                     signature = block._signature
@@ -558,6 +558,22 @@ class Generator:
                 schema_fmt += "  Py_RETURN_NONE;\n"
                 schema_fmt += "  END_HANDLE_ERRORS\n"
                 schema_fmt += "}\n"
+                schema_fmt += "\n"
+                schema_fmt += "PyObject* {0}(PyObject* self, PyObject* args, PyObject* kwargs) {{\n".format(
+                    name
+                )
+                schema_fmt += "  return {0}_impl(PythonArguments(args, kwargs));\n".format(
+                    name
+                )
+                schema_fmt += "}\n"
+                schema_fmt += "\n"
+                schema_fmt += "static PyObject* {0}_fastcall(PyObject* self, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames) {{\n".format(
+                    name
+                )
+                schema_fmt += "  return {0}_impl(PythonArguments(args, nargs, kwnames));\n".format(
+                    name
+                )
+                schema_fmt += "}\n"
 
         render_file_if_different(
             target_pybind_header_file, pybind_header_fmt.format(header_fmt)